@@ -1,24 +1,21 @@
 #include <iostream>
 #include <cstdlib>
-#include <iterator>
-#include <fstream>
 #include <string>
 #include <vector>
-#include <SDL2/SDL.h>
 
-#include <OpenGL/gl3.h>
-
-using namespace std;
+#include "opengl.h"
+#include "shader_program.h"
+#include "window.h"
 
 GLuint vertex_array_id;
 GLuint vertex_buffer_id;
-GLuint program_id;
+ShaderProgram program;
 
-void Render(SDL_Window* window, SDL_GLContext* gl_context) {
+void Render() {
   glClearColor(0.f, 0.f, 0.f, 1.f);
   glClear(GL_COLOR_BUFFER_BIT);
 
-  glUseProgram(program_id);
+  program.Use();
 
   glBindVertexArray(vertex_array_id);
 
@@ -29,98 +26,23 @@ void Render(SDL_Window* window, SDL_GLContext* gl_context) {
   glDrawArrays(GL_TRIANGLES, 0, 3);
 
   glDisableVertexAttribArray(0);
-  
-  SDL_GL_SwapWindow(window);
 }
 
-bool CompileShader(GLuint shader_id, const std::string& path) {
-  std::ifstream shader_fin(path);
-  std::string shader_source =
-    std::string(std::istreambuf_iterator<char>(shader_fin),
-                std::istreambuf_iterator<char>());
-
-  const char* shader_source_ptr = shader_source.c_str();
-  glShaderSource(shader_id, 1, &shader_source_ptr, NULL);
-  glCompileShader(shader_id);
-
-  GLint result;
-  GLint infolog_length;
-  glGetShaderiv(shader_id, GL_COMPILE_STATUS, &result);
-  glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &infolog_length);
-
-  if (infolog_length > 0) {
-    std::vector<char> infolog_buf(infolog_length);
-    glGetShaderInfoLog(shader_id, infolog_length, NULL, &infolog_buf[0]);
-    std::cout << &infolog_buf[0] << std::endl;
-  }
-
-  if (result == GL_FALSE) {
-    return false;
-  }
-
-  return true;
-}
-
-int main() {
-   
-  if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) != 0) {
-    SDL_Log("Failed to initialized SDL: %s", SDL_GetError());
+int main(int argc, char* argv[]) {
+  AppWindow window;
+  if (!ParseAppOptions(argc, argv, &window.options)) {
     exit(1);
   }
-
-  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
-
-  // To use GLSL version 330
-  SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK,
-                      SDL_GL_CONTEXT_PROFILE_CORE);
-  
-  SDL_Window* window = SDL_CreateWindow("Hello, World!",
-                                        SDL_WINDOWPOS_UNDEFINED,
-                                        SDL_WINDOWPOS_UNDEFINED,
-                                        1024, // window width
-                                        768, // window height
-                                        SDL_WINDOW_OPENGL);
-
-  SDL_GLContext gl_context = SDL_GL_CreateContext(window);
-  
-  if (gl_context == NULL) {
-    cout << "OpenGL context could not be created: " << SDL_GetError() << endl;
+  if (!CreateAppWindow("Hello, World!", 1024, 768, 3, 3, &window)) {
     exit(1);
   }
 
-  std::cout << "OpenGL Version: " << glGetString(GL_VERSION) << std::endl;
-  std::cout << "GLSL Version: " << glGetString(GL_SHADING_LANGUAGE_VERSION)
-            << std::endl;
-
-  GLuint vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
-  GLuint fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
-
-  CompileShader(vertex_shader_id, "simple.vs");
-  CompileShader(fragment_shader_id, "simple.fs");
-
-  program_id = glCreateProgram();
-  glAttachShader(program_id, vertex_shader_id);
-  glAttachShader(program_id, fragment_shader_id);
-  glLinkProgram(program_id);
-
-  GLint link_result;
-  GLint infolog_length;
-  glGetProgramiv(program_id, GL_LINK_STATUS, &link_result);
-  glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &infolog_length);
-    
-  if (infolog_length > 0) {
-    std::vector<char> infolog(infolog_length);
-    glGetProgramInfoLog(program_id, infolog_length, NULL, &infolog[0]);
-    std::cout << &infolog[0] << std::endl;
-  }
+  program.AttachShader(GL_VERTEX_SHADER, "simple.vs");
+  program.AttachShader(GL_FRAGMENT_SHADER, "simple.fs");
 
-  if (link_result == GL_FALSE) {
+  if (!program.Link()) {
     exit(1);
   }
-  
-  glDeleteShader(vertex_shader_id);
-  glDeleteShader(fragment_shader_id);
 
   glGenVertexArrays(1, &vertex_array_id);
   glBindVertexArray(vertex_array_id);
@@ -135,24 +57,14 @@ int main() {
   glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_id);
   glBufferData(GL_ARRAY_BUFFER, sizeof(vertices),
                static_cast<float*>(vertices), GL_STATIC_DRAW);
-  
 
-  bool should_quit = false;
-  
-  while (!should_quit) {
-    SDL_Event event;
-    while (SDL_PollEvent(&event)) {
-      if (event.type == SDL_QUIT) {
-        should_quit = true;
-      }
-    }
-
-    Render(window, &gl_context);
-  }
+  RunFrameLoop(&window, Render);
+
+  glDeleteBuffers(1, &vertex_buffer_id);
+  glDeleteVertexArrays(1, &vertex_array_id);
+  program.Destroy();
 
-  SDL_GL_DeleteContext(gl_context);
-  SDL_DestroyWindow(window);
-  SDL_Quit();
+  DestroyAppWindow(&window);
 
   return 0;
 }
@@ -1,9 +0,0 @@
-#version 330 core
-
-in vec3 vert_color;
-
-out vec4 frag_color;
-
-void main() {
-     frag_color = vec4(vert_color, 1.0);
-}
\ No newline at end of file
@@ -3,246 +3,239 @@
 #include <string>
 #include <vector>
 #include <algorithm>
-#include <fstream>
-#include <iterator>
 
-#include <SDL2/SDL.h>
-#include <OpenGL/gl3.h>
+#include "opengl.h"
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
-#include "glm/gtc/type_ptr.hpp"
 
+#include "asset_loader.h"
+#include "frame_uniforms.h"
+#include "instancing.h"
+#include "mesh.h"
+#include "mesh_lod.h"
+#include "mesh_optimizer.h"
 #include "model.h"
+#include "shader_program.h"
+#include "uniform_ring.h"
+#include "window.h"
 
-using namespace std;
+// Width of the grid the teapot instances are laid out on
+const float kInstanceGridExtent = 40.f;
+
+// Largest error in pixels of the level of detail drawn with --lod
+const float kLodPixelError = 1.f;
 
 Model teapot_model;
+Mesh teapot_mesh;
+ShaderProgram program;
 
-GLuint program_id;
-GLuint vertex_array_id;
-GLuint position_buffer_id;
-GLuint normal_buffer_id;
+// With --async-load the teapot is loaded on a worker thread and drawn once
+// its buffers are filled
+AssetLoader asset_loader;
+bool teapot_ready = false;
 
-void Render(SDL_Window* window, SDL_GLContext* gl_context) {
-  glClearColor(0.f, 0.f, 0.f, 1.f);
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+FrameUniforms frame_uniforms;
+UniformRing uniform_ring;
+
+// Levels of detail with --lod. lod_distance is the distance from the eye to
+// the nearest teapot, in the teapot model's units.
+std::vector<LodLevel> lod_levels;
+float lod_distance = 0.f;
+unsigned int lod_level = 0;
 
-  glUseProgram(program_id);
+void Render() {
+  uniform_ring.BeginFrame();
+  uniform_ring.Push(kFrameUniformsBinding, frame_uniforms);
 
-  glBindVertexArray(vertex_array_id);
-  glDrawArrays(GL_TRIANGLES, 0, teapot_model.vert_count);
+  glClearColor(0.f, 0.f, 0.f, 1.f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-  glBindVertexArray(0);
+  asset_loader.Update();
+
+  program.Use();
+  if (!teapot_ready) {
+    // Still loading
+  } else if (lod_levels.empty()) {
+    teapot_mesh.Draw();
+  } else {
+    // All instances share the level chosen for the nearest one
+    lod_level = SelectLod(lod_levels, frame_uniforms.proj_mat, 768.f,
+                          lod_distance, kLodPixelError);
+    const LodLevel& level = lod_levels[lod_level];
+    teapot_mesh.DrawFaces(level.first_face, level.face_count);
+  }
   glUseProgram(0);
-  
-  SDL_GL_SwapWindow(window);
+
+  uniform_ring.EndFrame();
 }
 
-// Forward Declarations
-bool CompileShader(GLuint shader_id, const std::string& path);
-bool LinkProgram(GLuint program_id, GLuint vertex_shader_id,
-                 GLuint fragment_shader_id);
+// Distance from the eye to the nearest point of any instance's bounding
+// sphere, divided by the instance's scale
+float NearestInstanceDistance(const Model& model,
+                              const std::vector<InstanceTransform>& instances,
+                              const glm::mat4& view_mat) {
+  glm::vec3 min_pos = model.positions[0];
+  glm::vec3 max_pos = model.positions[0];
+  for (unsigned int v = 1; v < model.vert_count; ++v) {
+    min_pos = glm::min(min_pos, model.positions[v]);
+    max_pos = glm::max(max_pos, model.positions[v]);
+  }
+  glm::vec3 center = 0.5f * (min_pos + max_pos);
+  float radius = 0.5f * glm::length(max_pos - min_pos);
+
+  float nearest = 0.f;
+  for (size_t i = 0; i < instances.size(); ++i) {
+    glm::mat4 model_view_mat = view_mat * instances[i].model_mat;
+    float scale = glm::length(glm::vec3(model_view_mat[0]));
+    glm::vec3 eye_center = glm::vec3(model_view_mat * glm::vec4(center, 1.f));
+    float distance = std::max(glm::length(eye_center) / scale - radius, 0.f);
+    if (i == 0 || distance < nearest) {
+      nearest = distance;
+    }
+  }
+  return nearest;
+}
 
-int main() {
-   
-  if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) != 0) {
-    SDL_Log("Failed to initialized SDL: %s", SDL_GetError());
-    exit(1);
+// Optimizes the model and sets up the levels of detail. Runs on a worker
+// thread with --async-load.
+bool PrepareModel(Model* model,
+                  const std::vector<InstanceTransform>& instances,
+                  const glm::mat4& view_mat, bool lod) {
+  if (!OptimizeMesh(model)) {
+    return false;
   }
+  if (lod && !BuildLodChain(model, LodOptions(), &lod_levels)) {
+    return false;
+  }
+  lod_distance = NearestInstanceDistance(*model, instances, view_mat);
+  return true;
+}
 
-  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+void PrintAssetLoaderStats(const AssetLoaderStats& stats) {
+  const double kMegabyte = 1024.0 * 1024.0;
+  double megabytes = stats.bytes_uploaded / kMegabyte;
+  std::cout << "Async load: " << stats.meshes_ready << " meshes ready after "
+            << stats.ready_ms << " ms, " << megabytes << " MB uploaded in "
+            << stats.upload_frames << " frames taking " << stats.upload_ms
+            << " ms on the GL thread (";
+  if (stats.upload_ms > 0.0) {
+    std::cout << megabytes / (stats.upload_ms / 1000.0) << " MB/s, ";
+  }
+  std::cout << "at most " << stats.max_upload_ms << " ms per frame)"
+            << std::endl;
+}
 
-  // To use GLSL version 330
-  SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK,
-                      SDL_GL_CONTEXT_PROFILE_CORE);
-  
-  SDL_Window* window = SDL_CreateWindow("Hello, World!",
-                                        SDL_WINDOWPOS_UNDEFINED,
-                                        SDL_WINDOWPOS_UNDEFINED,
-                                        1024, // window width
-                                        768, // window height
-                                        SDL_WINDOW_OPENGL);
-
-  SDL_GLContext gl_context = SDL_GL_CreateContext(window);
-  
-  if (gl_context == NULL) {
-    cout << "OpenGL context could not be created: " << SDL_GetError() << endl;
+int main(int argc, char* argv[]) {
+  AppWindow window;
+  if (!ParseAppOptions(argc, argv, &window.options)) {
+    exit(1);
+  }
+  if (!CreateAppWindow("Hello, World!", 1024, 768, 3, 3, &window)) {
     exit(1);
   }
-
-  std::cout << "OpenGL Version: " << glGetString(GL_VERSION) << std::endl;
-  std::cout << "GLSL Version: " << glGetString(GL_SHADING_LANGUAGE_VERSION)
-            << std::endl;
 
   glEnable(GL_DEPTH_TEST);
   glDepthFunc(GL_LESS);
   
   glViewport(0, 0, 1024, 768);
 
-  // Create and compile shaders
-  GLuint vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
-  GLuint fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
-  if (!CompileShader(vertex_shader_id, "lighting.vs")) {
+  // Create and link program
+  ShaderDefines defines = {{"INSTANCING", ""}};
+  if (window.options.per_pixel_lighting) {
+    defines["PER_PIXEL_LIGHTING"] = "";
+  }
+  std::string shader_dir = kShaderLibraryDir;
+  if (!program.AttachShader(GL_VERTEX_SHADER, shader_dir + "/lit.vs",
+                            defines)) {
     std::cerr << "Could not compile vertex shader" << std::endl;
   }
-  if (!CompileShader(fragment_shader_id, "lighting.fs")) {
+  if (!program.AttachShader(GL_FRAGMENT_SHADER, shader_dir + "/lit.fs",
+                            defines)) {
     std::cerr << "Could not compile fragment shader" << std::endl;
   }
-
-  // Create and link program
-  program_id = glCreateProgram();
-  if (!LinkProgram(program_id, vertex_shader_id, fragment_shader_id)) {
+  if (!program.Link()) {
     std::cerr << "Could not link program" << std::endl;
     exit(1);
   }
-  glDeleteShader(vertex_shader_id);
-  glDeleteShader(fragment_shader_id);
-  glUseProgram(program_id);
+  program.BindUniformBlock("FrameUniforms", kFrameUniformsBinding);
 
   // Set uniforms
-  GLint light_position_loc = glGetUniformLocation(program_id,
-                                                  "light_position");
-  glm::vec3 light_position = glm::vec3(0.f, 10.f, 20.f);
-  glUniform3fv(light_position_loc, 1, glm::value_ptr(light_position));
-
-  GLint diffuse_param_loc = glGetUniformLocation(program_id, "diffuse_param");
-  glm::vec3 diffuse_param = glm::vec3(1.f, 1.f, 1.f);
-  glUniform3fv(diffuse_param_loc, 1, glm::value_ptr(diffuse_param));
-
-  GLint ambient_param_loc = glGetUniformLocation(program_id, "ambient_param");
-  glm::vec3 ambient_param = glm::vec3(1.f, 0.f, 0.f);
-  glUniform3fv(ambient_param_loc, 1, glm::value_ptr(ambient_param));
-
-  GLint specular_param_loc = glGetUniformLocation(program_id,
-                                                  "specular_param");
-  glm::vec3 specular_param = glm::vec3(1.f, 1.f, 1.f);
-  glUniform3fv(specular_param_loc, 1, glm::value_ptr(specular_param));
-
-  GLint shininess_loc = glGetUniformLocation(program_id, "shininess");
-  glUniform1f(shininess_loc, 4.f);
-  
-  GLint model_mat_loc = glGetUniformLocation(program_id, "model_mat");
+  frame_uniforms.light_position = glm::vec3(0.f, 10.f, 20.f);
+  frame_uniforms.diffuse_param = glm::vec3(1.f, 1.f, 1.f);
+  frame_uniforms.ambient_param = glm::vec3(1.f, 0.f, 0.f);
+  frame_uniforms.specular_param = glm::vec3(1.f, 1.f, 1.f);
+  frame_uniforms.shininess = 4.f;
+
+  frame_uniforms.view_mat = glm::translate(glm::mat4(1.f),
+                                           glm::vec3(0.f, 0.f, -50.f));
+  frame_uniforms.proj_mat = glm::perspective(45.f, 1024.f / 768.f, 0.1f,
+                                             1000.f);
+
+  if (!uniform_ring.Init(sizeof(FrameUniforms))) {
+    exit(1);
+  }
+
+  // All teapots are drawn with one instanced draw call
   glm::mat4 model_mat = glm::rotate(glm::mat4(1.f), -1.f,
                                     glm::vec3(1.f, 0.f, 0.f));
-  glUniformMatrix4fv(model_mat_loc, 1, GL_FALSE, glm::value_ptr(model_mat));
-  
-  GLint view_mat_loc = glGetUniformLocation(program_id, "view_mat");
-  glm::mat4 view_mat = glm::translate(glm::mat4(1.f),
-                                      glm::vec3(0.f, 0.f, -50.f));
-  glUniformMatrix4fv(view_mat_loc, 1, GL_FALSE, glm::value_ptr(view_mat));
-
-  GLint proj_mat_loc = glGetUniformLocation(program_id, "proj_mat");
-  glm::mat4 proj_mat = glm::perspective(45.f, 1024.f / 768.f, 0.1f, 1000.f);
-  glUniformMatrix4fv(proj_mat_loc, 1, GL_FALSE, glm::value_ptr(proj_mat));
-
-  GLint normal_mat_loc = glGetUniformLocation(program_id, "normal_mat");
-  glm::mat4 normal_mat = glm::transpose(glm::inverse(view_mat * model_mat));
-  glUniformMatrix4fv(normal_mat_loc, 1, GL_FALSE, glm::value_ptr(normal_mat));
-  
-
-  CreateModelFromFile("../assets/teapot.obj", &teapot_model);
-  
-  // Create the position vertex buffer
-  glGenBuffers(1, &position_buffer_id);
-  glBindBuffer(GL_ARRAY_BUFFER, position_buffer_id);
-  glBufferData(GL_ARRAY_BUFFER, 3 * teapot_model.vert_count * sizeof(float),
-               &teapot_model.positions[0][0], GL_STATIC_DRAW);
-
-  // Create the normal vertex buffer
-  glGenBuffers(1, &normal_buffer_id);
-  glBindBuffer(GL_ARRAY_BUFFER, normal_buffer_id);
-  glBufferData(GL_ARRAY_BUFFER, 3 * teapot_model.vert_count * sizeof(float),
-               &teapot_model.normals[0][0], GL_STATIC_DRAW);
-  
-  // Create the vertex array object
-  glGenVertexArrays(1, &vertex_array_id);
-  glBindVertexArray(vertex_array_id);
-
-  // Vertex array specification
-  glBindBuffer(GL_ARRAY_BUFFER, position_buffer_id);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-  glEnableVertexAttribArray(0);
-
-  glBindBuffer(GL_ARRAY_BUFFER, normal_buffer_id);
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-  glEnableVertexAttribArray(1);
-  
-  bool should_quit = false;
-  
-  while (!should_quit) {
-    SDL_Event event;
-    while (SDL_PollEvent(&event)) {
-      if (event.type == SDL_QUIT) {
-        should_quit = true;
+  std::vector<InstanceTransform> instances;
+  CreateInstanceGrid(window.options.instances, kInstanceGridExtent, model_mat,
+                     &instances);
+
+  std::string model_path = window.options.model_path.empty()
+                               ? "../assets/teapot.obj"
+                               : window.options.model_path;
+  glm::mat4 view_mat = frame_uniforms.view_mat;
+  bool lod = window.options.lod;
+  if (window.options.async_load) {
+    if (!asset_loader.Init()) {
+      exit(1);
+    }
+    MeshRequest request;
+    request.path = model_path;
+    request.format = kVertexPacked;
+    request.process = [&instances, view_mat, lod](Model* model) {
+      return PrepareModel(model, instances, view_mat, lod);
+    };
+    request.on_ready = [&instances](bool loaded) {
+      if (!loaded) {
+        exit(1);
       }
+      teapot_mesh.UploadInstances(instances);
+      teapot_ready = true;
+    };
+    asset_loader.LoadMesh(request, &teapot_mesh);
+  } else {
+    if (!CreateModelFromFile(model_path, &teapot_model, true) ||
+        !PrepareModel(&teapot_model, instances, view_mat, lod)) {
+      exit(1);
     }
-
-    Render(window, &gl_context);
+    teapot_mesh.Upload(teapot_model, kMeshPositions | kMeshNormals,
+                       kVertexPacked);
+    teapot_mesh.UploadInstances(instances);
+    teapot_ready = true;
   }
 
-  glDeleteBuffers(1, &position_buffer_id);
-  glDeleteVertexArrays(1, &vertex_array_id);
-  glDeleteProgram(program_id);
+  RunFrameLoop(&window, Render);
 
-  SDL_GL_DeleteContext(gl_context);
-  SDL_DestroyWindow(window);
-  SDL_Quit();
-
-  return 0;
-}                
-
-bool CompileShader(GLuint shader_id, const std::string& path) {
-  std::ifstream shader_fin(path);
-  std::string shader_source =
-    std::string(std::istreambuf_iterator<char>(shader_fin),
-                std::istreambuf_iterator<char>());
-
-  const char* shader_source_ptr = shader_source.c_str();
-  glShaderSource(shader_id, 1, &shader_source_ptr, NULL);
-  glCompileShader(shader_id);
-
-  GLint result;
-  GLint infolog_length;
-  glGetShaderiv(shader_id, GL_COMPILE_STATUS, &result);
-  glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &infolog_length);
-
-  if (infolog_length > 0) {
-    std::vector<char> infolog_buf(infolog_length);
-    glGetShaderInfoLog(shader_id, infolog_length, NULL, &infolog_buf[0]);
-    std::cout << &infolog_buf[0] << std::endl;
+  // Lets a load still in progress finish before its results are read
+  asset_loader.Destroy();
+  if (window.options.async_load) {
+    PrintAssetLoaderStats(asset_loader.stats());
   }
 
-  if (result == GL_FALSE) {
-    return false;
+  if (!lod_levels.empty()) {
+    std::cout << "Level of detail: " << lod_level << " of "
+              << lod_levels.size() << " ("
+              << lod_levels[lod_level].face_count << " faces, error "
+              << lod_levels[lod_level].error << ")" << std::endl;
   }
 
-  return true;
-}
+  teapot_mesh.Destroy();
+  uniform_ring.Destroy();
+  program.Destroy();
 
-bool LinkProgram(GLuint program_id, GLuint vertex_shader_id,
-                 GLuint fragment_shader_id) {
+  DestroyAppWindow(&window);
 
-  // (TODO:) Validate program_id and shaders
-  
-  glAttachShader(program_id, vertex_shader_id);
-  glAttachShader(program_id, fragment_shader_id);
-  glLinkProgram(program_id);
-
-  GLint link_result;
-  GLint infolog_length;
-  glGetProgramiv(program_id, GL_LINK_STATUS, &link_result);
-  glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &infolog_length);
-    
-  if (infolog_length > 0) {
-    std::vector<char> infolog(infolog_length);
-    glGetProgramInfoLog(program_id, infolog_length, NULL, &infolog[0]);
-    std::cout << &infolog[0] << std::endl;
-  }
-
-  if (link_result == GL_FALSE) {
-    return false;
-  }
-
-  return true;
+  return 0;
 }
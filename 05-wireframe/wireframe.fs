@@ -6,36 +6,12 @@ noperspective in vec3 gs_edge_dist;
 
 layout(location = 0) out vec4 fs_color;
 
-uniform struct LineInfo {
-    float width;
-    vec4 color;
-} line_info;
-
-uniform vec3 light_pos;
-uniform vec3 diffuse_param;
-uniform vec3 ambient_param;
-uniform vec3 specular_param;
-uniform float shininess;
-
-uniform mat4 view_mat;
-
-vec3 calc_light(vec3 light_pos, vec3 position, vec3 normal) {
-     vec3 light_unit = normalize(light_pos - position);
-     vec3 normal_unit = normalize(normal);
-     vec3 position_unit = normalize(-position);
-     return (0.1 * ambient_param  +
-             diffuse_param  * max(dot(position_unit, normal_unit), 0.0) +
-             specular_param * pow(max(dot(light_unit, normal_unit), 0.0),
-                            shininess));
-}
+#include "lighting.glsl"
+#include "wireframe.glsl"
 
 void main() {
-     vec3 light_eyepos = (view_mat * vec4(light_pos, 1.0)).xyz;
-     vec3 light_color  = calc_light(light_eyepos, gs_eyepos, gs_normal);
-
-     float d = min(gs_edge_dist.x, gs_edge_dist.y);
-     d = min(d, gs_edge_dist.y);
-     float mix_val = smoothstep(line_info.width - 1, line_info.width + 1, d);
+     vec3 light_color = calc_light(light_eye_position(), gs_eyepos,
+                                   gs_normal);
 
-     fs_color = mix(line_info.color, vec4(light_color, 1.0), mix_val);
+     fs_color = apply_wireframe(vec4(light_color, 1.0), gs_edge_dist);
 }
\ No newline at end of file
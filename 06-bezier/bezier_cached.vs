@@ -0,0 +1,10 @@
+#version 400
+
+// Draws the curve vertices captured by --tess-cache
+layout(location = 0) in vec3 tes_position;
+
+uniform mat4 mvp_mat;
+
+void main() {
+     gl_Position = mvp_mat * vec4(tes_position, 1.0);
+}
\ No newline at end of file
@@ -2,56 +2,82 @@
 #include <cstdlib>
 #include <string>
 #include <vector>
-#include <algorithm>
-#include <fstream>
-#include <iterator>
 
-#include <SDL2/SDL.h>
-#include <OpenGL/gl3.h>
+#include "opengl.h"
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
-#include "glm/gtc/type_ptr.hpp"
 
-// Forward Declarations
-bool CompileShader(GLuint shader_id, const std::string& path);
-bool LinkProgram(GLuint program_id, GLuint vert_shader_id,
-                 GLuint tess_ctl_shader_id, GLuint tess_eval_shader_id,
-                 GLuint geom_shader_id, GLuint frag_shader_id);
+#include "frame_stats.h"
+#include "shader_program.h"
+#include "tess_cache.h"
+#include "window.h"
 
 // Constants
 unsigned int kScreenWidth = 1024;
 unsigned int kScreenHeight = 768;
 
+// Target on-screen length of a tessellated segment with --adaptive-tess
+const float kPixelsPerSegment = 16.f;
+
 // Globals
-GLuint program_id;
+AppWindow window;
+
+ShaderProgram program;
 GLuint vertex_array_id;
 GLuint position_buffer_id;
 
-void Render(SDL_Window* window, SDL_GLContext* gl_context) {
+// Used instead of program with --tess-cache
+ShaderProgram capture_program;
+ShaderProgram cached_program;
+TessCache tess_cache;
+
+void Render() {
   glClearColor(0.f, 0.f, 0.f, 1.f);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-  glUseProgram(program_id);
+  if (window.options.tess_cache) {
+    tess_cache.Draw(cached_program, vertex_array_id, 0, 4);
+  } else {
+    program.Use();
 
-  glBindVertexArray(vertex_array_id);
-  glDrawArrays(GL_PATCHES, 0, 4);
+    glBindVertexArray(vertex_array_id);
+    glDrawArrays(GL_PATCHES, 0, 4);
+    CountDrawCalls();
+  }
 
   glBindVertexArray(0);
   glUseProgram(0);
-  
-  SDL_GL_SwapWindow(window);
+}
+
+// Sets a uniform of the tessellation stages. With --tess-cache it goes
+// through the cache, so that changing it tessellates the curve again.
+template <typename T>
+void SetTessUniform(const std::string& name, const T& value) {
+  if (window.options.tess_cache) {
+    tess_cache.SetUniform(name, value);
+  } else {
+    program.Use();
+    program.SetUniform(name, value);
+  }
+}
+
+void SetControlPoints(const void* data, GLsizeiptr size) {
+  if (window.options.tess_cache) {
+    tess_cache.SetControlPoints(position_buffer_id, data, size);
+  } else {
+    glBindBuffer(GL_ARRAY_BUFFER, position_buffer_id);
+    glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
+  }
 }
 
 void InitShaderVariables() {
+  ShaderProgram& draw_program = window.options.tess_cache ? cached_program
+                                                          : program;
   
   // Set uniforms
-  GLint num_segments_loc = glGetUniformLocation(program_id, "num_segments");
-  glUniform1i(num_segments_loc, 30);
-
-  GLint num_strips_loc = glGetUniformLocation(program_id, "num_strips");
-  glUniform1i(num_strips_loc, 1);
+  SetTessUniform("num_segments", 30);
+  SetTessUniform("num_strips", 1);
   
-  GLint mvp_mat_loc = glGetUniformLocation(program_id, "mvp_mat");
   glm::mat4 model_mat = glm::mat4(1.f);
   glm::mat4 view_mat = glm::translate(glm::mat4(1.f),
                                       glm::vec3(0.f, 0.f, -5.f));
@@ -60,19 +86,33 @@ void InitShaderVariables() {
                                         static_cast<float>(kScreenHeight)
                                         , 0.1f, 1000.f);
   glm::mat4 mvp_mat = proj_mat * view_mat * model_mat;
-  glUniformMatrix4fv(mvp_mat_loc, 1, GL_FALSE, glm::value_ptr(mvp_mat));
-  
-  GLint line_color_loc = glGetUniformLocation(program_id, "line_color");
-  glm::vec4 line_color = glm::vec4(1.f, 0.f, 0.f, 1.f);
-  glUniform4fv(line_color_loc, 1, glm::value_ptr(line_color));
+  SetTessUniform("mvp_mat", mvp_mat);
+
+  float l = 0.f;
+  float r = static_cast<float>(kScreenWidth);
+  float t = 0.f;
+  float b = static_cast<float>(kScreenHeight);
+  float f = 1.f;
+  float n = 0.f;
+  glm::mat4 viewport_mat = {(r-l)/2.f, 0, 0, (r+l)/2.f,
+                            0, (t-b)/2, 0, (t+b)/2.f,
+                            0, 0, (f-n)/2.f, (f+n)/2.f,
+                            0, 0, 0, 1};
+  SetTessUniform("viewport_mat", viewport_mat);
+
+  SetTessUniform("adaptive_tess", window.options.adaptive_tess ? 1 : 0);
+  SetTessUniform("pixels_per_segment", kPixelsPerSegment);
+
+  draw_program.Use();
+  draw_program.SetUniform("mvp_mat", mvp_mat);
+  draw_program.SetUniform("line_color", glm::vec4(1.f, 0.f, 0.f, 1.f));
 
   float pos_data[] = {-1.f, -1.f, -0.8f, 1.f,
                       0.8f, -1.f, 1.f, 1.f};
   
   // Create the position vertex buffer
   glGenBuffers(1, &position_buffer_id);
-  glBindBuffer(GL_ARRAY_BUFFER, position_buffer_id);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(pos_data), pos_data, GL_STATIC_DRAW);
+  SetControlPoints(pos_data, sizeof(pos_data));
   
   // Create the vertex array object
   glGenVertexArrays(1, &vertex_array_id);
@@ -87,7 +127,11 @@ void InitShaderVariables() {
 void DestroyShaderVariables() {
   glDeleteBuffers(1, &position_buffer_id);
   glDeleteVertexArrays(1, &vertex_array_id);
-  glDeleteProgram(program_id);
+  program.Destroy();
+
+  tess_cache.Destroy();
+  capture_program.Destroy();
+  cached_program.Destroy();
 }
 
 void InitGL() {
@@ -99,167 +143,88 @@ void InitGL() {
   glPatchParameteri(GL_PATCH_VERTICES, 4);
 }
 
+// Splits the curve drawing into a program that only tessellates and captures
+// the curve, and one that draws the captured vertices
+void CreateCachedPrograms() {
+  if (!capture_program.AttachShader(GL_VERTEX_SHADER, "bezier.vs") ||
+      !capture_program.AttachShader(GL_TESS_CONTROL_SHADER, "bezier.tcs") ||
+      !capture_program.AttachShader(GL_TESS_EVALUATION_SHADER,
+                                    "bezier.tes")) {
+    std::cerr << "Could not compile capture shaders" << std::endl;
+  }
+  capture_program.SetFeedbackVaryings({"tes_position"});
+  if (!capture_program.Link()) {
+    std::cerr << "Could not link capture program" << std::endl;
+    exit(1);
+  }
+
+  if (!cached_program.AttachShader(GL_VERTEX_SHADER, "bezier_cached.vs") ||
+      !cached_program.AttachShader(GL_FRAGMENT_SHADER, "bezier.fs")) {
+    std::cerr << "Could not compile cached drawing shaders" << std::endl;
+  }
+  if (!cached_program.Link()) {
+    std::cerr << "Could not link cached drawing program" << std::endl;
+    exit(1);
+  }
+
+  // Isolines are captured as line segments
+  if (!tess_cache.Init(&capture_program, GL_LINES, 3)) {
+    exit(1);
+  }
+}
+
 void CreateProgram() {
-  // Create and compile shaders
-  GLuint vert_shader_id = glCreateShader(GL_VERTEX_SHADER);
-  GLuint tess_ctl_shader_id = glCreateShader(GL_TESS_CONTROL_SHADER);
-  GLuint tess_eval_shader_id = glCreateShader(GL_TESS_EVALUATION_SHADER);
-  GLuint frag_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
-  
-  if (!CompileShader(vert_shader_id, "bezier.vs")) {
+  if (window.options.tess_cache) {
+    CreateCachedPrograms();
+    return;
+  }
+
+  if (!program.AttachShader(GL_VERTEX_SHADER, "bezier.vs")) {
     std::cerr << "Could not compile vertex shader" << std::endl;
   }
-  if (!CompileShader(tess_ctl_shader_id, "bezier.tcs")) {
+  if (!program.AttachShader(GL_TESS_CONTROL_SHADER, "bezier.tcs")) {
     std::cerr << "Could not compile tesselation control shader" << std::endl;
   }
-  if (!CompileShader(tess_eval_shader_id, "bezier.tes")) {
+  if (!program.AttachShader(GL_TESS_EVALUATION_SHADER, "bezier.tes")) {
     std::cerr << "Could not compile tesselation evaluation shader"
               << std::endl;
   }
-  if (!CompileShader(frag_shader_id, "bezier.fs")) {
+  if (!program.AttachShader(GL_FRAGMENT_SHADER, "bezier.fs")) {
     std::cerr << "Could not compile fragment shader" << std::endl;
   }
 
-  // Create and link program
-  program_id = glCreateProgram();
-  if (!LinkProgram(program_id, vert_shader_id, tess_ctl_shader_id,
-                   tess_eval_shader_id, 0, frag_shader_id)) {
+  if (!program.Link()) {
     std::cerr << "Could not link program" << std::endl;
     exit(1);
   }
-  glDeleteShader(vert_shader_id);
-  glDeleteShader(tess_ctl_shader_id);
-  glDeleteShader(tess_eval_shader_id);
-  glDeleteShader(frag_shader_id);
-  glUseProgram(program_id);
+  program.Use();
 }
 
 
-int main() {
-   
-  if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) != 0) {
-    SDL_Log("Failed to initialized SDL: %s", SDL_GetError());
+int main(int argc, char* argv[]) {
+  if (!ParseAppOptions(argc, argv, &window.options)) {
     exit(1);
   }
-
-  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
-
-  // To use GLSL version 330
-  SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK,
-                      SDL_GL_CONTEXT_PROFILE_CORE);
-  
-  SDL_Window* window = SDL_CreateWindow("Hello, World!",
-                                        SDL_WINDOWPOS_UNDEFINED,
-                                        SDL_WINDOWPOS_UNDEFINED,
-                                        kScreenWidth, // window width
-                                        kScreenHeight, // window height
-                                        SDL_WINDOW_OPENGL);
-
-  SDL_GLContext gl_context = SDL_GL_CreateContext(window);
-  
-  if (gl_context == NULL) {
-    std::cout << "OpenGL context could not be created: " << SDL_GetError()
-              << std::endl;
+  if (!CreateAppWindow("Hello, World!", kScreenWidth, kScreenHeight, 3, 3,
+                       &window)) {
     exit(1);
   }
 
-  std::cout << "OpenGL Version: " << glGetString(GL_VERSION) << std::endl;
-  std::cout << "GLSL Version: " << glGetString(GL_SHADING_LANGUAGE_VERSION)
-            << std::endl;
-
   InitGL();
 
   CreateProgram();
 
   InitShaderVariables();
   
-  bool should_quit = false;
-  
-  while (!should_quit) {
-    SDL_Event event;
-    while (SDL_PollEvent(&event)) {
-      if (event.type == SDL_QUIT) {
-        should_quit = true;
-      }
-    }
-
-    Render(window, &gl_context);
+  RunFrameLoop(&window, Render);
+
+  if (window.options.tess_cache) {
+    tess_cache.PrintStats();
   }
 
   DestroyShaderVariables();
 
-  SDL_GL_DeleteContext(gl_context);
-  SDL_DestroyWindow(window);
-  SDL_Quit();
+  DestroyAppWindow(&window);
 
   return 0;
-}                
-
-bool CompileShader(GLuint shader_id, const std::string& path) {
-  std::ifstream shader_fin(path);
-  std::string shader_source =
-    std::string(std::istreambuf_iterator<char>(shader_fin),
-                std::istreambuf_iterator<char>());
-
-  const char* shader_source_ptr = shader_source.c_str();
-  glShaderSource(shader_id, 1, &shader_source_ptr, NULL);
-  std::cout << "Compiling shader: " << path << std::endl;
-  glCompileShader(shader_id);
-
-  GLint result;
-  GLint infolog_length;
-  glGetShaderiv(shader_id, GL_COMPILE_STATUS, &result);
-  glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &infolog_length);
-
-  if (infolog_length > 0) {
-    std::vector<char> infolog_buf(infolog_length);
-    glGetShaderInfoLog(shader_id, infolog_length, NULL, &infolog_buf[0]);
-    std::cout << &infolog_buf[0] << std::endl;
-  }
-
-  if (result == GL_FALSE) {
-    return false;
-  }
-
-  return true;
-}
-
-// Shader id should be 0 if unused
-bool LinkProgram(GLuint program_id, GLuint vert_shader_id,
-                 GLuint tess_ctl_shader_id, GLuint tess_eval_shader_id,
-                 GLuint geom_shader_id, GLuint frag_shader_id) {
-
-  // (TODO:) Validate program_id and shaders
-  
-  glAttachShader(program_id, vert_shader_id);
-  glAttachShader(program_id, frag_shader_id);
-  if (geom_shader_id > 0) {
-    glAttachShader(program_id, geom_shader_id);
-  }
-  if (tess_ctl_shader_id > 0) {
-    glAttachShader(program_id, tess_ctl_shader_id);
-  }
-  if (tess_eval_shader_id > 0) {
-    glAttachShader(program_id, tess_eval_shader_id);
-  }
-  
-  glLinkProgram(program_id);
-
-  GLint link_result;
-  GLint infolog_length;
-  glGetProgramiv(program_id, GL_LINK_STATUS, &link_result);
-  glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &infolog_length);
-    
-  if (infolog_length > 0) {
-    std::vector<char> infolog(infolog_length);
-    glGetProgramInfoLog(program_id, infolog_length, NULL, &infolog[0]);
-    std::cout << &infolog[0] << std::endl;
-  }
-
-  if (link_result == GL_FALSE) {
-    return false;
-  }
-
-  return true;
 }
@@ -0,0 +1,10 @@
+#version 400
+
+// Draws the quad triangles captured by --tess-cache
+layout(location = 0) in vec4 tes_position;
+
+uniform mat4 mvp_mat;
+
+void main() {
+     gl_Position = mvp_mat * tes_position;
+}
\ No newline at end of file
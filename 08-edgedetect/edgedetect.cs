@@ -0,0 +1,3 @@
+#version 430
+
+#include "edgedetect_filter.glsl"
@@ -0,0 +1,8 @@
+#version 400
+#extension GL_ARB_compute_shader : require
+#extension GL_ARB_shader_image_load_store : require
+#extension GL_ARB_shading_language_420pack : require
+
+// The filter on contexts older than 4.3 that have the extensions
+
+#include "edgedetect_filter.glsl"
@@ -0,0 +1,74 @@
+// Same filter as edgedetect.fs, one 16x16 tile per work group. The tile and
+// a 1 pixel apron are converted to luma once into shared memory, instead of
+// every pixel fetching and converting its 9 neighbours. Included by
+// edgedetect.cs for GL 4.3 and by edgedetect_arb.cs for the extensions.
+
+layout(local_size_x = 16, local_size_y = 16) in;
+
+layout(rgba8, binding = 0) uniform writeonly image2D edge_image;
+
+uniform sampler2D render_texture;
+
+uniform float edge_threshold;
+
+const int kTileSize = 16;
+const int kApronTileSize = kTileSize + 2;
+
+// Rows of the apron tile, flattened since arrays of arrays need GLSL 4.30
+shared float tile_luma[kApronTileSize * kApronTileSize];
+
+float apron_luma(int x, int y) {
+      return tile_luma[y * kApronTileSize + x];
+}
+
+// Approximates brightness of RGB value
+float luma(vec3 color) {
+      return 0.2126 * color.r + 0.7152 * color.g + 0.0722 * color.b;
+}
+
+void main() {
+     ivec2 size = textureSize(render_texture, 0);
+     ivec2 apron_origin = ivec2(gl_WorkGroupID.xy) * kTileSize - 1;
+
+     // 18x18 texels loaded by 16x16 invocations. Coordinates wrap around
+     // like the GL_REPEAT lookups of the fragment shader.
+     for (int i = int(gl_LocalInvocationIndex);
+          i < kApronTileSize * kApronTileSize;
+          i += kTileSize * kTileSize) {
+          ivec2 local = ivec2(i % kApronTileSize, i / kApronTileSize);
+          ivec2 texel = (apron_origin + local + size) % size;
+          tile_luma[i] = luma(texelFetch(render_texture, texel, 0).rgb);
+     }
+
+     barrier();
+
+     ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+     if (pixel.x >= size.x || pixel.y >= size.y) {
+          return;
+     }
+
+     // Named as in edgedetect.fs: row 0 is the row above (+y), column 0
+     // the column to the left. s22 repeats that shader's upper right fetch.
+     ivec2 c = ivec2(gl_LocalInvocationID.xy) + 1;
+
+     float s00 = apron_luma(c.x - 1, c.y + 1);
+     float s01 = apron_luma(c.x, c.y + 1);
+     float s02 = apron_luma(c.x + 1, c.y + 1);
+     float s10 = apron_luma(c.x - 1, c.y);
+     float s12 = apron_luma(c.x + 1, c.y);
+     float s20 = apron_luma(c.x - 1, c.y - 1);
+     float s21 = apron_luma(c.x, c.y - 1);
+     float s22 = apron_luma(c.x + 1, c.y + 1);
+
+     float sx = s00 + 2 * s10 + s20 - (s02 + 2 * s12 + s22);
+     float sy = s00 + 2 * s01 + s02 - (s20 + 2 * s21 + s22);
+
+     float dist = sx * sx + sy * sy;
+
+     if (dist > edge_threshold) {
+          imageStore(edge_image, pixel, vec4(1.0));
+     }
+     else {
+          imageStore(edge_image, pixel, vec4(0.0, 0.0, 0.0, 1.0));
+     }
+}
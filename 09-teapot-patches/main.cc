@@ -0,0 +1,225 @@
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "opengl.h"
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "frame_stats.h"
+#include "frame_uniforms.h"
+#include "instancing.h"
+#include "mesh.h"
+#include "model.h"
+#include "shader_program.h"
+#include "tessellation.h"
+#include "uniform_ring.h"
+#include "window.h"
+
+// Constants
+unsigned int kScreenWidth = 1024;
+unsigned int kScreenHeight = 768;
+
+// Width of the grid the teapot instances are laid out on
+const float kInstanceGridExtent = 40.f;
+
+// Target on-screen length of a tessellated segment
+const float kPixelsPerSegment = 8.f;
+
+// The patches are in the units of the original teapot, which
+// assets/teapot.obj scales by 5
+const float kTeapotScale = 5.f;
+
+// Globals
+AppWindow window;
+
+std::vector<glm::vec3> control_points;
+Mesh teapot_mesh;
+ShaderProgram program;
+
+FrameUniforms frame_uniforms;
+UniformRing uniform_ring;
+
+void DrawPatches() {
+  program.Use();
+
+  glBindVertexArray(teapot_mesh.vao_id());
+  glDrawArraysInstanced(GL_PATCHES, 0, teapot_mesh.vert_count(),
+                        teapot_mesh.instance_count());
+  CountDrawCalls();
+
+  glBindVertexArray(0);
+  glUseProgram(0);
+}
+
+void Render() {
+  uniform_ring.BeginFrame();
+  uniform_ring.Push(kFrameUniformsBinding, frame_uniforms);
+
+  glClearColor(0.f, 0.f, 0.f, 1.f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+  DrawPatches();
+
+  uniform_ring.EndFrame();
+}
+
+// Number of triangles the tessellator generates for one frame
+GLuint CountTessellatedTriangles(bool cull_patches) {
+  program.Use();
+  program.SetUniform("cull_patches", cull_patches ? 1 : 0);
+
+  GLuint query_id;
+  glGenQueries(1, &query_id);
+
+  uniform_ring.BeginFrame();
+  uniform_ring.Push(kFrameUniformsBinding, frame_uniforms);
+
+  glBeginQuery(GL_PRIMITIVES_GENERATED, query_id);
+  DrawPatches();
+  glEndQuery(GL_PRIMITIVES_GENERATED);
+
+  uniform_ring.EndFrame();
+
+  GLuint triangles = 0;
+  glGetQueryObjectuiv(query_id, GL_QUERY_RESULT, &triangles);
+  glDeleteQueries(1, &query_id);
+
+  return triangles;
+}
+
+// Compares the stored control points with the tessellated triangles they
+// expand to, with and without culling
+void PrintPatchStats() {
+  GLuint culled = CountTessellatedTriangles(true);
+  GLuint unculled = CountTessellatedTriangles(false);
+  program.SetUniform("cull_patches", 1);
+
+  size_t patches = control_points.size() / 16;
+  std::cout << "Patches: " << patches << " (" << control_points.size()
+            << " control points, "
+            << control_points.size() * sizeof(glm::vec3) << " bytes) per "
+            << "teapot, " << teapot_mesh.instance_count() << " teapots"
+            << std::endl;
+  std::cout << "Tessellated triangles: " << culled << " with patch culling, "
+            << unculled << " without" << std::endl;
+}
+
+void InitShaderVariables() {
+  program.BindUniformBlock("FrameUniforms", kFrameUniformsBinding);
+
+  frame_uniforms.light_position = glm::vec3(0.f, 10.f, 20.f);
+  frame_uniforms.diffuse_param = glm::vec3(1.f, 1.f, 1.f);
+  frame_uniforms.ambient_param = glm::vec3(1.f, 0.f, 0.f);
+  frame_uniforms.specular_param = glm::vec3(1.f, 1.f, 1.f);
+  frame_uniforms.shininess = 4.f;
+
+  frame_uniforms.view_mat = glm::translate(glm::mat4(1.f),
+                                           glm::vec3(0.f, 0.f, -50.f));
+  frame_uniforms.proj_mat = glm::perspective(45.f,
+                                             static_cast<float>(kScreenWidth) /
+                                             static_cast<float>(kScreenHeight),
+                                             0.1f, 1000.f);
+
+  if (!uniform_ring.Init(sizeof(FrameUniforms))) {
+    exit(1);
+  }
+
+  float l = 0.f;
+  float r = static_cast<float>(kScreenWidth);
+  float t = 0.f;
+  float b = static_cast<float>(kScreenHeight);
+  float f = 1.f;
+  float n = 0.f;
+  glm::mat4 viewport_mat = {(r-l)/2.f, 0, 0, (r+l)/2.f,
+                            0, (t-b)/2, 0, (t+b)/2.f,
+                            0, 0, (f-n)/2.f, (f+n)/2.f,
+                            0, 0, 0, 1};
+
+  program.Use();
+  program.SetUniform("viewport_mat", viewport_mat);
+  program.SetUniform("pixels_per_segment", kPixelsPerSegment);
+  program.SetUniform("cull_patches", 1);
+
+  // Only the control points are uploaded, the tessellator generates the
+  // surface from them every frame
+  if (!LoadBezierPatches("../assets/teapot.bpt", &control_points)) {
+    exit(1);
+  }
+  Model patch_model;
+  patch_model.positions = control_points;
+  patch_model.vert_count = control_points.size();
+  teapot_mesh.Upload(patch_model, kMeshPositions);
+
+  glm::mat4 model_mat = glm::rotate(glm::mat4(1.f), -1.f,
+                                    glm::vec3(1.f, 0.f, 0.f)) *
+                        glm::scale(glm::mat4(1.f), glm::vec3(kTeapotScale));
+  std::vector<InstanceTransform> instances;
+  CreateInstanceGrid(window.options.instances, kInstanceGridExtent, model_mat,
+                     &instances);
+  teapot_mesh.UploadInstances(instances);
+}
+
+void DestroyShaderVariables() {
+  teapot_mesh.Destroy();
+  uniform_ring.Destroy();
+  program.Destroy();
+}
+
+void InitGL() {
+  glEnable(GL_DEPTH_TEST);
+  glDepthFunc(GL_LESS);
+
+  glViewport(0, 0, kScreenWidth, kScreenHeight);
+
+  glPatchParameteri(GL_PATCH_VERTICES, 16);
+}
+
+void CreateProgram() {
+  if (!program.AttachShader(GL_VERTEX_SHADER, "teapot.vs")) {
+    std::cerr << "Could not compile vertex shader" << std::endl;
+  }
+  if (!program.AttachShader(GL_TESS_CONTROL_SHADER, "teapot.tcs")) {
+    std::cerr << "Could not compile tesselation control shader" << std::endl;
+  }
+  if (!program.AttachShader(GL_TESS_EVALUATION_SHADER, "teapot.tes")) {
+    std::cerr << "Could not compile tesselation evaluation shader"
+              << std::endl;
+  }
+  if (!program.AttachShader(GL_FRAGMENT_SHADER, "teapot.fs")) {
+    std::cerr << "Could not compile fragment shader" << std::endl;
+  }
+
+  if (!program.Link()) {
+    std::cerr << "Could not link program" << std::endl;
+    exit(1);
+  }
+  program.Use();
+}
+
+int main(int argc, char* argv[]) {
+  if (!ParseAppOptions(argc, argv, &window.options)) {
+    exit(1);
+  }
+  if (!CreateAppWindow("Hello, World!", kScreenWidth, kScreenHeight, 3, 3,
+                       &window)) {
+    exit(1);
+  }
+
+  InitGL();
+
+  CreateProgram();
+
+  InitShaderVariables();
+
+  RunFrameLoop(&window, Render);
+
+  PrintPatchStats();
+
+  DestroyShaderVariables();
+
+  DestroyAppWindow(&window);
+
+  return 0;
+}
@@ -0,0 +1,14 @@
+#version 400
+
+in vec3 eye_position;
+in vec3 eye_normal;
+
+layout(location = 0) out vec4 frag_color;
+
+#include "lighting.glsl"
+
+void main() {
+     // Lit per fragment, as the tessellation level changes with the view
+     frag_color = vec4(calc_light(light_eye_position(), eye_position,
+                                  eye_normal), 1.0);
+}
\ No newline at end of file
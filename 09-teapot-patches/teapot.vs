@@ -0,0 +1,15 @@
+#version 400
+
+layout(location = 0) in vec3 position;
+
+// Per-instance transforms, see common/instancing.h
+layout(location = 3) in mat4 instance_model_mat;
+
+#include "frame_uniforms.glsl"
+
+void main() {
+     // Transforming the control points of a Bezier patch by an affine
+     // matrix transforms the whole patch, so the later stages work on eye
+     // space control points
+     gl_Position = view_mat * instance_model_mat * vec4(position, 1.0);
+}
\ No newline at end of file
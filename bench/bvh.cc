@@ -0,0 +1,340 @@
+// Builds BVHs over scenes of 10K to 10M triangles and measures the build
+// time and the rays per second of closest-hit and any-hit queries for each
+// thread count. A scene is the grid of teapots 04-lighting draws with
+// --instances, each teapot randomly rotated, with as many teapots as the
+// triangle count needs. Three sets of rays are traced: picking rays
+// through the pixels of 04-lighting's view, closest-hit rays in random
+// directions, and any-hit visibility rays between random points. On every
+// scene a sample of each set is checked against brute force
+// glm::intersectRayTriangle in double precision.
+//
+// Usage:
+//   ./bvh [--max-faces <count>] [--threads <max>] [--rays <count>]
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <algorithm>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#define GLM_ENABLE_EXPERIMENTAL // For the gtx extensions
+#include "glm/gtx/intersect.hpp"
+
+#include "bvh.h"
+#include "instancing.h"
+#include "model.h"
+#include "parallel.h"
+
+// Constants
+const int kRuns = 3;
+
+// 04-lighting's window, view and instance grid
+const unsigned int kWindowWidth = 1024;
+const unsigned int kWindowHeight = 768;
+const float kInstanceGridExtent = 40.f;
+
+// Picking rays are traced through every second pixel in each direction
+const unsigned int kPickStep = 2;
+
+// Ray-triangle tests the brute force check may spend per set of rays
+const double kCheckWork = 2e8;
+const unsigned int kMaxCheckRays = 1024;
+
+// Closest hits farther apart than this, relative to t, disagree
+const double kMaxRelativeError = 1e-4;
+
+double Milliseconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start).count();
+}
+
+// Copies of the teapot on 04-lighting's grid until the scene has
+// face_count faces; the last copy keeps only the faces that fit
+void CreateTeapotScene(const Model& teapot, size_t face_count,
+                       Model* scene) {
+  unsigned int copies = static_cast<unsigned int>(
+      (face_count + teapot.faces.size() - 1) / teapot.faces.size());
+  glm::mat4 base_model_mat = glm::rotate(glm::mat4(1.f), -1.f,
+                                         glm::vec3(1.f, 0.f, 0.f));
+  std::vector<InstanceTransform> instances;
+  CreateInstanceGrid(copies, kInstanceGridExtent, base_model_mat,
+                     &instances);
+
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+
+  scene->positions.clear();
+  scene->faces.clear();
+  scene->positions.reserve(static_cast<size_t>(copies) * teapot.vert_count);
+  scene->faces.reserve(face_count);
+  for (const InstanceTransform& instance : instances) {
+    glm::vec3 axis(uniform(rng), uniform(rng), uniform(rng));
+    if (glm::length(axis) == 0.f) {
+      axis = glm::vec3(0.f, 1.f, 0.f);
+    }
+    glm::mat4 model_mat = glm::rotate(instance.model_mat,
+                                      3.14159265f * uniform(rng),
+                                      glm::normalize(axis));
+
+    unsigned int base = static_cast<unsigned int>(scene->positions.size());
+    for (const glm::vec3& p : teapot.positions) {
+      scene->positions.push_back(glm::vec3(model_mat * glm::vec4(p, 1.f)));
+    }
+    for (const glm::uvec3& face : teapot.faces) {
+      if (scene->faces.size() == face_count) {
+        break;
+      }
+      scene->faces.push_back(face + glm::uvec3(base));
+    }
+  }
+
+  scene->vert_count = scene->positions.size();
+  scene->face_count = scene->faces.size();
+  scene->indexed_drawing = true;
+}
+
+void CreatePickRays(std::vector<Ray>* rays) {
+  glm::mat4 view_mat = glm::translate(glm::mat4(1.f),
+                                      glm::vec3(0.f, 0.f, -50.f));
+  glm::mat4 proj_mat = glm::perspective(45.f, 1024.f / 768.f, 0.1f, 1000.f);
+  glm::vec4 viewport(0.f, 0.f, kWindowWidth, kWindowHeight);
+
+  rays->clear();
+  for (unsigned int y = 0; y < kWindowHeight; y += kPickStep) {
+    for (unsigned int x = 0; x < kWindowWidth; x += kPickStep) {
+      rays->push_back(MakePickRay(glm::vec2(x + 0.5f, y + 0.5f), view_mat,
+                                  proj_mat, viewport));
+    }
+  }
+}
+
+// Rays from random points in the scene's bounds, in random directions for
+// closest hits or to another random point for visibility
+void CreateRandomRays(const Model& scene, unsigned int count,
+                      bool visibility, std::vector<Ray>* rays) {
+  glm::vec3 min_pos = scene.positions[0];
+  glm::vec3 max_pos = scene.positions[0];
+  for (const glm::vec3& p : scene.positions) {
+    min_pos = glm::min(min_pos, p);
+    max_pos = glm::max(max_pos, p);
+  }
+
+  std::mt19937 rng(visibility ? 2 : 3);
+  std::uniform_real_distribution<float> uniform(0.f, 1.f);
+  std::normal_distribution<float> normal;
+  auto random_point = [&]() {
+    return min_pos + (max_pos - min_pos) * glm::vec3(uniform(rng),
+                                                     uniform(rng),
+                                                     uniform(rng));
+  };
+
+  rays->clear();
+  for (unsigned int i = 0; i < count; ++i) {
+    Ray ray;
+    ray.origin = random_point();
+    if (visibility) {
+      ray.direction = random_point() - ray.origin;
+      ray.t_max = 1.f;
+    } else {
+      glm::vec3 d(normal(rng), normal(rng), normal(rng));
+      ray.direction = glm::length(d) > 0.f ? glm::normalize(d)
+                                           : glm::vec3(0.f, 0.f, 1.f);
+    }
+    rays->push_back(ray);
+  }
+}
+
+// Closest hit by testing every face in double precision. Returns t or a
+// negative value for a miss.
+double BruteForceHit(const Model& scene, const Ray& ray) {
+  glm::dvec3 origin(ray.origin);
+  glm::dvec3 direction(ray.direction);
+  double closest = -1.0;
+  for (const glm::uvec3& face : scene.faces) {
+    glm::dvec2 barycentrics;
+    double t;
+    if (glm::intersectRayTriangle(origin, direction,
+                                  glm::dvec3(scene.positions[face.x]),
+                                  glm::dvec3(scene.positions[face.y]),
+                                  glm::dvec3(scene.positions[face.z]),
+                                  barycentrics, t) &&
+        t >= ray.t_min && t <= ray.t_max && (closest < 0.0 || t < closest)) {
+      closest = t;
+    }
+  }
+  return closest;
+}
+
+// Number of rays, out of about check_count spread over the set, on which
+// the BVH and brute force disagree
+unsigned int CheckRays(const Bvh& bvh, const Model& scene,
+                       const std::vector<Ray>& rays, bool any_hit,
+                       unsigned int check_count) {
+  unsigned int stride = std::max<unsigned int>(
+      static_cast<unsigned int>(rays.size()) / check_count, 1);
+  unsigned int mismatches = 0;
+  for (size_t i = 0; i < rays.size(); i += stride) {
+    double expected = BruteForceHit(scene, rays[i]);
+    if (any_hit) {
+      mismatches += bvh.AnyHit(rays[i]) != (expected >= 0.0) ? 1 : 0;
+      continue;
+    }
+
+    RayHit hit;
+    bool found = bvh.ClosestHit(rays[i], &hit);
+    if (found != (expected >= 0.0) ||
+        (found && std::abs(hit.t - expected) >
+                      kMaxRelativeError * std::max(expected, 1e-3))) {
+      ++mismatches;
+    }
+  }
+  return mismatches;
+}
+
+// Millions of rays per second over the best of kRuns runs
+double TraceRays(const Bvh& bvh, const std::vector<Ray>& rays, bool any_hit,
+                 unsigned int threads, unsigned int* hits) {
+  double best_ms = 0.0;
+  std::vector<unsigned int> thread_hits(threads);
+  for (int run = 0; run < kRuns; ++run) {
+    auto start = std::chrono::steady_clock::now();
+    ParallelFor(threads, [&](unsigned int thread_index) {
+      size_t begin = rays.size() * thread_index / threads;
+      size_t end = rays.size() * (thread_index + 1) / threads;
+      unsigned int count = 0;
+      RayHit hit;
+      for (size_t i = begin; i < end; ++i) {
+        bool found = any_hit ? bvh.AnyHit(rays[i])
+                             : bvh.ClosestHit(rays[i], &hit);
+        count += found ? 1 : 0;
+      }
+      thread_hits[thread_index] = count;
+    });
+    double ms = Milliseconds(start);
+    if (run == 0 || ms < best_ms) {
+      best_ms = ms;
+    }
+  }
+
+  *hits = 0;
+  for (unsigned int count : thread_hits) {
+    *hits += count;
+  }
+  return rays.size() / (best_ms * 1e3);
+}
+
+bool Report(const Model& scene, const std::vector<unsigned int>& thread_counts,
+            unsigned int ray_count) {
+  std::cout << scene.face_count << " faces" << std::endl;
+
+  Bvh bvh;
+  std::cout << std::fixed << std::setprecision(1) << "  build:";
+  for (unsigned int threads : thread_counts) {
+    BvhOptions options;
+    options.num_threads = threads;
+    auto start = std::chrono::steady_clock::now();
+    if (!bvh.Build(scene, options)) {
+      return false;
+    }
+    std::cout << " " << Milliseconds(start) << " ms (" << threads << ")";
+  }
+  std::cout << std::endl;
+
+  size_t leaves = 0;
+  for (const BvhNode& node : bvh.nodes()) {
+    leaves += node.count > 0 ? 1 : 0;
+  }
+  std::cout << "  " << bvh.nodes().size() << " nodes, " << leaves
+            << " leaves of " << static_cast<float>(scene.face_count) / leaves
+            << " faces on average, " << bvh.wide_node_count()
+            << " wide nodes, " << bvh.query_bytes() / (1024.f * 1024.f)
+            << " MB" << std::endl;
+  std::cout << "  wide nodes: "
+            << static_cast<float>(bvh.wide_node_bytes()) / scene.face_count
+            << " bytes per triangle" << std::endl;
+
+  struct RaySet {
+    const char* name;
+    bool any_hit;
+    std::vector<Ray> rays;
+  };
+  RaySet sets[3] = {{"picking, closest hit", false, {}},
+                    {"random, closest hit", false, {}},
+                    {"visibility, any hit", true, {}}};
+  CreatePickRays(&sets[0].rays);
+  CreateRandomRays(scene, ray_count, false, &sets[1].rays);
+  CreateRandomRays(scene, ray_count, true, &sets[2].rays);
+
+  unsigned int check_count = static_cast<unsigned int>(std::max(
+      std::min(kCheckWork / scene.face_count,
+               static_cast<double>(kMaxCheckRays)), 16.0));
+  unsigned int mismatches = 0;
+  for (const RaySet& set : sets) {
+    std::cout << "  " << std::left << std::setw(22) << set.name << std::right;
+    unsigned int hits = 0;
+    for (unsigned int threads : thread_counts) {
+      double mrays = TraceRays(bvh, set.rays, set.any_hit, threads, &hits);
+      std::cout << std::setprecision(2) << std::setw(7) << mrays
+                << " Mrays/s (" << threads << ")";
+    }
+    std::cout << std::setprecision(1) << ", "
+              << 100.f * hits / set.rays.size() << "% hit" << std::endl;
+    mismatches += CheckRays(bvh, scene, set.rays, set.any_hit, check_count);
+  }
+
+  std::cout << "  rays disagreeing with brute force: " << mismatches
+            << (mismatches == 0 ? " - PASS" : " - FAIL") << std::endl;
+  return mismatches == 0;
+}
+
+int main(int argc, char** argv) {
+  size_t max_faces = 10000000;
+  unsigned int ray_count = 1 << 18;
+  unsigned int max_threads = std::max(std::thread::hardware_concurrency(),
+                                      1u);
+
+  for (int i = 1; i < argc; ++i) {
+    bool has_value = i + 1 < argc;
+    if (strcmp(argv[i], "--max-faces") == 0 && has_value) {
+      max_faces = std::max(atol(argv[++i]), 1L);
+    } else if (strcmp(argv[i], "--threads") == 0 && has_value) {
+      max_threads = std::max(atoi(argv[++i]), 1);
+    } else if (strcmp(argv[i], "--rays") == 0 && has_value) {
+      ray_count = std::max(atoi(argv[++i]), 1);
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--max-faces <count>]"
+                << " [--threads <max>] [--rays <count>]" << std::endl;
+      return 1;
+    }
+  }
+
+  Model teapot;
+  if (!CreateModelFromFile("../assets/teapot.obj", &teapot, true)) {
+    std::cerr << "Could not load ../assets/teapot.obj" << std::endl;
+    return 1;
+  }
+
+  std::vector<unsigned int> thread_counts;
+  for (unsigned int threads = 1; threads < max_threads; threads *= 2) {
+    thread_counts.push_back(threads);
+  }
+  thread_counts.push_back(max_threads);
+
+  bool pass = true;
+  for (size_t face_count = 10000; face_count <= max_faces;
+       face_count *= 10) {
+    Model scene;
+    CreateTeapotScene(teapot, face_count, &scene);
+    pass = Report(scene, thread_counts, ray_count) && pass;
+  }
+
+  return pass ? 0 : 1;
+}
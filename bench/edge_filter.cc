@@ -0,0 +1,178 @@
+// Measures the throughput of the CPU edge detection filter in megapixels
+// per second against the scalar reference, and checks that both produce the
+// same image.
+//
+// Usage:
+//   ./edge_filter [--input <ppm>] [--size <width>x<height>]
+//                 [--threads <max>] [--out <ppm>] [--reference <ppm>]
+//
+// Without --input the teapot scene of 08-edgedetect is rendered with the
+// software rasterizer at the given size (3840x2160 by default). A frame
+// filtered on the GPU can be passed with --reference, together with the
+// unfiltered frame it came from as --input, and must match exactly.
+
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <functional>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "edge_filter.h"
+#include "image.h"
+#include "model.h"
+#include "soft_raster.h"
+
+// Constants
+const int kRuns = 5;
+
+LightingParams SceneParams(unsigned int width, unsigned int height) {
+  LightingParams params;
+  params.light_position = glm::vec3(0.f, 10.f, 20.f);
+  params.diffuse_param = glm::vec3(1.f, 1.f, 1.f);
+  params.ambient_param = glm::vec3(1.f, 0.f, 0.f);
+  params.specular_param = glm::vec3(1.f, 1.f, 1.f);
+  params.shininess = 4.f;
+
+  params.model_mat = glm::rotate(glm::mat4(1.f), -1.f,
+                                 glm::vec3(1.f, 0.f, 0.f));
+  params.view_mat = glm::translate(glm::mat4(1.f),
+                                   glm::vec3(0.f, 0.f, -50.f));
+  params.proj_mat = glm::perspective(45.f, static_cast<float>(width) /
+                                           static_cast<float>(height),
+                                     0.1f, 1000.f);
+  params.normal_mat = glm::transpose(glm::inverse(params.view_mat *
+                                                  params.model_mat));
+  return params;
+}
+
+// Best of kRuns, in megapixels per second
+double MeasureMps(const Image& src, const std::function<void()>& filter) {
+  double best_ms = 0.0;
+  for (int run = 0; run < kRuns; ++run) {
+    auto start = std::chrono::steady_clock::now();
+    filter();
+    auto end = std::chrono::steady_clock::now();
+
+    double ms = std::chrono::duration<double, std::milli>(end - start).count();
+    if (run == 0 || ms < best_ms) {
+      best_ms = ms;
+    }
+  }
+  return src.width * src.height / (best_ms * 1000.0);
+}
+
+size_t CountDifferentPixels(const Image& a, const Image& b) {
+  if (a.width != b.width || a.height != b.height) {
+    return static_cast<size_t>(a.width) * a.height;
+  }
+
+  size_t different = 0;
+  for (size_t i = 0; i < a.pixels.size(); i += 3) {
+    if (a.pixels[i] != b.pixels[i] || a.pixels[i + 1] != b.pixels[i + 1] ||
+        a.pixels[i + 2] != b.pixels[i + 2]) {
+      ++different;
+    }
+  }
+  return different;
+}
+
+int main(int argc, char** argv) {
+  std::string input_path;
+  std::string out_path = "edge_filter.ppm";
+  std::string reference_path;
+  unsigned int width = 3840;
+  unsigned int height = 2160;
+  unsigned int max_threads = std::max(std::thread::hardware_concurrency(),
+                                      1u);
+
+  for (int i = 1; i < argc; ++i) {
+    bool has_value = i + 1 < argc;
+    if (strcmp(argv[i], "--input") == 0 && has_value) {
+      input_path = argv[++i];
+    } else if (strcmp(argv[i], "--size") == 0 && has_value &&
+               sscanf(argv[i + 1], "%ux%u", &width, &height) == 2 &&
+               width > 0 && height > 0) {
+      ++i;
+    } else if (strcmp(argv[i], "--threads") == 0 && has_value) {
+      max_threads = std::max(atoi(argv[++i]), 1);
+    } else if (strcmp(argv[i], "--out") == 0 && has_value) {
+      out_path = argv[++i];
+    } else if (strcmp(argv[i], "--reference") == 0 && has_value) {
+      reference_path = argv[++i];
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--input <ppm>]"
+                << " [--size <width>x<height>] [--threads <max>]"
+                << " [--out <ppm>] [--reference <ppm>]" << std::endl;
+      return 1;
+    }
+  }
+
+  Image scene;
+  if (!input_path.empty()) {
+    if (!LoadImagePPM(input_path, &scene)) {
+      return 1;
+    }
+  } else {
+    Model model;
+    if (!CreateModelFromFile("../assets/teapot.obj", &model, true)) {
+      std::cerr << "Could not load the teapot" << std::endl;
+      return 1;
+    }
+    RenderLightingSoftware(model, SceneParams(width, height), kShadePerPixel,
+                           width, height, 0, &scene);
+  }
+
+  std::cout << "Input: " << scene.width << "x" << scene.height << std::endl;
+
+  Image reference_edges;
+  double scalar_mps = MeasureMps(scene, [&]() {
+    DetectEdgesReference(scene, kDefaultEdgeThreshold, &reference_edges);
+  });
+  std::cout << "  scalar reference: " << scalar_mps << " MP/s" << std::endl;
+
+  // Powers of two up to, and always including, the maximum thread count
+  std::vector<unsigned int> thread_counts;
+  for (unsigned int threads = 1; threads < max_threads; threads *= 2) {
+    thread_counts.push_back(threads);
+  }
+  thread_counts.push_back(max_threads);
+
+  Image edges;
+  for (unsigned int threads : thread_counts) {
+    double mps = MeasureMps(scene, [&]() {
+      DetectEdges(scene, kDefaultEdgeThreshold, threads, &edges);
+    });
+    std::cout << "  simd, " << threads << " threads: " << mps << " MP/s ("
+              << mps / scalar_mps << "x)" << std::endl;
+  }
+
+  size_t different = CountDifferentPixels(edges, reference_edges);
+  std::cout << "Scalar reference: " << different << " pixels differ"
+            << (different == 0 ? " - PASS" : " - FAIL") << std::endl;
+
+  if (!SaveImagePPM(out_path, edges)) {
+    return 1;
+  }
+  std::cout << "Wrote " << out_path << std::endl;
+
+  if (!reference_path.empty()) {
+    Image gpu_edges;
+    if (!LoadImagePPM(reference_path, &gpu_edges)) {
+      return 1;
+    }
+    size_t gpu_different = CountDifferentPixels(edges, gpu_edges);
+    std::cout << "GPU reference: " << gpu_different << " pixels differ"
+              << (gpu_different == 0 ? " - PASS" : " - FAIL") << std::endl;
+    different += gpu_different;
+  }
+
+  return different == 0 ? 0 : 1;
+}
@@ -0,0 +1,187 @@
+// Builds level-of-detail chains with BuildLodChain and reports, for each
+// level, its triangle count and geometric error. The estimated error is
+// the one the runtime selection uses. The measured error is the distance
+// from the full-detail vertices to the level's surface. The report also
+// gives the distance at which each level is selected in the lighting
+// samples' view.
+//
+// Usage:
+//   ./lod_chain [--levels <count>] [--reduction <fraction>] [file.obj ...]
+//
+// With no files the teapot is used.
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "mesh_lod.h"
+#include "mesh_optimizer.h"
+#include "model.h"
+
+// Viewport height and largest error in pixels used by the samples
+const float kViewportHeight = 768.f;
+const float kMaxPixelError = 1.f;
+
+// Closest point to p on the triangle abc (Ericson, "Real-Time Collision
+// Detection", 5.1.5)
+glm::vec3 ClosestPointOnTriangle(const glm::vec3& p, const glm::vec3& a,
+                                 const glm::vec3& b, const glm::vec3& c) {
+  glm::vec3 ab = b - a;
+  glm::vec3 ac = c - a;
+  glm::vec3 ap = p - a;
+  float d1 = glm::dot(ab, ap);
+  float d2 = glm::dot(ac, ap);
+  if (d1 <= 0.f && d2 <= 0.f) {
+    return a;
+  }
+
+  glm::vec3 bp = p - b;
+  float d3 = glm::dot(ab, bp);
+  float d4 = glm::dot(ac, bp);
+  if (d3 >= 0.f && d4 <= d3) {
+    return b;
+  }
+
+  float vc = d1 * d4 - d3 * d2;
+  if (vc <= 0.f && d1 >= 0.f && d3 <= 0.f) {
+    return a + ab * (d1 / (d1 - d3));
+  }
+
+  glm::vec3 cp = p - c;
+  float d5 = glm::dot(ab, cp);
+  float d6 = glm::dot(ac, cp);
+  if (d6 >= 0.f && d5 <= d6) {
+    return c;
+  }
+
+  float vb = d5 * d2 - d1 * d6;
+  if (vb <= 0.f && d2 >= 0.f && d6 <= 0.f) {
+    return a + ac * (d2 / (d2 - d6));
+  }
+
+  float va = d3 * d6 - d5 * d4;
+  if (va <= 0.f && (d4 - d3) >= 0.f && (d5 - d6) >= 0.f) {
+    return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+  }
+
+  float denom = 1.f / (va + vb + vc);
+  return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+// Largest and root mean square distance from the vertices of the full
+// model to the faces of the level
+void MeasureError(const Model& model, const LodLevel& level,
+                  float* max_distance, float* rms_distance) {
+  double sum = 0.0;
+  *max_distance = 0.f;
+  for (unsigned int v = 0; v < model.vert_count; ++v) {
+    const glm::vec3& p = model.positions[v];
+    float best = INFINITY;
+    for (unsigned int f = level.first_face;
+         f < level.first_face + level.face_count; ++f) {
+      const glm::uvec3& face = model.faces[f];
+      glm::vec3 closest = ClosestPointOnTriangle(p, model.positions[face.x],
+                                                 model.positions[face.y],
+                                                 model.positions[face.z]);
+      glm::vec3 diff = p - closest;
+      best = std::min(best, glm::dot(diff, diff));
+    }
+    sum += best;
+    *max_distance = std::max(*max_distance, best);
+  }
+  *max_distance = std::sqrt(*max_distance);
+  *rms_distance = static_cast<float>(std::sqrt(sum / model.vert_count));
+}
+
+int main(int argc, char** argv) {
+  LodOptions options;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; ++i) {
+    bool has_value = i + 1 < argc;
+    if (strcmp(argv[i], "--levels") == 0 && has_value) {
+      options.max_levels = std::max(atoi(argv[++i]), 1);
+    } else if (strcmp(argv[i], "--reduction") == 0 && has_value) {
+      options.reduction = static_cast<float>(atof(argv[++i]));
+    } else if (argv[i][0] == '-') {
+      std::cerr << "Usage: " << argv[0] << " [--levels <count>]"
+                << " [--reduction <fraction>] [file.obj ...]" << std::endl;
+      return 1;
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+  if (paths.empty()) {
+    paths.push_back("../assets/teapot.obj");
+  }
+
+  // The projection of 04-lighting
+  glm::mat4 proj_mat = glm::perspective(45.f, 1024.f / 768.f, 0.1f, 1000.f);
+
+  for (const std::string& path : paths) {
+    Model model;
+    if (!CreateModelFromFile(path, &model, true)) {
+      std::cerr << "Could not load " << path << std::endl;
+      return 1;
+    }
+    OptimizeMesh(&model);
+
+    std::cout << path << " (" << model.vert_count << " vertices, "
+              << model.face_count << " faces)" << std::endl;
+
+    std::vector<LodLevel> levels;
+    auto start = std::chrono::steady_clock::now();
+    if (!BuildLodChain(&model, options, &levels)) {
+      return 1;
+    }
+    auto end = std::chrono::steady_clock::now();
+    double build_ms =
+        std::chrono::duration<double, std::milli>(end - start).count();
+
+    std::cout << "  level  faces   kept  estimated   measured max / rms"
+              << "   ACMR  selected beyond" << std::endl;
+    Model level_model;
+    level_model.vert_count = model.vert_count;
+    level_model.indexed_drawing = true;
+    for (unsigned int i = 0; i < levels.size(); ++i) {
+      const LodLevel& level = levels[i];
+      float max_distance = 0.f;
+      float rms_distance = 0.f;
+      MeasureError(model, level, &max_distance, &rms_distance);
+
+      level_model.faces.assign(
+          model.faces.begin() + level.first_face,
+          model.faces.begin() + level.first_face + level.face_count);
+      level_model.face_count = level.face_count;
+
+      // Distance at which the level's error projects to kMaxPixelError
+      float distance = ProjectedLodError(level.error, proj_mat,
+                                         kViewportHeight, 1.f) /
+                       kMaxPixelError;
+
+      std::cout << std::fixed << std::setprecision(4) << "  " << std::setw(5)
+                << i << std::setw(7) << level.face_count << std::setw(6)
+                << std::setprecision(1)
+                << 100.f * level.face_count / levels[0].face_count << "%"
+                << std::setprecision(4) << std::setw(11) << level.error
+                << std::setw(11) << max_distance << " / " << std::setw(6)
+                << rms_distance << std::setprecision(3) << std::setw(7)
+                << AnalyzeVertexCache(level_model).acmr
+                << std::setprecision(1) << std::setw(16) << distance
+                << std::endl;
+    }
+
+    std::cout << std::setprecision(2) << "  built " << levels.size() - 1
+              << " levels in " << build_ms << " ms" << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,266 @@
+// Builds meshlets for the teapot and for a large generated mesh and culls
+// them on the CPU over a camera path, reporting the fraction of meshlets
+// and faces culled and the culling time per frame for each thread count.
+// Also checks that culling is conservative: every face that faces the eye
+// with a corner inside the frustum must be in the compacted faces.
+//
+// Usage:
+//   ./meshlets [--segments <count>] [--threads <max>] [file.obj ...]
+//
+// The generated mesh is a bumpy torus of segments^2 faces (1M by default).
+// With no files the teapot is used.
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "mesh_optimizer.h"
+#include "meshlet.h"
+#include "model.h"
+
+// Constants
+const unsigned int kFrames = 64;
+const int kRuns = 3;
+
+// Torus with a ring of radius 1 and a tube of radius 0.4 whose surface is
+// displaced by bumps, with segments steps around the ring and half as many
+// around the tube
+void CreateBumpyTorus(unsigned int segments, Model* model) {
+  const unsigned int rings = segments;
+  const unsigned int sides = std::max(segments / 2, 3u);
+  const float kPi = 3.14159265f;
+
+  model->positions.clear();
+  model->faces.clear();
+  for (unsigned int i = 0; i < rings; ++i) {
+    float u = 2.f * kPi * i / rings;
+    for (unsigned int j = 0; j < sides; ++j) {
+      float v = 2.f * kPi * j / sides;
+      float r = 0.4f * (1.f + 0.05f * std::sin(24.f * u) *
+                        std::sin(16.f * v));
+      model->positions.push_back(glm::vec3((1.f + r * std::cos(v)) *
+                                           std::cos(u),
+                                           (1.f + r * std::cos(v)) *
+                                           std::sin(u),
+                                           r * std::sin(v)));
+    }
+  }
+
+  // Counterclockwise seen from outside
+  for (unsigned int i = 0; i < rings; ++i) {
+    for (unsigned int j = 0; j < sides; ++j) {
+      unsigned int a = i * sides + j;
+      unsigned int b = ((i + 1) % rings) * sides + j;
+      unsigned int c = ((i + 1) % rings) * sides + (j + 1) % sides;
+      unsigned int d = i * sides + (j + 1) % sides;
+      model->faces.push_back(glm::uvec3(a, b, c));
+      model->faces.push_back(glm::uvec3(a, c, d));
+    }
+  }
+
+  model->vert_count = model->positions.size();
+  model->face_count = model->faces.size();
+  model->indexed_drawing = true;
+}
+
+// Views of the model circling it and moving from twice its size away to
+// well inside its bounding sphere, where most of it is out of view
+void CreateCameraPath(const Model& model, std::vector<glm::mat4>* view_mats) {
+  glm::vec3 min_pos = model.positions[0];
+  glm::vec3 max_pos = model.positions[0];
+  for (const glm::vec3& p : model.positions) {
+    min_pos = glm::min(min_pos, p);
+    max_pos = glm::max(max_pos, p);
+  }
+  glm::vec3 center = 0.5f * (min_pos + max_pos);
+  float radius = 0.5f * glm::length(max_pos - min_pos);
+
+  const float kPi = 3.14159265f;
+  view_mats->clear();
+  for (unsigned int frame = 0; frame < kFrames; ++frame) {
+    float t = static_cast<float>(frame) / kFrames;
+    float angle = 2.f * kPi * t;
+    float distance = radius * (1.5f + std::cos(3.f * angle));
+    glm::vec3 eye = center + distance * glm::vec3(std::cos(angle), 0.4f,
+                                                  std::sin(angle));
+    view_mats->push_back(glm::lookAt(eye, center, glm::vec3(0.f, 1.f, 0.f)));
+  }
+}
+
+// Faces that face the eye and have a corner inside the frustum, which
+// culling must keep
+unsigned int CountMissedFaces(const Model& model,
+                              const std::vector<Meshlet>& meshlets,
+                              const MeshletView& view,
+                              const glm::mat4& mvp_mat) {
+  unsigned int missed = 0;
+  for (const Meshlet& meshlet : meshlets) {
+    if (TestMeshlet(meshlet, view) == kMeshletVisible) {
+      continue;
+    }
+
+    unsigned int end = meshlet.first_face + meshlet.face_count;
+    for (unsigned int f = meshlet.first_face; f < end; ++f) {
+      const glm::uvec3& face = model.faces[f];
+      glm::vec3 p0 = model.positions[face.x];
+      glm::vec3 n = glm::cross(model.positions[face.y] - p0,
+                               model.positions[face.z] - p0);
+      if (glm::dot(n, view.eye_position - p0) <= 0.f) {
+        continue;
+      }
+
+      for (int c = 0; c < 3; ++c) {
+        glm::vec4 clip = mvp_mat * glm::vec4(model.positions[face[c]], 1.f);
+        if (std::abs(clip.x) < clip.w && std::abs(clip.y) < clip.w &&
+            std::abs(clip.z) < clip.w) {
+          ++missed;
+          break;
+        }
+      }
+    }
+  }
+  return missed;
+}
+
+bool Report(const std::string& name, Model* model,
+            unsigned int max_threads) {
+  std::cout << name << " (" << model->vert_count << " vertices, "
+            << model->faces.size() << " faces)" << std::endl;
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<Meshlet> meshlets;
+  if (!BuildMeshlets(model, &meshlets)) {
+    return false;
+  }
+  auto end = std::chrono::steady_clock::now();
+  double build_ms =
+      std::chrono::duration<double, std::milli>(end - start).count();
+
+  size_t vertices = 0;
+  unsigned int cone_culling = 0;
+  for (const Meshlet& meshlet : meshlets) {
+    vertices += meshlet.vert_count;
+    cone_culling += meshlet.cone_cutoff <= 1.f ? 1 : 0;
+  }
+  std::cout << std::fixed << std::setprecision(1) << "  " << meshlets.size()
+            << " meshlets in " << build_ms << " ms, "
+            << static_cast<float>(model->faces.size()) / meshlets.size()
+            << " faces and "
+            << static_cast<float>(vertices) / meshlets.size()
+            << " vertices on average, "
+            << 100.f * cone_culling / meshlets.size()
+            << "% with a usable normal cone" << std::endl;
+
+  glm::mat4 proj_mat = glm::perspective(45.f, 1024.f / 768.f, 0.01f,
+                                        1000.f);
+  std::vector<glm::mat4> view_mats;
+  CreateCameraPath(*model, &view_mats);
+  std::vector<MeshletView> views;
+  for (const glm::mat4& view_mat : view_mats) {
+    views.push_back(MakeMeshletView(glm::mat4(1.f), view_mat, proj_mat));
+  }
+
+  // Culling results over the path, which do not depend on the thread count
+  std::vector<glm::uvec3> visible_faces;
+  double frustum = 0.0;
+  double backface = 0.0;
+  double faces = 0.0;
+  unsigned int missed = 0;
+  for (size_t i = 0; i < views.size(); ++i) {
+    MeshletCullStats stats;
+    CullMeshlets(*model, meshlets, views[i], 1, &visible_faces, &stats);
+    frustum += stats.frustum_culled;
+    backface += stats.backface_culled;
+    faces += stats.visible_faces;
+    missed += CountMissedFaces(*model, meshlets, views[i],
+                               proj_mat * view_mats[i]);
+  }
+  double meshlet_frames = static_cast<double>(meshlets.size()) * kFrames;
+  std::cout << "  culled per frame: " << 100.0 * frustum / meshlet_frames
+            << "% of meshlets by frustum, " << 100.0 * backface /
+                                                  meshlet_frames
+            << "% by normal cone, "
+            << 100.0 * (1.0 - faces / (model->faces.size() * kFrames))
+            << "% of faces" << std::endl;
+
+  std::vector<unsigned int> thread_counts;
+  for (unsigned int threads = 1; threads < max_threads; threads *= 2) {
+    thread_counts.push_back(threads);
+  }
+  thread_counts.push_back(max_threads);
+
+  for (unsigned int threads : thread_counts) {
+    double best_ms = 0.0;
+    for (int run = 0; run < kRuns; ++run) {
+      auto start = std::chrono::steady_clock::now();
+      for (const MeshletView& view : views) {
+        CullMeshlets(*model, meshlets, view, threads, &visible_faces);
+      }
+      auto end = std::chrono::steady_clock::now();
+      double ms =
+          std::chrono::duration<double, std::milli>(end - start).count();
+      if (run == 0 || ms < best_ms) {
+        best_ms = ms;
+      }
+    }
+    std::cout << std::setprecision(3) << "  " << threads << " threads: "
+              << best_ms / kFrames << " ms per frame" << std::endl;
+  }
+
+  std::cout << "  visible faces culled: " << missed
+            << (missed == 0 ? " - PASS" : " - FAIL") << std::endl;
+  return missed == 0;
+}
+
+int main(int argc, char** argv) {
+  unsigned int segments = 1024;
+  unsigned int max_threads = std::max(std::thread::hardware_concurrency(),
+                                      1u);
+  std::vector<std::string> paths;
+
+  for (int i = 1; i < argc; ++i) {
+    bool has_value = i + 1 < argc;
+    if (strcmp(argv[i], "--segments") == 0 && has_value) {
+      segments = std::max(atoi(argv[++i]), 6);
+    } else if (strcmp(argv[i], "--threads") == 0 && has_value) {
+      max_threads = std::max(atoi(argv[++i]), 1);
+    } else if (argv[i][0] == '-') {
+      std::cerr << "Usage: " << argv[0] << " [--segments <count>]"
+                << " [--threads <max>] [file.obj ...]" << std::endl;
+      return 1;
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+  if (paths.empty()) {
+    paths.push_back("../assets/teapot.obj");
+  }
+
+  bool pass = true;
+  for (const std::string& path : paths) {
+    Model model;
+    if (!CreateModelFromFile(path, &model, true)) {
+      std::cerr << "Could not load " << path << std::endl;
+      return 1;
+    }
+    OptimizeVertexCache(&model);
+    pass = Report(path, &model, max_threads) && pass;
+  }
+
+  Model torus;
+  CreateBumpyTorus(segments, &torus);
+  OptimizeVertexCache(&torus);
+  pass = Report("bumpy torus", &torus, max_threads) && pass;
+
+  return pass ? 0 : 1;
+}
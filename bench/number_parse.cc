@@ -0,0 +1,273 @@
+// Checks and times the number parsing of tiny_obj_loader.h: tryParseFloat
+// against the previous tryParseDouble, and the face index parser against
+// atoi().
+//
+// Usage:
+//   ./number_parse [file.obj ...]
+//
+// With no arguments the teapot is used. The corpus is every number in the
+// v, vn, vt and f lines of the files, plus numbers printed in the formats
+// OBJ exporters use. Each float must equal strtof(), and also the old
+// parser's result wherever that one was correctly rounded. The old parser
+// rounds an approximate double, so a few numbers written with an exponent
+// that lie exactly halfway between two floats used to round the wrong way.
+// Reports floats and indices parsed per second.
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#define TINYOBJLOADER_KEEP_DOUBLE_PARSER
+#include "tiny_obj_loader.h"
+
+// Constants
+const int kRuns = 5;
+const int kSyntheticCount = 1000000;
+const char* const kIndexDelims = "/ \t\r";
+
+// Tokens stored back to back, each followed by a NUL
+struct Corpus {
+  std::vector<char> text;
+  std::vector<size_t> offsets;
+
+  void Add(const char* begin, const char* end) {
+    offsets.push_back(text.size());
+    text.insert(text.end(), begin, end);
+    text.push_back('\0');
+  }
+
+  size_t size() const { return offsets.size(); }
+  const char* token(size_t i) const { return &text[offsets[i]]; }
+};
+
+// Splits the lines of an OBJ file into float and face index tokens
+bool ReadObjTokens(const std::string& path, Corpus* floats,
+                   Corpus* indices) {
+  std::ifstream fin(path);
+  if (!fin) {
+    return false;
+  }
+
+  std::string line;
+  while (std::getline(fin, line)) {
+    const char* p = line.c_str();
+    p += strspn(p, " \t");
+    bool is_face = p[0] == 'f' && (p[1] == ' ' || p[1] == '\t');
+    bool is_attrib = p[0] == 'v' &&
+                     (p[1] == ' ' || p[1] == '\t' ||
+                      ((p[1] == 'n' || p[1] == 't') &&
+                       (p[2] == ' ' || p[2] == '\t')));
+    if (!is_face && !is_attrib) {
+      continue;
+    }
+
+    p += strcspn(p, " \t");
+    while (true) {
+      p += strspn(p, " \t\r");
+      if (*p == '\0') {
+        break;
+      }
+      size_t len = strcspn(p, is_face ? kIndexDelims : " \t\r");
+      if (is_face) {
+        indices->Add(p, p + len);
+        p += len;
+        if (*p == '/') {
+          p++;
+        }
+      } else {
+        floats->Add(p, p + len);
+        p += len;
+      }
+    }
+  }
+  return true;
+}
+
+// Numbers in the formats OBJ exporters write, over the ranges models use
+void AddSyntheticTokens(Corpus* floats, Corpus* indices) {
+  const char* const formats[] = {"%.6f", "%.4f", "%f", "%.7g", "%.9g",
+                                 "%e", "%.8e", "%g"};
+  const size_t num_formats = sizeof(formats) / sizeof(formats[0]);
+
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<double> unit(-1.0, 1.0);
+  std::uniform_int_distribution<int> scale(-3, 6);
+  for (int i = 0; i < kSyntheticCount; ++i) {
+    double x = unit(rng) * std::pow(10.0, scale(rng));
+    char buffer[64];
+    int len = snprintf(buffer, sizeof(buffer), formats[i % num_formats], x);
+    floats->Add(buffer, buffer + len);
+  }
+
+  std::uniform_int_distribution<int> index(-1000, 10000000);
+  for (int i = 0; i < kSyntheticCount; ++i) {
+    std::string text = std::to_string(index(rng));
+    indices->Add(text.c_str(), text.c_str() + text.size());
+  }
+}
+
+bool SameFloat(float a, float b) {
+  return memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+// Returns false if tryParseFloat is wrong for any token
+bool CheckFloats(const Corpus& floats) {
+  size_t identical = 0;
+  size_t old_misrounded = 0;
+  size_t wrong = 0;
+  for (size_t i = 0; i < floats.size(); ++i) {
+    const char* s = floats.token(i);
+    const char* s_end = s + strlen(s);
+
+    double old_value = 0.0;
+    float value = 0.f;
+    bool old_ok = tinyobj::tryParseDouble(s, s_end, &old_value);
+    bool ok = tinyobj::tryParseFloat(s, s_end, &value);
+    float old_float = static_cast<float>(old_value);
+    float reference = strtof(s, NULL);
+
+    if (ok != old_ok || (ok && !SameFloat(value, reference))) {
+      if (wrong++ < 10) {
+        std::cerr << "  Wrong result for \"" << s << "\": "
+                  << std::setprecision(9) << value << ", expected "
+                  << reference << std::endl;
+      }
+    } else if (!ok || SameFloat(value, old_float)) {
+      ++identical;
+    } else {
+      ++old_misrounded;
+    }
+  }
+
+  std::cout << "  Floats:  " << floats.size() << " tokens, " << identical
+            << " identical to tryParseDouble, " << old_misrounded
+            << " it misrounded, " << wrong << " wrong" << std::endl;
+  return wrong == 0;
+}
+
+// Returns false if parseIntUntil differs from atoi() for any token
+bool CheckIndices(const Corpus& indices) {
+  size_t wrong = 0;
+  for (size_t i = 0; i < indices.size(); ++i) {
+    const char* s = indices.token(i);
+    const char* token = s;
+    int value = tinyobj::parseIntUntil(&token, kIndexDelims);
+    if (value != atoi(s) || token != s + strcspn(s, kIndexDelims)) {
+      if (wrong++ < 10) {
+        std::cerr << "  Wrong result for \"" << s << "\": " << value
+                  << std::endl;
+      }
+    }
+  }
+
+  std::cout << "  Indices: " << indices.size() << " tokens, " << wrong
+            << " different from atoi" << std::endl;
+  return wrong == 0;
+}
+
+// Millions of tokens per second for the best of a few passes. The sum
+// keeps the compiler from dropping the parsing.
+template <typename ParseFn>
+double MeasureRate(const Corpus& corpus, ParseFn parse) {
+  std::vector<const char*> ends(corpus.size());
+  for (size_t i = 0; i < corpus.size(); ++i) {
+    ends[i] = corpus.token(i) + strlen(corpus.token(i));
+  }
+
+  double best_ms = 0.0;
+  double sum = 0.0;
+  for (int run = 0; run < kRuns; ++run) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < corpus.size(); ++i) {
+      sum += parse(corpus.token(i), ends[i]);
+    }
+    auto end = std::chrono::steady_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(end - start).count();
+    if (run == 0 || ms < best_ms) {
+      best_ms = ms;
+    }
+  }
+
+  volatile double sink = sum;
+  (void)sink;
+  return corpus.size() / (best_ms * 1000.0);
+}
+
+void PrintRate(const std::string& name, double rate, double base_rate) {
+  std::cout << "  " << std::left << std::setw(16) << name << std::right
+            << std::fixed << std::setprecision(1) << std::setw(8) << rate
+            << " M/s (" << std::setprecision(2) << rate / base_rate << "x)"
+            << std::endl;
+}
+
+int main(int argc, char** argv) {
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; ++i) {
+    paths.push_back(argv[i]);
+  }
+  if (paths.empty()) {
+    paths.push_back("../assets/teapot.obj");
+  }
+
+  Corpus floats;
+  Corpus indices;
+  for (const std::string& path : paths) {
+    if (!ReadObjTokens(path, &floats, &indices)) {
+      std::cerr << "Could not read " << path << std::endl;
+      return 1;
+    }
+  }
+  AddSyntheticTokens(&floats, &indices);
+
+  std::cout << "Corpus" << std::endl;
+  bool floats_ok = CheckFloats(floats);
+  bool indices_ok = CheckIndices(indices);
+
+  double old_rate = MeasureRate(floats, [](const char* s, const char* e) {
+    double value = 0.0;
+    tinyobj::tryParseDouble(s, e, &value);
+    return static_cast<double>(static_cast<float>(value));
+  });
+  double new_rate = MeasureRate(floats, [](const char* s, const char* e) {
+    float value = 0.f;
+    tinyobj::tryParseFloat(s, e, &value);
+    return static_cast<double>(value);
+  });
+  double strtof_rate = MeasureRate(floats, [](const char* s, const char*) {
+    return static_cast<double>(strtof(s, NULL));
+  });
+
+  std::cout << "Floats" << std::endl;
+  PrintRate("tryParseDouble", old_rate, old_rate);
+  PrintRate("tryParseFloat", new_rate, old_rate);
+  PrintRate("strtof", strtof_rate, old_rate);
+
+  double atoi_rate = MeasureRate(indices, [](const char* s, const char*) {
+    const char* token = s;
+    int value = atoi(token);
+    token += strcspn(token, kIndexDelims);
+    return static_cast<double>(value) + (token - s);
+  });
+  double int_rate = MeasureRate(indices, [](const char* s, const char*) {
+    const char* token = s;
+    int value = tinyobj::parseIntUntil(&token, kIndexDelims);
+    return static_cast<double>(value) + (token - s);
+  });
+
+  std::cout << "Indices" << std::endl;
+  PrintRate("atoi + strcspn", atoi_rate, atoi_rate);
+  PrintRate("parseIntUntil", int_rate, atoi_rate);
+
+  return floats_ok && indices_ok ? 0 : 1;
+}
@@ -0,0 +1,204 @@
+// Compares the peak memory and load time of LoadModelFromObj, which goes
+// through tinyobj's attrib and shape arrays, with StreamModelFromObj, which
+// writes faces straight into the model.
+//
+// Usage:
+//   ./obj_import [file.obj ...]
+//
+// With no arguments the teapot is used. A large file can be written with
+// `./obj_parse --generate`. Each load runs in its own child process so that
+// its peak resident set size is measured alone. Both paths are checked to
+// produce identical models, indexed and not.
+
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "model.h"
+
+// Constants
+const int kRuns = 3;
+
+struct LoadResult {
+  bool loaded = false;
+  double ms = 0.0;
+  double peak_mb = 0.0;
+  double model_mb = 0.0;
+  uint64_t hash = 0;
+};
+
+template <typename T>
+uint64_t HashArray(const std::vector<T>& array, uint64_t h) {
+  const unsigned char* bytes =
+      reinterpret_cast<const unsigned char*>(array.data());
+  for (size_t i = 0; i < array.size() * sizeof(T); ++i) {
+    h = (h ^ bytes[i]) * 1099511628211ull;
+  }
+  return h;
+}
+
+// FNV-1a over the model's arrays and counts
+uint64_t HashModel(const Model& model) {
+  uint64_t h = 14695981039346656037ull;
+  h = HashArray(model.positions, h);
+  h = HashArray(model.normals, h);
+  h = HashArray(model.texcoords, h);
+  h = HashArray(model.faces, h);
+  h = (h ^ model.vert_count) * 1099511628211ull;
+  h = (h ^ model.face_count) * 1099511628211ull;
+  h = (h ^ model.indexed_drawing) * 1099511628211ull;
+  return h;
+}
+
+double PeakResidentMb() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / (1024.0 * 1024.0); // Bytes
+#else
+  return usage.ru_maxrss / 1024.0; // Kilobytes
+#endif
+}
+
+// Loads the file in a child process and reports back through a pipe. An
+// empty path loads nothing, to measure the process itself.
+LoadResult LoadInChild(const std::string& path, bool streaming,
+                       bool indexed) {
+  LoadResult result;
+
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return result;
+  }
+
+  pid_t pid = fork();
+  if (pid < 0) {
+    close(fds[0]);
+    close(fds[1]);
+    return result;
+  }
+
+  if (pid == 0) {
+    close(fds[0]);
+    // The loaders print the attribute counts, which would repeat each run
+    if (!freopen("/dev/null", "w", stdout)) {
+      _exit(1);
+    }
+
+    Model model;
+    auto start = std::chrono::steady_clock::now();
+    if (path.empty()) {
+      result.loaded = true;
+    } else if (streaming) {
+      result.loaded = StreamModelFromObj(path, &model, indexed);
+    } else {
+      result.loaded = LoadModelFromObj(path, &model, indexed);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    result.ms = std::chrono::duration<double, std::milli>(end - start).count();
+    result.peak_mb = PeakResidentMb();
+    result.model_mb = (model.positions.size() * sizeof(glm::vec3) +
+                       model.normals.size() * sizeof(glm::vec3) +
+                       model.texcoords.size() * sizeof(glm::vec2) +
+                       model.faces.size() * sizeof(glm::uvec3)) /
+                      (1024.0 * 1024.0);
+    result.hash = HashModel(model);
+
+    ssize_t written = write(fds[1], &result, sizeof(result));
+    _exit(written == sizeof(result) ? 0 : 1);
+  }
+
+  close(fds[1]);
+  ssize_t size = read(fds[0], &result, sizeof(result));
+  close(fds[0]);
+
+  int status = 0;
+  waitpid(pid, &status, 0);
+  if (size != sizeof(result) || !WIFEXITED(status) ||
+      WEXITSTATUS(status) != 0) {
+    result.loaded = false;
+  }
+  return result;
+}
+
+// Best time and largest peak of a few runs
+LoadResult Measure(const std::string& path, bool streaming, bool indexed) {
+  LoadResult best;
+  for (int run = 0; run < kRuns; ++run) {
+    LoadResult result = LoadInChild(path, streaming, indexed);
+    if (!result.loaded) {
+      return result;
+    }
+    if (run == 0 || result.ms < best.ms) {
+      double peak_mb = std::max(best.peak_mb, result.peak_mb);
+      best = result;
+      best.peak_mb = peak_mb;
+    } else {
+      best.peak_mb = std::max(best.peak_mb, result.peak_mb);
+    }
+  }
+  return best;
+}
+
+// The peak is also given as a multiple of the model's size, not counting
+// the memory of the empty process
+void PrintResult(const std::string& name, const LoadResult& result,
+                 double base_mb) {
+  std::cout << "    " << std::left << std::setw(20) << name << std::right
+            << std::fixed << std::setprecision(1)
+            << std::setw(9) << result.ms << " ms"
+            << std::setw(9) << result.peak_mb << " MB peak"
+            << "  (" << std::setprecision(2)
+            << (result.peak_mb - base_mb) / result.model_mb << "x model)"
+            << std::endl;
+}
+
+int main(int argc, char** argv) {
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; ++i) {
+    paths.push_back(argv[i]);
+  }
+  if (paths.empty()) {
+    paths.push_back("../assets/teapot.obj");
+  }
+
+  double base_mb = LoadInChild("", false, false).peak_mb;
+  std::cout << "Empty process: " << std::fixed << std::setprecision(1)
+            << base_mb << " MB peak" << std::endl;
+
+  bool all_same = true;
+  for (const std::string& path : paths) {
+    std::cout << path << std::endl;
+    for (int indexed = 1; indexed >= 0; --indexed) {
+      LoadResult current = Measure(path, false, indexed);
+      LoadResult streaming = Measure(path, true, indexed);
+      if (!current.loaded || !streaming.loaded) {
+        std::cerr << "Failed to load " << path << std::endl;
+        return 1;
+      }
+
+      bool same = current.hash == streaming.hash;
+      all_same = all_same && same;
+
+      std::cout << "  " << (indexed ? "Indexed" : "Not indexed")
+                << ", model " << std::fixed << std::setprecision(1)
+                << current.model_mb << " MB" << std::endl;
+      PrintResult("LoadModelFromObj", current, base_mb);
+      PrintResult("StreamModelFromObj", streaming, base_mb);
+      std::cout << "    Output: " << (same ? "identical" : "DIFFERENT")
+                << std::endl;
+    }
+  }
+
+  return all_same ? 0 : 1;
+}
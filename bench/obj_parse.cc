@@ -0,0 +1,173 @@
+// Compares the single-threaded tinyobj::LoadObj with LoadObjParallel.
+//
+// Usage:
+//   ./obj_parse [file.obj ...]
+//   ./obj_parse --generate <num_triangles> <out.obj>
+//
+// With no arguments the teapot is used. Each file is loaded with both
+// parsers, the results are checked for equality and the best of a few runs
+// is reported.
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+// Constants
+const int kRuns = 3;
+
+struct ObjData {
+  tinyobj::attrib_t attrib;
+  std::vector<tinyobj::shape_t> shapes;
+  std::vector<tinyobj::material_t> materials;
+};
+
+template <typename T>
+bool SameArray(const std::vector<T>& a, const std::vector<T>& b) {
+  return a.size() == b.size() &&
+         (a.empty() || memcmp(&a[0], &b[0], a.size() * sizeof(T)) == 0);
+}
+
+bool SameObjData(const ObjData& a, const ObjData& b) {
+  if (!SameArray(a.attrib.vertices, b.attrib.vertices) ||
+      !SameArray(a.attrib.normals, b.attrib.normals) ||
+      !SameArray(a.attrib.texcoords, b.attrib.texcoords) ||
+      !SameArray(a.attrib.colors, b.attrib.colors) ||
+      a.shapes.size() != b.shapes.size() ||
+      a.materials.size() != b.materials.size()) {
+    return false;
+  }
+
+  for (size_t i = 0; i < a.shapes.size(); ++i) {
+    const tinyobj::mesh_t& ma = a.shapes[i].mesh;
+    const tinyobj::mesh_t& mb = b.shapes[i].mesh;
+    if (a.shapes[i].name != b.shapes[i].name ||
+        !SameArray(ma.indices, mb.indices) ||
+        !SameArray(ma.num_face_vertices, mb.num_face_vertices) ||
+        !SameArray(ma.material_ids, mb.material_ids) ||
+        !SameArray(ma.smoothing_group_ids, mb.smoothing_group_ids)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+double LoadMs(const std::string& path, bool parallel, ObjData* data) {
+  double best_ms = 0.0;
+  for (int run = 0; run < kRuns; ++run) {
+    *data = ObjData();
+    std::string err_msg;
+
+    auto start = std::chrono::steady_clock::now();
+    bool result;
+    if (parallel) {
+      result = tinyobj::LoadObjParallel(&data->attrib, &data->shapes,
+                                        &data->materials, &err_msg,
+                                        path.c_str());
+    } else {
+      result = tinyobj::LoadObj(&data->attrib, &data->shapes,
+                                &data->materials, &err_msg, path.c_str());
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    if (!result) {
+      std::cerr << "Failed to load " << path << ": " << err_msg << std::endl;
+      exit(1);
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(end - start).count();
+    if (run == 0 || ms < best_ms) {
+      best_ms = ms;
+    }
+  }
+  return best_ms;
+}
+
+// Writes a square grid mesh with at least num_triangles triangles
+bool GenerateObj(size_t num_triangles, const std::string& path) {
+  size_t n = static_cast<size_t>(std::ceil(std::sqrt(num_triangles / 2.0)));
+  size_t row = n + 1;
+
+  FILE* fp = fopen(path.c_str(), "w");
+  if (!fp) {
+    return false;
+  }
+
+  fprintf(fp, "# %zu x %zu grid\n", n, n);
+  for (size_t y = 0; y < row; ++y) {
+    for (size_t x = 0; x < row; ++x) {
+      float u = static_cast<float>(x) / n;
+      float v = static_cast<float>(y) / n;
+      float h = 0.1f * std::sin(10.f * u) * std::cos(10.f * v);
+      fprintf(fp, "v %.6f %.6f %.6f\n", u, h, v);
+      fprintf(fp, "vn %.6f %.6f %.6f\n", 0.f, 1.f, 0.f);
+      fprintf(fp, "vt %.6f %.6f\n", u, v);
+    }
+  }
+
+  fprintf(fp, "g grid\n");
+  for (size_t y = 0; y < n; ++y) {
+    for (size_t x = 0; x < n; ++x) {
+      size_t i0 = y * row + x + 1;
+      size_t i1 = i0 + 1;
+      size_t i2 = i0 + row;
+      size_t i3 = i2 + 1;
+      fprintf(fp, "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n",
+              i0, i0, i0, i1, i1, i1, i3, i3, i3);
+      fprintf(fp, "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n",
+              i0, i0, i0, i3, i3, i3, i2, i2, i2);
+    }
+  }
+
+  fclose(fp);
+
+  std::cout << "Wrote " << 2 * n * n << " triangles to " << path
+            << std::endl;
+  return true;
+}
+
+int main(int argc, char** argv) {
+  if (argc == 4 && std::string(argv[1]) == "--generate") {
+    return GenerateObj(strtoull(argv[2], NULL, 10), argv[3]) ? 0 : 1;
+  }
+
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; ++i) {
+    paths.push_back(argv[i]);
+  }
+  if (paths.empty()) {
+    paths.push_back("../assets/teapot.obj");
+  }
+
+  std::cout << "Threads: " << std::thread::hardware_concurrency()
+            << std::endl;
+
+  bool all_same = true;
+  for (size_t i = 0; i < paths.size(); ++i) {
+    ObjData serial_data;
+    ObjData parallel_data;
+    double serial_ms = LoadMs(paths[i], false, &serial_data);
+    double parallel_ms = LoadMs(paths[i], true, &parallel_data);
+    bool same = SameObjData(serial_data, parallel_data);
+    all_same = all_same && same;
+
+    std::cout << paths[i] << std::endl;
+    std::cout << "  LoadObj:         " << serial_ms << " ms" << std::endl;
+    std::cout << "  LoadObjParallel: " << parallel_ms << " ms ("
+              << serial_ms / parallel_ms << "x)" << std::endl;
+    std::cout << "  Output:          " << (same ? "identical" : "DIFFERENT")
+              << std::endl;
+  }
+
+  return all_same ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+// Renders the teapot scene of 04-lighting with the software rasterizer and
+// measures how it scales with the number of threads.
+//
+// Usage:
+//   ./soft_raster [--shading vertex|pixel] [--threads <max>] [--out <ppm>]
+//                 [--reference <ppm>]
+//
+// Vertex shading matches 04-lighting, pixel shading matches the render pass
+// of 08-edgedetect. A GL reference frame can be made with
+//   cd ../04-lighting && ./app --headless 1 --frame-out ref.ppm
+// and is compared against the software image when given.
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "image.h"
+#include "model.h"
+#include "soft_raster.h"
+
+// Constants
+const unsigned int kScreenWidth = 1024;
+const unsigned int kScreenHeight = 768;
+
+const int kRuns = 5;
+
+// Channel difference allowed before a pixel counts as different. Edge
+// pixels also differ where the GPU rounds coverage differently.
+const int kPixelTolerance = 3;
+const double kMaxDifferentFraction = 0.005;
+
+LightingParams SceneParams() {
+  LightingParams params;
+  params.light_position = glm::vec3(0.f, 10.f, 20.f);
+  params.diffuse_param = glm::vec3(1.f, 1.f, 1.f);
+  params.ambient_param = glm::vec3(1.f, 0.f, 0.f);
+  params.specular_param = glm::vec3(1.f, 1.f, 1.f);
+  params.shininess = 4.f;
+
+  params.model_mat = glm::rotate(glm::mat4(1.f), -1.f,
+                                 glm::vec3(1.f, 0.f, 0.f));
+  params.view_mat = glm::translate(glm::mat4(1.f),
+                                   glm::vec3(0.f, 0.f, -50.f));
+  params.proj_mat = glm::perspective(45.f, 1024.f / 768.f, 0.1f, 1000.f);
+  params.normal_mat = glm::transpose(glm::inverse(params.view_mat *
+                                                  params.model_mat));
+  return params;
+}
+
+double RenderMs(const Model& model, const LightingParams& params,
+                ShadingMode shading, unsigned int num_threads, Image* image) {
+  double best_ms = 0.0;
+  for (int run = 0; run < kRuns; ++run) {
+    auto start = std::chrono::steady_clock::now();
+    RenderLightingSoftware(model, params, shading, kScreenWidth,
+                           kScreenHeight, num_threads, image);
+    auto end = std::chrono::steady_clock::now();
+
+    double ms = std::chrono::duration<double, std::milli>(end - start).count();
+    if (run == 0 || ms < best_ms) {
+      best_ms = ms;
+    }
+  }
+  return best_ms;
+}
+
+bool CompareImages(const Image& image, const Image& reference) {
+  if (image.width != reference.width || image.height != reference.height) {
+    std::cerr << "Reference is " << reference.width << "x"
+              << reference.height << ", expected " << image.width << "x"
+              << image.height << std::endl;
+    return false;
+  }
+
+  size_t pixel_count = image.width * image.height;
+  size_t different = 0;
+  int max_diff = 0;
+  for (size_t i = 0; i < pixel_count; ++i) {
+    int pixel_diff = 0;
+    for (int c = 0; c < 3; ++c) {
+      int diff = std::abs(static_cast<int>(image.pixels[i * 3 + c]) -
+                          static_cast<int>(reference.pixels[i * 3 + c]));
+      pixel_diff = std::max(pixel_diff, diff);
+    }
+    max_diff = std::max(max_diff, pixel_diff);
+    if (pixel_diff > kPixelTolerance) {
+      ++different;
+    }
+  }
+
+  double fraction = static_cast<double>(different) / pixel_count;
+  bool pass = fraction <= kMaxDifferentFraction;
+
+  std::cout << "Reference: " << different << " of " << pixel_count
+            << " pixels differ by more than " << kPixelTolerance << " ("
+            << fraction * 100.0 << "%), max difference " << max_diff
+            << (pass ? " - PASS" : " - FAIL") << std::endl;
+  return pass;
+}
+
+int main(int argc, char** argv) {
+  ShadingMode shading = kShadePerVertex;
+  unsigned int max_threads = std::max(std::thread::hardware_concurrency(),
+                                      1u);
+  std::string out_path = "soft_raster.ppm";
+  std::string reference_path;
+
+  for (int i = 1; i < argc; ++i) {
+    bool has_value = i + 1 < argc;
+    if (strcmp(argv[i], "--shading") == 0 && has_value) {
+      shading = strcmp(argv[++i], "pixel") == 0 ? kShadePerPixel
+                                                : kShadePerVertex;
+    } else if (strcmp(argv[i], "--threads") == 0 && has_value) {
+      max_threads = std::max(atoi(argv[++i]), 1);
+    } else if (strcmp(argv[i], "--out") == 0 && has_value) {
+      out_path = argv[++i];
+    } else if (strcmp(argv[i], "--reference") == 0 && has_value) {
+      reference_path = argv[++i];
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--shading vertex|pixel]"
+                << " [--threads <max>] [--out <ppm>] [--reference <ppm>]"
+                << std::endl;
+      return 1;
+    }
+  }
+
+  Model model;
+  if (!CreateModelFromFile("../assets/teapot.obj", &model, true)) {
+    std::cerr << "Could not load the teapot" << std::endl;
+    return 1;
+  }
+
+  LightingParams params = SceneParams();
+  Image image;
+
+  std::cout << "Shading: "
+            << (shading == kShadePerVertex ? "per vertex" : "per pixel")
+            << ", " << kScreenWidth << "x" << kScreenHeight << std::endl;
+
+  // Powers of two up to, and always including, the maximum thread count
+  std::vector<unsigned int> thread_counts;
+  for (unsigned int threads = 1; threads < max_threads; threads *= 2) {
+    thread_counts.push_back(threads);
+  }
+  thread_counts.push_back(max_threads);
+
+  double single_ms = 0.0;
+  for (unsigned int threads : thread_counts) {
+    double ms = RenderMs(model, params, shading, threads, &image);
+    if (threads == 1) {
+      single_ms = ms;
+    }
+    std::cout << "  " << threads << " threads: " << ms << " ms ("
+              << single_ms / ms << "x)" << std::endl;
+  }
+
+  if (!SaveImagePPM(out_path, image)) {
+    return 1;
+  }
+  std::cout << "Wrote " << out_path << std::endl;
+
+  if (!reference_path.empty()) {
+    Image reference;
+    if (!LoadImagePPM(reference_path, &reference) ||
+        !CompareImages(image, reference)) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
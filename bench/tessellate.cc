@@ -0,0 +1,245 @@
+// Measures CPU tessellation throughput in patches per second for Bezier
+// curves, bilinear patches and bicubic Bezier patches, comparing
+// TessellatePatches against scalar direct evaluation. Also checks that
+// quad domains cover the unit square with counterclockwise triangles for a
+// range of levels, and that both evaluations agree.
+//
+// Usage:
+//   ./tessellate [--level <level>] [--patches <count>] [--threads <max>]
+//
+// The level (16 by default) is used for every outer and inner level.
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <random>
+#include <algorithm>
+#include <functional>
+
+#include "glm/glm.hpp"
+
+#include "model.h"
+#include "tessellation.h"
+
+// Constants
+const int kRuns = 5;
+
+// Largest difference allowed between the two evaluations, relative to the
+// size of the control points (about 1) and in degrees for normals
+const float kMaxPositionError = 1e-5f;
+const float kMaxNormalDegrees = 0.01f;
+
+// Patches of the given type around the samples' control points, randomly
+// displaced so that no two are the same
+std::vector<glm::vec3> MakePatches(PatchType type, unsigned int count) {
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> jitter(-0.2f, 0.2f);
+
+  std::vector<glm::vec3> base;
+  if (type == kBezierCurve) {
+    // 06-bezier
+    base = {glm::vec3(-1.f, -1.f, 0.f), glm::vec3(-0.8f, 1.f, 0.f),
+            glm::vec3(0.8f, -1.f, 0.f), glm::vec3(1.f, 1.f, 0.f)};
+  } else if (type == kBilinearPatch) {
+    // 07-tess2d
+    base = {glm::vec3(-1.f, -1.f, 0.f), glm::vec3(1.f, -1.f, 0.f),
+            glm::vec3(1.f, 1.f, 0.f), glm::vec3(-1.f, 1.f, 0.f)};
+  } else {
+    for (int j = 0; j < 4; ++j) {
+      for (int i = 0; i < 4; ++i) {
+        base.push_back(glm::vec3(i / 1.5f - 1.f, j / 1.5f - 1.f, 0.f));
+      }
+    }
+  }
+
+  std::vector<glm::vec3> control_points;
+  for (unsigned int patch = 0; patch < count; ++patch) {
+    for (const glm::vec3& point : base) {
+      control_points.push_back(point + glm::vec3(jitter(rng), jitter(rng),
+                                                 jitter(rng)));
+    }
+  }
+  return control_points;
+}
+
+// Best of kRuns, in patches per second
+double MeasurePatchesPerSecond(size_t patch_count,
+                               const std::function<void()>& tessellate) {
+  double best_ms = 0.0;
+  for (int run = 0; run < kRuns; ++run) {
+    auto start = std::chrono::steady_clock::now();
+    tessellate();
+    auto end = std::chrono::steady_clock::now();
+
+    double ms = std::chrono::duration<double, std::milli>(end - start).count();
+    if (run == 0 || ms < best_ms) {
+      best_ms = ms;
+    }
+  }
+  return patch_count / (best_ms / 1000.0);
+}
+
+// Returns the number of problems found in the domain of the given levels
+unsigned int CheckQuadDomain(const QuadTessLevels& levels) {
+  TessDomain domain;
+  if (!BuildQuadDomain(levels, &domain)) {
+    return 1;
+  }
+
+  int outer = 0;
+  for (int k = 0; k < 4; ++k) {
+    outer += EqualSpacingLevel(levels.outer[k]);
+  }
+  int m = std::max(EqualSpacingLevel(levels.inner[0]), 2);
+  int n = std::max(EqualSpacingLevel(levels.inner[1]), 2);
+  size_t expected = domain.triangles.size() == 2
+                        ? 4 : static_cast<size_t>(outer + (m - 1) * (n - 1));
+
+  unsigned int problems = 0;
+  if (domain.coords.size() != expected) {
+    std::cerr << "  " << domain.coords.size() << " coordinates instead of "
+              << expected << std::endl;
+    ++problems;
+  }
+
+  double area = 0.0;
+  for (const glm::uvec3& triangle : domain.triangles) {
+    glm::vec2 a = domain.coords[triangle.x];
+    glm::vec2 b = domain.coords[triangle.y];
+    glm::vec2 c = domain.coords[triangle.z];
+    double signed_area = 0.5 * ((b.x - a.x) * (c.y - a.y) -
+                                (c.x - a.x) * (b.y - a.y));
+    if (signed_area <= 0.0) {
+      ++problems;
+    }
+    area += signed_area;
+  }
+  if (std::abs(area - 1.0) > 1e-5) {
+    std::cerr << "  Triangles cover an area of " << area << std::endl;
+    ++problems;
+  }
+
+  return problems;
+}
+
+int main(int argc, char** argv) {
+  float level = 16.f;
+  unsigned int patch_count = 4096;
+  unsigned int max_threads = std::max(std::thread::hardware_concurrency(),
+                                      1u);
+
+  for (int i = 1; i < argc; ++i) {
+    bool has_value = i + 1 < argc;
+    if (strcmp(argv[i], "--level") == 0 && has_value) {
+      level = static_cast<float>(atof(argv[++i]));
+    } else if (strcmp(argv[i], "--patches") == 0 && has_value) {
+      patch_count = std::max(atoi(argv[++i]), 1);
+    } else if (strcmp(argv[i], "--threads") == 0 && has_value) {
+      max_threads = std::max(atoi(argv[++i]), 1);
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--level <level>]"
+                << " [--patches <count>] [--threads <max>]" << std::endl;
+      return 1;
+    }
+  }
+
+  // Every combination of small levels, including fractional ones and the
+  // special cases of inner levels of 1
+  const float test_levels[] = {1.f, 1.5f, 2.f, 3.f, 4.2f, 7.f};
+  unsigned int problems = 0;
+  unsigned int domains = 0;
+  for (float a : test_levels) {
+    for (float b : test_levels) {
+      for (float inner_u : test_levels) {
+        for (float inner_v : test_levels) {
+          QuadTessLevels levels = {{a, b, b, a}, {inner_u, inner_v}};
+          problems += CheckQuadDomain(levels);
+          ++domains;
+        }
+      }
+    }
+  }
+  std::cout << "Quad domains: " << domains << " checked, " << problems
+            << " problems" << (problems == 0 ? " - PASS" : " - FAIL")
+            << std::endl;
+
+  // Powers of two up to, and always including, the maximum thread count
+  std::vector<unsigned int> thread_counts;
+  for (unsigned int threads = 1; threads < max_threads; threads *= 2) {
+    thread_counts.push_back(threads);
+  }
+  thread_counts.push_back(max_threads);
+
+  const PatchType types[] = {kBezierCurve, kBilinearPatch, kBezierPatch};
+  const char* const type_names[] = {"bezier curves", "bilinear patches",
+                                    "bezier patches"};
+
+  for (int t = 0; t < 3; ++t) {
+    PatchType type = types[t];
+
+    TessDomain domain;
+    if (type == kBezierCurve) {
+      BuildIsolineDomain(1.f, level, &domain);
+    } else {
+      QuadTessLevels levels = {{level, level, level, level}, {level, level}};
+      BuildQuadDomain(levels, &domain);
+    }
+
+    std::vector<glm::vec3> control_points = MakePatches(type, patch_count);
+
+    std::cout << type_names[t] << ": " << domain.coords.size()
+              << " vertices per patch" << std::endl;
+
+    Model reference;
+    double reference_pps = MeasurePatchesPerSecond(patch_count, [&]() {
+      TessellatePatchesReference(type, control_points, domain, &reference);
+    });
+    std::cout << "  direct evaluation: " << reference_pps << " patches/s"
+              << std::endl;
+
+    Model model;
+    for (unsigned int threads : thread_counts) {
+      double pps = MeasurePatchesPerSecond(patch_count, [&]() {
+        TessellatePatches(type, control_points, domain, threads, &model);
+      });
+      std::cout << "  TessellatePatches, " << threads << " threads: "
+                << pps << " patches/s (" << pps / reference_pps << "x)"
+                << std::endl;
+    }
+
+    float position_error = 0.f;
+    float normal_degrees = 0.f;
+    for (size_t i = 0; i < model.positions.size(); ++i) {
+      glm::vec3 diff = glm::abs(model.positions[i] - reference.positions[i]);
+      position_error = std::max(position_error,
+                                std::max(std::max(diff.x, diff.y), diff.z));
+      if (!model.normals.empty()) {
+        // From the chord rather than acos of the dot product, which cannot
+        // resolve angles below a few hundredths of a degree in float
+        float chord = glm::length(model.normals[i] - reference.normals[i]);
+        float angle = glm::degrees(2.f * std::asin(std::min(chord / 2.f,
+                                                            1.f)));
+        normal_degrees = std::max(normal_degrees, angle);
+      }
+    }
+
+    bool pass = position_error <= kMaxPositionError &&
+                normal_degrees <= kMaxNormalDegrees &&
+                model.faces == reference.faces;
+    std::cout << "  max difference from direct evaluation: "
+              << position_error;
+    if (!model.normals.empty()) {
+      std::cout << ", normals " << normal_degrees << " degrees";
+    }
+    std::cout << (pass ? " - PASS" : " - FAIL") << std::endl;
+
+    problems += pass ? 0 : 1;
+  }
+
+  return problems == 0 ? 0 : 1;
+}
@@ -0,0 +1,167 @@
+// Packs models into each vertex format and checks the quantization error of
+// every attribute against the bound its encoding guarantees.
+//
+// Usage:
+//   ./vertex_format [file.obj ...]
+//
+// With no arguments the teapot is used. Exits with 1 if any attribute is
+// further from the original than its format allows.
+
+#include <iostream>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "glm/glm.hpp"
+
+#include "model.h"
+#include "vertex_format.h"
+
+// Constants
+
+// Round to nearest gives at most half a step of error. The small slack
+// covers float rounding in the encode and decode arithmetic.
+const float kHalfRelativeBound = 1.f / 2048.f * 1.0001f;
+const float kHalfSubnormalBound = 1.f / 33554432.f; // 2^-25
+const float kSnormBound = 0.5f / 511.f + 1e-6f;
+
+struct FormatReport {
+  float max_position_error = 0.f;
+  float max_normal_error = 0.f;
+  float max_normal_angle = 0.f; // Degrees
+  float max_texcoord_error = 0.f;
+  unsigned int tiled_texcoords = 0; // Outside [0, 1]
+  unsigned int violations = 0;
+};
+
+// Error bound of a value stored as a half float
+float HalfBound(float original) {
+  return std::max(std::abs(original) * kHalfRelativeBound,
+                  kHalfSubnormalBound);
+}
+
+float MaxComponent(const glm::vec3& v) {
+  return std::max(std::max(std::abs(v.x), std::abs(v.y)), std::abs(v.z));
+}
+
+FormatReport CheckFormat(const Model& model, const PackedVertices& packed) {
+  FormatReport report;
+
+  for (unsigned int i = 0; i < packed.vert_count; ++i) {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 texcoord;
+    UnpackVertex(packed, i, &position, &normal, &texcoord);
+
+    if (packed.position_offset >= 0) {
+      for (int c = 0; c < 3; ++c) {
+        float original = model.positions[i][c];
+        float error = std::abs(position[c] - original);
+        float bound = packed.half_positions ? HalfBound(original) : 0.f;
+        report.max_position_error = std::max(report.max_position_error,
+                                             error);
+        report.violations += error > bound;
+      }
+    }
+
+    if (packed.normal_offset >= 0) {
+      glm::vec3 original = model.normals[i];
+      float error = MaxComponent(normal - glm::clamp(original, -1.f, 1.f));
+      report.max_normal_error = std::max(report.max_normal_error, error);
+      report.violations += error > kSnormBound;
+
+      if (glm::length(original) > 0.f && glm::length(normal) > 0.f) {
+        float cos_angle = glm::dot(glm::normalize(original),
+                                   glm::normalize(normal));
+        float angle = glm::degrees(std::acos(glm::clamp(cos_angle, -1.f,
+                                                        1.f)));
+        report.max_normal_angle = std::max(report.max_normal_angle, angle);
+      }
+    }
+
+    if (packed.texcoord_offset >= 0) {
+      glm::vec2 original = model.texcoords[i];
+      report.tiled_texcoords +=
+          glm::clamp(original, 0.f, 1.f) != original;
+
+      // Compared against the original, so any clamping is a violation
+      for (int c = 0; c < 2; ++c) {
+        float error = std::abs(texcoord[c] - original[c]);
+        report.max_texcoord_error = std::max(report.max_texcoord_error,
+                                             error);
+        report.violations += !(error <= HalfBound(original[c]));
+      }
+    }
+  }
+
+  return report;
+}
+
+int main(int argc, char** argv) {
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; ++i) {
+    paths.push_back(argv[i]);
+  }
+  if (paths.empty()) {
+    paths.push_back("../assets/teapot.obj");
+  }
+
+  const unsigned int attribs = kMeshPositions | kMeshNormals |
+                               kMeshTexcoords;
+  const VertexFormat formats[] = {kVertexPacked, kVertexPackedHalf};
+  const char* const format_names[] = {"packed", "packed half"};
+
+  unsigned int total_violations = 0;
+  for (const std::string& path : paths) {
+    Model model;
+    if (!CreateModelFromFile(path, &model, true)) {
+      std::cerr << "Could not load " << path << std::endl;
+      return 1;
+    }
+
+    unsigned int separate_size = 3 * sizeof(float);
+    separate_size += model.normals.size() >= model.vert_count
+                         ? 3 * sizeof(float) : 0;
+    separate_size += model.texcoords.size() >= model.vert_count
+                         ? 2 * sizeof(float) : 0;
+
+    std::cout << path << " (" << model.vert_count << " vertices)"
+              << std::endl;
+    std::cout << "  separate: " << separate_size << " bytes/vertex"
+              << std::endl;
+
+    for (int f = 0; f < 2; ++f) {
+      PackedVertices packed;
+      if (!PackVertices(model, attribs, formats[f], &packed)) {
+        return 1;
+      }
+
+      FormatReport report = CheckFormat(model, packed);
+      total_violations += report.violations;
+
+      std::cout << "  " << format_names[f] << ": " << packed.stride
+                << " bytes/vertex" << std::endl;
+      std::cout << "    position error: " << report.max_position_error
+                << std::endl;
+      if (packed.normal_offset >= 0) {
+        std::cout << "    normal error:   " << report.max_normal_error
+                  << " (" << report.max_normal_angle << " degrees)"
+                  << std::endl;
+      }
+      if (packed.texcoord_offset >= 0) {
+        std::cout << "    texcoord error: " << report.max_texcoord_error;
+        if (report.tiled_texcoords > 0) {
+          std::cout << " (" << report.tiled_texcoords
+                    << " outside [0, 1])";
+        }
+        std::cout << std::endl;
+      }
+      std::cout << "    " << (report.violations == 0 ? "within bounds"
+                                                     : "OUT OF BOUNDS")
+                << std::endl;
+    }
+  }
+
+  return total_violations == 0 ? 0 : 1;
+}
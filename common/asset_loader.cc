@@ -0,0 +1,322 @@
+#include "asset_loader.h"
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "opengl.h"
+#include "gl_caps.h"
+#include "mesh.h"
+#include "model.h"
+#include "parallel.h"
+
+namespace {
+
+// Gives up on a fence after one second, in case the context was lost
+const GLuint64 kFenceTimeoutNs = 1000000000;
+
+// Amount copied between checks of the frame's time budget
+const size_t kUploadChunkBytes = 256 << 10;
+
+double MsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+AssetLoader::AssetLoader() : stopping_(false),
+                             pending_(0),
+                             staging_buffer_id_(0),
+                             mapped_(NULL),
+                             region_index_(0) {
+  for (unsigned int i = 0; i < kAssetStagingFrames; ++i) {
+    fences_[i] = 0;
+  }
+}
+
+AssetLoader::~AssetLoader() {
+  StopWorkers();
+}
+
+bool AssetLoader::Init(const AssetLoaderOptions& options) {
+  Destroy();
+
+  options_ = options;
+  if (options_.frame_upload_bytes == 0) {
+    std::cerr << "Asset upload budget must be positive" << std::endl;
+    return false;
+  }
+
+  GLsizeiptr buffer_size = options_.frame_upload_bytes * kAssetStagingFrames;
+  glGenBuffers(1, &staging_buffer_id_);
+  glBindBuffer(GL_COPY_READ_BUFFER, staging_buffer_id_);
+
+#ifdef GL_MAP_PERSISTENT_BIT
+  // glBufferStorage is core in 4.4 and otherwise needs ARB_buffer_storage
+  if (HasGLVersion(4, 4) || HasGLExtension("GL_ARB_buffer_storage")) {
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT |
+                             GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_COPY_READ_BUFFER, buffer_size, NULL, flags);
+    mapped_ = static_cast<uint8_t*>(
+        glMapBufferRange(GL_COPY_READ_BUFFER, 0, buffer_size, flags));
+  }
+#endif
+
+  if (mapped_ == NULL) {
+    glBufferData(GL_COPY_READ_BUFFER, buffer_size, NULL, GL_STREAM_COPY);
+  }
+
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+  unsigned int threads = options_.num_threads;
+  if (threads == 0) {
+    threads = std::max(ResolveThreadCount(0), 2u) - 1;
+  }
+  stopping_ = false;
+  for (unsigned int i = 0; i < threads; ++i) {
+    workers_.push_back(std::thread(&AssetLoader::RunWorker, this));
+  }
+
+  region_index_ = 0;
+  init_time_ = std::chrono::steady_clock::now();
+  stats_ = AssetLoaderStats();
+
+  return true;
+}
+
+void AssetLoader::StopWorkers() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    jobs_.clear();
+  }
+  jobs_cv_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+  workers_.clear();
+  loaded_jobs_.clear();
+}
+
+void AssetLoader::Destroy() {
+  StopWorkers();
+  uploads_.clear();
+  pending_ = 0;
+
+  for (unsigned int i = 0; i < kAssetStagingFrames; ++i) {
+    if (fences_[i] != 0) {
+      glDeleteSync(fences_[i]);
+      fences_[i] = 0;
+    }
+  }
+
+  if (staging_buffer_id_ != 0) {
+    if (mapped_ != NULL) {
+      glBindBuffer(GL_COPY_READ_BUFFER, staging_buffer_id_);
+      glUnmapBuffer(GL_COPY_READ_BUFFER);
+      glBindBuffer(GL_COPY_READ_BUFFER, 0);
+      mapped_ = NULL;
+    }
+    glDeleteBuffers(1, &staging_buffer_id_);
+    staging_buffer_id_ = 0;
+  }
+}
+
+void AssetLoader::LoadMesh(const MeshRequest& request, Mesh* mesh) {
+  std::unique_ptr<Job> job(new Job());
+  job->request = request;
+  job->mesh = mesh;
+  ++pending_;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.push_back(std::move(job));
+  }
+  jobs_cv_.notify_one();
+}
+
+void AssetLoader::RunWorker() {
+  while (true) {
+    std::unique_ptr<Job> job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      jobs_cv_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+      if (stopping_) {
+        return;
+      }
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+    }
+
+    const MeshRequest& request = job->request;
+    Model model;
+    job->data.reset(new MeshData());
+    job->loaded =
+        CreateModelFromFile(request.path, &model, request.indexed) &&
+        (!request.process || request.process(&model)) &&
+        PrepareMeshData(&model, request.attribs, request.format,
+                        job->data.get());
+    if (!job->loaded) {
+      std::cerr << "Could not load mesh: " << request.path << std::endl;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    loaded_jobs_.push_back(std::move(job));
+  }
+}
+
+void AssetLoader::WaitForRegion() {
+  GLsync& fence = fences_[region_index_];
+  if (fence == 0) {
+    return;
+  }
+
+  GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                   kFenceTimeoutNs);
+  if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED) {
+    std::cerr << "Asset staging fence was not signaled" << std::endl;
+  }
+
+  glDeleteSync(fence);
+  fence = 0;
+}
+
+void AssetLoader::Update() {
+  auto start = std::chrono::steady_clock::now();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (!loaded_jobs_.empty()) {
+      uploads_.push_back(std::move(loaded_jobs_.front()));
+      loaded_jobs_.pop_front();
+    }
+  }
+  if (uploads_.empty() || staging_buffer_id_ == 0) {
+    return;
+  }
+
+  WaitForRegion();
+
+  const size_t region_size = options_.frame_upload_bytes;
+  const GLintptr region_offset = region_size * region_index_;
+  uint8_t* staging = NULL;
+  if (mapped_ != NULL) {
+    staging = mapped_ + region_offset;
+  } else {
+    // The fence waited on above guarantees the GPU is done with this
+    // region, so the driver does not need to synchronize
+    glBindBuffer(GL_COPY_READ_BUFFER, staging_buffer_id_);
+    staging = static_cast<uint8_t*>(glMapBufferRange(
+        GL_COPY_READ_BUFFER, region_offset, region_size,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+        GL_MAP_UNSYNCHRONIZED_BIT));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    if (staging == NULL) {
+      std::cerr << "Could not map asset staging buffer" << std::endl;
+      return;
+    }
+  }
+
+  // Fills the region from the front of the queue. Meshes are allocated
+  // when their turn comes, so that only one is partly filled at a time.
+  // Allocating counts against the time budget too, as drivers may back
+  // the buffers with memory right away.
+  std::vector<std::unique_ptr<Job>> done;
+  copies_.clear();
+  size_t written = 0;
+  bool worked = false;
+  while (written < region_size && !uploads_.empty() &&
+         (!worked || MsSince(start) < options_.frame_upload_ms)) {
+    worked = true;
+    Job& job = *uploads_.front();
+    if (job.loaded && !job.allocated) {
+      job.loaded = job.mesh->Allocate(*job.data, &job.ranges);
+      job.allocated = true;
+      continue;
+    }
+    if (!job.loaded || job.range_index == job.ranges.size()) {
+      done.push_back(std::move(uploads_.front()));
+      uploads_.pop_front();
+      continue;
+    }
+
+    const MeshBufferRange& range = job.ranges[job.range_index];
+    size_t size = std::min(std::min(range.size - job.range_offset,
+                                    region_size - written),
+                           kUploadChunkBytes);
+    if (size > 0) {
+      std::memcpy(staging + written,
+                  static_cast<const uint8_t*>(range.data) + job.range_offset,
+                  size);
+      StagedCopy copy;
+      copy.buffer_id = range.buffer_id;
+      copy.staging_offset = region_offset + written;
+      copy.offset = job.range_offset;
+      copy.size = size;
+      copies_.push_back(copy);
+    }
+
+    written += size;
+    job.range_offset += size;
+    if (job.range_offset == range.size) {
+      ++job.range_index;
+      job.range_offset = 0;
+    }
+  }
+
+  // A mesh whose last bytes went into this region is done too
+  while (!uploads_.empty() &&
+         uploads_.front()->allocated &&
+         uploads_.front()->range_index == uploads_.front()->ranges.size()) {
+    done.push_back(std::move(uploads_.front()));
+    uploads_.pop_front();
+  }
+
+  if (mapped_ == NULL) {
+    glBindBuffer(GL_COPY_READ_BUFFER, staging_buffer_id_);
+    glUnmapBuffer(GL_COPY_READ_BUFFER);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  }
+
+  if (!copies_.empty()) {
+    glBindBuffer(GL_COPY_READ_BUFFER, staging_buffer_id_);
+    for (const StagedCopy& copy : copies_) {
+      glBindBuffer(GL_COPY_WRITE_BUFFER, copy.buffer_id);
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                          copy.staging_offset, copy.offset, copy.size);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    fences_[region_index_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    region_index_ = (region_index_ + 1) % kAssetStagingFrames;
+  }
+
+  // The copies above come before any draw the callbacks lead to
+  for (std::unique_ptr<Job>& job : done) {
+    --pending_;
+    if (job->loaded) {
+      ++stats_.meshes_ready;
+      stats_.ready_ms = MsSince(init_time_);
+    }
+    if (job->request.on_ready) {
+      job->request.on_ready(job->loaded);
+    }
+  }
+
+  if (worked) {
+    double ms = MsSince(start);
+    stats_.bytes_uploaded += written;
+    ++stats_.upload_frames;
+    stats_.upload_ms += ms;
+    stats_.max_upload_ms = std::max(stats_.max_upload_ms, ms);
+  }
+}
@@ -0,0 +1,151 @@
+#ifndef ASSET_LOADER_H_
+#define ASSET_LOADER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "opengl.h"
+#include "mesh.h"
+#include "model.h"
+#include "vertex_format.h"
+
+// Frames an upload's staging region may stay in use by the GPU
+const unsigned int kAssetStagingFrames = 3;
+
+struct AssetLoaderOptions {
+  // 0 uses all hardware threads but one, which is left to the GL thread
+  unsigned int num_threads = 0;
+
+  // Most bytes copied into meshes per frame, which is also the size of
+  // each frame's staging region
+  size_t frame_upload_bytes = 4 << 20;
+
+  // Update() stops copying once it has spent this long in a frame, so that
+  // slow copies do not push the frame past its target
+  double frame_upload_ms = 2.0;
+};
+
+struct MeshRequest {
+  std::string path; // OBJ file, see CreateModelFromFile
+  bool indexed = true;
+  unsigned int attribs = kMeshPositions | kMeshNormals;
+  VertexFormat format = kVertexSeparate;
+
+  // Called on a worker thread after loading, e.g. to optimize the model.
+  // Returning false fails the request.
+  std::function<bool(Model*)> process;
+
+  // Called on the GL thread once the mesh is filled and may be drawn, or
+  // with false if the model could not be loaded
+  std::function<void(bool)> on_ready;
+};
+
+struct AssetLoaderStats {
+  unsigned int meshes_ready = 0;
+  size_t bytes_uploaded = 0;
+
+  unsigned int upload_frames = 0; // Frames that allocated or copied
+  double upload_ms = 0.0;         // GL thread time spent in those frames
+  double max_upload_ms = 0.0;     // Most of it in a single frame
+
+  double ready_ms = 0.0; // From Init() until the last mesh became ready
+};
+
+// Loads meshes without stalling the frame loop. Models are read, processed
+// and converted to their buffer layout (see PrepareMeshData) on a pool of
+// worker threads. Update(), called once per frame on the GL thread, then
+// fills the meshes' buffers a budgeted amount at a time: it writes into a
+// staging buffer mapped with GL_MAP_UNSYNCHRONIZED_BIT, or persistently
+// where buffer storage is available, and copies from there with
+// glCopyBufferSubData. Each frame has its own staging region, guarded by a
+// fence as in UniformRing. All methods are called from the GL thread.
+//
+// Destroy() must be called explicitly while the GL context is alive. It
+// waits for the models being loaded to finish. The destructor only stops
+// the workers.
+class AssetLoader {
+ public:
+  AssetLoader();
+  ~AssetLoader();
+
+  AssetLoader(const AssetLoader&) = delete;
+  AssetLoader& operator=(const AssetLoader&) = delete;
+
+  bool Init(const AssetLoaderOptions& options = AssetLoaderOptions());
+  void Destroy();
+
+  // Queues the model for loading into mesh, which must outlive the request
+  void LoadMesh(const MeshRequest& request, Mesh* mesh);
+
+  // Uploads the next pieces of the loaded meshes and calls on_ready for
+  // those that are done
+  void Update();
+
+  // Requests whose on_ready has not been called yet
+  unsigned int pending() const { return pending_; }
+
+  const AssetLoaderStats& stats() const { return stats_; }
+
+ private:
+  struct Job {
+    MeshRequest request;
+    Mesh* mesh = NULL;
+    bool loaded = false;
+    std::unique_ptr<MeshData> data;
+
+    // Upload progress, once the mesh is allocated
+    bool allocated = false;
+    std::vector<MeshBufferRange> ranges;
+    size_t range_index = 0;
+    size_t range_offset = 0;
+  };
+
+  // Copy from the staging buffer into a mesh buffer
+  struct StagedCopy {
+    GLuint buffer_id;
+    GLintptr staging_offset;
+    GLintptr offset;
+    GLsizeiptr size;
+  };
+
+  void RunWorker();
+
+  // Joins the workers, dropping the requests they have not started
+  void StopWorkers();
+
+  // Waits until the GPU has finished with the current staging region
+  void WaitForRegion();
+
+  AssetLoaderOptions options_;
+  std::vector<std::thread> workers_;
+
+  // Shared with the workers
+  std::mutex mutex_;
+  std::condition_variable jobs_cv_;
+  std::deque<std::unique_ptr<Job>> jobs_;
+  std::deque<std::unique_ptr<Job>> loaded_jobs_;
+  bool stopping_;
+
+  // GL thread only
+  std::deque<std::unique_ptr<Job>> uploads_;
+  unsigned int pending_;
+  GLuint staging_buffer_id_;
+  uint8_t* mapped_;
+  unsigned int region_index_;
+  GLsync fences_[kAssetStagingFrames];
+  std::vector<StagedCopy> copies_;
+
+  std::chrono::steady_clock::time_point init_time_;
+  AssetLoaderStats stats_;
+};
+
+#endif
@@ -0,0 +1,768 @@
+#include "bvh.h"
+
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "parallel.h"
+#include "simd.h"
+
+namespace {
+
+// Centroid bins per axis when evaluating splits
+const unsigned int kBins = 16;
+
+// Levels of the binary tree. A range that reaches the last level becomes a
+// leaf however many faces it has, which bounds the traversal stack.
+const unsigned int kMaxDepth = 64;
+
+// A wide node pushes at most 7 more entries than it pops
+const int kStackSize = 7 * kMaxDepth + 1;
+
+// Ranges at least this large are binned by all threads together before
+// the tree is split into subtrees that each thread builds on its own
+const size_t kMinParallelBinSize = 1 << 16;
+const size_t kMinSubtreeSize = 1 << 12;
+const unsigned int kSubtreesPerThread = 4;
+
+// Smallest direction component, so that inverting it stays finite
+const float kMinDirection = 1e-20f;
+
+// Scales the distance at which a ray leaves a box so that rounding in the
+// slab test never misses a box the ray touches (Ize, "Robust BVH ray
+// traversal")
+const float kFarScale = 1.f + 6.f * 0.5f * 1.1920929e-7f;
+
+// Largest offset of a quantized child plane from its node's origin
+const int kMaxQuantized = 255;
+
+// 2^exponent, built from the bits since ldexp is slow. The exponent must
+// be in the range of normal floats, [-126, 127].
+inline float ExponentScale(int exponent) {
+  uint32_t bits = static_cast<uint32_t>(exponent + 127) << 23;
+  float scale;
+  std::memcpy(&scale, &bits, sizeof(scale));
+  return scale;
+}
+
+// Quantizes the planes of count boxes along one axis to offsets from
+// origin in steps of 2^exponent, picking the smallest exponent at which
+// every box fits. Planes round outwards, so a quantized box always holds
+// the box it stands for.
+void QuantizeAxis(const float* mins, const float* maxs, int count,
+                  float origin, int8_t* exponent, uint8_t* q_min,
+                  uint8_t* q_max) {
+  float extent = 0.f;
+  for (int i = 0; i < count; ++i) {
+    extent = std::max(extent, maxs[i] - origin);
+  }
+  int e = -126;
+  if (extent > 0.f) {
+    std::frexp(extent / kMaxQuantized, &e);
+    e = std::max(e, -126);
+  }
+
+  for (; e <= 127; ++e) {
+    const float scale = ExponentScale(e);
+    bool fits = true;
+    for (int i = 0; i < count; ++i) {
+      // The products are exact, so these match the planes that the box
+      // test reconstructs
+      int lo = static_cast<int>(std::floor((mins[i] - origin) / scale));
+      lo = std::max(lo, 0);
+      while (lo > 0 && origin + static_cast<float>(lo) * scale > mins[i]) {
+        --lo;
+      }
+      int hi = static_cast<int>(std::ceil((maxs[i] - origin) / scale));
+      hi = std::max(hi, lo);
+      while (hi <= kMaxQuantized &&
+             origin + static_cast<float>(hi) * scale < maxs[i]) {
+        ++hi;
+      }
+      if (hi > kMaxQuantized) {
+        fits = false;
+        break;
+      }
+      q_min[i] = static_cast<uint8_t>(lo);
+      q_max[i] = static_cast<uint8_t>(hi);
+    }
+    if (fits) {
+      *exponent = static_cast<int8_t>(e);
+      return;
+    }
+  }
+  // Only reachable with boxes spanning most of the float range
+  *exponent = 127;
+  std::fill(q_min, q_min + count, 0);
+  std::fill(q_max, q_max + count, kMaxQuantized);
+}
+
+struct Bounds {
+  glm::vec3 min = glm::vec3(INFINITY);
+  glm::vec3 max = glm::vec3(-INFINITY);
+
+  void Grow(const glm::vec3& p) {
+    min = glm::min(min, p);
+    max = glm::max(max, p);
+  }
+
+  void Grow(const Bounds& b) {
+    min = glm::min(min, b.min);
+    max = glm::max(max, b.max);
+  }
+
+  // Half the surface area, which is all the heuristic's ratios need
+  float HalfArea() const {
+    glm::vec3 d = max - min;
+    return d.x * d.y + d.y * d.z + d.z * d.x;
+  }
+};
+
+struct Bin {
+  Bounds bounds;
+  Bounds centroids;
+  unsigned int count = 0;
+};
+
+struct Bins {
+  Bin axis[3][kBins];
+};
+
+struct BuildContext {
+  std::vector<Bounds> face_bounds;
+  std::vector<glm::vec3> centroids;
+  std::vector<unsigned int> refs;
+  BvhOptions options;
+};
+
+// References [begin, end) under nodes[node], whose centroids lie in
+// centroids
+struct BuildTask {
+  unsigned int node;
+  size_t begin;
+  size_t end;
+  Bounds centroids;
+  unsigned int depth;
+};
+
+// Maps a centroid coordinate to its bin, the same way for binning and for
+// partitioning
+struct BinMapping {
+  glm::vec3 origin;
+  glm::vec3 scale; // 0 along axes where the centroids do not spread
+
+  explicit BinMapping(const Bounds& centroids) : origin(centroids.min) {
+    glm::vec3 extent = centroids.max - centroids.min;
+    for (int axis = 0; axis < 3; ++axis) {
+      scale[axis] = extent[axis] > 0.f ? kBins / extent[axis] : 0.f;
+    }
+  }
+
+  unsigned int Index(const glm::vec3& centroid, int axis) const {
+    int index = static_cast<int>((centroid[axis] - origin[axis]) *
+                                 scale[axis]);
+    return static_cast<unsigned int>(std::min(std::max(index, 0),
+                                              static_cast<int>(kBins) - 1));
+  }
+};
+
+void BinRange(const BuildContext& context, size_t begin, size_t end,
+              const BinMapping& mapping, Bins* bins) {
+  for (size_t i = begin; i < end; ++i) {
+    unsigned int ref = context.refs[i];
+    const glm::vec3& centroid = context.centroids[ref];
+    for (int axis = 0; axis < 3; ++axis) {
+      Bin& bin = bins->axis[axis][mapping.Index(centroid, axis)];
+      bin.bounds.Grow(context.face_bounds[ref]);
+      bin.centroids.Grow(centroid);
+      ++bin.count;
+    }
+  }
+}
+
+// Splits the task's range in two, appending the two children to nodes and
+// their tasks to children, or makes its node a leaf. Large ranges are
+// binned with num_threads threads.
+void SplitNode(BuildContext* context, const BuildTask& task,
+               unsigned int num_threads, std::vector<BvhNode>* nodes,
+               std::vector<BuildTask>* children) {
+  const size_t count = task.end - task.begin;
+  const BvhOptions& options = context->options;
+
+  BvhNode& node = (*nodes)[task.node];
+  node.first = static_cast<unsigned int>(task.begin);
+  node.count = static_cast<unsigned int>(count);
+  if (count <= 1 || task.depth + 1 >= kMaxDepth) {
+    return;
+  }
+
+  BinMapping mapping(task.centroids);
+  Bins all_bins;
+  unsigned int threads = num_threads;
+  if (count < kMinParallelBinSize) {
+    threads = 1;
+  }
+  if (threads == 1) {
+    BinRange(*context, task.begin, task.end, mapping, &all_bins);
+  } else {
+    std::vector<Bins> thread_bins(threads);
+    ParallelFor(threads, [&](unsigned int thread_index) {
+      size_t begin = task.begin + count * thread_index / threads;
+      size_t end = task.begin + count * (thread_index + 1) / threads;
+      BinRange(*context, begin, end, mapping, &thread_bins[thread_index]);
+    });
+    for (const Bins& local : thread_bins) {
+      for (int axis = 0; axis < 3; ++axis) {
+        for (unsigned int b = 0; b < kBins; ++b) {
+          Bin& bin = all_bins.axis[axis][b];
+          bin.bounds.Grow(local.axis[axis][b].bounds);
+          bin.centroids.Grow(local.axis[axis][b].centroids);
+          bin.count += local.axis[axis][b].count;
+        }
+      }
+    }
+  }
+  const Bin (&bins)[3][kBins] = all_bins.axis;
+
+  // Sweeps the bins from the right to get the area and count of every
+  // right side, then from the left to evaluate each split
+  float best_cost = INFINITY;
+  int best_axis = -1;
+  unsigned int best_bin = 0;
+  for (int axis = 0; axis < 3; ++axis) {
+    if (mapping.scale[axis] == 0.f) {
+      continue;
+    }
+    float right_area[kBins];
+    unsigned int right_count[kBins];
+    Bounds right;
+    unsigned int right_total = 0;
+    for (unsigned int b = kBins - 1; b > 0; --b) {
+      right.Grow(bins[axis][b].bounds);
+      right_total += bins[axis][b].count;
+      right_area[b] = right_total > 0 ? right.HalfArea() : 0.f;
+      right_count[b] = right_total;
+    }
+
+    Bounds left;
+    unsigned int left_total = 0;
+    for (unsigned int b = 0; b + 1 < kBins; ++b) {
+      left.Grow(bins[axis][b].bounds);
+      left_total += bins[axis][b].count;
+      if (left_total == 0 || right_count[b + 1] == 0) {
+        continue;
+      }
+      float cost = left.HalfArea() * left_total +
+                   right_area[b + 1] * right_count[b + 1];
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_axis = axis;
+        best_bin = b;
+      }
+    }
+  }
+
+  Bounds node_bounds;
+  node_bounds.min = node.min_bounds;
+  node_bounds.max = node.max_bounds;
+  float split_cost = INFINITY;
+  if (best_axis >= 0) {
+    split_cost = options.traversal_cost +
+                 best_cost / std::max(node_bounds.HalfArea(), 1e-30f);
+  }
+  if (count <= options.max_leaf_size && count <= split_cost) {
+    return;
+  }
+
+  Bounds child_bounds[2];
+  Bounds child_centroids[2];
+  size_t middle;
+  if (best_axis >= 0) {
+    unsigned int* refs = context->refs.data();
+    const std::vector<glm::vec3>& centroids = context->centroids;
+    middle = std::partition(refs + task.begin, refs + task.end,
+                            [&](unsigned int ref) {
+                              return mapping.Index(centroids[ref],
+                                                   best_axis) <= best_bin;
+                            }) - refs;
+    for (unsigned int b = 0; b < kBins; ++b) {
+      int side = b <= best_bin ? 0 : 1;
+      child_bounds[side].Grow(bins[best_axis][b].bounds);
+      child_centroids[side].Grow(bins[best_axis][b].centroids);
+    }
+  } else {
+    // Every centroid is the same point, so any split is as good as another
+    middle = task.begin + count / 2;
+    for (size_t i = task.begin; i < task.end; ++i) {
+      unsigned int ref = context->refs[i];
+      int side = i < middle ? 0 : 1;
+      child_bounds[side].Grow(context->face_bounds[ref]);
+      child_centroids[side].Grow(context->centroids[ref]);
+    }
+  }
+
+  unsigned int first_child = static_cast<unsigned int>(nodes->size());
+  node.first = first_child;
+  node.count = 0;
+  for (int side = 0; side < 2; ++side) {
+    BvhNode child;
+    child.min_bounds = child_bounds[side].min;
+    child.max_bounds = child_bounds[side].max;
+    child.first = 0;
+    child.count = 0;
+    nodes->push_back(child);
+
+    BuildTask child_task;
+    child_task.node = first_child + side;
+    child_task.begin = side == 0 ? task.begin : middle;
+    child_task.end = side == 0 ? middle : task.end;
+    child_task.centroids = child_centroids[side];
+    child_task.depth = task.depth + 1;
+    children->push_back(child_task);
+  }
+}
+
+// Builds the subtree under (*nodes)[root.node] depth first on this thread
+void BuildSubtree(BuildContext* context, const BuildTask& root,
+                  std::vector<BvhNode>* nodes) {
+  std::vector<BuildTask> tasks(1, root);
+  std::vector<BuildTask> children;
+  while (!tasks.empty()) {
+    BuildTask task = tasks.back();
+    tasks.pop_back();
+    children.clear();
+    SplitNode(context, task, 1, nodes, &children);
+
+    // Right first, so that the left child is built next
+    for (size_t i = children.size(); i > 0; --i) {
+      tasks.push_back(children[i - 1]);
+    }
+  }
+}
+
+// The ray as the box tests use it. The near and far planes of a box along
+// each axis depend only on the sign of the direction, so they are picked
+// once per ray instead of with a min and max per test.
+struct TraversalRay {
+  Float8 origin[3];
+  Float8 inv_direction[3];
+  int near_plane[3];       // Index into WideNode::bounds
+  int far_plane[3];
+};
+
+TraversalRay MakeTraversalRay(const Ray& ray) {
+  TraversalRay traversal_ray;
+  for (int axis = 0; axis < 3; ++axis) {
+    float d = ray.direction[axis];
+    if (std::abs(d) < kMinDirection) {
+      d = d < 0.f ? -kMinDirection : kMinDirection;
+    }
+    float inv = 1.f / d;
+    traversal_ray.origin[axis] = Float8(ray.origin[axis]);
+    traversal_ray.inv_direction[axis] = Float8(inv);
+    traversal_ray.near_plane[axis] = inv >= 0.f ? axis : axis + 3;
+    traversal_ray.far_plane[axis] = inv >= 0.f ? axis + 3 : axis;
+  }
+  return traversal_ray;
+}
+
+// Slab test of the ray against eight boxes at once, whose planes are
+// origin + bounds * 2^exponent along each axis. Returns a bit per box that
+// the ray enters before t_max, and each box's entry distance.
+inline int IntersectBoxes(const float origin[3], const int8_t exponent[3],
+                          const uint8_t bounds[6][8],
+                          const TraversalRay& ray, float t_min, float t_max,
+                          float t_near[8]) {
+  Float8 near = Float8(t_min);
+  Float8 far = Float8(INFINITY);
+  for (int axis = 0; axis < 3; ++axis) {
+    Float8 node_origin = Float8(origin[axis]);
+    Float8 scale = Float8(ExponentScale(exponent[axis]));
+    Float8 near_plane =
+        node_origin + Float8::LoadBytes(bounds[ray.near_plane[axis]]) * scale;
+    Float8 far_plane =
+        node_origin + Float8::LoadBytes(bounds[ray.far_plane[axis]]) * scale;
+    Float8 t0 = (near_plane - ray.origin[axis]) * ray.inv_direction[axis];
+    Float8 t1 = (far_plane - ray.origin[axis]) * ray.inv_direction[axis];
+    near = Max(near, t0);
+    far = Min(far, t1);
+  }
+  far = Min(far * Float8(kFarScale), Float8(t_max));
+  near.Store(t_near);
+  return (near <= far).Bits();
+}
+
+} // namespace
+
+bool Bvh::Build(const Model& model, const BvhOptions& options) {
+  nodes_.clear();
+  faces_.clear();
+  triangles_.clear();
+  wide_nodes_.clear();
+
+  const size_t face_count = model.face_count;
+  if (face_count == 0) {
+    std::cerr << "Bvh::Build needs a model with faces" << std::endl;
+    return false;
+  }
+
+  const unsigned int threads = ResolveThreadCount(options.num_threads);
+  auto corner = [&](size_t face, int c) -> const glm::vec3& {
+    return model.positions[model.indexed_drawing ? model.faces[face][c]
+                                                 : face * 3 + c];
+  };
+
+  BuildContext context;
+  context.options = options;
+  context.options.max_leaf_size = std::max(options.max_leaf_size, 1u);
+  context.face_bounds.resize(face_count);
+  context.centroids.resize(face_count);
+  context.refs.resize(face_count);
+
+  std::vector<Bounds> thread_bounds(threads);
+  std::vector<Bounds> thread_centroids(threads);
+  ParallelFor(threads, [&](unsigned int thread_index) {
+    size_t begin = face_count * thread_index / threads;
+    size_t end = face_count * (thread_index + 1) / threads;
+    for (size_t f = begin; f < end; ++f) {
+      Bounds bounds;
+      for (int c = 0; c < 3; ++c) {
+        bounds.Grow(corner(f, c));
+      }
+      context.face_bounds[f] = bounds;
+      context.centroids[f] = 0.5f * (bounds.min + bounds.max);
+      context.refs[f] = static_cast<unsigned int>(f);
+      thread_bounds[thread_index].Grow(bounds);
+      thread_centroids[thread_index].Grow(context.centroids[f]);
+    }
+  });
+
+  BuildTask root;
+  root.node = 0;
+  root.begin = 0;
+  root.end = face_count;
+  root.depth = 0;
+  Bounds root_bounds;
+  for (unsigned int t = 0; t < threads; ++t) {
+    root_bounds.Grow(thread_bounds[t]);
+    root.centroids.Grow(thread_centroids[t]);
+  }
+  BvhNode root_node;
+  root_node.min_bounds = root_bounds.min;
+  root_node.max_bounds = root_bounds.max;
+  root_node.first = 0;
+  root_node.count = 0;
+  nodes_.reserve(2 * face_count / context.options.max_leaf_size + 1);
+  nodes_.push_back(root_node);
+
+  // The top of the tree is split with all threads binning each range,
+  // until there are enough ranges for every thread to build subtrees on
+  // its own
+  std::vector<BuildTask> subtrees;
+  if (threads == 1) {
+    subtrees.push_back(root);
+  } else {
+    size_t subtree_size = std::max(
+        face_count / (threads * kSubtreesPerThread), kMinSubtreeSize);
+    std::vector<BuildTask> pending(1, root);
+    std::vector<BuildTask> children;
+    while (!pending.empty()) {
+      BuildTask task = pending.back();
+      pending.pop_back();
+      if (task.end - task.begin <= subtree_size) {
+        subtrees.push_back(task);
+        continue;
+      }
+      children.clear();
+      SplitNode(&context, task, threads, &nodes_, &children);
+      pending.insert(pending.end(), children.begin(), children.end());
+    }
+  }
+
+  // Largest first, so that no thread is left with a large one at the end
+  std::sort(subtrees.begin(), subtrees.end(),
+            [](const BuildTask& a, const BuildTask& b) {
+              return a.end - a.begin > b.end - b.begin;
+            });
+
+  // Each subtree is built into its own array with its root at index 0
+  std::vector<std::vector<BvhNode>> subtree_nodes(subtrees.size());
+  std::atomic<size_t> next_subtree(0);
+  ParallelFor(std::min<unsigned int>(threads, subtrees.size()),
+              [&](unsigned int) {
+    size_t i;
+    while ((i = next_subtree++) < subtrees.size()) {
+      BuildTask task = subtrees[i];
+      std::vector<BvhNode>& local = subtree_nodes[i];
+      local.push_back(nodes_[task.node]);
+      task.node = 0;
+      BuildSubtree(&context, task, &local);
+    }
+  });
+
+  // Appends the subtrees after the top of the tree, moving child indices
+  // by the same amount. Local node 0 goes back into the existing root slot.
+  for (size_t i = 0; i < subtrees.size(); ++i) {
+    std::vector<BvhNode>& local = subtree_nodes[i];
+    unsigned int offset = static_cast<unsigned int>(nodes_.size()) - 1;
+    for (BvhNode& node : local) {
+      if (node.count == 0) {
+        node.first += offset;
+      }
+    }
+    nodes_[subtrees[i].node] = local[0];
+    nodes_.insert(nodes_.end(), local.begin() + 1, local.end());
+    std::vector<BvhNode>().swap(local);
+  }
+
+  faces_.swap(context.refs);
+  triangles_.resize(face_count);
+  ParallelFor(threads, [&](unsigned int thread_index) {
+    size_t begin = face_count * thread_index / threads;
+    size_t end = face_count * (thread_index + 1) / threads;
+    for (size_t i = begin; i < end; ++i) {
+      const glm::vec3& v0 = corner(faces_[i], 0);
+      triangles_[i].v0 = v0;
+      triangles_[i].e1 = corner(faces_[i], 1) - v0;
+      triangles_[i].e2 = corner(faces_[i], 2) - v0;
+    }
+  });
+
+  Collapse(0);
+  return true;
+}
+
+unsigned int Bvh::Collapse(unsigned int node_index) {
+  unsigned int wide_index = static_cast<unsigned int>(wide_nodes_.size());
+  wide_nodes_.push_back(WideNode());
+
+  // Opens the inner child with the largest surface area until there are
+  // eight children, since it is the one rays are most likely to enter
+  unsigned int children[8];
+  int count = 0;
+  const BvhNode& node = nodes_[node_index];
+  if (node.count > 0) {
+    children[count++] = node_index;
+  } else {
+    children[count++] = node.first;
+    children[count++] = node.first + 1;
+    while (count < 8) {
+      int best = -1;
+      float best_area = -1.f;
+      for (int i = 0; i < count; ++i) {
+        const BvhNode& child = nodes_[children[i]];
+        if (child.count > 0) {
+          continue;
+        }
+        glm::vec3 d = child.max_bounds - child.min_bounds;
+        float area = d.x * d.y + d.y * d.z + d.z * d.x;
+        if (area > best_area) {
+          best_area = area;
+          best = i;
+        }
+      }
+      if (best < 0) {
+        break;
+      }
+      unsigned int first = nodes_[children[best]].first;
+      children[best] = first;
+      children[count++] = first + 1;
+    }
+  }
+
+  WideNode wide;
+  std::fill(&wide.bounds[0][0], &wide.bounds[0][0] + 6 * 8, 0);
+  std::fill(wide.child, wide.child + 8, 0u);
+  std::fill(wide.count, wide.count + 8, 0u);
+  wide.child_mask = static_cast<uint8_t>((1u << count) - 1);
+  for (int axis = 0; axis < 3; ++axis) {
+    float mins[8];
+    float maxs[8];
+    float origin = INFINITY;
+    for (int i = 0; i < count; ++i) {
+      mins[i] = nodes_[children[i]].min_bounds[axis];
+      maxs[i] = nodes_[children[i]].max_bounds[axis];
+      origin = std::min(origin, mins[i]);
+    }
+    wide.origin[axis] = origin;
+    QuantizeAxis(mins, maxs, count, origin, &wide.exponent[axis],
+                 wide.bounds[axis], wide.bounds[axis + 3]);
+  }
+  for (int i = 0; i < count; ++i) {
+    const BvhNode& child = nodes_[children[i]];
+    if (child.count > 0) {
+      wide.child[i] = child.first;
+      wide.count[i] = child.count;
+    } else {
+      wide.child[i] = Collapse(children[i]);
+    }
+  }
+
+  // Stored last, since collapsing the children grows wide_nodes_
+  wide_nodes_[wide_index] = wide;
+  return wide_index;
+}
+
+bool Bvh::IntersectLeaf(const Ray& ray, unsigned int first,
+                        unsigned int count, float* t_max,
+                        RayHit* hit) const {
+  // Moller and Trumbore, "Fast, minimum storage ray/triangle intersection"
+  bool found = false;
+  for (unsigned int i = first; i < first + count; ++i) {
+    const Triangle& tri = triangles_[i];
+    glm::vec3 p = glm::cross(ray.direction, tri.e2);
+    float det = glm::dot(tri.e1, p);
+    if (det == 0.f) {
+      continue;
+    }
+    float inv_det = 1.f / det;
+
+    glm::vec3 s = ray.origin - tri.v0;
+    float u = glm::dot(s, p) * inv_det;
+    if (u < 0.f || u > 1.f) {
+      continue;
+    }
+    glm::vec3 q = glm::cross(s, tri.e1);
+    float v = glm::dot(ray.direction, q) * inv_det;
+    if (v < 0.f || u + v > 1.f) {
+      continue;
+    }
+    float t = glm::dot(tri.e2, q) * inv_det;
+    if (t < ray.t_min || t > *t_max) {
+      continue;
+    }
+
+    *t_max = t;
+    hit->face = faces_[i];
+    hit->t = t;
+    hit->u = u;
+    hit->v = v;
+    found = true;
+  }
+  return found;
+}
+
+bool Bvh::ClosestHit(const Ray& ray, RayHit* hit) const {
+  if (wide_nodes_.empty()) {
+    return false;
+  }
+
+  struct Entry {
+    unsigned int node;
+    float t; // Where the ray enters the node
+  };
+  Entry stack[kStackSize];
+  int size = 0;
+  stack[size++] = {0, ray.t_min};
+
+  TraversalRay traversal_ray = MakeTraversalRay(ray);
+  float t_max = ray.t_max;
+  bool found = false;
+  while (size > 0) {
+    Entry entry = stack[--size];
+    if (entry.t > t_max) {
+      continue;
+    }
+
+    const WideNode& node = wide_nodes_[entry.node];
+    float t_near[8];
+    int bits = IntersectBoxes(node.origin, node.exponent, node.bounds,
+                              traversal_ray, ray.t_min, t_max, t_near) &
+               node.child_mask;
+
+    // Leaves are intersected right away, so that their hits shorten the
+    // ray before the inner children are pushed
+    Entry inner[8];
+    int inner_count = 0;
+    for (int i = 0; i < 8; ++i) {
+      if ((bits & (1 << i)) == 0) {
+        continue;
+      }
+      if (node.count[i] > 0) {
+        found = IntersectLeaf(ray, node.child[i], node.count[i], &t_max,
+                              hit) || found;
+      } else {
+        inner[inner_count++] = {node.child[i], t_near[i]};
+      }
+    }
+
+    // Farthest first, so that the nearest child is visited next
+    for (int i = 1; i < inner_count; ++i) {
+      Entry e = inner[i];
+      int j = i;
+      for (; j > 0 && inner[j - 1].t < e.t; --j) {
+        inner[j] = inner[j - 1];
+      }
+      inner[j] = e;
+    }
+    for (int i = 0; i < inner_count; ++i) {
+      if (inner[i].t <= t_max) {
+        stack[size++] = inner[i];
+      }
+    }
+  }
+  return found;
+}
+
+bool Bvh::AnyHit(const Ray& ray) const {
+  if (wide_nodes_.empty()) {
+    return false;
+  }
+
+  unsigned int stack[kStackSize];
+  int size = 0;
+  stack[size++] = 0;
+
+  TraversalRay traversal_ray = MakeTraversalRay(ray);
+  float t_max = ray.t_max;
+  RayHit hit;
+  while (size > 0) {
+    const WideNode& node = wide_nodes_[stack[--size]];
+    float t_near[8];
+    int bits = IntersectBoxes(node.origin, node.exponent, node.bounds,
+                              traversal_ray, ray.t_min, t_max, t_near) &
+               node.child_mask;
+    for (int i = 0; i < 8; ++i) {
+      if ((bits & (1 << i)) == 0) {
+        continue;
+      }
+      if (node.count[i] == 0) {
+        stack[size++] = node.child[i];
+      } else if (IntersectLeaf(ray, node.child[i], node.count[i], &t_max,
+                               &hit)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+size_t Bvh::wide_node_bytes() const {
+  return wide_nodes_.size() * sizeof(WideNode);
+}
+
+size_t Bvh::query_bytes() const {
+  return wide_node_bytes() +
+         triangles_.size() * sizeof(Triangle) +
+         faces_.size() * sizeof(unsigned int);
+}
+
+Ray MakePickRay(const glm::vec2& window_pos, const glm::mat4& model_view_mat,
+                const glm::mat4& proj_mat, const glm::vec4& viewport) {
+  glm::vec3 near_point = glm::unProject(glm::vec3(window_pos, 0.f),
+                                        model_view_mat, proj_mat, viewport);
+  glm::vec3 far_point = glm::unProject(glm::vec3(window_pos, 1.f),
+                                       model_view_mat, proj_mat, viewport);
+  Ray ray;
+  ray.origin = near_point;
+  ray.direction = far_point - near_point;
+  ray.t_min = 0.f;
+  ray.t_max = 1.f;
+  return ray;
+}
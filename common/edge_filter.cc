@@ -0,0 +1,177 @@
+#include "edge_filter.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "image.h"
+#include "parallel.h"
+#include "simd.h"
+
+namespace {
+
+// Weighted unorm value of every channel byte, so that a texel's luma is
+// three lookups and the same two additions as luma() in the shader
+struct LumaTable {
+  float r[256];
+  float g[256];
+  float b[256];
+
+  LumaTable() {
+    for (int i = 0; i < 256; ++i) {
+      float value = static_cast<float>(i) / 255.f;
+      r[i] = 0.2126f * value;
+      g[i] = 0.7152f * value;
+      b[i] = 0.0722f * value;
+    }
+  }
+};
+
+const LumaTable& GetLumaTable() {
+  static const LumaTable table;
+  return table;
+}
+
+float Luma(const LumaTable& table, const unsigned char* pixel) {
+  return table.r[pixel[0]] + table.g[pixel[1]] + table.b[pixel[2]];
+}
+
+unsigned int Wrap(int i, unsigned int size) {
+  int n = static_cast<int>(size);
+  return static_cast<unsigned int>(((i % n) + n) % n);
+}
+
+void WritePixel(bool edge, unsigned char* pixel) {
+  unsigned char value = edge ? 255 : 0;
+  pixel[0] = value;
+  pixel[1] = value;
+  pixel[2] = value;
+}
+
+// Converts image row y to luma. The row starts with the wrapped-around
+// left neighbour, so luma[x + 1] is pixel x and luma[width + 1] is pixel 0.
+void ConvertRow(const Image& src, const LumaTable& table, unsigned int y,
+                float* luma) {
+  const unsigned char* pixel = &src.pixels[3 * y * src.width];
+  for (unsigned int x = 0; x < src.width; ++x, pixel += 3) {
+    luma[x + 1] = Luma(table, pixel);
+  }
+  luma[0] = luma[src.width];
+  luma[src.width + 1] = luma[1];
+}
+
+// Filters image rows [y_begin, y_end). Image rows run top to bottom while
+// the shader's +dy points up the texture, so the shader's row 0 (s00, s01,
+// s02) is the row above.
+void FilterBand(const Image& src, float threshold, unsigned int y_begin,
+                unsigned int y_end, Image* dst) {
+  const LumaTable& table = GetLumaTable();
+  const unsigned int width = src.width;
+
+  // Whole groups of eight plus the wrap-around neighbours on either side.
+  // Lanes past the last pixel read zeros and are not written.
+  const unsigned int groups = (width + kSimdWidth - 1) / kSimdWidth;
+  const unsigned int row_size = groups * kSimdWidth + 2;
+
+  std::vector<float> buffers(3 * row_size, 0.f);
+  float* above = &buffers[0];
+  float* row = &buffers[row_size];
+  float* below = &buffers[2 * row_size];
+
+  ConvertRow(src, table, Wrap(static_cast<int>(y_begin) - 1, src.height),
+             above);
+  ConvertRow(src, table, y_begin, row);
+
+  const Float8 two(2.f);
+  const Float8 threshold8(threshold);
+
+  for (unsigned int y = y_begin; y < y_end; ++y) {
+    ConvertRow(src, table, Wrap(static_cast<int>(y) + 1, src.height), below);
+
+    unsigned char* out = &dst->pixels[3 * y * width];
+    for (unsigned int group = 0; group < groups; ++group) {
+      unsigned int x = group * kSimdWidth + 1;
+
+      Float8 s00 = Float8::Load(above + x - 1);
+      Float8 s01 = Float8::Load(above + x);
+      Float8 s02 = Float8::Load(above + x + 1);
+      Float8 s10 = Float8::Load(row + x - 1);
+      Float8 s12 = Float8::Load(row + x + 1);
+      Float8 s20 = Float8::Load(below + x - 1);
+      Float8 s21 = Float8::Load(below + x);
+      Float8 s22 = s02;
+
+      Float8 sx = s00 + two * s10 + s20 - (s02 + two * s12 + s22);
+      Float8 sy = s00 + two * s01 + s02 - (s20 + two * s21 + s22);
+      int edges = (sx * sx + sy * sy > threshold8).Bits();
+
+      unsigned int lanes = std::min<unsigned int>(kSimdWidth,
+                                                  width - (x - 1));
+      for (unsigned int i = 0; i < lanes; ++i) {
+        WritePixel((edges >> i) & 1, out + 3 * (x - 1 + i));
+      }
+    }
+
+    // Slides the window down a row
+    float* oldest = above;
+    above = row;
+    row = below;
+    below = oldest;
+  }
+}
+
+} // namespace
+
+void DetectEdges(const Image& src, float threshold, unsigned int num_threads,
+                 Image* dst) {
+  dst->width = src.width;
+  dst->height = src.height;
+  dst->pixels.assign(3 * src.width * src.height, 0);
+  if (src.width == 0 || src.height == 0) {
+    return;
+  }
+
+  // Bands of at least a few rows, so the two extra rows each band converts
+  // stay small against the rows it filters
+  const unsigned int kMinBandRows = 16;
+  num_threads = ResolveThreadCount(num_threads);
+  unsigned int bands = std::max(1u, std::min(num_threads,
+                                             src.height / kMinBandRows));
+
+  ParallelFor(bands, [&](unsigned int band) {
+    FilterBand(src, threshold, src.height * band / bands,
+               src.height * (band + 1) / bands, dst);
+  });
+}
+
+void DetectEdgesReference(const Image& src, float threshold, Image* dst) {
+  const LumaTable& table = GetLumaTable();
+
+  dst->width = src.width;
+  dst->height = src.height;
+  dst->pixels.assign(3 * src.width * src.height, 0);
+
+  // Luma of the pixel dx to the right of and dy up from (x, y)
+  auto sample = [&](unsigned int x, unsigned int y, int dx, int dy) {
+    unsigned int px = Wrap(static_cast<int>(x) + dx, src.width);
+    unsigned int py = Wrap(static_cast<int>(y) - dy, src.height);
+    return Luma(table, &src.pixels[3 * (py * src.width + px)]);
+  };
+
+  for (unsigned int y = 0; y < src.height; ++y) {
+    for (unsigned int x = 0; x < src.width; ++x) {
+      float s00 = sample(x, y, -1, 1);
+      float s01 = sample(x, y, 0, 1);
+      float s02 = sample(x, y, 1, 1);
+      float s10 = sample(x, y, -1, 0);
+      float s12 = sample(x, y, 1, 0);
+      float s20 = sample(x, y, -1, -1);
+      float s21 = sample(x, y, 0, -1);
+      float s22 = sample(x, y, 1, 1);
+
+      float sx = s00 + 2.f * s10 + s20 - (s02 + 2.f * s12 + s22);
+      float sy = s00 + 2.f * s01 + s02 - (s20 + 2.f * s21 + s22);
+      WritePixel(sx * sx + sy * sy > threshold,
+                 &dst->pixels[3 * (y * src.width + x)]);
+    }
+  }
+}
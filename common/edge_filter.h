@@ -0,0 +1,28 @@
+#ifndef EDGE_FILTER_H_
+#define EDGE_FILTER_H_
+
+#include "image.h"
+
+// Threshold 08-edgedetect sets for edge_threshold
+const float kDefaultEdgeThreshold = 0.2f;
+
+// CPU version of the Sobel filter in 08-edgedetect/edgedetect.fs, for
+// filtering rendered frames offline. Matches the shader exactly: the same
+// luma weights on channels converted as unorm values, the same 3x3 kernel
+// including the shader's upper right sample in place of the lower right
+// one, and white where sx^2 + sy^2 > threshold, black elsewhere. Lookups
+// past the border wrap around like the shader's GL_REPEAT texture.
+//
+// The image is split into bands of rows processed in parallel. Each band
+// converts every source row to luma once into a sliding window of three
+// rows, and the kernel runs on eight pixels at a time (see simd.h).
+// num_threads of 0 uses all hardware threads.
+void DetectEdges(const Image& src, float threshold, unsigned int num_threads,
+                 Image* dst);
+
+// Straightforward per-pixel version that fetches and converts the nine
+// neighbours of every pixel, like the shader. Used as the reference for
+// DetectEdges.
+void DetectEdgesReference(const Image& src, float threshold, Image* dst);
+
+#endif
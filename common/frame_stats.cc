@@ -0,0 +1,166 @@
+#include "frame_stats.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "opengl.h"
+#include "shader_program.h"
+
+namespace {
+
+unsigned int frame_draw_calls = 0;
+
+} // namespace
+
+void CountDrawCalls(unsigned int count) {
+  frame_draw_calls += count;
+}
+
+void FrameTimer::Init() {
+  glGenQueries(kQueryCount, query_ids_);
+  for (int i = 0; i < kQueryCount; ++i) {
+    query_pending_[i] = false;
+  }
+  frame_index_ = 0;
+  cpu_ms_.clear();
+  gpu_ms_.clear();
+  draw_calls_.clear();
+}
+
+void FrameTimer::Destroy() {
+  glDeleteQueries(kQueryCount, query_ids_);
+}
+
+void FrameTimer::BeginFrame() {
+  int slot = frame_index_ % kQueryCount;
+
+  // Reuses the oldest query, so its result has to be collected first
+  if (query_pending_[slot]) {
+    CollectQuery(slot);
+  }
+
+  frame_draw_calls = 0;
+  frame_start_ = std::chrono::steady_clock::now();
+  glBeginQuery(GL_TIME_ELAPSED, query_ids_[slot]);
+}
+
+void FrameTimer::EndFrame() {
+  int slot = frame_index_ % kQueryCount;
+
+  glEndQuery(GL_TIME_ELAPSED);
+  query_pending_[slot] = true;
+
+  auto frame_end = std::chrono::steady_clock::now();
+  cpu_ms_.push_back(std::chrono::duration<double, std::milli>(
+      frame_end - frame_start_).count());
+  draw_calls_.push_back(frame_draw_calls);
+
+  ++frame_index_;
+}
+
+void FrameTimer::Finish() {
+  // Collects in submission order so gpu_ms lines up with cpu_ms
+  for (int i = 0; i < kQueryCount; ++i) {
+    int slot = (frame_index_ + i) % kQueryCount;
+    if (query_pending_[slot]) {
+      CollectQuery(slot);
+    }
+  }
+}
+
+void FrameTimer::CollectQuery(int slot) {
+  GLuint64 elapsed_ns = 0;
+  glGetQueryObjectui64v(query_ids_[slot], GL_QUERY_RESULT, &elapsed_ns);
+  gpu_ms_.push_back(static_cast<double>(elapsed_ns) / 1.0e6);
+  query_pending_[slot] = false;
+}
+
+double Percentile(std::vector<double> values, double percentile) {
+  if (values.empty()) {
+    return 0.0;
+  }
+
+  std::sort(values.begin(), values.end());
+  size_t rank = static_cast<size_t>(
+      std::ceil(percentile / 100.0 * values.size()));
+  if (rank > 0) {
+    --rank;
+  }
+  return values[std::min(rank, values.size() - 1)];
+}
+
+namespace {
+
+double Mean(const std::vector<double>& values) {
+  double sum = 0.0;
+  for (double value : values) {
+    sum += value;
+  }
+  return values.empty() ? 0.0 : sum / values.size();
+}
+
+std::string StatsJson(const std::vector<double>& values) {
+  std::ostringstream out;
+  out << "{\"mean\": " << Mean(values)
+      << ", \"p50\": " << Percentile(values, 50.0)
+      << ", \"p95\": " << Percentile(values, 95.0)
+      << ", \"p99\": " << Percentile(values, 99.0) << "}";
+  return out.str();
+}
+
+std::string GLString(GLenum name) {
+  const GLubyte* value = glGetString(name);
+  if (value == NULL) {
+    return "";
+  }
+
+  // Escapes the characters JSON does not allow inside strings
+  std::string escaped;
+  for (const GLubyte* c = value; *c != '\0'; ++c) {
+    if (*c == '"' || *c == '\\') {
+      escaped += '\\';
+    }
+    if (*c >= 0x20) {
+      escaped += static_cast<char>(*c);
+    }
+  }
+  return escaped;
+}
+
+} // namespace
+
+bool WriteFrameStatsJson(const std::string& path, const FrameTimer& timer,
+                         unsigned int width, unsigned int height,
+                         double startup_ms) {
+  const ProgramStats& program_stats = GetProgramStats();
+  std::ostringstream json;
+  json << "{\n"
+       << "  \"renderer\": \"" << GLString(GL_RENDERER) << "\",\n"
+       << "  \"version\": \"" << GLString(GL_VERSION) << "\",\n"
+       << "  \"width\": " << width << ",\n"
+       << "  \"height\": " << height << ",\n"
+       << "  \"frames\": " << timer.cpu_ms().size() << ",\n"
+       << "  \"startup_ms\": " << startup_ms << ",\n"
+       << "  \"programs\": " << program_stats.linked << ",\n"
+       << "  \"program_cache_hits\": " << program_stats.cache_hits << ",\n"
+       << "  \"program_ms\": " << program_stats.ms << ",\n"
+       << "  \"draw_calls\": " << Mean(timer.draw_calls()) << ",\n"
+       << "  \"cpu_ms\": " << StatsJson(timer.cpu_ms()) << ",\n"
+       << "  \"gpu_ms\": " << StatsJson(timer.gpu_ms()) << "\n"
+       << "}\n";
+
+  std::ofstream fout(path);
+  if (!fout) {
+    std::cerr << "Could not write frame stats: " << path << std::endl;
+    return false;
+  }
+  fout << json.str();
+
+  return true;
+}
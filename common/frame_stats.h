@@ -0,0 +1,63 @@
+#ifndef FRAME_STATS_H_
+#define FRAME_STATS_H_
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "opengl.h"
+
+// Adds to the number of draw calls issued in the current frame. Mesh::Draw
+// counts itself; code calling glDraw* directly counts its own calls.
+void CountDrawCalls(unsigned int count = 1);
+
+// Measures the CPU time, the GPU time and the draw calls of each frame. GPU
+// time comes from GL_TIME_ELAPSED queries, which are read back a few frames
+// later so that timing does not stall the pipeline.
+class FrameTimer {
+ public:
+  FrameTimer() {}
+
+  FrameTimer(const FrameTimer&) = delete;
+  FrameTimer& operator=(const FrameTimer&) = delete;
+
+  void Init();
+  void Destroy();
+
+  void BeginFrame();
+  void EndFrame();
+
+  // Waits for the outstanding queries and collects their results
+  void Finish();
+
+  const std::vector<double>& cpu_ms() const { return cpu_ms_; }
+  const std::vector<double>& gpu_ms() const { return gpu_ms_; }
+  const std::vector<double>& draw_calls() const { return draw_calls_; }
+
+ private:
+  static const int kQueryCount = 4;
+
+  void CollectQuery(int slot);
+
+  GLuint query_ids_[kQueryCount];
+  bool query_pending_[kQueryCount];
+  int frame_index_ = 0;
+
+  std::chrono::steady_clock::time_point frame_start_;
+
+  std::vector<double> cpu_ms_;
+  std::vector<double> gpu_ms_;
+  std::vector<double> draw_calls_;
+};
+
+// Value at the given percentile (0-100) using the nearest-rank method
+double Percentile(std::vector<double> values, double percentile);
+
+// Writes mean, p50, p95 and p99 of the CPU and GPU frame times and the
+// mean draw calls per frame as JSON, along with the startup time and the
+// shader program totals from GetProgramStats().
+bool WriteFrameStatsJson(const std::string& path, const FrameTimer& timer,
+                         unsigned int width, unsigned int height,
+                         double startup_ms);
+
+#endif
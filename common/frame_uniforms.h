@@ -0,0 +1,47 @@
+#ifndef FRAME_UNIFORMS_H_
+#define FRAME_UNIFORMS_H_
+
+#include "opengl.h"
+#include "glm/glm.hpp"
+
+// Uniform block binding point of FrameUniforms
+const GLuint kFrameUniformsBinding = 0;
+
+// Mirrors the std140 layout of the block shared by the lighting shaders:
+//
+//   layout(std140) uniform FrameUniforms {
+//        mat4 model_mat;
+//        mat4 view_mat;
+//        mat4 proj_mat;
+//        mat4 normal_mat;
+//        vec3 light_position;
+//        vec3 diffuse_param;
+//        vec3 ambient_param;
+//        vec3 specular_param;
+//        float shininess;
+//   };
+//
+// The instanced shaders take the model and normal matrices from per-instance
+// attributes instead (see instancing.h) and ignore model_mat and normal_mat.
+// std140 aligns each vec3 to 16 bytes, hence the padding. shininess fits in
+// the last four bytes of specular_param's slot.
+struct FrameUniforms {
+  glm::mat4 model_mat;
+  glm::mat4 view_mat;
+  glm::mat4 proj_mat;
+  glm::mat4 normal_mat;
+
+  glm::vec3 light_position;
+  float pad0;
+  glm::vec3 diffuse_param;
+  float pad1;
+  glm::vec3 ambient_param;
+  float pad2;
+  glm::vec3 specular_param;
+  float shininess;
+};
+
+static_assert(sizeof(FrameUniforms) == 320,
+              "FrameUniforms must match the std140 block layout");
+
+#endif
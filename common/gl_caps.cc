@@ -0,0 +1,27 @@
+#include "gl_caps.h"
+
+#include <string>
+
+#include "opengl.h"
+
+bool HasGLVersion(int major, int minor) {
+  GLint context_major = 0;
+  GLint context_minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &context_major);
+  glGetIntegerv(GL_MINOR_VERSION, &context_minor);
+  return context_major > major ||
+         (context_major == major && context_minor >= minor);
+}
+
+bool HasGLExtension(const std::string& name) {
+  GLint num_extensions = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &num_extensions);
+  for (GLint i = 0; i < num_extensions; ++i) {
+    const GLubyte* extension = glGetStringi(GL_EXTENSIONS, i);
+    if (extension != NULL &&
+        name == reinterpret_cast<const char*>(extension)) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,16 @@
+#ifndef GL_CAPS_H_
+#define GL_CAPS_H_
+
+#include <string>
+
+// Queries of the current context, for features beyond what the samples
+// require. Headers may still lack the entry points (the macOS headers stop
+// at GL 4.1), so callers also guard with the feature's #defines.
+
+// True if the context version is at least major.minor
+bool HasGLVersion(int major, int minor);
+
+// True if the context reports the extension, e.g. "GL_ARB_compute_shader"
+bool HasGLExtension(const std::string& name);
+
+#endif
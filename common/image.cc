@@ -0,0 +1,50 @@
+#include "image.h"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+
+bool SaveImagePPM(const std::string& path, const Image& image) {
+  std::ofstream fout(path, std::ios::binary);
+  if (!fout) {
+    std::cerr << "Could not write image: " << path << std::endl;
+    return false;
+  }
+
+  fout << "P6\n" << image.width << " " << image.height << "\n255\n";
+  fout.write(reinterpret_cast<const char*>(image.pixels.data()),
+             image.pixels.size());
+
+  return static_cast<bool>(fout);
+}
+
+bool LoadImagePPM(const std::string& path, Image* image) {
+  std::ifstream fin(path, std::ios::binary);
+  if (!fin) {
+    std::cerr << "Could not open image: " << path << std::endl;
+    return false;
+  }
+
+  std::string magic;
+  unsigned int maxval = 0;
+  fin >> magic >> image->width >> image->height >> maxval;
+
+  // Exactly one whitespace character separates the header from the pixels
+  fin.get();
+
+  if (!fin || magic != "P6" || maxval != 255) {
+    std::cerr << "Unsupported PPM file: " << path << std::endl;
+    return false;
+  }
+
+  image->pixels.resize(image->width * image->height * 3);
+  fin.read(reinterpret_cast<char*>(image->pixels.data()),
+           image->pixels.size());
+  if (!fin) {
+    std::cerr << "PPM file is truncated: " << path << std::endl;
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,18 @@
+#ifndef IMAGE_H_
+#define IMAGE_H_
+
+#include <string>
+#include <vector>
+
+// 8-bit RGB image with rows stored top to bottom, as in image files
+struct Image {
+  unsigned int width = 0;
+  unsigned int height = 0;
+  std::vector<unsigned char> pixels;
+};
+
+// Binary PPM (P6) with a maxval of 255
+bool SaveImagePPM(const std::string& path, const Image& image);
+bool LoadImagePPM(const std::string& path, Image* image);
+
+#endif
@@ -0,0 +1,43 @@
+#include "instancing.h"
+
+#include <cmath>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+InstanceTransform MakeInstanceTransform(const glm::mat4& model_mat) {
+  InstanceTransform instance;
+  instance.model_mat = model_mat;
+  instance.normal_mat = glm::transpose(glm::inverse(glm::mat3(model_mat)));
+  return instance;
+}
+
+void CreateInstanceGrid(unsigned int count, float extent,
+                        const glm::mat4& base_model_mat,
+                        std::vector<InstanceTransform>* instances) {
+  instances->clear();
+  if (count == 0) {
+    return;
+  }
+
+  unsigned int cols = static_cast<unsigned int>(
+      std::ceil(std::sqrt(static_cast<double>(count))));
+  unsigned int rows = (count + cols - 1) / cols;
+
+  float cell = extent / static_cast<float>(cols);
+  float scale = 1.f / static_cast<float>(cols);
+
+  instances->reserve(count);
+  for (unsigned int i = 0; i < count; ++i) {
+    unsigned int col = i % cols;
+    unsigned int row = i / cols;
+
+    glm::vec3 offset((col - 0.5f * (cols - 1)) * cell,
+                     (0.5f * (rows - 1) - row) * cell, 0.f);
+    glm::mat4 model_mat = glm::translate(glm::mat4(1.f), offset) *
+                          glm::scale(glm::mat4(1.f), glm::vec3(scale)) *
+                          base_model_mat;
+    instances->push_back(MakeInstanceTransform(model_mat));
+  }
+}
@@ -0,0 +1,25 @@
+#ifndef INSTANCING_H_
+#define INSTANCING_H_
+
+#include <vector>
+
+#include "glm/glm.hpp"
+
+// Per-instance vertex attributes read by the instanced lighting shaders.
+// normal_mat is the inverse transpose of model_mat's upper 3x3; the
+// shaders assume a rigid view matrix and apply mat3(view_mat) to it.
+struct InstanceTransform {
+  glm::mat4 model_mat;
+  glm::mat3 normal_mat;
+};
+
+InstanceTransform MakeInstanceTransform(const glm::mat4& model_mat);
+
+// Lays out count copies of base_model_mat on a square grid in the xy plane,
+// centered on the origin and extent units across. Each copy is scaled down
+// to its grid cell, so a single instance is base_model_mat unchanged.
+void CreateInstanceGrid(unsigned int count, float extent,
+                        const glm::mat4& base_model_mat,
+                        std::vector<InstanceTransform>* instances);
+
+#endif
@@ -0,0 +1,359 @@
+#include "mesh.h"
+
+#include <iostream>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "opengl.h"
+#include "frame_stats.h"
+#include "instancing.h"
+#include "model.h"
+#include "vertex_format.h"
+
+namespace {
+
+// Leaves the buffer unfilled if data is null
+GLuint CreateArrayBuffer(const void* data, size_t size) {
+  GLuint buffer_id;
+  glGenBuffers(1, &buffer_id);
+  glBindBuffer(GL_ARRAY_BUFFER, buffer_id);
+  glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
+  return buffer_id;
+}
+
+const GLvoid* BufferOffset(int offset) {
+  return reinterpret_cast<const GLvoid*>(static_cast<uintptr_t>(offset));
+}
+
+} // namespace
+
+bool PrepareMeshData(Model* model, unsigned int attribs, VertexFormat format,
+                     MeshData* data) {
+  if (model->vert_count == 0 || model->positions.size() < model->vert_count) {
+    std::cerr << "Mesh has no vertices to upload" << std::endl;
+    return false;
+  }
+
+  data->vert_count = model->vert_count;
+  data->face_count = model->face_count;
+  data->indexed = model->indexed_drawing;
+  data->format = format;
+  data->attribs = 0;
+
+  if (format != kVertexSeparate) {
+    if (!PackVertices(*model, attribs, format, &data->packed)) {
+      return false;
+    }
+  } else {
+    if (attribs & kMeshPositions) {
+      data->attribs |= kMeshPositions;
+      data->positions.swap(model->positions);
+    }
+    if ((attribs & kMeshNormals) &&
+        model->normals.size() >= model->vert_count) {
+      data->attribs |= kMeshNormals;
+      data->normals.swap(model->normals);
+    }
+    if ((attribs & kMeshTexcoords) &&
+        model->texcoords.size() >= model->vert_count) {
+      data->attribs |= kMeshTexcoords;
+      data->texcoords.swap(model->texcoords);
+    }
+  }
+
+  if (data->indexed) {
+    data->faces.swap(model->faces);
+  }
+
+  std::vector<glm::vec3>().swap(model->positions);
+  std::vector<glm::vec3>().swap(model->normals);
+  std::vector<glm::vec2>().swap(model->texcoords);
+  std::vector<glm::uvec3>().swap(model->faces);
+  model->vert_count = 0;
+  model->face_count = 0;
+
+  return true;
+}
+
+Mesh::Mesh() : vao_id_(0),
+               position_buffer_id_(0),
+               normal_buffer_id_(0),
+               texcoord_buffer_id_(0),
+               interleaved_buffer_id_(0),
+               index_buffer_id_(0),
+               instance_buffer_id_(0),
+               vert_count_(0),
+               face_count_(0),
+               instance_count_(0),
+               indexed_(false) {}
+
+bool Mesh::Upload(const Model& model, unsigned int attribs,
+                  VertexFormat format) {
+  if (model.vert_count == 0 || model.positions.size() < model.vert_count) {
+    std::cerr << "Mesh has no vertices to upload" << std::endl;
+    return false;
+  }
+
+  PackedVertices packed;
+  if (format != kVertexSeparate &&
+      !PackVertices(model, attribs, format, &packed)) {
+    return false;
+  }
+
+  Destroy();
+
+  vert_count_ = model.vert_count;
+  face_count_ = model.face_count;
+  indexed_ = model.indexed_drawing;
+
+  glGenVertexArrays(1, &vao_id_);
+  glBindVertexArray(vao_id_);
+
+  if (format != kVertexSeparate) {
+    UploadPacked(packed, true);
+  } else {
+    unsigned int present = attribs & kMeshPositions;
+    if ((attribs & kMeshNormals) && model.normals.size() >= vert_count_) {
+      present |= kMeshNormals;
+    }
+    if ((attribs & kMeshTexcoords) && model.texcoords.size() >= vert_count_) {
+      present |= kMeshTexcoords;
+    }
+    UploadSeparate(present, model.positions.data(), model.normals.data(),
+                   model.texcoords.data());
+  }
+
+  if (indexed_) {
+    UploadIndices(model.faces.data());
+  }
+
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  return true;
+}
+
+bool Mesh::Allocate(const MeshData& data,
+                    std::vector<MeshBufferRange>* ranges) {
+  Destroy();
+
+  vert_count_ = data.vert_count;
+  face_count_ = data.face_count;
+  indexed_ = data.indexed;
+
+  glGenVertexArrays(1, &vao_id_);
+  glBindVertexArray(vao_id_);
+
+  ranges->clear();
+  MeshBufferRange range;
+  if (data.format != kVertexSeparate) {
+    UploadPacked(data.packed, false);
+    range.buffer_id = interleaved_buffer_id_;
+    range.data = data.packed.data.data();
+    range.size = data.packed.data.size();
+    ranges->push_back(range);
+  } else {
+    UploadSeparate(data.attribs, NULL, NULL, NULL);
+    if (data.attribs & kMeshPositions) {
+      range.buffer_id = position_buffer_id_;
+      range.data = data.positions.data();
+      range.size = vert_count_ * sizeof(glm::vec3);
+      ranges->push_back(range);
+    }
+    if (data.attribs & kMeshNormals) {
+      range.buffer_id = normal_buffer_id_;
+      range.data = data.normals.data();
+      range.size = vert_count_ * sizeof(glm::vec3);
+      ranges->push_back(range);
+    }
+    if (data.attribs & kMeshTexcoords) {
+      range.buffer_id = texcoord_buffer_id_;
+      range.data = data.texcoords.data();
+      range.size = vert_count_ * sizeof(glm::vec2);
+      ranges->push_back(range);
+    }
+  }
+
+  if (indexed_) {
+    UploadIndices(NULL);
+    range.buffer_id = index_buffer_id_;
+    range.data = data.faces.data();
+    range.size = face_count_ * sizeof(glm::uvec3);
+    ranges->push_back(range);
+  }
+
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  return true;
+}
+
+void Mesh::UploadSeparate(unsigned int attribs, const glm::vec3* positions,
+                          const glm::vec3* normals,
+                          const glm::vec2* texcoords) {
+  if (attribs & kMeshPositions) {
+    position_buffer_id_ =
+        CreateArrayBuffer(positions, 3 * vert_count_ * sizeof(float));
+    glVertexAttribPointer(kPositionAttribLoc, 3, GL_FLOAT, GL_FALSE, 0, NULL);
+    glEnableVertexAttribArray(kPositionAttribLoc);
+  }
+
+  if (attribs & kMeshNormals) {
+    normal_buffer_id_ =
+        CreateArrayBuffer(normals, 3 * vert_count_ * sizeof(float));
+    glVertexAttribPointer(kNormalAttribLoc, 3, GL_FLOAT, GL_FALSE, 0, NULL);
+    glEnableVertexAttribArray(kNormalAttribLoc);
+  }
+
+  if (attribs & kMeshTexcoords) {
+    texcoord_buffer_id_ =
+        CreateArrayBuffer(texcoords, 2 * vert_count_ * sizeof(float));
+    glVertexAttribPointer(kTexcoordAttribLoc, 2, GL_FLOAT, GL_FALSE, 0, NULL);
+    glEnableVertexAttribArray(kTexcoordAttribLoc);
+  }
+}
+
+void Mesh::UploadIndices(const glm::uvec3* faces) {
+  // The element buffer binding is part of the vertex array state
+  glGenBuffers(1, &index_buffer_id_);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_id_);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+               3 * face_count_ * sizeof(unsigned int), faces,
+               GL_STATIC_DRAW);
+}
+
+void Mesh::UploadPacked(const PackedVertices& packed, bool fill) {
+  interleaved_buffer_id_ = CreateArrayBuffer(
+      fill ? packed.data.data() : NULL, packed.data.size());
+
+  if (packed.position_offset >= 0) {
+    if (packed.half_positions) {
+      glVertexAttribPointer(kPositionAttribLoc, 4, GL_HALF_FLOAT, GL_FALSE,
+                            packed.stride,
+                            BufferOffset(packed.position_offset));
+    } else {
+      glVertexAttribPointer(kPositionAttribLoc, 3, GL_FLOAT, GL_FALSE,
+                            packed.stride,
+                            BufferOffset(packed.position_offset));
+    }
+    glEnableVertexAttribArray(kPositionAttribLoc);
+  }
+
+  if (packed.normal_offset >= 0) {
+    glVertexAttribPointer(kNormalAttribLoc, 4, GL_INT_2_10_10_10_REV, GL_TRUE,
+                          packed.stride, BufferOffset(packed.normal_offset));
+    glEnableVertexAttribArray(kNormalAttribLoc);
+  }
+
+  if (packed.texcoord_offset >= 0) {
+    glVertexAttribPointer(kTexcoordAttribLoc, 2, GL_HALF_FLOAT, GL_FALSE,
+                          packed.stride, BufferOffset(packed.texcoord_offset));
+    glEnableVertexAttribArray(kTexcoordAttribLoc);
+  }
+}
+
+bool Mesh::UploadInstances(const std::vector<InstanceTransform>& instances) {
+  if (vao_id_ == 0) {
+    std::cerr << "Mesh must be uploaded before its instances" << std::endl;
+    return false;
+  }
+  if (instances.empty()) {
+    std::cerr << "No instances to upload" << std::endl;
+    return false;
+  }
+
+  if (instance_buffer_id_ != 0) {
+    glDeleteBuffers(1, &instance_buffer_id_);
+  }
+
+  glBindVertexArray(vao_id_);
+  instance_buffer_id_ = CreateArrayBuffer(
+      &instances[0], instances.size() * sizeof(InstanceTransform));
+
+  // Matrix attributes are specified one column at a time
+  const GLsizei stride = sizeof(InstanceTransform);
+  for (GLuint col = 0; col < 4; ++col) {
+    GLuint loc = kInstanceModelMatAttribLoc + col;
+    glVertexAttribPointer(loc, 4, GL_FLOAT, GL_FALSE, stride,
+                          BufferOffset(offsetof(InstanceTransform, model_mat) +
+                                       col * sizeof(glm::vec4)));
+    glVertexAttribDivisor(loc, 1);
+    glEnableVertexAttribArray(loc);
+  }
+  for (GLuint col = 0; col < 3; ++col) {
+    GLuint loc = kInstanceNormalMatAttribLoc + col;
+    glVertexAttribPointer(loc, 3, GL_FLOAT, GL_FALSE, stride,
+                          BufferOffset(offsetof(InstanceTransform, normal_mat) +
+                                       col * sizeof(glm::vec3)));
+    glVertexAttribDivisor(loc, 1);
+    glEnableVertexAttribArray(loc);
+  }
+
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  instance_count_ = instances.size();
+
+  return true;
+}
+
+void Mesh::Draw() const {
+  if (indexed_) {
+    DrawFaces(0, face_count_);
+    return;
+  }
+
+  glBindVertexArray(vao_id_);
+  if (instance_count_ > 0) {
+    glDrawArraysInstanced(GL_TRIANGLES, 0, vert_count_, instance_count_);
+  } else {
+    glDrawArrays(GL_TRIANGLES, 0, vert_count_);
+  }
+  glBindVertexArray(0);
+
+  CountDrawCalls();
+}
+
+void Mesh::DrawFaces(unsigned int first_face, unsigned int face_count) const {
+  if (!indexed_) {
+    std::cerr << "DrawFaces needs an indexed mesh" << std::endl;
+    return;
+  }
+
+  const GLvoid* offset = BufferOffset(3 * first_face * sizeof(unsigned int));
+
+  glBindVertexArray(vao_id_);
+  if (instance_count_ > 0) {
+    glDrawElementsInstanced(GL_TRIANGLES, 3 * face_count, GL_UNSIGNED_INT,
+                            offset, instance_count_);
+  } else {
+    glDrawElements(GL_TRIANGLES, 3 * face_count, GL_UNSIGNED_INT, offset);
+  }
+  glBindVertexArray(0);
+
+  CountDrawCalls();
+}
+
+void Mesh::Destroy() {
+  GLuint buffer_ids[] = {position_buffer_id_, normal_buffer_id_,
+                         texcoord_buffer_id_, interleaved_buffer_id_,
+                         index_buffer_id_, instance_buffer_id_};
+  for (GLuint buffer_id : buffer_ids) {
+    if (buffer_id != 0) {
+      glDeleteBuffers(1, &buffer_id);
+    }
+  }
+  if (vao_id_ != 0) {
+    glDeleteVertexArrays(1, &vao_id_);
+  }
+
+  vao_id_ = 0;
+  position_buffer_id_ = 0;
+  normal_buffer_id_ = 0;
+  texcoord_buffer_id_ = 0;
+  interleaved_buffer_id_ = 0;
+  index_buffer_id_ = 0;
+  instance_buffer_id_ = 0;
+  instance_count_ = 0;
+}
@@ -0,0 +1,122 @@
+#ifndef MESH_H_
+#define MESH_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "opengl.h"
+#include "glm/glm.hpp"
+#include "instancing.h"
+#include "model.h"
+#include "vertex_format.h"
+
+// Vertex attribute locations used by Mesh
+const GLuint kPositionAttribLoc = 0;
+const GLuint kNormalAttribLoc = 1;
+const GLuint kTexcoordAttribLoc = 2;
+
+// Per-instance attributes. A mat4 takes four consecutive locations and a
+// mat3 three.
+const GLuint kInstanceModelMatAttribLoc = 3;
+const GLuint kInstanceNormalMatAttribLoc = 7;
+
+// The contents of a Mesh's buffers, made from a Model by PrepareMeshData.
+// Building it touches no GL state, so it can be done on a worker thread and
+// the buffers filled later from the GL thread.
+struct MeshData {
+  unsigned int vert_count = 0;
+  unsigned int face_count = 0;
+  bool indexed = false;
+  VertexFormat format = kVertexSeparate;
+
+  // Separate format: the attributes present, each in its own array
+  unsigned int attribs = 0;
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec3> normals;
+  std::vector<glm::vec2> texcoords;
+
+  PackedVertices packed; // Packed formats
+  std::vector<glm::uvec3> faces; // Indexed models only
+};
+
+// Moves the attributes of model selected by attribs into data, packing them
+// for packed formats, and leaves the model empty
+bool PrepareMeshData(Model* model, unsigned int attribs, VertexFormat format,
+                     MeshData* data);
+
+// Where one of the arrays of a MeshData goes: the first size bytes of the
+// buffer
+struct MeshBufferRange {
+  GLuint buffer_id = 0;
+  const void* data = NULL;
+  size_t size = 0;
+};
+
+// GPU copy of a Model: one vertex buffer per attribute (or a single
+// interleaved one), an index buffer for indexed models and a vertex array
+// object tying them together. Optionally, a buffer of per-instance
+// transforms turns every draw into one instanced draw call.
+//
+// Destroy() must be called explicitly while the GL context is alive.
+class Mesh {
+ public:
+  Mesh();
+
+  Mesh(const Mesh&) = delete;
+  Mesh& operator=(const Mesh&) = delete;
+
+  // Packed formats store the attributes in one interleaved buffer, see
+  // PackVertices
+  bool Upload(const Model& model,
+              unsigned int attribs = kMeshPositions | kMeshNormals,
+              VertexFormat format = kVertexSeparate);
+
+  // Creates the buffers and vertex array for data without filling them. The
+  // caller copies each of the ranges into its buffer, e.g. in pieces with
+  // glCopyBufferSubData, and must not draw the mesh before that is done.
+  // The ranges point into data.
+  bool Allocate(const MeshData& data, std::vector<MeshBufferRange>* ranges);
+
+  // Replaces the per-instance transforms. Must be called after Upload(),
+  // which discards them.
+  bool UploadInstances(const std::vector<InstanceTransform>& instances);
+
+  // Binds the vertex array object and issues the draw call, instanced if
+  // instances were uploaded
+  void Draw() const;
+
+  // Draws faces [first_face, first_face + face_count) of an indexed mesh,
+  // such as one level of a chain built by BuildLodChain (see mesh_lod.h)
+  void DrawFaces(unsigned int first_face, unsigned int face_count) const;
+
+  void Destroy();
+
+  GLuint vao_id() const { return vao_id_; }
+  unsigned int vert_count() const { return vert_count_; }
+  unsigned int face_count() const { return face_count_; }
+  bool indexed() const { return indexed_; }
+  unsigned int instance_count() const { return instance_count_; }
+
+ private:
+  // Create the vertex buffers and attribute pointers of the bound VAO. With
+  // null data or fill set to false, the buffers are left unfilled.
+  void UploadSeparate(unsigned int attribs, const glm::vec3* positions,
+                      const glm::vec3* normals, const glm::vec2* texcoords);
+  void UploadPacked(const PackedVertices& packed, bool fill);
+  void UploadIndices(const glm::uvec3* faces);
+
+  GLuint vao_id_;
+  GLuint position_buffer_id_;
+  GLuint normal_buffer_id_;
+  GLuint texcoord_buffer_id_;
+  GLuint interleaved_buffer_id_;
+  GLuint index_buffer_id_;
+  GLuint instance_buffer_id_;
+
+  unsigned int vert_count_;
+  unsigned int face_count_;
+  unsigned int instance_count_; // 0 if not instanced
+  bool indexed_;
+};
+
+#endif
@@ -0,0 +1,672 @@
+#include "mesh_lod.h"
+
+#include <iostream>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "mesh_optimizer.h"
+#include "model.h"
+
+namespace {
+
+// Attributes the quadrics preserve: the three normal components and the
+// two texcoord components
+const int kMaxAttribs = 5;
+
+// Border edges are held in place by planes through them, perpendicular to
+// their face, which count this much more than the face planes
+const double kBorderWeight = 10.0;
+
+// A collapse may not turn any remaining face by more than about 75 degrees
+const double kMinFlipCos = 0.25;
+
+// A level that keeps more than this fraction of the faces of the level
+// before it means the model cannot be simplified much further
+const float kMinLevelReduction = 0.95f;
+
+enum PositionKind {
+  kManifold, // Only inside edges, may collapse onto any neighbour
+  kBorder,   // On one open border, may only collapse along it
+  kLocked    // On non-manifold edges or several borders, never moves
+};
+
+// Squared distance to a set of weighted planes, plus for each attribute the
+// squared difference from the planes of attribute values over the faces,
+// in the memory-efficient form of Hoppe's paper. Evaluated at a position p
+// with attributes s:
+//
+//   p.A.p + 2 b.p + c + sum over k of (w s_k^2 - 2 s_k (g_k.p + d_k))
+struct Quadric {
+  double a00, a11, a22, a01, a02, a12;
+  glm::dvec3 b;
+  double c;
+  double w; // Total area of the faces
+  glm::dvec3 g[kMaxAttribs];
+  double d[kMaxAttribs];
+
+  Quadric() : a00(0.0), a11(0.0), a22(0.0), a01(0.0), a02(0.0), a12(0.0),
+              b(0.0), c(0.0), w(0.0) {
+    for (int k = 0; k < kMaxAttribs; ++k) {
+      g[k] = glm::dvec3(0.0);
+      d[k] = 0.0;
+    }
+  }
+
+  // Adds weight * (n.p + offset)^2
+  void AddPlane(const glm::dvec3& n, double offset, double weight) {
+    a00 += weight * n.x * n.x;
+    a11 += weight * n.y * n.y;
+    a22 += weight * n.z * n.z;
+    a01 += weight * n.x * n.y;
+    a02 += weight * n.x * n.z;
+    a12 += weight * n.y * n.z;
+    b += weight * offset * n;
+    c += weight * offset * offset;
+  }
+
+  // Adds area * (gradient.p + offset - s_k)^2, where gradient.p + offset
+  // interpolates attribute k over the face
+  void AddAttribute(int k, const glm::dvec3& gradient, double offset,
+                    double area) {
+    AddPlane(gradient, offset, area);
+    g[k] += area * gradient;
+    d[k] += area * offset;
+  }
+
+  void Add(const Quadric& o) {
+    a00 += o.a00;
+    a11 += o.a11;
+    a22 += o.a22;
+    a01 += o.a01;
+    a02 += o.a02;
+    a12 += o.a12;
+    b += o.b;
+    c += o.c;
+    w += o.w;
+    for (int k = 0; k < kMaxAttribs; ++k) {
+      g[k] += o.g[k];
+      d[k] += o.d[k];
+    }
+  }
+
+  double Evaluate(const glm::dvec3& p, const double* s,
+                  int attrib_count) const {
+    glm::dvec3 ap(a00 * p.x + a01 * p.y + a02 * p.z,
+                  a01 * p.x + a11 * p.y + a12 * p.z,
+                  a02 * p.x + a12 * p.y + a22 * p.z);
+    double error = glm::dot(p, ap) + 2.0 * glm::dot(b, p) + c;
+    for (int k = 0; k < attrib_count; ++k) {
+      error += w * s[k] * s[k] - 2.0 * s[k] * (glm::dot(g[k], p) + d[k]);
+    }
+    // Rounding can take an exact fit slightly below zero
+    return std::max(error, 0.0);
+  }
+};
+
+// Model positions scaled into the unit cube and weighted attributes, so
+// that errors do not depend on the size of the model
+struct SimplifyVertices {
+  std::vector<glm::dvec3> positions;
+  std::vector<double> attribs; // kMaxAttribs per vertex
+  int attrib_count = 0;
+  double extent = 1.0;
+
+  // Vertices at the same position, the corners of a seam, share an id
+  std::vector<unsigned int> position_ids;
+  unsigned int position_count = 0;
+};
+
+void PrepareVertices(const Model& model, const LodOptions& options,
+                     SimplifyVertices* vertices) {
+  const unsigned int vert_count = model.vert_count;
+
+  glm::vec3 min_pos = model.positions[0];
+  glm::vec3 max_pos = model.positions[0];
+  for (unsigned int v = 1; v < vert_count; ++v) {
+    min_pos = glm::min(min_pos, model.positions[v]);
+    max_pos = glm::max(max_pos, model.positions[v]);
+  }
+  glm::vec3 size = max_pos - min_pos;
+  double extent = std::max(std::max(size.x, size.y), size.z);
+  vertices->extent = extent > 0.0 ? extent : 1.0;
+
+  vertices->positions.resize(vert_count);
+  for (unsigned int v = 0; v < vert_count; ++v) {
+    vertices->positions[v] = glm::dvec3(model.positions[v] - min_pos) /
+                             vertices->extent;
+  }
+
+  bool has_normals = model.normals.size() >= vert_count;
+  bool has_texcoords = model.texcoords.size() >= vert_count;
+  vertices->attrib_count = (has_normals ? 3 : 0) + (has_texcoords ? 2 : 0);
+  vertices->attribs.assign(vert_count * kMaxAttribs, 0.0);
+  for (unsigned int v = 0; v < vert_count; ++v) {
+    double* s = &vertices->attribs[v * kMaxAttribs];
+    if (has_normals) {
+      for (int k = 0; k < 3; ++k) {
+        *s++ = model.normals[v][k] * options.normal_weight;
+      }
+    }
+    if (has_texcoords) {
+      for (int k = 0; k < 2; ++k) {
+        *s++ = model.texcoords[v][k] * options.texcoord_weight;
+      }
+    }
+  }
+
+  // Sorting the vertices by position puts equal positions next to each other
+  std::vector<unsigned int> order(vert_count);
+  for (unsigned int v = 0; v < vert_count; ++v) {
+    order[v] = v;
+  }
+  auto less = [&](unsigned int a, unsigned int b) {
+    const glm::vec3& pa = model.positions[a];
+    const glm::vec3& pb = model.positions[b];
+    if (pa.x != pb.x) return pa.x < pb.x;
+    if (pa.y != pb.y) return pa.y < pb.y;
+    return pa.z < pb.z;
+  };
+  std::sort(order.begin(), order.end(), less);
+
+  vertices->position_ids.resize(vert_count);
+  vertices->position_count = 0;
+  for (unsigned int i = 0; i < vert_count; ++i) {
+    if (i > 0 && less(order[i - 1], order[i])) {
+      ++vertices->position_count;
+    }
+    vertices->position_ids[order[i]] = vertices->position_count;
+  }
+  ++vertices->position_count;
+}
+
+// Key of the undirected edge between two positions
+uint64_t EdgeKey(unsigned int a, unsigned int b) {
+  if (a > b) {
+    std::swap(a, b);
+  }
+  return (static_cast<uint64_t>(a) << 32) | b;
+}
+
+struct EdgeUse {
+  uint64_t key;
+  unsigned int face;
+  int corner; // The edge runs from this corner of the face to the next
+
+  bool operator<(const EdgeUse& o) const { return key < o.key; }
+};
+
+// Every face's edges between positions, sorted so that the uses of one edge
+// are next to each other
+void CollectEdges(const std::vector<glm::uvec3>& faces,
+                  const SimplifyVertices& vertices,
+                  std::vector<EdgeUse>* edges) {
+  edges->clear();
+  edges->reserve(faces.size() * 3);
+  for (unsigned int f = 0; f < faces.size(); ++f) {
+    for (int c = 0; c < 3; ++c) {
+      unsigned int a = vertices.position_ids[faces[f][c]];
+      unsigned int b = vertices.position_ids[faces[f][(c + 1) % 3]];
+      edges->push_back({EdgeKey(a, b), f, c});
+    }
+  }
+  std::sort(edges->begin(), edges->end());
+}
+
+// quadrics get every term. plane_quadrics only get the face planes, to
+// estimate the geometric error of the levels.
+void ComputeQuadrics(const std::vector<glm::uvec3>& faces,
+                     const SimplifyVertices& vertices,
+                     std::vector<Quadric>* quadrics,
+                     std::vector<Quadric>* plane_quadrics) {
+  quadrics->assign(vertices.positions.size(), Quadric());
+  plane_quadrics->assign(vertices.positions.size(), Quadric());
+
+  for (const glm::uvec3& face : faces) {
+    glm::dvec3 p0 = vertices.positions[face.x];
+    glm::dvec3 e1 = vertices.positions[face.y] - p0;
+    glm::dvec3 e2 = vertices.positions[face.z] - p0;
+    glm::dvec3 n = glm::cross(e1, e2);
+    double length = glm::length(n);
+    if (length == 0.0) {
+      continue;
+    }
+    n /= length;
+    double area = 0.5 * length;
+    double offset = -glm::dot(n, p0);
+
+    // Gradient of each attribute within the plane of the face, from the
+    // differences along the two edges
+    double e11 = glm::dot(e1, e1);
+    double e12 = glm::dot(e1, e2);
+    double e22 = glm::dot(e2, e2);
+    double det = e11 * e22 - e12 * e12;
+
+    for (int c = 0; c < 3; ++c) {
+      (*quadrics)[face[c]].AddPlane(n, offset, area);
+      (*quadrics)[face[c]].w += area;
+      (*plane_quadrics)[face[c]].AddPlane(n, offset, area);
+      (*plane_quadrics)[face[c]].w += area;
+    }
+
+    for (int k = 0; k < vertices.attrib_count; ++k) {
+      double s0 = vertices.attribs[face.x * kMaxAttribs + k];
+      double ds1 = vertices.attribs[face.y * kMaxAttribs + k] - s0;
+      double ds2 = vertices.attribs[face.z * kMaxAttribs + k] - s0;
+      double alpha = (ds1 * e22 - ds2 * e12) / det;
+      double beta = (ds2 * e11 - ds1 * e12) / det;
+      glm::dvec3 gradient = alpha * e1 + beta * e2;
+      double attrib_offset = s0 - glm::dot(gradient, p0);
+
+      for (int c = 0; c < 3; ++c) {
+        (*quadrics)[face[c]].AddAttribute(k, gradient, attrib_offset, area);
+      }
+    }
+  }
+
+  // Edges used by one face only are open borders
+  std::vector<EdgeUse> edges;
+  CollectEdges(faces, vertices, &edges);
+  for (size_t i = 0; i < edges.size(); ++i) {
+    bool single = (i == 0 || edges[i - 1].key != edges[i].key) &&
+                  (i + 1 == edges.size() || edges[i + 1].key != edges[i].key);
+    if (!single) {
+      continue;
+    }
+
+    const glm::uvec3& face = faces[edges[i].face];
+    unsigned int v0 = face[edges[i].corner];
+    unsigned int v1 = face[(edges[i].corner + 1) % 3];
+    unsigned int v2 = face[(edges[i].corner + 2) % 3];
+    glm::dvec3 p0 = vertices.positions[v0];
+    glm::dvec3 edge = vertices.positions[v1] - p0;
+    glm::dvec3 n = glm::cross(edge, vertices.positions[v2] - p0);
+    glm::dvec3 m = glm::cross(edge, n);
+    double length = glm::length(m);
+    if (length == 0.0) {
+      continue;
+    }
+    m /= length;
+
+    double weight = kBorderWeight * glm::dot(edge, edge);
+    (*quadrics)[v0].AddPlane(m, -glm::dot(m, p0), weight);
+    (*quadrics)[v1].AddPlane(m, -glm::dot(m, p0), weight);
+  }
+}
+
+// Faces of the current level around each position, and what kind of
+// position it is
+struct PositionAdjacency {
+  std::vector<unsigned int> offsets; // position_count + 1 entries
+  std::vector<unsigned int> faces;
+  std::vector<PositionKind> kinds;
+};
+
+void BuildPositionAdjacency(const std::vector<glm::uvec3>& faces,
+                            const SimplifyVertices& vertices,
+                            const std::vector<EdgeUse>& edges,
+                            PositionAdjacency* adjacency) {
+  const unsigned int position_count = vertices.position_count;
+
+  adjacency->offsets.assign(position_count + 1, 0);
+  for (const glm::uvec3& face : faces) {
+    for (int c = 0; c < 3; ++c) {
+      ++adjacency->offsets[vertices.position_ids[face[c]] + 1];
+    }
+  }
+  for (unsigned int p = 0; p < position_count; ++p) {
+    adjacency->offsets[p + 1] += adjacency->offsets[p];
+  }
+  adjacency->faces.resize(adjacency->offsets[position_count]);
+  std::vector<unsigned int> fill(adjacency->offsets.begin(),
+                                 adjacency->offsets.end() - 1);
+  for (unsigned int f = 0; f < faces.size(); ++f) {
+    for (int c = 0; c < 3; ++c) {
+      adjacency->faces[fill[vertices.position_ids[faces[f][c]]]++] = f;
+    }
+  }
+
+  std::vector<unsigned int> border_edges(position_count, 0);
+  adjacency->kinds.assign(position_count, kManifold);
+  for (size_t i = 0; i < edges.size();) {
+    size_t end = i;
+    while (end < edges.size() && edges[end].key == edges[i].key) {
+      ++end;
+    }
+
+    unsigned int a = static_cast<unsigned int>(edges[i].key >> 32);
+    unsigned int b = static_cast<unsigned int>(edges[i].key);
+    if (end - i == 1) {
+      ++border_edges[a];
+      ++border_edges[b];
+    } else if (end - i > 2) {
+      adjacency->kinds[a] = kLocked;
+      adjacency->kinds[b] = kLocked;
+    }
+    i = end;
+  }
+
+  for (unsigned int p = 0; p < position_count; ++p) {
+    if (adjacency->kinds[p] == kLocked || border_edges[p] == 0) {
+      continue;
+    }
+    adjacency->kinds[p] = border_edges[p] == 2 ? kBorder : kLocked;
+  }
+}
+
+struct Collapse {
+  unsigned int from; // Positions
+  unsigned int to;
+  double error;
+
+  bool operator<(const Collapse& o) const { return error < o.error; }
+};
+
+// Finds the vertex each vertex at position from moves to: the one at
+// position to it shares an edge with. Fails if a vertex has no such edge
+// or several, which would tear an attribute seam.
+bool MapWedges(const std::vector<glm::uvec3>& faces,
+               const SimplifyVertices& vertices,
+               const PositionAdjacency& adjacency, unsigned int from,
+               unsigned int to,
+               std::vector<std::pair<unsigned int, unsigned int>>* wedges) {
+  wedges->clear();
+  for (unsigned int i = adjacency.offsets[from];
+       i < adjacency.offsets[from + 1]; ++i) {
+    const glm::uvec3& face = faces[adjacency.faces[i]];
+    for (int c = 0; c < 3; ++c) {
+      if (vertices.position_ids[face[c]] != from) {
+        continue;
+      }
+
+      unsigned int target = 0;
+      bool found = false;
+      for (int o = 1; o < 3; ++o) {
+        unsigned int v = face[(c + o) % 3];
+        if (vertices.position_ids[v] == to) {
+          target = v;
+          found = true;
+        }
+      }
+
+      bool known = false;
+      for (auto& wedge : *wedges) {
+        if (wedge.first != face[c]) {
+          continue;
+        }
+        known = true;
+        if (found) {
+          if (wedge.second == face[c]) {
+            wedge.second = target;
+          } else if (wedge.second != target) {
+            return false;
+          }
+        }
+      }
+      if (!known) {
+        // Vertices map to themselves until an edge to the target is found
+        wedges->push_back(std::make_pair(face[c], found ? target : face[c]));
+      }
+    }
+  }
+
+  for (const auto& wedge : *wedges) {
+    if (wedge.first == wedge.second) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// True if moving position from onto position to turns a face that remains
+// too far, or makes it degenerate
+bool FlipsFaces(const std::vector<glm::uvec3>& faces,
+                const SimplifyVertices& vertices,
+                const PositionAdjacency& adjacency, unsigned int from,
+                const glm::dvec3& to_position, unsigned int to) {
+  for (unsigned int i = adjacency.offsets[from];
+       i < adjacency.offsets[from + 1]; ++i) {
+    const glm::uvec3& face = faces[adjacency.faces[i]];
+    glm::dvec3 before[3];
+    glm::dvec3 after[3];
+    bool removed = false;
+    for (int c = 0; c < 3; ++c) {
+      unsigned int position_id = vertices.position_ids[face[c]];
+      removed = removed || position_id == to;
+      before[c] = vertices.positions[face[c]];
+      after[c] = position_id == from ? to_position : before[c];
+    }
+    if (removed) {
+      continue;
+    }
+
+    glm::dvec3 n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+    glm::dvec3 n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+    double length1 = glm::length(n1);
+    if (length1 == 0.0 ||
+        glm::dot(n0, n1) < kMinFlipCos * glm::length(n0) * length1) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Collapses as many edges as it can without two collapses touching the same
+// faces, cheapest first, until faces has target_faces left. Keeps the
+// largest mean squared distance of a collapsed position from the planes of
+// its faces in max_error. Returns false if no edge could be collapsed.
+bool CollapseEdges(size_t target_faces, const SimplifyVertices& vertices,
+                   std::vector<glm::uvec3>* faces,
+                   std::vector<Quadric>* quadrics,
+                   std::vector<Quadric>* plane_quadrics, double* max_error) {
+  std::vector<EdgeUse> edges;
+  CollectEdges(*faces, vertices, &edges);
+
+  PositionAdjacency adjacency;
+  BuildPositionAdjacency(*faces, vertices, edges, &adjacency);
+
+  std::vector<std::pair<unsigned int, unsigned int>> wedges;
+  std::vector<Collapse> collapses;
+  for (size_t i = 0; i < edges.size();) {
+    size_t end = i;
+    while (end < edges.size() && edges[end].key == edges[i].key) {
+      ++end;
+    }
+    bool border_edge = end - i == 1;
+    unsigned int a = static_cast<unsigned int>(edges[i].key >> 32);
+    unsigned int b = static_cast<unsigned int>(edges[i].key);
+    i = end;
+
+    for (int direction = 0; direction < 2; ++direction) {
+      unsigned int from = direction == 0 ? a : b;
+      unsigned int to = direction == 0 ? b : a;
+      PositionKind kind = adjacency.kinds[from];
+      if (kind == kLocked || (kind == kBorder && !border_edge)) {
+        continue;
+      }
+      if (!MapWedges(*faces, vertices, adjacency, from, to, &wedges)) {
+        continue;
+      }
+
+      double error = 0.0;
+      double area = 0.0;
+      for (const auto& wedge : wedges) {
+        const Quadric& quadric = (*quadrics)[wedge.first];
+        error += quadric.Evaluate(
+            vertices.positions[wedge.second],
+            &vertices.attribs[wedge.second * kMaxAttribs],
+            vertices.attrib_count);
+        area += quadric.w;
+      }
+      collapses.push_back({from, to, area > 0.0 ? error / area : error});
+    }
+  }
+  std::sort(collapses.begin(), collapses.end());
+
+  std::vector<unsigned int> remap(vertices.positions.size());
+  for (unsigned int v = 0; v < remap.size(); ++v) {
+    remap[v] = v;
+  }
+
+  std::vector<bool> touched(vertices.position_count, false);
+  size_t face_count = faces->size();
+  unsigned int collapsed = 0;
+  for (const Collapse& collapse : collapses) {
+    if (face_count <= target_faces) {
+      break;
+    }
+    if (touched[collapse.from] || touched[collapse.to]) {
+      continue;
+    }
+
+    MapWedges(*faces, vertices, adjacency, collapse.from, collapse.to,
+              &wedges);
+    const glm::dvec3& to_position = vertices.positions[wedges[0].second];
+    if (FlipsFaces(*faces, vertices, adjacency, collapse.from, to_position,
+                   collapse.to)) {
+      continue;
+    }
+
+    double plane_error = 0.0;
+    double plane_area = 0.0;
+    for (const auto& wedge : wedges) {
+      const Quadric& quadric = (*plane_quadrics)[wedge.first];
+      plane_error += quadric.Evaluate(to_position, NULL, 0);
+      plane_area += quadric.w;
+    }
+    if (plane_area > 0.0) {
+      *max_error = std::max(*max_error, plane_error / plane_area);
+    }
+
+    for (const auto& wedge : wedges) {
+      remap[wedge.first] = wedge.second;
+      (*quadrics)[wedge.second].Add((*quadrics)[wedge.first]);
+      (*plane_quadrics)[wedge.second].Add((*plane_quadrics)[wedge.first]);
+    }
+
+    // The faces around from change, so none of their positions may take
+    // part in another collapse until the next pass
+    for (unsigned int i = adjacency.offsets[collapse.from];
+         i < adjacency.offsets[collapse.from + 1]; ++i) {
+      const glm::uvec3& face = (*faces)[adjacency.faces[i]];
+      bool removed = false;
+      for (int c = 0; c < 3; ++c) {
+        unsigned int position_id = vertices.position_ids[face[c]];
+        touched[position_id] = true;
+        removed = removed || position_id == collapse.to;
+      }
+      face_count -= removed ? 1 : 0;
+    }
+
+    ++collapsed;
+  }
+
+  // Faces whose corners end up at fewer than three positions are dropped
+  size_t kept = 0;
+  for (const glm::uvec3& face : *faces) {
+    glm::uvec3 new_face(remap[face.x], remap[face.y], remap[face.z]);
+    unsigned int p0 = vertices.position_ids[new_face.x];
+    unsigned int p1 = vertices.position_ids[new_face.y];
+    unsigned int p2 = vertices.position_ids[new_face.z];
+    if (p0 != p1 && p1 != p2 && p0 != p2) {
+      (*faces)[kept++] = new_face;
+    }
+  }
+  faces->resize(kept);
+
+  return collapsed > 0;
+}
+
+} // namespace
+
+bool BuildLodChain(Model* model, const LodOptions& options,
+                   std::vector<LodLevel>* levels) {
+  if (!model->indexed_drawing) {
+    std::cerr << "BuildLodChain needs an indexed model" << std::endl;
+    return false;
+  }
+  if (model->face_count == 0 || model->vert_count == 0) {
+    std::cerr << "BuildLodChain needs a model with faces" << std::endl;
+    return false;
+  }
+
+  SimplifyVertices vertices;
+  PrepareVertices(*model, options, &vertices);
+
+  model->faces.resize(model->face_count);
+  std::vector<glm::uvec3> faces = model->faces;
+
+  std::vector<Quadric> quadrics;
+  std::vector<Quadric> plane_quadrics;
+  ComputeQuadrics(faces, vertices, &quadrics, &plane_quadrics);
+
+  levels->clear();
+  LodLevel full_level;
+  full_level.face_count = model->face_count;
+  levels->push_back(full_level);
+
+  // Each level is reordered on its own, in a model sharing the vertices
+  Model level_model;
+  level_model.vert_count = model->vert_count;
+  level_model.indexed_drawing = true;
+
+  double max_error = 0.0;
+  while (levels->size() < options.max_levels) {
+    size_t previous_faces = faces.size();
+    size_t target_faces = static_cast<size_t>(previous_faces *
+                                              options.reduction);
+
+    while (faces.size() > target_faces &&
+           CollapseEdges(target_faces, vertices, &faces, &quadrics,
+                         &plane_quadrics, &max_error)) {
+    }
+    if (faces.empty() ||
+        faces.size() > previous_faces * kMinLevelReduction) {
+      break;
+    }
+
+    level_model.faces = faces;
+    level_model.face_count = faces.size();
+    OptimizeVertexCache(&level_model);
+
+    LodLevel level;
+    level.first_face = model->faces.size();
+    level.face_count = faces.size();
+    // The quadric errors are mean squared distances in the unit cube
+    level.error = static_cast<float>(std::sqrt(max_error) * vertices.extent);
+    levels->push_back(level);
+
+    model->faces.insert(model->faces.end(), level_model.faces.begin(),
+                        level_model.faces.end());
+  }
+
+  model->face_count = model->faces.size();
+  return true;
+}
+
+float ProjectedLodError(float error, const glm::mat4& proj_mat,
+                        float viewport_height, float distance) {
+  // proj_mat[1][1] is the cotangent of half the vertical field of view for
+  // a perspective projection, which spans 2 units at a distance of 1
+  float pixels = error * proj_mat[1][1] * 0.5f * viewport_height;
+  if (proj_mat[3][3] == 0.f) {
+    pixels /= std::max(distance, 1e-6f);
+  }
+  return pixels;
+}
+
+unsigned int SelectLod(const std::vector<LodLevel>& levels,
+                       const glm::mat4& proj_mat, float viewport_height,
+                       float distance, float max_pixels) {
+  unsigned int selected = 0;
+  for (unsigned int i = 1; i < levels.size(); ++i) {
+    if (ProjectedLodError(levels[i].error, proj_mat, viewport_height,
+                          distance) <= max_pixels) {
+      selected = i;
+    }
+  }
+  return selected;
+}
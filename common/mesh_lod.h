@@ -0,0 +1,64 @@
+#ifndef MESH_LOD_H_
+#define MESH_LOD_H_
+
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "model.h"
+
+// Levels of detail for an indexed model, built by simplifying it with
+// quadric error metrics (Garland and Heckbert, "Surface simplification
+// using quadric error metrics"). Every level is a range of the model's
+// faces, and all of them index the model's one set of vertices, so a mesh
+// uploads a single vertex buffer and picks a level with Mesh::DrawFaces.
+
+// One level of detail: faces [first_face, first_face + face_count) of the
+// model. error estimates how far the level deviates from the full-detail
+// surface, in the units of the model's positions.
+struct LodLevel {
+  unsigned int first_face = 0;
+  unsigned int face_count = 0;
+  float error = 0.f;
+};
+
+struct LodOptions {
+  unsigned int max_levels = 5; // Including the full-detail level
+  float reduction = 0.5f;      // Fraction of faces kept from level to level
+
+  // How much a change in normal or texcoord counts against a collapse,
+  // relative to a change in position the size of the model
+  float normal_weight = 0.5f;
+  float texcoord_weight = 1.f;
+};
+
+// Appends the simplified levels to the faces of an indexed model, after its
+// full-detail faces, and sets face_count to the total. Level 0 is the
+// model as it was. Each further level collapses edges of the one before it
+// onto one of their two vertices, cheapest first, until
+// options.reduction of its faces remain, so that no vertices are added.
+// The cost of a collapse includes the change in normals and texcoords
+// (Hoppe, "New quadric metric for simplifying meshes with appearance
+// attributes"). Vertices at the same position with different attributes
+// are collapsed together, so attribute seams stay closed; open borders
+// stay in place and non-manifold vertices are never moved. The chain stops
+// early if a level cannot be simplified any further. Each level is
+// ordered for the vertex cache with OptimizeVertexCache.
+bool BuildLodChain(Model* model, const LodOptions& options,
+                   std::vector<LodLevel>* levels);
+
+// Size in pixels of an error at the given distance from the eye, both in
+// the same units, on a viewport of the given height. Orthographic
+// projections ignore the distance.
+float ProjectedLodError(float error, const glm::mat4& proj_mat,
+                        float viewport_height, float distance);
+
+// Returns the coarsest level whose projected error is at most max_pixels,
+// or level 0 if none is. distance is from the eye to the closest point of
+// the model, in the units of the model's positions; for a model scaled by
+// s that is the eye space distance divided by s.
+unsigned int SelectLod(const std::vector<LodLevel>& levels,
+                       const glm::mat4& proj_mat, float viewport_height,
+                       float distance, float max_pixels);
+
+#endif
@@ -0,0 +1,501 @@
+#include "mesh_optimizer.h"
+
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "model.h"
+
+namespace {
+
+// Cache size used for scoring in the Forsyth optimization. Scores assume a
+// larger LRU cache than the FIFO of the statistics, as in the original
+// article, which also does well on smaller hardware caches.
+const int kForsythCacheSize = 32;
+
+const unsigned int kOverdrawResolution = 256;
+
+bool CheckIndexed(const Model& model, const char* pass_name) {
+  if (!model.indexed_drawing) {
+    std::cerr << pass_name << " needs an indexed model" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+float ForsythVertexScore(int cache_position, unsigned int remaining_faces) {
+  if (remaining_faces == 0) {
+    return -1.f;
+  }
+
+  float score = 0.f;
+  if (cache_position >= 0) {
+    if (cache_position < 3) {
+      // The last face's vertices get a fixed score so that the next face
+      // does not simply reuse the same edge
+      score = 0.75f;
+    } else {
+      float scale = 1.f / (kForsythCacheSize - 3);
+      score = std::pow(1.f - (cache_position - 3) * scale, 1.5f);
+    }
+  }
+
+  // Favors vertices with few faces left, to get rid of lone triangles
+  score += 2.f / std::sqrt(static_cast<float>(remaining_faces));
+  return score;
+}
+
+// Faces using each vertex, stored as one array with per-vertex offsets
+struct VertexAdjacency {
+  std::vector<unsigned int> counts;
+  std::vector<unsigned int> offsets;
+  std::vector<unsigned int> faces;
+};
+
+void BuildAdjacency(const Model& model, VertexAdjacency* adjacency) {
+  unsigned int vert_count = model.vert_count;
+  adjacency->counts.assign(vert_count, 0);
+  adjacency->offsets.assign(vert_count, 0);
+
+  for (const glm::uvec3& face : model.faces) {
+    for (int c = 0; c < 3; ++c) {
+      ++adjacency->counts[face[c]];
+    }
+  }
+
+  unsigned int offset = 0;
+  for (unsigned int v = 0; v < vert_count; ++v) {
+    adjacency->offsets[v] = offset;
+    offset += adjacency->counts[v];
+  }
+
+  adjacency->faces.resize(offset);
+  std::vector<unsigned int> fill(vert_count, 0);
+  for (unsigned int f = 0; f < model.faces.size(); ++f) {
+    for (int c = 0; c < 3; ++c) {
+      unsigned int v = model.faces[f][c];
+      adjacency->faces[adjacency->offsets[v] + fill[v]++] = f;
+    }
+  }
+}
+
+// Simulated FIFO cache. A vertex is cached if fewer than cache_size misses
+// happened since it was last loaded.
+class FifoCache {
+ public:
+  FifoCache(unsigned int vert_count, unsigned int cache_size)
+      : load_time_(vert_count, 0), time_(cache_size + 1),
+        cache_size_(cache_size) {}
+
+  void Reset() {
+    time_ += cache_size_ + 1;
+  }
+
+  // Returns the number of misses for the face's vertices
+  unsigned int Access(const glm::uvec3& face) {
+    unsigned int misses = 0;
+    for (int c = 0; c < 3; ++c) {
+      unsigned int v = face[c];
+      if (time_ - load_time_[v] > cache_size_) {
+        load_time_[v] = ++time_;
+        ++misses;
+      }
+    }
+    return misses;
+  }
+
+ private:
+  std::vector<unsigned int> load_time_;
+  unsigned int time_;
+  unsigned int cache_size_;
+};
+
+struct Cluster {
+  unsigned int begin;
+  unsigned int end;
+  float sort_key;
+};
+
+} // namespace
+
+bool OptimizeVertexCache(Model* model) {
+  if (!CheckIndexed(*model, "OptimizeVertexCache")) {
+    return false;
+  }
+
+  unsigned int face_count = model->faces.size();
+  unsigned int vert_count = model->vert_count;
+
+  VertexAdjacency adjacency;
+  BuildAdjacency(*model, &adjacency);
+
+  std::vector<int> cache_position(vert_count, -1);
+  std::vector<float> vertex_score(vert_count);
+  for (unsigned int v = 0; v < vert_count; ++v) {
+    vertex_score[v] = ForsythVertexScore(-1, adjacency.counts[v]);
+  }
+
+  std::vector<float> face_score(face_count);
+  std::vector<bool> emitted(face_count, false);
+  for (unsigned int f = 0; f < face_count; ++f) {
+    const glm::uvec3& face = model->faces[f];
+    face_score[f] = vertex_score[face.x] + vertex_score[face.y] +
+                    vertex_score[face.z];
+  }
+
+  std::vector<glm::uvec3> new_faces;
+  new_faces.reserve(face_count);
+
+  std::vector<unsigned int> cache;
+  std::vector<unsigned int> new_cache;
+  cache.reserve(kForsythCacheSize + 3);
+  new_cache.reserve(kForsythCacheSize + 3);
+
+  unsigned int input_cursor = 0;
+  int best_face = -1;
+
+  while (new_faces.size() < face_count) {
+    // Without a candidate next to the cache, continues with the next face
+    // in input order
+    if (best_face < 0) {
+      while (emitted[input_cursor]) {
+        ++input_cursor;
+      }
+      best_face = input_cursor;
+    }
+
+    const glm::uvec3 face = model->faces[best_face];
+    new_faces.push_back(face);
+    emitted[best_face] = true;
+
+    // Removes the face from its vertices' lists of remaining faces
+    for (int c = 0; c < 3; ++c) {
+      unsigned int v = face[c];
+      unsigned int* begin = &adjacency.faces[adjacency.offsets[v]];
+      unsigned int* end = begin + adjacency.counts[v];
+      *std::find(begin, end, static_cast<unsigned int>(best_face)) =
+          *(end - 1);
+      --adjacency.counts[v];
+    }
+
+    // Moves the face's vertices to the front of the LRU cache
+    new_cache.clear();
+    new_cache.push_back(face.x);
+    new_cache.push_back(face.y);
+    new_cache.push_back(face.z);
+    for (unsigned int v : cache) {
+      if (v != face.x && v != face.y && v != face.z) {
+        new_cache.push_back(v);
+      }
+    }
+
+    for (size_t i = 0; i < new_cache.size(); ++i) {
+      unsigned int v = new_cache[i];
+      cache_position[v] = i < static_cast<size_t>(kForsythCacheSize)
+                              ? static_cast<int>(i) : -1;
+      vertex_score[v] = ForsythVertexScore(cache_position[v],
+                                           adjacency.counts[v]);
+    }
+
+    // Rescores the faces touching the cache and picks the best of them
+    best_face = -1;
+    float best_score = -std::numeric_limits<float>::max();
+    for (unsigned int v : new_cache) {
+      unsigned int begin = adjacency.offsets[v];
+      unsigned int end = begin + adjacency.counts[v];
+      for (unsigned int i = begin; i < end; ++i) {
+        unsigned int f = adjacency.faces[i];
+        const glm::uvec3& other = model->faces[f];
+        face_score[f] = vertex_score[other.x] + vertex_score[other.y] +
+                        vertex_score[other.z];
+        if (face_score[f] > best_score) {
+          best_score = face_score[f];
+          best_face = f;
+        }
+      }
+    }
+
+    if (new_cache.size() > static_cast<size_t>(kForsythCacheSize)) {
+      new_cache.resize(kForsythCacheSize);
+    }
+    cache.swap(new_cache);
+  }
+
+  model->faces.swap(new_faces);
+  return true;
+}
+
+bool OptimizeOverdraw(Model* model, float threshold) {
+  if (!CheckIndexed(*model, "OptimizeOverdraw")) {
+    return false;
+  }
+
+  const std::vector<glm::uvec3>& faces = model->faces;
+  unsigned int face_count = faces.size();
+  if (face_count == 0) {
+    return true;
+  }
+
+  FifoCache cache(model->vert_count, kVertexCacheSize);
+
+  // Hard boundaries are where the cache has to be refilled entirely, so
+  // splitting there costs nothing
+  std::vector<unsigned int> hard_boundaries;
+  for (unsigned int f = 0; f < face_count; ++f) {
+    if (cache.Access(faces[f]) == 3 || f == 0) {
+      hard_boundaries.push_back(f);
+    }
+  }
+  hard_boundaries.push_back(face_count);
+
+  // Soft boundaries split hard clusters further where the part before the
+  // split keeps its ACMR within the threshold
+  std::vector<Cluster> clusters;
+  for (size_t h = 0; h + 1 < hard_boundaries.size(); ++h) {
+    unsigned int begin = hard_boundaries[h];
+    unsigned int end = hard_boundaries[h + 1];
+
+    cache.Reset();
+    unsigned int cluster_misses = 0;
+    for (unsigned int f = begin; f < end; ++f) {
+      cluster_misses += cache.Access(faces[f]);
+    }
+    float max_acmr = threshold * cluster_misses / (end - begin);
+
+    cache.Reset();
+    unsigned int cluster_begin = begin;
+    unsigned int misses = 0;
+    for (unsigned int f = begin; f < end; ++f) {
+      misses += cache.Access(faces[f]);
+
+      float acmr = static_cast<float>(misses) / (f + 1 - cluster_begin);
+      if (acmr <= max_acmr && f + 1 < end) {
+        Cluster cluster = {cluster_begin, f + 1, 0.f};
+        clusters.push_back(cluster);
+        cluster_begin = f + 1;
+        misses = 0;
+        cache.Reset();
+      }
+    }
+    Cluster cluster = {cluster_begin, end, 0.f};
+    clusters.push_back(cluster);
+  }
+
+  glm::vec3 mesh_center(0.f);
+  for (unsigned int v = 0; v < model->vert_count; ++v) {
+    mesh_center += model->positions[v];
+  }
+  mesh_center /= static_cast<float>(model->vert_count);
+
+  // Clusters far out along their own facing direction are likely to
+  // occlude the rest of the mesh, so they are drawn first
+  for (Cluster& cluster : clusters) {
+    glm::vec3 centroid(0.f);
+    glm::vec3 normal(0.f);
+    float area_sum = 0.f;
+
+    for (unsigned int f = cluster.begin; f < cluster.end; ++f) {
+      const glm::vec3& p0 = model->positions[faces[f].x];
+      const glm::vec3& p1 = model->positions[faces[f].y];
+      const glm::vec3& p2 = model->positions[faces[f].z];
+      glm::vec3 face_normal = glm::cross(p1 - p0, p2 - p0);
+      float area = glm::length(face_normal);
+
+      centroid += (p0 + p1 + p2) * (area / 3.f);
+      normal += face_normal;
+      area_sum += area;
+    }
+
+    float normal_length = glm::length(normal);
+    if (area_sum > 0.f && normal_length > 0.f) {
+      centroid /= area_sum;
+      cluster.sort_key = glm::dot(centroid - mesh_center,
+                                  normal / normal_length);
+    }
+  }
+
+  std::stable_sort(clusters.begin(), clusters.end(),
+                   [](const Cluster& a, const Cluster& b) {
+                     return a.sort_key > b.sort_key;
+                   });
+
+  std::vector<glm::uvec3> new_faces;
+  new_faces.reserve(face_count);
+  for (const Cluster& cluster : clusters) {
+    new_faces.insert(new_faces.end(), faces.begin() + cluster.begin,
+                     faces.begin() + cluster.end);
+  }
+
+  model->faces.swap(new_faces);
+  return true;
+}
+
+bool OptimizeVertexFetch(Model* model) {
+  if (!CheckIndexed(*model, "OptimizeVertexFetch")) {
+    return false;
+  }
+
+  const unsigned int kUnassigned = std::numeric_limits<unsigned int>::max();
+  unsigned int vert_count = model->vert_count;
+
+  std::vector<unsigned int> remap(vert_count, kUnassigned);
+  unsigned int next_index = 0;
+  for (glm::uvec3& face : model->faces) {
+    for (int c = 0; c < 3; ++c) {
+      if (remap[face[c]] == kUnassigned) {
+        remap[face[c]] = next_index++;
+      }
+      face[c] = remap[face[c]];
+    }
+  }
+  for (unsigned int v = 0; v < vert_count; ++v) {
+    if (remap[v] == kUnassigned) {
+      remap[v] = next_index++;
+    }
+  }
+
+  if (model->positions.size() >= vert_count) {
+    std::vector<glm::vec3> positions(model->positions.size());
+    for (unsigned int v = 0; v < vert_count; ++v) {
+      positions[remap[v]] = model->positions[v];
+    }
+    model->positions.swap(positions);
+  }
+  if (model->normals.size() >= vert_count) {
+    std::vector<glm::vec3> normals(model->normals.size());
+    for (unsigned int v = 0; v < vert_count; ++v) {
+      normals[remap[v]] = model->normals[v];
+    }
+    model->normals.swap(normals);
+  }
+  if (model->texcoords.size() >= vert_count) {
+    std::vector<glm::vec2> texcoords(model->texcoords.size());
+    for (unsigned int v = 0; v < vert_count; ++v) {
+      texcoords[remap[v]] = model->texcoords[v];
+    }
+    model->texcoords.swap(texcoords);
+  }
+
+  return true;
+}
+
+bool OptimizeMesh(Model* model) {
+  return OptimizeVertexCache(model) && OptimizeOverdraw(model) &&
+         OptimizeVertexFetch(model);
+}
+
+VertexCacheStats AnalyzeVertexCache(const Model& model,
+                                    unsigned int cache_size) {
+  VertexCacheStats stats;
+  if (!model.indexed_drawing || model.faces.empty()) {
+    return stats;
+  }
+
+  FifoCache cache(model.vert_count, cache_size);
+  std::vector<bool> used(model.vert_count, false);
+  unsigned int misses = 0;
+  unsigned int used_count = 0;
+
+  for (const glm::uvec3& face : model.faces) {
+    misses += cache.Access(face);
+    for (int c = 0; c < 3; ++c) {
+      if (!used[face[c]]) {
+        used[face[c]] = true;
+        ++used_count;
+      }
+    }
+  }
+
+  stats.acmr = static_cast<float>(misses) / model.faces.size();
+  stats.atvr = static_cast<float>(misses) / used_count;
+  return stats;
+}
+
+float AnalyzeOverdraw(const Model& model) {
+  if (!model.indexed_drawing || model.faces.empty()) {
+    return 0.f;
+  }
+
+  glm::vec3 min_pos(std::numeric_limits<float>::max());
+  glm::vec3 max_pos(-std::numeric_limits<float>::max());
+  for (unsigned int v = 0; v < model.vert_count; ++v) {
+    min_pos = glm::min(min_pos, model.positions[v]);
+    max_pos = glm::max(max_pos, model.positions[v]);
+  }
+  glm::vec3 extent = max_pos - min_pos;
+  float scale = (kOverdrawResolution - 1) /
+                std::max(std::max(std::max(extent.x, extent.y), extent.z),
+                         1e-6f);
+
+  const unsigned int res = kOverdrawResolution;
+  std::vector<float> depth(res * res);
+  unsigned long long covered = 0;
+  unsigned long long shaded = 0;
+
+  // Orthographic views along both directions of each axis
+  for (int axis = 0; axis < 3; ++axis) {
+    for (int side = 0; side < 2; ++side) {
+      std::fill(depth.begin(), depth.end(),
+                std::numeric_limits<float>::max());
+      int u_axis = (axis + 1) % 3;
+      int v_axis = (axis + 2) % 3;
+      float depth_sign = side == 0 ? 1.f : -1.f;
+
+      for (const glm::uvec3& face : model.faces) {
+        glm::vec3 p[3];
+        for (int c = 0; c < 3; ++c) {
+          glm::vec3 pos = (model.positions[face[c]] - min_pos) * scale;
+          p[c] = glm::vec3(pos[u_axis], pos[v_axis], depth_sign * pos[axis]);
+        }
+
+        float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) -
+                     (p[2].x - p[0].x) * (p[1].y - p[0].y);
+        if (area == 0.f) {
+          continue;
+        }
+
+        int min_x = std::max(static_cast<int>(std::ceil(
+            std::min(std::min(p[0].x, p[1].x), p[2].x) - 0.5f)), 0);
+        int min_y = std::max(static_cast<int>(std::ceil(
+            std::min(std::min(p[0].y, p[1].y), p[2].y) - 0.5f)), 0);
+        int max_x = std::min(static_cast<int>(std::floor(
+            std::max(std::max(p[0].x, p[1].x), p[2].x) - 0.5f)),
+            static_cast<int>(res) - 1);
+        int max_y = std::min(static_cast<int>(std::floor(
+            std::max(std::max(p[0].y, p[1].y), p[2].y) - 0.5f)),
+            static_cast<int>(res) - 1);
+
+        for (int y = min_y; y <= max_y; ++y) {
+          for (int x = min_x; x <= max_x; ++x) {
+            float px = x + 0.5f;
+            float py = y + 0.5f;
+            float w0 = ((p[2].x - p[1].x) * (py - p[1].y) -
+                        (p[2].y - p[1].y) * (px - p[1].x)) / area;
+            float w1 = ((p[0].x - p[2].x) * (py - p[2].y) -
+                        (p[0].y - p[2].y) * (px - p[2].x)) / area;
+            float w2 = 1.f - w0 - w1;
+            if (w0 < 0.f || w1 < 0.f || w2 < 0.f) {
+              continue;
+            }
+
+            float z = w0 * p[0].z + w1 * p[1].z + w2 * p[2].z;
+            float& stored = depth[y * res + x];
+            if (z < stored) {
+              if (stored == std::numeric_limits<float>::max()) {
+                ++covered;
+              }
+              stored = z;
+              ++shaded;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  return covered == 0 ? 0.f : static_cast<float>(shaded) / covered;
+}
@@ -0,0 +1,45 @@
+#ifndef MESH_OPTIMIZER_H_
+#define MESH_OPTIMIZER_H_
+
+#include "model.h"
+
+// Reordering passes for indexed models, run after CreateModelFromFile and
+// before uploading. None of them change what is drawn, only the order of
+// faces and vertices.
+
+// Size of the post-transform cache the passes and statistics assume
+const unsigned int kVertexCacheSize = 16;
+
+// Reorders faces for post-transform vertex cache hits using Tom Forsyth's
+// linear-speed vertex cache optimization
+bool OptimizeVertexCache(Model* model);
+
+// Reorders clusters of faces so that faces likely to occlude others are
+// drawn first, independent of the view direction (Sander et al., "Fast
+// triangle reordering for vertex locality and reduced overdraw"). Expects a
+// cache-optimized face order. Clusters are only split where their ACMR stays
+// within threshold times the ACMR of the input.
+bool OptimizeOverdraw(Model* model, float threshold = 1.05f);
+
+// Renumbers vertices in the order faces first use them, so vertex fetches
+// walk memory linearly. Unused vertices are moved to the end.
+bool OptimizeVertexFetch(Model* model);
+
+// Runs the three passes above in order
+bool OptimizeMesh(Model* model);
+
+struct VertexCacheStats {
+  float acmr = 0.f; // Cache misses per triangle, 0.5 is the ideal
+  float atvr = 0.f; // Cache misses per used vertex, 1.0 is the ideal
+};
+
+// Simulates a FIFO post-transform cache of the given size
+VertexCacheStats AnalyzeVertexCache(const Model& model,
+                                    unsigned int cache_size = kVertexCacheSize);
+
+// Rasterizes the model with depth testing from each side of its bounding
+// box and returns the average number of fragments that pass the depth test
+// per covered pixel. 1.0 means no overdraw.
+float AnalyzeOverdraw(const Model& model);
+
+#endif
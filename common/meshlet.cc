@@ -0,0 +1,339 @@
+#include "meshlet.h"
+
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "model.h"
+#include "parallel.h"
+
+namespace {
+
+// How much the spread of normals counts against adding a face, relative to
+// the face bringing one new vertex
+const float kConeWeight = 0.25f;
+
+// Added to the normal cone cutoff so that rounding in the bounds and in
+// the test never culls a face seen close to edge on
+const float kConeCutoffMargin = 1e-3f;
+
+// Fewest meshlets worth giving a thread of their own when culling
+const size_t kMinMeshletsPerThread = 256;
+
+void ComputeBounds(const Model& model, const std::vector<glm::vec3>& normals,
+                   const std::vector<unsigned int>& vertices,
+                   Meshlet* meshlet) {
+  glm::vec3 min_pos = model.positions[vertices[0]];
+  glm::vec3 max_pos = min_pos;
+  for (unsigned int v : vertices) {
+    min_pos = glm::min(min_pos, model.positions[v]);
+    max_pos = glm::max(max_pos, model.positions[v]);
+  }
+  meshlet->center = 0.5f * (min_pos + max_pos);
+  meshlet->radius = 0.f;
+  for (unsigned int v : vertices) {
+    meshlet->radius = std::max(meshlet->radius,
+                               glm::length(model.positions[v] -
+                                           meshlet->center));
+  }
+
+  unsigned int end = meshlet->first_face + meshlet->face_count;
+  glm::vec3 normal_sum(0.f);
+  for (unsigned int f = meshlet->first_face; f < end; ++f) {
+    normal_sum += normals[f];
+  }
+  meshlet->cone_cutoff = 2.f;
+  if (normal_sum == glm::vec3(0.f)) {
+    return;
+  }
+  meshlet->cone_axis = glm::normalize(normal_sum);
+
+  float min_dot = 1.f;
+  for (unsigned int f = meshlet->first_face; f < end; ++f) {
+    if (normals[f] != glm::vec3(0.f)) {
+      min_dot = std::min(min_dot, glm::dot(normals[f], meshlet->cone_axis));
+    }
+  }
+  if (min_dot <= 0.f) {
+    return;
+  }
+
+  // The apex is the point along the axis behind the plane of every face,
+  // so that a face is back facing whenever the direction from the eye to
+  // the apex is within 90 degrees of its normal. For all normals within
+  // the cone's half angle a of the axis that holds within 90 - a degrees
+  // of the axis, hence a cutoff of cos(90 - a) = sin(a).
+  float apex_offset = 0.f;
+  for (unsigned int f = meshlet->first_face; f < end; ++f) {
+    if (normals[f] == glm::vec3(0.f)) {
+      continue;
+    }
+    const glm::vec3& p0 = model.positions[model.faces[f].x];
+    float offset = glm::dot(meshlet->center - p0, normals[f]) /
+                   glm::dot(meshlet->cone_axis, normals[f]);
+    apex_offset = std::max(apex_offset, offset);
+  }
+  meshlet->cone_apex = meshlet->center - meshlet->cone_axis * apex_offset;
+  meshlet->cone_cutoff = std::sqrt(1.f - min_dot * min_dot) +
+                         kConeCutoffMargin;
+}
+
+} // namespace
+
+bool BuildMeshlets(Model* model, std::vector<Meshlet>* meshlets) {
+  if (!model->indexed_drawing) {
+    std::cerr << "BuildMeshlets needs an indexed model" << std::endl;
+    return false;
+  }
+
+  const unsigned int vert_count = model->vert_count;
+  const unsigned int face_count = model->faces.size();
+
+  // Faces using each vertex, stored as one array with per-vertex offsets
+  std::vector<unsigned int> offsets(vert_count + 1, 0);
+  for (const glm::uvec3& face : model->faces) {
+    for (int c = 0; c < 3; ++c) {
+      ++offsets[face[c] + 1];
+    }
+  }
+  for (unsigned int v = 0; v < vert_count; ++v) {
+    offsets[v + 1] += offsets[v];
+  }
+  std::vector<unsigned int> vertex_faces(offsets[vert_count]);
+  std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+  for (unsigned int f = 0; f < face_count; ++f) {
+    for (int c = 0; c < 3; ++c) {
+      vertex_faces[fill[model->faces[f][c]]++] = f;
+    }
+  }
+
+  // Unit normals, zero for degenerate faces
+  std::vector<glm::vec3> normals(face_count);
+  for (unsigned int f = 0; f < face_count; ++f) {
+    const glm::uvec3& face = model->faces[f];
+    glm::vec3 p0 = model->positions[face.x];
+    glm::vec3 n = glm::cross(model->positions[face.y] - p0,
+                             model->positions[face.z] - p0);
+    float length = glm::length(n);
+    normals[f] = length > 0.f ? n / length : glm::vec3(0.f);
+  }
+
+  // vertex_meshlet[v] is the index of the last meshlet that used v
+  const unsigned int kNone = std::numeric_limits<unsigned int>::max();
+  std::vector<unsigned int> vertex_meshlet(vert_count, kNone);
+  std::vector<bool> assigned(face_count, false);
+
+  std::vector<glm::uvec3> new_faces;
+  std::vector<glm::vec3> new_normals;
+  new_faces.reserve(face_count);
+  new_normals.reserve(face_count);
+
+  std::vector<unsigned int> candidates;
+  std::vector<unsigned int> vertices;
+  meshlets->clear();
+
+  unsigned int seed = 0;
+  while (true) {
+    while (seed < face_count && assigned[seed]) {
+      ++seed;
+    }
+    if (seed == face_count) {
+      break;
+    }
+
+    const unsigned int id = meshlets->size();
+    Meshlet meshlet;
+    meshlet.first_face = new_faces.size();
+    glm::vec3 normal_sum(0.f);
+    candidates.clear();
+    vertices.clear();
+
+    unsigned int next = seed;
+    while (true) {
+      const glm::uvec3& face = model->faces[next];
+      assigned[next] = true;
+      new_faces.push_back(face);
+      new_normals.push_back(normals[next]);
+      normal_sum += normals[next];
+      ++meshlet.face_count;
+
+      for (int c = 0; c < 3; ++c) {
+        unsigned int v = face[c];
+        if (vertex_meshlet[v] == id) {
+          continue;
+        }
+        vertex_meshlet[v] = id;
+        vertices.push_back(v);
+        for (unsigned int i = offsets[v]; i < offsets[v + 1]; ++i) {
+          if (!assigned[vertex_faces[i]]) {
+            candidates.push_back(vertex_faces[i]);
+          }
+        }
+      }
+
+      if (meshlet.face_count == kMaxMeshletFaces) {
+        break;
+      }
+
+      glm::vec3 axis = normal_sum == glm::vec3(0.f)
+                           ? glm::vec3(0.f) : glm::normalize(normal_sum);
+      float best_score = std::numeric_limits<float>::max();
+      next = kNone;
+      for (size_t i = 0; i < candidates.size();) {
+        unsigned int f = candidates[i];
+        if (assigned[f]) {
+          candidates[i] = candidates.back();
+          candidates.pop_back();
+          continue;
+        }
+        ++i;
+
+        unsigned int new_vertices = 0;
+        for (int c = 0; c < 3; ++c) {
+          new_vertices += vertex_meshlet[model->faces[f][c]] == id ? 0 : 1;
+        }
+        if (vertices.size() + new_vertices > kMaxMeshletVertices) {
+          continue;
+        }
+
+        float score = new_vertices +
+                      kConeWeight * (1.f - glm::dot(normals[f], axis));
+        if (score < best_score) {
+          best_score = score;
+          next = f;
+        }
+      }
+      if (next == kNone) {
+        break;
+      }
+    }
+
+    meshlet.vert_count = vertices.size();
+    meshlets->push_back(meshlet);
+  }
+
+  model->faces.swap(new_faces);
+  for (Meshlet& meshlet : *meshlets) {
+    vertices.clear();
+    unsigned int end = meshlet.first_face + meshlet.face_count;
+    for (unsigned int f = meshlet.first_face; f < end; ++f) {
+      for (int c = 0; c < 3; ++c) {
+        vertices.push_back(model->faces[f][c]);
+      }
+    }
+    ComputeBounds(*model, new_normals, vertices, &meshlet);
+  }
+
+  return true;
+}
+
+MeshletView MakeMeshletView(const glm::mat4& model_mat,
+                            const glm::mat4& view_mat,
+                            const glm::mat4& proj_mat) {
+  MeshletView view;
+
+  // Planes of the clip volume -w <= x, y, z <= w, taken back to model space
+  // through the rows of the combined matrix (Gribb and Hartmann)
+  glm::mat4 mvp_mat = proj_mat * view_mat * model_mat;
+  glm::vec4 rows[4];
+  for (int i = 0; i < 4; ++i) {
+    rows[i] = glm::vec4(mvp_mat[0][i], mvp_mat[1][i], mvp_mat[2][i],
+                        mvp_mat[3][i]);
+  }
+  for (int i = 0; i < 3; ++i) {
+    view.planes[2 * i] = rows[3] + rows[i];
+    view.planes[2 * i + 1] = rows[3] - rows[i];
+  }
+  for (glm::vec4& plane : view.planes) {
+    plane /= glm::length(glm::vec3(plane));
+  }
+
+  glm::mat4 model_view_inverse = glm::inverse(view_mat * model_mat);
+  view.eye_position = glm::vec3(model_view_inverse[3]);
+
+  return view;
+}
+
+MeshletVisibility TestMeshlet(const Meshlet& meshlet,
+                              const MeshletView& view) {
+  for (const glm::vec4& plane : view.planes) {
+    if (glm::dot(glm::vec3(plane), meshlet.center) + plane.w <
+        -meshlet.radius) {
+      return kMeshletOutsideFrustum;
+    }
+  }
+
+  glm::vec3 direction = meshlet.cone_apex - view.eye_position;
+  float length = glm::length(direction);
+  if (length > 0.f &&
+      glm::dot(direction, meshlet.cone_axis) >= meshlet.cone_cutoff * length) {
+    return kMeshletBackFacing;
+  }
+
+  return kMeshletVisible;
+}
+
+void CullMeshlets(const Model& model, const std::vector<Meshlet>& meshlets,
+                  const MeshletView& view, unsigned int num_threads,
+                  std::vector<glm::uvec3>* visible_faces,
+                  MeshletCullStats* stats) {
+  size_t meshlet_count = meshlets.size();
+  unsigned int threads = ResolveThreadCount(num_threads);
+  threads = static_cast<unsigned int>(std::max<size_t>(
+      std::min<size_t>(threads, meshlet_count / kMinMeshletsPerThread), 1));
+
+  std::vector<unsigned char> visibility(meshlet_count);
+  std::vector<MeshletCullStats> thread_stats(threads);
+
+  // Each thread tests a contiguous range of meshlets, counting the faces
+  // that remain so that it knows where to write them
+  ParallelFor(threads, [&](unsigned int thread_index) {
+    size_t begin = meshlet_count * thread_index / threads;
+    size_t end = meshlet_count * (thread_index + 1) / threads;
+
+    MeshletCullStats& counts = thread_stats[thread_index];
+    for (size_t i = begin; i < end; ++i) {
+      MeshletVisibility result = TestMeshlet(meshlets[i], view);
+      visibility[i] = result;
+      if (result == kMeshletVisible) {
+        counts.visible_faces += meshlets[i].face_count;
+      } else if (result == kMeshletOutsideFrustum) {
+        ++counts.frustum_culled;
+      } else {
+        ++counts.backface_culled;
+      }
+    }
+  });
+
+  std::vector<size_t> offsets(threads);
+  MeshletCullStats total;
+  for (unsigned int t = 0; t < threads; ++t) {
+    offsets[t] = total.visible_faces;
+    total.visible_faces += thread_stats[t].visible_faces;
+    total.frustum_culled += thread_stats[t].frustum_culled;
+    total.backface_culled += thread_stats[t].backface_culled;
+  }
+  visible_faces->resize(total.visible_faces);
+
+  ParallelFor(threads, [&](unsigned int thread_index) {
+    size_t begin = meshlet_count * thread_index / threads;
+    size_t end = meshlet_count * (thread_index + 1) / threads;
+
+    glm::uvec3* out = visible_faces->data() + offsets[thread_index];
+    for (size_t i = begin; i < end; ++i) {
+      if (visibility[i] != kMeshletVisible) {
+        continue;
+      }
+      const glm::uvec3* faces = &model.faces[meshlets[i].first_face];
+      out = std::copy(faces, faces + meshlets[i].face_count, out);
+    }
+  });
+
+  if (stats != NULL) {
+    *stats = total;
+  }
+}
@@ -0,0 +1,82 @@
+#ifndef MESHLET_H_
+#define MESHLET_H_
+
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "model.h"
+
+// Clusters of neighbouring faces of an indexed model that are culled as a
+// unit on the CPU, below the level of whole objects. Every frame the faces
+// of the clusters that survive are gathered into one compacted index
+// buffer.
+
+// Limits of the meshlets mesh shading pipelines commonly use
+const unsigned int kMaxMeshletVertices = 64;
+const unsigned int kMaxMeshletFaces = 124;
+
+// Faces [first_face, first_face + face_count) of the model, with a
+// bounding sphere and a cone bounding their normals. The cone is set up so
+// that the meshlet faces away from any eye position from which the apex is
+// seen within the cone's cutoff of the axis: dot(normalize(cone_apex -
+// eye), cone_axis) >= cone_cutoff. A cutoff above 1 never culls, for
+// meshlets whose normals spread over a hemisphere or more.
+struct Meshlet {
+  unsigned int first_face = 0;
+  unsigned int face_count = 0;
+  unsigned int vert_count = 0; // Distinct vertices used by the faces
+
+  glm::vec3 center = glm::vec3(0.f);
+  float radius = 0.f;
+
+  glm::vec3 cone_apex = glm::vec3(0.f);
+  glm::vec3 cone_axis = glm::vec3(0.f, 0.f, 1.f);
+  float cone_cutoff = 2.f;
+};
+
+// Splits the faces of an indexed model into meshlets of at most
+// kMaxMeshletVertices vertices and kMaxMeshletFaces faces, and reorders
+// model->faces so that the faces of each meshlet are contiguous. A meshlet
+// grows from the first unassigned face in the current face order, so a
+// model ordered for the vertex cache gives compact meshlets, adding the
+// neighbouring face that brings the fewest new vertices and whose normal
+// is closest to the meshlet's. Faces are front facing when
+// counterclockwise, as in GL.
+bool BuildMeshlets(Model* model, std::vector<Meshlet>* meshlets);
+
+// A view to cull against, in the space of the model's positions
+struct MeshletView {
+  glm::vec4 planes[6]; // Normalized, pointing into the frustum
+  glm::vec3 eye_position;
+};
+
+MeshletView MakeMeshletView(const glm::mat4& model_mat,
+                            const glm::mat4& view_mat,
+                            const glm::mat4& proj_mat);
+
+enum MeshletVisibility {
+  kMeshletVisible,
+  kMeshletOutsideFrustum,
+  kMeshletBackFacing
+};
+
+MeshletVisibility TestMeshlet(const Meshlet& meshlet, const MeshletView& view);
+
+struct MeshletCullStats {
+  unsigned int frustum_culled = 0; // Meshlets
+  unsigned int backface_culled = 0;
+  unsigned int visible_faces = 0;
+};
+
+// Tests every meshlet against the view and writes the faces of the visible
+// ones to visible_faces, in meshlet order, ready to upload as the index
+// buffer of the frame. The meshlets are split between num_threads threads;
+// 0 uses all hardware threads. Reusing visible_faces from frame to frame
+// saves reallocating it.
+void CullMeshlets(const Model& model, const std::vector<Meshlet>& meshlets,
+                  const MeshletView& view, unsigned int num_threads,
+                  std::vector<glm::uvec3>* visible_faces,
+                  MeshletCullStats* stats = NULL);
+
+#endif
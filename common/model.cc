@@ -0,0 +1,847 @@
+#include "model.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "glm/glm.hpp"
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+namespace {
+
+// Hashes the (position, normal, texcoord) index triple of a face corner so
+// that corners referring to the same attributes map to one vertex
+struct IndexTripleHash {
+  size_t operator()(const tinyobj::index_t& idx) const {
+    size_t h = static_cast<size_t>(idx.vertex_index);
+    h = h * 73856093u ^ static_cast<size_t>(idx.normal_index);
+    h = h * 19349663u ^ static_cast<size_t>(idx.texcoord_index);
+    return h;
+  }
+};
+
+struct IndexTripleEqual {
+  bool operator()(const tinyobj::index_t& a,
+                  const tinyobj::index_t& b) const {
+    return a.vertex_index == b.vertex_index &&
+           a.normal_index == b.normal_index &&
+           a.texcoord_index == b.texcoord_index;
+  }
+};
+
+// Copies the attributes referenced by idx into vertex i of the model
+void CopyVertex(const tinyobj::attrib_t& attrib, const tinyobj::index_t& idx,
+                Model* model, size_t i) {
+  size_t v = idx.vertex_index;
+  model->positions[i][0] = attrib.vertices[3 * v + 0];
+  model->positions[i][1] = attrib.vertices[3 * v + 1];
+  model->positions[i][2] = attrib.vertices[3 * v + 2];
+
+  size_t vn = idx.normal_index;
+  model->normals[i][0] = attrib.normals[3 * vn + 0];
+  model->normals[i][1] = attrib.normals[3 * vn + 1];
+  model->normals[i][2] = attrib.normals[3 * vn + 2];
+
+  size_t vt = idx.texcoord_index;
+  model->texcoords[i][0] = attrib.texcoords[2 * vt + 0];
+  model->texcoords[i][1] = attrib.texcoords[2 * vt + 1];
+}
+
+// Creates one vertex per unique index triple and fills the faces with
+// indices into the deduplicated vertex arrays
+bool BuildIndexedModel(const tinyobj::attrib_t& attrib,
+                       const std::vector<tinyobj::index_t>& indices,
+                       Model* model) {
+  std::unordered_map<tinyobj::index_t, unsigned int, IndexTripleHash,
+                     IndexTripleEqual> vert_map;
+  vert_map.reserve(indices.size());
+
+  std::vector<unsigned int> remap(indices.size());
+  std::vector<size_t> unique_corners;
+  unique_corners.reserve(indices.size());
+
+  for (size_t i = 0; i < indices.size(); ++i) {
+    unsigned int next_index = static_cast<unsigned int>(unique_corners.size());
+    auto result = vert_map.insert(std::make_pair(indices[i], next_index));
+    if (result.second) {
+      unique_corners.push_back(i);
+    }
+    remap[i] = result.first->second;
+  }
+
+  size_t vert_count = unique_corners.size();
+
+  model->positions.resize(vert_count);
+  model->normals.resize(vert_count);
+  model->texcoords.resize(vert_count);
+
+  for (size_t i = 0; i < vert_count; ++i) {
+    CopyVertex(attrib, indices[unique_corners[i]], model, i);
+  }
+
+  size_t face_count = indices.size() / 3;
+  model->faces.resize(face_count);
+  for (size_t i = 0; i < face_count; ++i) {
+    model->faces[i] = glm::uvec3(remap[3 * i + 0], remap[3 * i + 1],
+                                 remap[3 * i + 2]);
+  }
+
+  model->vert_count = vert_count;
+  model->face_count = face_count;
+  model->indexed_drawing = true;
+
+  return true;
+}
+
+} // namespace
+
+bool LoadModelFromObj(const std::string& path, Model* model, bool indexed) {
+  tinyobj::attrib_t attrib;
+  std::vector<tinyobj::shape_t> shapes;
+  std::vector<tinyobj::material_t> materials;
+
+  std::string err_msg;
+  bool load_result = tinyobj::LoadObjParallel(&attrib, &shapes, &materials,
+                                              &err_msg, path.c_str());
+
+  if (!err_msg.empty()) {
+    std::cerr << err_msg << std::endl;
+  }
+
+  if (!load_result) {
+    std::cerr << "Failed to load model: " << path << std::endl;
+    return false;
+  }
+
+  std::cout << "Position attrib array size: " << attrib.vertices.size()
+            << std::endl;
+  std::cout << "Normal attrib array size: " << attrib.normals.size()
+            << std::endl;
+  std::cout << "Texcoord attrib array size: " << attrib.texcoords.size()
+            << std::endl;
+
+  if (shapes.size() != 1) {
+    std::cerr << "Does not support more than 1 shape." << std::endl;
+    return false;
+  }
+
+  for (auto num_verts : shapes[0].mesh.num_face_vertices) {
+    if (num_verts != 3) {
+      std::cerr << "Only supports triangles as faces." << std::endl;
+      return false;
+    }
+  }
+
+  const std::vector<tinyobj::index_t>& indices = shapes[0].mesh.indices;
+
+  if (indexed) {
+    return BuildIndexedModel(attrib, indices, model);
+  }
+
+  size_t vert_count = indices.size();
+  
+  model->positions.resize(vert_count);
+  model->normals.resize(vert_count);
+  model->texcoords.resize(vert_count);
+  model->faces.clear(); // Not used since we don't use indexed drawing
+
+  for (size_t i = 0; i < vert_count; ++i) {
+    CopyVertex(attrib, indices[i], model, i);
+  }
+
+  model->vert_count = vert_count;
+  model->face_count = shapes[0].mesh.num_face_vertices.size();
+  model->indexed_drawing = false;
+  
+  return true;
+}
+
+namespace {
+
+// Largest block read while counting the lines of an OBJ file, and largest
+// buffer of the stream LoadObjWithCallback reads from. Smaller files get
+// buffers of their own size.
+const size_t kObjCountBlockBytes = 1 << 20;
+const size_t kObjStreamBufferBytes = 1 << 20;
+
+// Marks an attribute that a face corner does not refer to
+const int kNoAttribute = -1;
+
+struct ObjLineCounts {
+  size_t file_bytes = 0;
+  size_t positions = 0;
+  size_t normals = 0;
+  size_t texcoords = 0;
+  size_t triangles = 0; // After polygons are split into fans
+};
+
+// Counts the v, vn, vt lines and the triangles of the f lines without
+// parsing them, to reserve the arrays. The counts only need to be close: a
+// miscount costs a reallocation.
+bool CountObjLines(const std::string& path, ObjLineCounts* counts) {
+  FILE* fp = fopen(path.c_str(), "rb");
+  if (!fp) {
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fileno(fp), &st) != 0) {
+    fclose(fp);
+    return false;
+  }
+  counts->file_bytes = static_cast<size_t>(st.st_size);
+
+  enum { kLineStart, kAfterV, kFace, kRestOfLine } state = kLineStart;
+  size_t corners = 0;
+  bool in_corner = false;
+  std::vector<char> block(std::min(kObjCountBlockBytes,
+                                   counts->file_bytes + 1));
+  size_t size;
+  while ((size = fread(&block[0], 1, block.size(), fp)) > 0) {
+    const char* p = &block[0];
+    const char* end = p + size;
+    while (p < end) {
+      if (state == kRestOfLine) {
+        const void* newline = memchr(p, '\n', end - p);
+        if (newline == NULL) {
+          break;
+        }
+        p = static_cast<const char*>(newline) + 1;
+        state = kLineStart;
+        continue;
+      }
+
+      char c = *p++;
+      if (state == kFace) {
+        if (c == '\n') {
+          counts->triangles += corners > 2 ? corners - 2 : 0;
+          state = kLineStart;
+        } else if (c == ' ' || c == '\t' || c == '\r') {
+          in_corner = false;
+        } else if (!in_corner) {
+          in_corner = true;
+          ++corners;
+        }
+        continue;
+      }
+
+      if (state == kLineStart) {
+        if (c == ' ' || c == '\t' || c == '\n') {
+          continue;
+        }
+        if (c == 'v') {
+          state = kAfterV;
+          continue;
+        }
+        if (c == 'f') {
+          state = kFace;
+          corners = 0;
+          in_corner = false;
+          continue;
+        }
+      } else if (c == ' ' || c == '\t') {
+        ++counts->positions;
+      } else if (c == 'n') {
+        ++counts->normals;
+      } else if (c == 't') {
+        ++counts->texcoords;
+      }
+      state = c == '\n' ? kLineStart : kRestOfLine;
+    }
+  }
+
+  if (state == kFace) {
+    counts->triangles += corners > 2 ? corners - 2 : 0;
+  }
+
+  bool read_all = feof(fp) != 0;
+  fclose(fp);
+  return read_all;
+}
+
+// Open-addressing map from the (position, normal, texcoord) index triple of
+// a face corner to its vertex. Takes 16 bytes a slot at most half full,
+// where std::unordered_map allocates a node and a bucket per vertex.
+class CornerMap {
+ public:
+  explicit CornerMap(size_t expected_count) : count_(0) {
+    size_t capacity = 16;
+    while (capacity < 2 * expected_count) {
+      capacity *= 2;
+    }
+    Rehash(capacity);
+  }
+
+  // Returns the vertex of the corner, adding it as new_vertex if it is not
+  // in the map yet
+  unsigned int Insert(int v, int vn, int vt, unsigned int new_vertex) {
+    if (2 * (count_ + 1) > slots_.size()) {
+      Rehash(2 * slots_.size());
+    }
+
+    size_t i = Hash(v, vn, vt);
+    while (true) {
+      Slot& slot = slots_[i];
+      if (slot.vertex == kEmpty) {
+        slot.v = v;
+        slot.vn = vn;
+        slot.vt = vt;
+        slot.vertex = new_vertex;
+        ++count_;
+        return new_vertex;
+      }
+      if (slot.v == v && slot.vn == vn && slot.vt == vt) {
+        return slot.vertex;
+      }
+      i = (i + 1) & (slots_.size() - 1);
+    }
+  }
+
+ private:
+  static const unsigned int kEmpty = 0xffffffffu;
+
+  struct Slot {
+    int v;
+    int vn;
+    int vt;
+    unsigned int vertex;
+  };
+
+  size_t Hash(int v, int vn, int vt) const {
+    uint64_t h = static_cast<uint32_t>(v);
+    h = h * 73856093u ^ static_cast<uint32_t>(vn);
+    h = h * 19349663u ^ static_cast<uint32_t>(vt);
+    // Fibonacci hashing spreads the bits over the table index
+    return static_cast<size_t>((h * 0x9e3779b97f4a7c15ull) >> shift_);
+  }
+
+  void Rehash(size_t capacity) {
+    std::vector<Slot> old_slots;
+    old_slots.swap(slots_);
+    Slot empty = {0, 0, 0, kEmpty};
+    slots_.assign(capacity, empty);
+
+    shift_ = 64;
+    for (size_t c = capacity; c > 1; c /= 2) {
+      --shift_;
+    }
+
+    for (const Slot& old : old_slots) {
+      if (old.vertex == kEmpty) {
+        continue;
+      }
+      size_t i = Hash(old.v, old.vn, old.vt);
+      while (slots_[i].vertex != kEmpty) {
+        i = (i + 1) & (capacity - 1);
+      }
+      slots_[i] = old;
+    }
+  }
+
+  std::vector<Slot> slots_;
+  size_t count_;
+  unsigned int shift_;
+};
+
+// State shared by the LoadObjWithCallback callbacks
+struct ObjStream {
+  Model* model = NULL;
+  std::unique_ptr<CornerMap> corners; // Only for indexed models
+
+  // Attributes of the v, vn and vt lines read so far
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec3> normals;
+  std::vector<glm::vec2> texcoords;
+
+  bool bad_index = false;
+};
+
+// Makes a raw OBJ index, 1-based or negative to count back from the last
+// attribute, 0-based. Returns false if it is out of range.
+bool ResolveObjIndex(int raw, size_t count, int* index) {
+  if (raw > 0 && static_cast<size_t>(raw) <= count) {
+    *index = raw - 1;
+    return true;
+  }
+  if (raw < 0 && static_cast<size_t>(-static_cast<int64_t>(raw)) <= count) {
+    *index = static_cast<int>(count) + raw;
+    return true;
+  }
+  return false;
+}
+
+void StreamPosition(void* user_data, tinyobj::real_t x, tinyobj::real_t y,
+                    tinyobj::real_t z, tinyobj::real_t) {
+  static_cast<ObjStream*>(user_data)->positions.push_back(
+      glm::vec3(x, y, z));
+}
+
+void StreamNormal(void* user_data, tinyobj::real_t x, tinyobj::real_t y,
+                  tinyobj::real_t z) {
+  static_cast<ObjStream*>(user_data)->normals.push_back(glm::vec3(x, y, z));
+}
+
+void StreamTexcoord(void* user_data, tinyobj::real_t x, tinyobj::real_t y,
+                    tinyobj::real_t) {
+  static_cast<ObjStream*>(user_data)->texcoords.push_back(glm::vec2(x, y));
+}
+
+// Adds a triangle of three face corners
+void StreamTriangle(ObjStream* stream, const tinyobj::index_t& corner0,
+                    const tinyobj::index_t& corner1,
+                    const tinyobj::index_t& corner2) {
+  Model* model = stream->model;
+  const tinyobj::index_t* corners[3] = {&corner0, &corner1, &corner2};
+  glm::uvec3 face;
+  for (int c = 0; c < 3; ++c) {
+    const tinyobj::index_t& raw = *corners[c];
+    int v;
+    int vn = kNoAttribute;
+    int vt = kNoAttribute;
+    // A raw index of 0 means the corner has no such attribute
+    if (!ResolveObjIndex(raw.vertex_index, stream->positions.size(), &v) ||
+        (raw.normal_index != 0 &&
+         !ResolveObjIndex(raw.normal_index, stream->normals.size(), &vn)) ||
+        (raw.texcoord_index != 0 &&
+         !ResolveObjIndex(raw.texcoord_index, stream->texcoords.size(),
+                          &vt))) {
+      stream->bad_index = true;
+      return;
+    }
+
+    unsigned int vertex = static_cast<unsigned int>(model->positions.size());
+    if (stream->corners) {
+      face[c] = stream->corners->Insert(v, vn, vt, vertex);
+      if (face[c] != vertex) {
+        continue;
+      }
+    }
+
+    model->positions.push_back(stream->positions[v]);
+    model->normals.push_back(vn == kNoAttribute ? glm::vec3(0.f)
+                                                : stream->normals[vn]);
+    model->texcoords.push_back(vt == kNoAttribute ? glm::vec2(0.f)
+                                                  : stream->texcoords[vt]);
+  }
+
+  if (stream->corners) {
+    model->faces.push_back(face);
+  }
+  ++model->face_count;
+}
+
+// Polygons are split into a fan of triangles (0, i, i + 1). Faces of fewer
+// than three corners are skipped, as tinyobj does.
+void StreamFace(void* user_data, tinyobj::index_t* indices,
+                int num_indices) {
+  ObjStream* stream = static_cast<ObjStream*>(user_data);
+  for (int i = 1; i + 1 < num_indices && !stream->bad_index; ++i) {
+    StreamTriangle(stream, indices[0], indices[i], indices[i + 1]);
+  }
+}
+
+} // namespace
+
+bool StreamModelFromObj(const std::string& path, Model* model, bool indexed) {
+  ObjLineCounts counts;
+  if (!CountObjLines(path, &counts)) {
+    std::cerr << "Failed to load model: " << path << std::endl;
+    return false;
+  }
+
+  std::vector<char> buffer(std::min(kObjStreamBufferBytes,
+                                    counts.file_bytes + 1));
+  std::ifstream fin;
+  fin.rdbuf()->pubsetbuf(&buffer[0], buffer.size());
+  fin.open(path, std::ios::binary);
+  if (!fin) {
+    std::cerr << "Failed to load model: " << path << std::endl;
+    return false;
+  }
+
+  ObjStream stream;
+  stream.model = model;
+  stream.positions.reserve(counts.positions);
+  stream.normals.reserve(counts.normals);
+  stream.texcoords.reserve(counts.texcoords);
+
+  // Most indexed meshes have about one vertex per position
+  size_t vert_count = 3 * counts.triangles;
+  if (indexed) {
+    vert_count = std::min(vert_count,
+                          std::max(counts.positions,
+                                   std::max(counts.normals,
+                                            counts.texcoords)));
+    stream.corners.reset(new CornerMap(vert_count));
+  }
+
+  model->positions.clear();
+  model->normals.clear();
+  model->texcoords.clear();
+  model->faces.clear();
+  model->face_count = 0;
+  model->positions.reserve(vert_count);
+  model->normals.reserve(vert_count);
+  model->texcoords.reserve(vert_count);
+  if (indexed) {
+    model->faces.reserve(counts.triangles);
+  }
+
+  tinyobj::callback_t callbacks;
+  callbacks.vertex_cb = StreamPosition;
+  callbacks.normal_cb = StreamNormal;
+  callbacks.texcoord_cb = StreamTexcoord;
+  callbacks.index_cb = StreamFace;
+
+  std::string err_msg;
+  bool load_result = tinyobj::LoadObjWithCallback(fin, callbacks, &stream,
+                                                  NULL, &err_msg);
+
+  if (!err_msg.empty()) {
+    std::cerr << err_msg << std::endl;
+  }
+
+  if (!load_result || stream.bad_index) {
+    if (stream.bad_index) {
+      std::cerr << "Face index out of range." << std::endl;
+    }
+    std::cerr << "Failed to load model: " << path << std::endl;
+    return false;
+  }
+
+  std::cout << "Position attrib array size: " << 3 * stream.positions.size()
+            << std::endl;
+  std::cout << "Normal attrib array size: " << 3 * stream.normals.size()
+            << std::endl;
+  std::cout << "Texcoord attrib array size: " << 2 * stream.texcoords.size()
+            << std::endl;
+
+  model->vert_count = model->positions.size();
+  model->indexed_drawing = indexed;
+
+  return true;
+}
+
+namespace {
+
+// On-disk layout of the binary mesh cache. The header is followed by the
+// position, normal, texcoord and face blobs at the recorded offsets.
+const char kMeshCacheMagic[8] = {'M', 'E', 'S', 'H', 'C', 'A', 'C', 'H'};
+const uint32_t kMeshCacheVersion = 2;
+const uint32_t kMeshCacheIndexedFlag = 1;
+const uint64_t kMeshCacheAlignment = 16;
+
+struct MeshCacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;
+  uint64_t source_size;
+  int64_t source_mtime_ns;
+  uint32_t vert_count;
+  uint32_t face_count;
+  uint64_t positions_offset;
+  uint64_t normals_offset;
+  uint64_t texcoords_offset;
+  uint64_t faces_offset;
+  uint64_t file_size;
+};
+
+uint64_t AlignCacheOffset(uint64_t offset) {
+  return (offset + kMeshCacheAlignment - 1) & ~(kMeshCacheAlignment - 1);
+}
+
+// The modification time is kept in nanoseconds, since an edit within the
+// second the cache was written must still invalidate it
+bool StatSourceFile(const std::string& path, uint64_t* size,
+                    int64_t* mtime_ns) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    return false;
+  }
+#ifdef __APPLE__
+  const struct timespec& mtime = st.st_mtimespec;
+#else
+  const struct timespec& mtime = st.st_mtim;
+#endif
+  *size = static_cast<uint64_t>(st.st_size);
+  *mtime_ns = static_cast<int64_t>(mtime.tv_sec) * 1000000000 +
+              mtime.tv_nsec;
+  return true;
+}
+
+bool BlobInFile(uint64_t offset, uint64_t size, uint64_t file_size) {
+  return offset <= file_size && size <= file_size - offset;
+}
+
+template <typename T>
+void CopyBlob(const char* data, uint64_t offset, size_t count,
+              std::vector<T>* out) {
+  out->resize(count);
+  if (count > 0) {
+    memcpy(&(*out)[0], data + offset, count * sizeof(T));
+  }
+}
+
+} // namespace
+
+bool LoadModelCache(const std::string& cache_path,
+                    const std::string& source_path, bool indexed,
+                    Model* model) {
+  uint64_t source_size;
+  int64_t source_mtime_ns;
+  if (!StatSourceFile(source_path, &source_size, &source_mtime_ns)) {
+    return false;
+  }
+
+  int fd = open(cache_path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<uint64_t>(st.st_size) < sizeof(MeshCacheHeader)) {
+    close(fd);
+    return false;
+  }
+
+  size_t file_size = static_cast<size_t>(st.st_size);
+  void* mapping = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return false;
+  }
+
+  const char* data = static_cast<const char*>(mapping);
+  MeshCacheHeader header;
+  memcpy(&header, data, sizeof(header));
+
+  uint32_t expected_flags = indexed ? kMeshCacheIndexedFlag : 0;
+  uint64_t vert_bytes = static_cast<uint64_t>(header.vert_count) *
+                        sizeof(glm::vec3);
+  uint64_t texcoord_bytes = static_cast<uint64_t>(header.vert_count) *
+                            sizeof(glm::vec2);
+  // Faces are only stored for indexed models
+  uint32_t stored_face_count = indexed ? header.face_count : 0;
+  uint64_t face_bytes = static_cast<uint64_t>(stored_face_count) *
+                        sizeof(glm::uvec3);
+
+  bool valid =
+      memcmp(header.magic, kMeshCacheMagic, sizeof(kMeshCacheMagic)) == 0 &&
+      header.version == kMeshCacheVersion &&
+      header.flags == expected_flags &&
+      header.source_size == source_size &&
+      header.source_mtime_ns == source_mtime_ns &&
+      header.file_size == file_size &&
+      BlobInFile(header.positions_offset, vert_bytes, file_size) &&
+      BlobInFile(header.normals_offset, vert_bytes, file_size) &&
+      BlobInFile(header.texcoords_offset, texcoord_bytes, file_size) &&
+      BlobInFile(header.faces_offset, face_bytes, file_size);
+
+  if (valid) {
+    CopyBlob(data, header.positions_offset, header.vert_count,
+             &model->positions);
+    CopyBlob(data, header.normals_offset, header.vert_count,
+             &model->normals);
+    CopyBlob(data, header.texcoords_offset, header.vert_count,
+             &model->texcoords);
+    CopyBlob(data, header.faces_offset, stored_face_count, &model->faces);
+
+    model->vert_count = header.vert_count;
+    model->face_count = header.face_count;
+    model->indexed_drawing = indexed;
+  }
+
+  munmap(mapping, file_size);
+
+  return valid;
+}
+
+bool SaveModelCache(const std::string& cache_path,
+                    const std::string& source_path, const Model& model) {
+  MeshCacheHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMeshCacheMagic, sizeof(kMeshCacheMagic));
+  header.version = kMeshCacheVersion;
+  header.flags = model.indexed_drawing ? kMeshCacheIndexedFlag : 0;
+
+  if (!StatSourceFile(source_path, &header.source_size,
+                      &header.source_mtime_ns)) {
+    return false;
+  }
+
+  if (model.positions.size() != model.vert_count ||
+      model.normals.size() != model.vert_count ||
+      model.texcoords.size() != model.vert_count ||
+      model.faces.size() != (model.indexed_drawing ? model.face_count : 0)) {
+    return false;
+  }
+
+  header.vert_count = model.vert_count;
+  header.face_count = model.face_count;
+
+  header.positions_offset = AlignCacheOffset(sizeof(header));
+  header.normals_offset = AlignCacheOffset(
+      header.positions_offset + model.positions.size() * sizeof(glm::vec3));
+  header.texcoords_offset = AlignCacheOffset(
+      header.normals_offset + model.normals.size() * sizeof(glm::vec3));
+  header.faces_offset = AlignCacheOffset(
+      header.texcoords_offset + model.texcoords.size() * sizeof(glm::vec2));
+  header.file_size =
+      header.faces_offset + model.faces.size() * sizeof(glm::uvec3);
+
+  std::vector<char> buffer(header.file_size, 0);
+  memcpy(&buffer[0], &header, sizeof(header));
+  if (!model.positions.empty()) {
+    memcpy(&buffer[header.positions_offset], &model.positions[0],
+           model.positions.size() * sizeof(glm::vec3));
+    memcpy(&buffer[header.normals_offset], &model.normals[0],
+           model.normals.size() * sizeof(glm::vec3));
+    memcpy(&buffer[header.texcoords_offset], &model.texcoords[0],
+           model.texcoords.size() * sizeof(glm::vec2));
+  }
+  if (!model.faces.empty()) {
+    memcpy(&buffer[header.faces_offset], &model.faces[0],
+           model.faces.size() * sizeof(glm::uvec3));
+  }
+
+  // Writes to a temporary file first so that a partially written cache is
+  // never picked up by another process
+  std::string tmp_path = cache_path + ".tmp";
+  {
+    std::ofstream fout(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!fout) {
+      return false;
+    }
+    fout.write(&buffer[0], buffer.size());
+    if (!fout) {
+      return false;
+    }
+  }
+
+  if (rename(tmp_path.c_str(), cache_path.c_str()) != 0) {
+    unlink(tmp_path.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+bool CreateModelFromFile(const std::string& path, Model* model,
+                         bool indexed) {
+  std::string cache_path = path + kMeshCacheSuffix;
+  if (LoadModelCache(cache_path, path, indexed, model)) {
+    return true;
+  }
+
+  if (!StreamModelFromObj(path, model, indexed)) {
+    return false;
+  }
+
+  if (!SaveModelCache(cache_path, path, *model)) {
+    std::cerr << "Could not write mesh cache: " << cache_path << std::endl;
+  }
+
+  return true;
+}
+
+
+Model CreateModelCube(float length) {
+  float n = length / 2;
+
+  Model model;
+  
+  model.positions = {{n, n, n}, {n, -n, n}, //Positive yz plane
+                     {n, -n, -n}, {n, n, -n},
+                     {-n, n, -n}, {-n, -n, -n}, //Negative yz plane
+                     {-n, -n, n}, {-n, n, n},
+                     {-n, n, -n}, {-n, n, n}, //Positive xz plane
+                     {n, n, n}, {n, n, -n},
+                     {n, -n, n}, {n, -n, -n}, //Negative xz plane
+                     {-n, -n, -n}, {-n, -n, n},
+                     {-n, n, n}, {-n, -n, n}, //Positive xy plane
+                     {n, -n, n}, {n, n, n},
+                     {n, n, -n}, {n, -n, -n}, //Negative xy Plane
+                     {-n, -n, -n}, {-n, n, -n}};
+    
+  model.normals = {{1.f, 0.f, 0.f}, {1.f, 0.f, 0.f},
+                   {1.f, 0.f, 0.f}, {1.f, 0.f, 0.f},
+                   {-1.f, 0.f, 0.f}, {-1.f, 0.f, 0.f},
+                   {-1.f, 0.f, 0.f}, {-1.f, 0.f, 0.f},
+                   {0.f, 1.f, 0.f}, {0.f, 1.f, 0.f},
+                   {0.f, 1.f, 0.f}, {0.f, 1.f, 0.f},
+                   {0.f, -1.f, 0.f}, {0.f, -1.f, 0.f},
+                   {0.f, -1.f, 0.f}, {0.f, -1.f, 0.f},
+                   {0.f, 0.f, 1.f}, {0.f, 0.f, 1.f},
+                   {0.f, 0.f, 1.f}, {0.f, 0.f, 1.f},
+                   {0.f, 0.f, -1.f}, {0.f, 0.f, -1.f},
+                   {0.f, 0.f, -1.f}, {0.f, 0.f, -1.f}};
+
+  model.texcoords = {};
+  
+  model.faces = {{0, 1, 3}, {3, 1, 2},
+                 {4, 5, 7}, {7, 5, 6},
+                 {8, 9, 11}, {11, 9, 10},
+                 {12, 13, 15}, {15, 13, 14},
+                 {16, 17, 19}, {19, 17, 18},
+                 {20, 21, 23}, {23, 21, 22}};
+
+  model.vert_count = 24;
+  model.face_count = 12;
+  model.indexed_drawing = true;
+
+  return std::move(model);
+}
+
+void DeindexModel(const Model& model, Model* deindexed) {
+  bool has_normals = model.normals.size() >= model.vert_count;
+  bool has_texcoords = model.texcoords.size() >= model.vert_count;
+
+  deindexed->positions.clear();
+  deindexed->normals.clear();
+  deindexed->texcoords.clear();
+  deindexed->faces.clear();
+
+  if (!model.indexed_drawing) {
+    deindexed->positions = model.positions;
+    deindexed->normals = model.normals;
+    deindexed->texcoords = model.texcoords;
+    deindexed->vert_count = model.vert_count;
+    deindexed->face_count = model.face_count;
+    deindexed->indexed_drawing = false;
+    return;
+  }
+
+  for (const glm::uvec3& face : model.faces) {
+    for (int corner = 0; corner < 3; ++corner) {
+      unsigned int i = face[corner];
+      deindexed->positions.push_back(model.positions[i]);
+      if (has_normals) {
+        deindexed->normals.push_back(model.normals[i]);
+      }
+      if (has_texcoords) {
+        deindexed->texcoords.push_back(model.texcoords[i]);
+      }
+    }
+  }
+
+  deindexed->vert_count = 3 * model.face_count;
+  deindexed->face_count = model.face_count;
+  deindexed->indexed_drawing = false;
+}
@@ -0,0 +1,79 @@
+#ifndef MODEL_H_
+#define MODEL_H_
+
+#include <string>
+#include <vector>
+#include <utility>
+
+#include "glm/glm.hpp"
+
+struct Model {
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec3> normals;
+  std::vector<glm::vec2> texcoords;
+  std::vector<glm::uvec3> faces; // Used for indexed drawing
+
+  unsigned int vert_count = 0;
+  unsigned int face_count = 0;
+
+  bool indexed_drawing = false;
+
+  Model() {}
+  Model(const Model&) = delete; // To prevent any unintended copying
+  Model(Model&& o) : positions(std::move(o.positions)),
+                     normals(std::move(o.normals)),
+                     texcoords(std::move(o.texcoords)),
+                     faces(std::move(o.faces)),
+                     vert_count(o.vert_count),
+                     face_count(o.face_count),
+                     indexed_drawing(o.indexed_drawing) {}
+};
+
+// Loads a triangulated OBJ file into the model with StreamModelFromObj. If
+// indexed is true, face corners that share the same position, normal and
+// texcoord indices are merged into one vertex and faces is filled for
+// glDrawElements. The parsed mesh is cached in a binary file next to the OBJ
+// so later runs skip the text parsing.
+bool CreateModelFromFile(const std::string& path, Model *model,
+                         bool indexed = false);
+
+// Parses a single-shape OBJ file with tinyobj::LoadObjParallel, then copies
+// the attributes its faces refer to into the model. Polygons are
+// triangulated. Bypasses the binary mesh cache.
+bool LoadModelFromObj(const std::string& path, Model *model, bool indexed);
+
+// Produces the same model as LoadModelFromObj, but reads the file one line
+// at a time with tinyobj::LoadObjWithCallback on the calling thread. Only
+// the v, vn and vt lines are kept aside, since faces may refer to any of
+// them. Each face is written straight into the model's arrays, which are
+// reserved from a first pass that counts the lines and triangles. For a
+// file of a million or more triangles or quads, the peak memory above the
+// empty process is a quarter of LoadModelFromObj's indexed and a half
+// unindexed. For the teapot it is about three quarters.
+//
+// All groups and objects go into the model. Corners without a normal or
+// texcoord get zeros. Polygons are split into fans of triangles
+// (0, i, i + 1). tinyobj clips ears instead, which gives the same triangles
+// for convex polygons that are close to planar.
+bool StreamModelFromObj(const std::string& path, Model *model, bool indexed);
+
+// Binary mesh cache written next to the OBJ file after the first load.
+// A cache is only used if it was built from a source file with the same
+// size and modification time and with the same indexed setting.
+const char* const kMeshCacheSuffix = ".meshcache";
+
+bool LoadModelCache(const std::string& cache_path,
+                    const std::string& source_path, bool indexed,
+                    Model *model);
+
+bool SaveModelCache(const std::string& cache_path,
+                    const std::string& source_path, const Model& model);
+
+Model CreateModelCube(float length);
+
+// Expands an indexed model so that every face has its own three vertices,
+// stored in face order, and clears indexed_drawing. Vertex i is then corner
+// i % 3 of face i / 3, which shaders can read from gl_VertexID.
+void DeindexModel(const Model& model, Model* deindexed);
+
+#endif
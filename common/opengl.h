@@ -0,0 +1,15 @@
+#ifndef OPENGL_H_
+#define OPENGL_H_
+
+// Single place to pull in the OpenGL headers for the platform
+
+#ifdef __APPLE__
+#include <OpenGL/gl3.h>
+#else
+// Mesa and other Linux drivers export the core profile entry points from
+// libGL directly
+#define GL_GLEXT_PROTOTYPES
+#include <GL/glcorearb.h>
+#endif
+
+#endif
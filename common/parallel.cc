@@ -0,0 +1,25 @@
+#include "parallel.h"
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <vector>
+
+void ParallelFor(unsigned int num_threads,
+                 const std::function<void(unsigned int)>& fn) {
+  std::vector<std::thread> threads;
+  for (unsigned int i = 1; i < num_threads; ++i) {
+    threads.push_back(std::thread(fn, i));
+  }
+  fn(0);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+unsigned int ResolveThreadCount(unsigned int num_threads) {
+  if (num_threads == 0) {
+    return std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  return num_threads;
+}
@@ -0,0 +1,14 @@
+#ifndef PARALLEL_H_
+#define PARALLEL_H_
+
+#include <functional>
+
+// Runs fn(thread_index) on num_threads threads, one of them the caller's,
+// and returns when all have finished
+void ParallelFor(unsigned int num_threads,
+                 const std::function<void(unsigned int)>& fn);
+
+// num_threads, or the number of hardware threads if num_threads is 0
+unsigned int ResolveThreadCount(unsigned int num_threads);
+
+#endif
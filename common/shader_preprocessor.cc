@@ -0,0 +1,193 @@
+#include "shader_preprocessor.h"
+
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct PreprocessState {
+  std::string* source;
+  std::vector<std::string>* files;
+  std::set<std::string> included;
+};
+
+bool ReadFile(const std::string& path, std::string* contents) {
+  std::ifstream fin(path, std::ios::binary);
+  if (!fin) {
+    return false;
+  }
+  contents->assign(std::istreambuf_iterator<char>(fin),
+                   std::istreambuf_iterator<char>());
+  return true;
+}
+
+std::string DirName(const std::string& path) {
+  size_t slash = path.find_last_of('/');
+  return slash == std::string::npos ? "" : path.substr(0, slash + 1);
+}
+
+// Returns the position after the directive name if the line is the given
+// directive, e.g. "#include", or std::string::npos otherwise
+size_t MatchDirective(const std::string& line, const std::string& name) {
+  size_t pos = line.find_first_not_of(" \t");
+  if (pos == std::string::npos || line[pos] != '#') {
+    return std::string::npos;
+  }
+  pos = line.find_first_not_of(" \t", pos + 1);
+  if (pos == std::string::npos || line.compare(pos, name.size(), name) != 0) {
+    return std::string::npos;
+  }
+  pos += name.size();
+  if (pos < line.size() && line[pos] != ' ' && line[pos] != '\t' &&
+      line[pos] != '"' && line[pos] != '\r') {
+    return std::string::npos;
+  }
+  return pos;
+}
+
+// Parses the quoted file name of an #include directive
+bool ParseIncludeName(const std::string& line, size_t pos,
+                      std::string* name) {
+  size_t open = line.find('"', pos);
+  if (open == std::string::npos ||
+      line.find_first_not_of(" \t", pos) != open) {
+    return false;
+  }
+  size_t close = line.find('"', open + 1);
+  if (close == std::string::npos || close == open + 1) {
+    return false;
+  }
+  *name = line.substr(open + 1, close - open - 1);
+  return true;
+}
+
+void AppendLineDirective(size_t line, size_t file_index,
+                         std::string* source) {
+  *source += "#line " + std::to_string(line) + " " +
+             std::to_string(file_index) + "\n";
+}
+
+void AppendDefines(const ShaderDefines& defines, std::string* source) {
+  for (const auto& define : defines) {
+    *source += "#define " + define.first;
+    if (!define.second.empty()) {
+      *source += " " + define.second;
+    }
+    *source += "\n";
+  }
+}
+
+bool ExpandFile(const std::string& path, const std::string& contents,
+                const ShaderDefines* defines, PreprocessState* state) {
+  const size_t file_index = state->files->size();
+  state->files->push_back(path);
+  state->included.insert(path);
+
+  std::vector<std::string> lines;
+  size_t begin = 0;
+  while (begin < contents.size()) {
+    size_t end = contents.find('\n', begin);
+    if (end == std::string::npos) {
+      end = contents.size();
+    }
+    lines.push_back(contents.substr(begin, end - begin));
+    begin = end + 1;
+  }
+
+  // The defines go after the #version line, which must come first, or at
+  // the top if there is none
+  size_t version_line = lines.size();
+  if (defines != NULL) {
+    for (size_t i = 0; i < lines.size(); ++i) {
+      if (MatchDirective(lines[i], "version") != std::string::npos) {
+        version_line = i;
+        break;
+      }
+    }
+    if (version_line == lines.size() && !defines->empty()) {
+      AppendDefines(*defines, state->source);
+      AppendLineDirective(1, file_index, state->source);
+    }
+  }
+
+  for (size_t i = 0; i < lines.size(); ++i) {
+    const std::string& line = lines[i];
+    size_t pos = MatchDirective(line, "include");
+    if (pos == std::string::npos) {
+      *state->source += line + "\n";
+      if (i == version_line && !defines->empty()) {
+        AppendDefines(*defines, state->source);
+        AppendLineDirective(i + 2, file_index, state->source);
+      }
+      continue;
+    }
+
+    std::string name;
+    if (!ParseIncludeName(line, pos, &name)) {
+      std::cerr << path << ":" << i + 1 << ": Expected #include \"file\""
+                << std::endl;
+      return false;
+    }
+
+    // Next to the including file first, then in the shader library
+    std::string include_path = DirName(path) + name;
+    std::string include_contents;
+    if (!state->included.count(include_path) &&
+        !ReadFile(include_path, &include_contents)) {
+      include_path = std::string(kShaderLibraryDir) + "/" + name;
+      if (!state->included.count(include_path) &&
+          !ReadFile(include_path, &include_contents)) {
+        std::cerr << path << ":" << i + 1 << ": Could not read include: "
+                  << name << std::endl;
+        return false;
+      }
+    }
+
+    if (!state->included.count(include_path)) {
+      AppendLineDirective(1, state->files->size(), state->source);
+      if (!ExpandFile(include_path, include_contents, NULL, state)) {
+        return false;
+      }
+    }
+    AppendLineDirective(i + 2, file_index, state->source);
+  }
+
+  return true;
+}
+
+} // namespace
+
+bool PreprocessShader(const std::string& path, const ShaderDefines& defines,
+                      std::string* source, std::vector<std::string>* files) {
+  source->clear();
+  files->clear();
+
+  std::string contents;
+  if (!ReadFile(path, &contents)) {
+    std::cerr << "Could not read shader: " << path << std::endl;
+    return false;
+  }
+
+  PreprocessState state;
+  state.source = source;
+  state.files = files;
+  return ExpandFile(path, contents, &defines, &state);
+}
+
+std::string ShaderDefinesKey(const ShaderDefines& defines) {
+  std::string key;
+  for (const auto& define : defines) {
+    if (!key.empty()) {
+      key += ",";
+    }
+    key += define.first;
+    if (!define.second.empty()) {
+      key += "=" + define.second;
+    }
+  }
+  return key;
+}
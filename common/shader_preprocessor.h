@@ -0,0 +1,35 @@
+#ifndef SHADER_PREPROCESSOR_H_
+#define SHADER_PREPROCESSOR_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Preprocessor definitions added to a shader, by name, each with a value
+// that may be empty: e.g. {{"INSTANCING", ""}, {"MAX_LIGHTS", "4"}}. A set
+// of definitions selects one permutation of a shader written with #ifdef.
+typedef std::map<std::string, std::string> ShaderDefines;
+
+// Shaders shared by the samples, relative to the sample directories they
+// run from. Searched for includes not found next to the including file.
+const char* const kShaderLibraryDir = "../common/shaders";
+
+// Reads the shader at path and resolves its #include "file" directives,
+// looking for each file next to the file including it and then in
+// kShaderLibraryDir. Every file is included at most once per shader, so
+// shared files need no include guards. Includes are resolved whether or
+// not they are inside #if blocks. The defines are added right after the
+// #version line.
+//
+// #line directives keep the line numbers in compiler messages right, and
+// give each file's index in *files as the source string number, the shader
+// itself being 0. Not every driver puts that number in its messages.
+// Returns false if any file cannot be read or an #include is malformed.
+bool PreprocessShader(const std::string& path, const ShaderDefines& defines,
+                      std::string* source, std::vector<std::string>* files);
+
+// Text naming the set of defines, the same for equal sets: e.g.
+// "INSTANCING,MAX_LIGHTS=4". Empty for no defines.
+std::string ShaderDefinesKey(const ShaderDefines& defines);
+
+#endif
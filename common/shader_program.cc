@@ -0,0 +1,428 @@
+#include "shader_program.h"
+
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/type_ptr.hpp"
+
+namespace {
+
+// On-disk layout of a program cache: the header followed by the binary
+const char kProgramCacheMagic[8] = {'P', 'R', 'O', 'G', 'C', 'A', 'C', 'H'};
+const uint32_t kProgramCacheVersion = 1;
+
+struct ProgramCacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t binary_format;
+  uint64_t key;
+  uint64_t binary_size;
+};
+
+bool program_cache_enabled = true;
+ProgramStats program_stats;
+
+bool ReadFile(const std::string& path, std::string* contents) {
+  std::ifstream fin(path, std::ios::binary);
+  if (!fin) {
+    return false;
+  }
+  contents->assign(std::istreambuf_iterator<char>(fin),
+                   std::istreambuf_iterator<char>());
+  return true;
+}
+
+bool CompileShaderSource(GLuint shader_id, const std::string& source,
+                         const std::vector<std::string>& files) {
+  const char* shader_source_ptr = source.c_str();
+  glShaderSource(shader_id, 1, &shader_source_ptr, NULL);
+  std::cout << "Compiling shader: " << files[0] << std::endl;
+  glCompileShader(shader_id);
+
+  GLint result;
+  GLint infolog_length;
+  glGetShaderiv(shader_id, GL_COMPILE_STATUS, &result);
+  glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &infolog_length);
+
+  if (infolog_length > 0) {
+    std::vector<char> infolog_buf(infolog_length);
+    glGetShaderInfoLog(shader_id, infolog_length, NULL, &infolog_buf[0]);
+    std::cout << &infolog_buf[0] << std::endl;
+
+    // The messages give the file of each line by its index
+    if (files.size() > 1) {
+      for (size_t i = 0; i < files.size(); ++i) {
+        std::cout << "  " << i << ": " << files[i] << std::endl;
+      }
+    }
+  }
+
+  if (result == GL_FALSE) {
+    return false;
+  }
+
+  return true;
+}
+
+// 64-bit FNV-1a
+void HashBytes(const void* data, size_t size, uint64_t* hash) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; ++i) {
+    *hash ^= bytes[i];
+    *hash *= 1099511628211ull;
+  }
+}
+
+// Hashes the length first so that consecutive strings cannot run together
+void HashString(const std::string& str, uint64_t* hash) {
+  uint64_t size = str.size();
+  HashBytes(&size, sizeof(size), hash);
+  HashBytes(str.data(), str.size(), hash);
+}
+
+std::string GLString(GLenum name) {
+  const GLubyte* str = glGetString(name);
+  return str != NULL ? reinterpret_cast<const char*>(str) : "";
+}
+
+bool ProgramBinariesSupported() {
+  GLint format_count = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+  return format_count > 0;
+}
+
+// Loads the cached binary into program_id if the cache was saved with the
+// same key and the driver accepts it
+bool LoadProgramCache(const std::string& cache_path, uint64_t key,
+                      GLuint program_id) {
+  std::string contents;
+  if (!ReadFile(cache_path, &contents) ||
+      contents.size() < sizeof(ProgramCacheHeader)) {
+    return false;
+  }
+
+  ProgramCacheHeader header;
+  memcpy(&header, contents.data(), sizeof(header));
+  bool valid =
+      memcmp(header.magic, kProgramCacheMagic,
+             sizeof(kProgramCacheMagic)) == 0 &&
+      header.version == kProgramCacheVersion &&
+      header.key == key &&
+      header.binary_size == contents.size() - sizeof(header);
+  if (!valid) {
+    return false;
+  }
+
+  glProgramBinary(program_id, header.binary_format,
+                  contents.data() + sizeof(header),
+                  static_cast<GLsizei>(header.binary_size));
+
+  GLint link_result = GL_FALSE;
+  glGetProgramiv(program_id, GL_LINK_STATUS, &link_result);
+  if (link_result == GL_FALSE) {
+    std::cerr << "Program cache rejected by the driver: " << cache_path
+              << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool SaveProgramCache(const std::string& cache_path, uint64_t key,
+                      GLuint program_id) {
+  GLint length = 0;
+  glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return false;
+  }
+
+  std::vector<char> buffer(sizeof(ProgramCacheHeader) + length);
+  GLsizei written = 0;
+  GLenum binary_format = 0;
+  glGetProgramBinary(program_id, length, &written, &binary_format,
+                     &buffer[sizeof(ProgramCacheHeader)]);
+  if (written <= 0) {
+    return false;
+  }
+  buffer.resize(sizeof(ProgramCacheHeader) + written);
+
+  ProgramCacheHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kProgramCacheMagic, sizeof(kProgramCacheMagic));
+  header.version = kProgramCacheVersion;
+  header.binary_format = binary_format;
+  header.key = key;
+  header.binary_size = static_cast<uint64_t>(written);
+  memcpy(&buffer[0], &header, sizeof(header));
+
+  // Writes to a temporary file first so that a partially written cache is
+  // never picked up by another process
+  std::string tmp_path = cache_path + ".tmp";
+  {
+    std::ofstream fout(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!fout) {
+      return false;
+    }
+    fout.write(&buffer[0], buffer.size());
+    if (!fout) {
+      return false;
+    }
+  }
+
+  if (rename(tmp_path.c_str(), cache_path.c_str()) != 0) {
+    unlink(tmp_path.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+} // namespace
+
+bool CompileShader(GLuint shader_id, const std::string& path) {
+  std::string shader_source;
+  std::vector<std::string> files;
+  if (!PreprocessShader(path, ShaderDefines(), &shader_source, &files)) {
+    return false;
+  }
+  return CompileShaderSource(shader_id, shader_source, files);
+}
+
+void SetProgramCacheEnabled(bool enabled) {
+  program_cache_enabled = enabled;
+}
+
+const ProgramStats& GetProgramStats() {
+  return program_stats;
+}
+
+bool ShaderProgram::AttachShader(GLenum type, const std::string& path,
+                                 const ShaderDefines& defines) {
+  auto start = std::chrono::steady_clock::now();
+  if (program_id_ == 0) {
+    program_id_ = glCreateProgram();
+  }
+
+  Stage stage;
+  stage.type = type;
+  stage.path = path;
+  stage.defines_key = ShaderDefinesKey(defines);
+  bool read = PreprocessShader(path, defines, &stage.source, &stage.files);
+  if (read) {
+    stages_.push_back(stage);
+  }
+
+  program_stats.ms += std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start).count();
+  return read;
+}
+
+void ShaderProgram::SetFeedbackVaryings(
+    const std::vector<std::string>& names) {
+  feedback_varyings_ = names;
+}
+
+bool ShaderProgram::Link() {
+  if (program_id_ == 0) {
+    return false;
+  }
+  auto start = std::chrono::steady_clock::now();
+
+  // Locations may change after relinking
+  uniform_locs_.clear();
+
+  bool use_cache = program_cache_enabled && ProgramBinariesSupported();
+  uint64_t key = 0;
+  std::string cache_path;
+  bool cache_hit = false;
+  if (use_cache) {
+    key = CacheKey();
+    cache_path = CachePath();
+    cache_hit = LoadProgramCache(cache_path, key, program_id_);
+  }
+
+  bool linked = cache_hit;
+  if (!linked) {
+    linked = CompileAndLink();
+    if (linked && use_cache &&
+        !SaveProgramCache(cache_path, key, program_id_)) {
+      std::cerr << "Could not write program cache: " << cache_path
+                << std::endl;
+    }
+  }
+  stages_.clear();
+
+  ++program_stats.linked;
+  program_stats.cache_hits += cache_hit ? 1 : 0;
+  program_stats.ms += std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start).count();
+  return linked;
+}
+
+uint64_t ShaderProgram::CacheKey() const {
+  uint64_t key = 14695981039346656037ull;
+  for (const Stage& stage : stages_) {
+    HashBytes(&stage.type, sizeof(stage.type), &key);
+    HashString(stage.source, &key);
+  }
+  for (const std::string& name : feedback_varyings_) {
+    HashString(name, &key);
+  }
+  HashString(GLString(GL_RENDERER), &key);
+  HashString(GLString(GL_VERSION), &key);
+  return key;
+}
+
+std::string ShaderProgram::CachePath() const {
+  std::string path = stages_.empty() ? "program" : stages_[0].path;
+  for (size_t i = 1; i < stages_.size(); ++i) {
+    size_t slash = stages_[i].path.find_last_of('/');
+    path += "+" + stages_[i].path.substr(slash == std::string::npos
+                                             ? 0 : slash + 1);
+  }
+
+  bool has_defines = false;
+  uint64_t defines_hash = 14695981039346656037ull;
+  for (const Stage& stage : stages_) {
+    has_defines = has_defines || !stage.defines_key.empty();
+    HashString(stage.defines_key, &defines_hash);
+  }
+  if (has_defines) {
+    char hex[9];
+    snprintf(hex, sizeof(hex), "%08x",
+             static_cast<unsigned int>(defines_hash ^ (defines_hash >> 32)));
+    path += std::string(".") + hex;
+  }
+  return path + kProgramCacheSuffix;
+}
+
+bool ShaderProgram::CompileAndLink() {
+  std::vector<GLuint> shader_ids;
+  bool compiled = true;
+  for (const Stage& stage : stages_) {
+    GLuint shader_id = glCreateShader(stage.type);
+    if (!CompileShaderSource(shader_id, stage.source, stage.files)) {
+      std::cerr << "Could not compile shader: " << stage.path << std::endl;
+      glDeleteShader(shader_id);
+      compiled = false;
+      break;
+    }
+    glAttachShader(program_id_, shader_id);
+    shader_ids.push_back(shader_id);
+  }
+
+  if (compiled) {
+    if (!feedback_varyings_.empty()) {
+      std::vector<const char*> name_ptrs;
+      for (const std::string& name : feedback_varyings_) {
+        name_ptrs.push_back(name.c_str());
+      }
+      glTransformFeedbackVaryings(program_id_, name_ptrs.size(),
+                                  name_ptrs.data(), GL_INTERLEAVED_ATTRIBS);
+    }
+    glProgramParameteri(program_id_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                        GL_TRUE);
+    glLinkProgram(program_id_);
+  }
+
+  for (GLuint shader_id : shader_ids) {
+    glDetachShader(program_id_, shader_id);
+    glDeleteShader(shader_id);
+  }
+  if (!compiled) {
+    return false;
+  }
+
+  GLint link_result;
+  GLint infolog_length;
+  glGetProgramiv(program_id_, GL_LINK_STATUS, &link_result);
+  glGetProgramiv(program_id_, GL_INFO_LOG_LENGTH, &infolog_length);
+
+  if (infolog_length > 0) {
+    std::vector<char> infolog(infolog_length);
+    glGetProgramInfoLog(program_id_, infolog_length, NULL, &infolog[0]);
+    std::cout << &infolog[0] << std::endl;
+  }
+
+  if (link_result == GL_FALSE) {
+    return false;
+  }
+
+  return true;
+}
+
+void ShaderProgram::Use() const {
+  glUseProgram(program_id_);
+}
+
+void ShaderProgram::Destroy() {
+  stages_.clear();
+  feedback_varyings_.clear();
+
+  if (program_id_ != 0) {
+    glDeleteProgram(program_id_);
+    program_id_ = 0;
+  }
+  uniform_locs_.clear();
+}
+
+GLint ShaderProgram::GetUniformLocation(const std::string& name) {
+  auto it = uniform_locs_.find(name);
+  if (it != uniform_locs_.end()) {
+    return it->second;
+  }
+
+  GLint loc = glGetUniformLocation(program_id_, name.c_str());
+  if (loc < 0) {
+    std::cerr << "Uniform not found: " << name << std::endl;
+  }
+  uniform_locs_[name] = loc;
+
+  return loc;
+}
+
+bool ShaderProgram::BindUniformBlock(const std::string& name,
+                                     GLuint binding) {
+  GLuint block_index = glGetUniformBlockIndex(program_id_, name.c_str());
+  if (block_index == GL_INVALID_INDEX) {
+    std::cerr << "Uniform block not found: " << name << std::endl;
+    return false;
+  }
+
+  glUniformBlockBinding(program_id_, block_index, binding);
+  return true;
+}
+
+void ShaderProgram::SetUniform(const std::string& name, int value) {
+  glUniform1i(GetUniformLocation(name), value);
+}
+
+void ShaderProgram::SetUniform(const std::string& name, float value) {
+  glUniform1f(GetUniformLocation(name), value);
+}
+
+void ShaderProgram::SetUniform(const std::string& name,
+                               const glm::vec3& value) {
+  glUniform3fv(GetUniformLocation(name), 1, glm::value_ptr(value));
+}
+
+void ShaderProgram::SetUniform(const std::string& name,
+                               const glm::vec4& value) {
+  glUniform4fv(GetUniformLocation(name), 1, glm::value_ptr(value));
+}
+
+void ShaderProgram::SetUniform(const std::string& name,
+                               const glm::mat4& value) {
+  glUniformMatrix4fv(GetUniformLocation(name), 1, GL_FALSE,
+                     glm::value_ptr(value));
+}
@@ -0,0 +1,108 @@
+#ifndef SHADER_PROGRAM_H_
+#define SHADER_PROGRAM_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "opengl.h"
+#include "glm/glm.hpp"
+
+#include "shader_preprocessor.h"
+
+// Compiles the shader at path into shader_id, resolving its includes
+bool CompileShader(GLuint shader_id, const std::string& path);
+
+// Linked programs are cached on disk with glGetProgramBinary, so that later
+// runs load them with glProgramBinary instead of compiling the shaders. A
+// cache is only used if it was built from the same stage sources and
+// transform feedback varyings on a driver reporting the same GL_RENDERER
+// and GL_VERSION. A binary the driver rejects is compiled again and its
+// cache rewritten. The cache of a program lives next to its first shader,
+// named after all of its shaders: e.g. bezier.vs+bezier.fs.programcache.
+const char* const kProgramCacheSuffix = ".programcache";
+
+// On by default. Drivers that support no binary formats never use it.
+void SetProgramCacheEnabled(bool enabled);
+
+// Totals over every program linked so far
+struct ProgramStats {
+  unsigned int linked = 0;
+  unsigned int cache_hits = 0; // Programs loaded from the cache
+  double ms = 0.0;             // Time spent attaching and linking
+};
+
+const ProgramStats& GetProgramStats();
+
+// Wraps a GL program object. Shaders are attached by path and compiled by
+// Link(), unless the program is in the program cache. Uniform locations are
+// looked up once per name and cached, so setting a uniform by name does not
+// go to the driver every time.
+//
+// None of the methods may be called before a GL context exists. Destroy()
+// must be called explicitly while the context is still alive.
+class ShaderProgram {
+ public:
+  ShaderProgram() : program_id_(0) {}
+
+  ShaderProgram(const ShaderProgram&) = delete;
+  ShaderProgram& operator=(const ShaderProgram&) = delete;
+
+  // Reads the shader at path, to be compiled by Link() for the given stage,
+  // resolving its includes and adding the defines (see PreprocessShader).
+  // Returns false if the shader or one of its includes cannot be read.
+  bool AttachShader(GLenum type, const std::string& path,
+                    const ShaderDefines& defines = ShaderDefines());
+
+  // Selects the outputs of the last vertex processing stage that transform
+  // feedback captures, interleaved into a single buffer. Takes effect at the
+  // next Link().
+  void SetFeedbackVaryings(const std::vector<std::string>& names);
+
+  // Loads the program from the program cache, or else compiles and links
+  // the attached shaders and saves the result to the cache. The shaders
+  // are detached and deleted afterwards.
+  bool Link();
+
+  void Use() const;
+  void Destroy();
+
+  GLuint id() const { return program_id_; }
+
+  GLint GetUniformLocation(const std::string& name);
+
+  // Assigns the named uniform block to a uniform buffer binding point. Needs
+  // to be done again after relinking.
+  bool BindUniformBlock(const std::string& name, GLuint binding);
+
+  // The program must be in use when setting uniforms
+  void SetUniform(const std::string& name, int value);
+  void SetUniform(const std::string& name, float value);
+  void SetUniform(const std::string& name, const glm::vec3& value);
+  void SetUniform(const std::string& name, const glm::vec4& value);
+  void SetUniform(const std::string& name, const glm::mat4& value);
+
+ private:
+  struct Stage {
+    GLenum type;
+    std::string path;
+    std::string defines_key;
+    std::string source;
+    std::vector<std::string> files; // Files of the source's #line numbers
+  };
+
+  // Hash of everything the linked program depends on
+  uint64_t CacheKey() const;
+  std::string CachePath() const;
+
+  // Compiles and links the stages. Returns false on any error.
+  bool CompileAndLink();
+
+  GLuint program_id_;
+  std::vector<Stage> stages_;
+  std::vector<std::string> feedback_varyings_;
+  std::unordered_map<std::string, GLint> uniform_locs_;
+};
+
+#endif
@@ -0,0 +1,12 @@
+// Updated once per frame, see common/frame_uniforms.h
+layout(std140) uniform FrameUniforms {
+     mat4 model_mat;
+     mat4 view_mat;
+     mat4 proj_mat;
+     mat4 normal_mat;
+     vec3 light_position;
+     vec3 diffuse_param;
+     vec3 ambient_param;
+     vec3 specular_param;
+     float shininess;
+};
\ No newline at end of file
@@ -0,0 +1,16 @@
+#include "frame_uniforms.glsl"
+
+// Phong lighting of a point, with everything in eye space
+vec3 calc_light(vec3 light_pos, vec3 position, vec3 normal) {
+     vec3 light_unit = normalize(light_pos - position);
+     vec3 normal_unit = normalize(normal);
+     vec3 position_unit = normalize(-position);
+     return (0.1 * ambient_param  +
+             diffuse_param  * max(dot(position_unit, normal_unit), 0.0) +
+             specular_param * pow(max(dot(light_unit, normal_unit), 0.0),
+                            shininess));
+}
+
+vec3 light_eye_position() {
+     return (view_mat * vec4(light_position, 1.0)).xyz;
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#version 400
+
+// See lit.vs for the defines
+
+#ifdef PER_PIXEL_LIGHTING
+in vec3 vs_eyepos;
+in vec3 vs_normal;
+#else
+in vec3 vs_color;
+#endif
+
+#ifdef WIREFRAME
+noperspective in vec3 vs_barycentric;
+#endif
+
+layout(location = 0) out vec4 fs_color;
+
+#include "lighting.glsl"
+
+#ifdef WIREFRAME
+#include "wireframe.glsl"
+#endif
+
+void main() {
+#ifdef PER_PIXEL_LIGHTING
+     fs_color = vec4(calc_light(light_eye_position(), vs_eyepos, vs_normal),
+                     1.0);
+#else
+     fs_color = vec4(vs_color, 1.0);
+#endif
+
+#ifdef WIREFRAME
+     // Each barycentric coordinate falls linearly to 0 at the opposite
+     // edge, so dividing by its screen-space gradient gives the distance to
+     // that edge in pixels, as wireframe.gs computes per vertex. fwidth()
+     // would overestimate the gradient, and thin the lines, on diagonals.
+     vec3 grad_x = dFdx(vs_barycentric);
+     vec3 grad_y = dFdy(vs_barycentric);
+     fs_color = apply_wireframe(fs_color, vs_barycentric /
+                                          sqrt(grad_x * grad_x +
+                                               grad_y * grad_y));
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#version 400
+
+// Lit mesh shared by the samples. Permutations are chosen with defines:
+//   INSTANCING          per-instance transforms (see common/instancing.h)
+//                       instead of model_mat and normal_mat
+//   PER_PIXEL_LIGHTING  lights each fragment instead of each vertex
+//   WIREFRAME           draws the edges of the faces, for meshes drawn
+//                       without an index buffer (see DeindexModel)
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+
+#ifdef INSTANCING
+layout(location = 3) in mat4 instance_model_mat;
+layout(location = 7) in mat3 instance_normal_mat;
+#endif
+
+#ifdef PER_PIXEL_LIGHTING
+out vec3 vs_eyepos;
+out vec3 vs_normal;
+#else
+out vec3 vs_color;
+#endif
+
+#ifdef WIREFRAME
+// Each face has its own three vertices, so gl_VertexID % 3 is the corner
+noperspective out vec3 vs_barycentric;
+#endif
+
+#include "lighting.glsl"
+
+void main() {
+#ifdef INSTANCING
+     vec4 eyepos = view_mat * instance_model_mat * vec4(position, 1.0);
+     vec3 eye_normal = normalize(mat3(view_mat) * instance_normal_mat *
+                                 normal);
+#else
+     vec4 eyepos = view_mat * model_mat * vec4(position, 1.0);
+     vec3 eye_normal = normalize((normal_mat * vec4(normal, 1.0)).xyz);
+#endif
+
+#ifdef PER_PIXEL_LIGHTING
+     vs_eyepos = eyepos.xyz;
+     vs_normal = eye_normal;
+#else
+     vs_color = calc_light(light_eye_position(), eyepos.xyz, eye_normal);
+#endif
+
+#ifdef WIREFRAME
+     vs_barycentric = vec3(0.0);
+     vs_barycentric[gl_VertexID % 3] = 1.0;
+#endif
+
+     gl_Position = proj_mat * eyepos;
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+uniform struct LineInfo {
+    float width;
+    vec4 color;
+} line_info;
+
+// Draws the edges of a face over its color, given the distances in pixels
+// from the fragment to the three edges
+vec4 apply_wireframe(vec4 color, vec3 edge_dist) {
+     float d = min(edge_dist.x, edge_dist.y);
+     d = min(d, edge_dist.z);
+     float mix_val = smoothstep(line_info.width - 1, line_info.width + 1, d);
+
+     return mix(line_info.color, color, mix_val);
+}
\ No newline at end of file
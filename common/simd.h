@@ -0,0 +1,420 @@
+#ifndef SIMD_H_
+#define SIMD_H_
+
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SIMD_SSE2 1
+#endif
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SIMD_AVX 1
+#endif
+
+// Eight float lanes. With AVX enabled (e.g. -mavx2 or -march=native) they
+// are held in one 8-wide register, on other SSE2 targets in two 4-wide
+// registers, elsewhere in a plain array the compiler can vectorize. Code
+// written against Float8 and Mask8 runs unchanged on any of them.
+const int kSimdWidth = 8;
+
+struct Mask8;
+
+struct Float8 {
+#if defined(SIMD_AVX)
+  __m256 v;
+
+  Float8() {}
+  explicit Float8(__m256 a) : v(a) {}
+  explicit Float8(float f) : v(_mm256_set1_ps(f)) {}
+
+  static Float8 Load(const float* p) {
+    return Float8(_mm256_loadu_ps(p));
+  }
+  void Store(float* p) const {
+    _mm256_storeu_ps(p, v);
+  }
+
+  // Lane i holds p[i]. AVX has no 8-wide integer conversion, so the halves
+  // are converted with SSE2.
+  static Float8 LoadBytes(const uint8_t* p) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i words = _mm_unpacklo_epi8(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)), zero);
+    __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero));
+    __m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(words, zero));
+    return Float8(_mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1));
+  }
+#elif defined(SIMD_SSE2)
+  __m128 lo;
+  __m128 hi;
+
+  Float8() {}
+  Float8(__m128 l, __m128 h) : lo(l), hi(h) {}
+  explicit Float8(float f) : lo(_mm_set1_ps(f)), hi(_mm_set1_ps(f)) {}
+
+  static Float8 Load(const float* p) {
+    return Float8(_mm_loadu_ps(p), _mm_loadu_ps(p + 4));
+  }
+  void Store(float* p) const {
+    _mm_storeu_ps(p, lo);
+    _mm_storeu_ps(p + 4, hi);
+  }
+
+  // Lane i holds p[i]
+  static Float8 LoadBytes(const uint8_t* p) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i words = _mm_unpacklo_epi8(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)), zero);
+    return Float8(_mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero)),
+                  _mm_cvtepi32_ps(_mm_unpackhi_epi16(words, zero)));
+  }
+#else
+  float v[8];
+
+  Float8() {}
+  explicit Float8(float f) {
+    for (int i = 0; i < 8; ++i) v[i] = f;
+  }
+
+  static Float8 Load(const float* p) {
+    Float8 r;
+    for (int i = 0; i < 8; ++i) r.v[i] = p[i];
+    return r;
+  }
+  void Store(float* p) const {
+    for (int i = 0; i < 8; ++i) p[i] = v[i];
+  }
+
+  // Lane i holds p[i]
+  static Float8 LoadBytes(const uint8_t* p) {
+    Float8 r;
+    for (int i = 0; i < 8; ++i) r.v[i] = static_cast<float>(p[i]);
+    return r;
+  }
+#endif
+
+  // Lane i holds start + i
+  static Float8 Ramp(float start) {
+    float lanes[8];
+    for (int i = 0; i < 8; ++i) lanes[i] = start + static_cast<float>(i);
+    return Load(lanes);
+  }
+};
+
+struct Mask8 {
+#if defined(SIMD_AVX)
+  __m256 v;
+
+  Mask8() {}
+  explicit Mask8(__m256 a) : v(a) {}
+
+  // One bit per lane, lane 0 in bit 0
+  int Bits() const {
+    return _mm256_movemask_ps(v);
+  }
+#elif defined(SIMD_SSE2)
+  __m128 lo;
+  __m128 hi;
+
+  Mask8() {}
+  Mask8(__m128 l, __m128 h) : lo(l), hi(h) {}
+
+  // One bit per lane, lane 0 in bit 0
+  int Bits() const {
+    return _mm_movemask_ps(lo) | (_mm_movemask_ps(hi) << 4);
+  }
+#else
+  bool v[8];
+
+  int Bits() const {
+    int bits = 0;
+    for (int i = 0; i < 8; ++i) bits |= v[i] ? (1 << i) : 0;
+    return bits;
+  }
+#endif
+
+  bool Any() const { return Bits() != 0; }
+  bool All() const { return Bits() == 0xff; }
+};
+
+#ifdef SIMD_SSE2
+
+namespace simd_internal {
+
+// Cephes style natural log and exp of four lanes, accurate to a few ulp
+// over the normal float range
+inline __m128 Log4(__m128 x) {
+  const __m128 one = _mm_set1_ps(1.f);
+  const __m128 half = _mm_set1_ps(0.5f);
+
+  __m128 invalid = _mm_cmple_ps(x, _mm_setzero_ps());
+  x = _mm_max_ps(x, _mm_castsi128_ps(_mm_set1_epi32(0x00800000)));
+
+  // Splits x into a mantissa in [0.5, 1) and an exponent
+  __m128i bits = _mm_castps_si128(x);
+  __m128i exp_bits = _mm_srli_epi32(bits, 23);
+  x = _mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32(~0x7f800000)));
+  x = _mm_or_ps(x, half);
+  __m128 e = _mm_add_ps(_mm_cvtepi32_ps(
+                            _mm_sub_epi32(exp_bits, _mm_set1_epi32(0x7f))),
+                        one);
+
+  // Moves the mantissa into [sqrt(0.5), sqrt(2)) for the polynomial
+  __m128 small = _mm_cmplt_ps(x, _mm_set1_ps(0.707106781186547524f));
+  __m128 tmp = _mm_and_ps(x, small);
+  x = _mm_sub_ps(x, one);
+  e = _mm_sub_ps(e, _mm_and_ps(one, small));
+  x = _mm_add_ps(x, tmp);
+
+  __m128 z = _mm_mul_ps(x, x);
+  __m128 y = _mm_set1_ps(7.0376836292E-2f);
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(-1.1514610310E-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.1676998740E-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(-1.2420140846E-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.4249322787E-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(-1.6668057665E-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(2.0000714765E-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(-2.4999993993E-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(3.3333331174E-1f));
+  y = _mm_mul_ps(_mm_mul_ps(y, x), z);
+
+  y = _mm_add_ps(y, _mm_mul_ps(e, _mm_set1_ps(-2.12194440e-4f)));
+  y = _mm_sub_ps(y, _mm_mul_ps(z, half));
+  x = _mm_add_ps(_mm_add_ps(x, y), _mm_mul_ps(e, _mm_set1_ps(0.693359375f)));
+
+  // Non-positive inputs give -inf, which Exp4 turns back into 0
+  return _mm_or_ps(_mm_andnot_ps(invalid, x),
+                   _mm_and_ps(invalid, _mm_set1_ps(-INFINITY)));
+}
+
+inline __m128 Exp4(__m128 x) {
+  const __m128 one = _mm_set1_ps(1.f);
+
+  __m128 underflow = _mm_cmplt_ps(x, _mm_set1_ps(-87.3365447505f));
+  x = _mm_min_ps(x, _mm_set1_ps(88.3762626647949f));
+  x = _mm_max_ps(x, _mm_set1_ps(-87.3365447505f));
+
+  // exp(x) = 2^n * exp(r) with n = round(x / ln 2)
+  __m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)),
+                         _mm_set1_ps(0.5f));
+  __m128 n = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+  n = _mm_sub_ps(n, _mm_and_ps(_mm_cmpgt_ps(n, fx), one));
+
+  x = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(0.693359375f)));
+  x = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(-2.12194440e-4f)));
+  __m128 z = _mm_mul_ps(x, x);
+
+  __m128 y = _mm_set1_ps(1.9875691500E-4f);
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.3981999507E-3f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(8.3334519073E-3f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(4.1665795894E-2f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.6666665459E-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(5.0000001201E-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, z), x);
+  y = _mm_add_ps(y, one);
+
+  __m128i pow2n = _mm_slli_epi32(
+      _mm_add_epi32(_mm_cvttps_epi32(n), _mm_set1_epi32(0x7f)), 23);
+  y = _mm_mul_ps(y, _mm_castsi128_ps(pow2n));
+
+  return _mm_andnot_ps(underflow, y);
+}
+
+} // namespace simd_internal
+
+#endif // SIMD_SSE2
+
+#if defined(SIMD_AVX)
+
+#define SIMD_BINARY_OP(op, intrinsic) \
+  inline Float8 op(const Float8& a, const Float8& b) { \
+    return Float8(intrinsic(a.v, b.v)); \
+  }
+#define SIMD_COMPARE_OP(op, predicate) \
+  inline Mask8 op(const Float8& a, const Float8& b) { \
+    return Mask8(_mm256_cmp_ps(a.v, b.v, predicate)); \
+  }
+#define SIMD_MASK_OP(op, intrinsic) \
+  inline Mask8 op(const Mask8& a, const Mask8& b) { \
+    return Mask8(intrinsic(a.v, b.v)); \
+  }
+
+SIMD_BINARY_OP(operator+, _mm256_add_ps)
+SIMD_BINARY_OP(operator-, _mm256_sub_ps)
+SIMD_BINARY_OP(operator*, _mm256_mul_ps)
+SIMD_BINARY_OP(operator/, _mm256_div_ps)
+SIMD_BINARY_OP(Min, _mm256_min_ps)
+SIMD_BINARY_OP(Max, _mm256_max_ps)
+
+SIMD_COMPARE_OP(operator<, _CMP_LT_OS)
+SIMD_COMPARE_OP(operator<=, _CMP_LE_OS)
+SIMD_COMPARE_OP(operator>, _CMP_GT_OS)
+SIMD_COMPARE_OP(operator>=, _CMP_GE_OS)
+SIMD_COMPARE_OP(operator==, _CMP_EQ_OQ)
+
+SIMD_MASK_OP(operator&, _mm256_and_ps)
+SIMD_MASK_OP(operator|, _mm256_or_ps)
+
+#undef SIMD_BINARY_OP
+#undef SIMD_COMPARE_OP
+#undef SIMD_MASK_OP
+
+inline Float8 Sqrt(const Float8& a) {
+  return Float8(_mm256_sqrt_ps(a.v));
+}
+
+// Lanes of a where mask is set, lanes of b elsewhere
+inline Float8 Select(const Mask8& mask, const Float8& a, const Float8& b) {
+  return Float8(_mm256_blendv_ps(b.v, a.v, mask.v));
+}
+
+// Same as pow() for base >= 0, which is all lighting needs: a zero base
+// gives 0 for any positive exponent. Runs the SSE2 version on each half so
+// the results match the 4-wide build exactly.
+inline Float8 Pow(const Float8& base, const Float8& exponent) {
+  using simd_internal::Exp4;
+  using simd_internal::Log4;
+  __m128 lo = Exp4(_mm_mul_ps(Log4(_mm256_castps256_ps128(base.v)),
+                              _mm256_castps256_ps128(exponent.v)));
+  __m128 hi = Exp4(_mm_mul_ps(Log4(_mm256_extractf128_ps(base.v, 1)),
+                              _mm256_extractf128_ps(exponent.v, 1)));
+  return Float8(_mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1));
+}
+
+#elif defined(SIMD_SSE2)
+
+#define SIMD_BINARY_OP(op, intrinsic) \
+  inline Float8 op(const Float8& a, const Float8& b) { \
+    return Float8(intrinsic(a.lo, b.lo), intrinsic(a.hi, b.hi)); \
+  }
+#define SIMD_COMPARE_OP(op, intrinsic) \
+  inline Mask8 op(const Float8& a, const Float8& b) { \
+    return Mask8(intrinsic(a.lo, b.lo), intrinsic(a.hi, b.hi)); \
+  }
+#define SIMD_MASK_OP(op, intrinsic) \
+  inline Mask8 op(const Mask8& a, const Mask8& b) { \
+    return Mask8(intrinsic(a.lo, b.lo), intrinsic(a.hi, b.hi)); \
+  }
+
+SIMD_BINARY_OP(operator+, _mm_add_ps)
+SIMD_BINARY_OP(operator-, _mm_sub_ps)
+SIMD_BINARY_OP(operator*, _mm_mul_ps)
+SIMD_BINARY_OP(operator/, _mm_div_ps)
+SIMD_BINARY_OP(Min, _mm_min_ps)
+SIMD_BINARY_OP(Max, _mm_max_ps)
+
+SIMD_COMPARE_OP(operator<, _mm_cmplt_ps)
+SIMD_COMPARE_OP(operator<=, _mm_cmple_ps)
+SIMD_COMPARE_OP(operator>, _mm_cmpgt_ps)
+SIMD_COMPARE_OP(operator>=, _mm_cmpge_ps)
+SIMD_COMPARE_OP(operator==, _mm_cmpeq_ps)
+
+SIMD_MASK_OP(operator&, _mm_and_ps)
+SIMD_MASK_OP(operator|, _mm_or_ps)
+
+#undef SIMD_BINARY_OP
+#undef SIMD_COMPARE_OP
+#undef SIMD_MASK_OP
+
+inline Float8 Sqrt(const Float8& a) {
+  return Float8(_mm_sqrt_ps(a.lo), _mm_sqrt_ps(a.hi));
+}
+
+// Lanes of a where mask is set, lanes of b elsewhere
+inline Float8 Select(const Mask8& mask, const Float8& a, const Float8& b) {
+  return Float8(_mm_or_ps(_mm_and_ps(mask.lo, a.lo),
+                          _mm_andnot_ps(mask.lo, b.lo)),
+                _mm_or_ps(_mm_and_ps(mask.hi, a.hi),
+                          _mm_andnot_ps(mask.hi, b.hi)));
+}
+
+// Same as pow() for base >= 0, which is all lighting needs: a zero base
+// gives 0 for any positive exponent
+inline Float8 Pow(const Float8& base, const Float8& exponent) {
+  using simd_internal::Exp4;
+  using simd_internal::Log4;
+  return Float8(Exp4(_mm_mul_ps(Log4(base.lo), exponent.lo)),
+                Exp4(_mm_mul_ps(Log4(base.hi), exponent.hi)));
+}
+
+#else // Scalar
+
+#define SIMD_BINARY_OP(op, expr) \
+  inline Float8 op(const Float8& a, const Float8& b) { \
+    Float8 r; \
+    for (int i = 0; i < 8; ++i) r.v[i] = (expr); \
+    return r; \
+  }
+#define SIMD_COMPARE_OP(op, expr) \
+  inline Mask8 op(const Float8& a, const Float8& b) { \
+    Mask8 r; \
+    for (int i = 0; i < 8; ++i) r.v[i] = (expr); \
+    return r; \
+  }
+
+SIMD_BINARY_OP(operator+, a.v[i] + b.v[i])
+SIMD_BINARY_OP(operator-, a.v[i] - b.v[i])
+SIMD_BINARY_OP(operator*, a.v[i] * b.v[i])
+SIMD_BINARY_OP(operator/, a.v[i] / b.v[i])
+SIMD_BINARY_OP(Min, b.v[i] < a.v[i] ? b.v[i] : a.v[i])
+SIMD_BINARY_OP(Max, b.v[i] > a.v[i] ? b.v[i] : a.v[i])
+SIMD_BINARY_OP(Pow, std::pow(a.v[i], b.v[i]))
+
+SIMD_COMPARE_OP(operator<, a.v[i] < b.v[i])
+SIMD_COMPARE_OP(operator<=, a.v[i] <= b.v[i])
+SIMD_COMPARE_OP(operator>, a.v[i] > b.v[i])
+SIMD_COMPARE_OP(operator>=, a.v[i] >= b.v[i])
+SIMD_COMPARE_OP(operator==, a.v[i] == b.v[i])
+
+#undef SIMD_BINARY_OP
+#undef SIMD_COMPARE_OP
+
+inline Mask8 operator&(const Mask8& a, const Mask8& b) {
+  Mask8 r;
+  for (int i = 0; i < 8; ++i) r.v[i] = a.v[i] && b.v[i];
+  return r;
+}
+
+inline Mask8 operator|(const Mask8& a, const Mask8& b) {
+  Mask8 r;
+  for (int i = 0; i < 8; ++i) r.v[i] = a.v[i] || b.v[i];
+  return r;
+}
+
+inline Float8 Sqrt(const Float8& a) {
+  Float8 r;
+  for (int i = 0; i < 8; ++i) r.v[i] = std::sqrt(a.v[i]);
+  return r;
+}
+
+inline Float8 Select(const Mask8& mask, const Float8& a, const Float8& b) {
+  Float8 r;
+  for (int i = 0; i < 8; ++i) r.v[i] = mask.v[i] ? a.v[i] : b.v[i];
+  return r;
+}
+
+#endif // SIMD_AVX, SIMD_SSE2
+
+// Shared helpers built on the operations above
+
+inline Float8 Clamp(const Float8& a, const Float8& lo, const Float8& hi) {
+  return Min(Max(a, lo), hi);
+}
+
+inline Float8 Dot3(const Float8& ax, const Float8& ay, const Float8& az,
+                   const Float8& bx, const Float8& by, const Float8& bz) {
+  return ax * bx + ay * by + az * bz;
+}
+
+// Normalizes the vector (x, y, z) in place
+inline void Normalize3(Float8* x, Float8* y, Float8* z) {
+  Float8 inv_len = Float8(1.f) / Sqrt(Dot3(*x, *y, *z, *x, *y, *z));
+  *x = *x * inv_len;
+  *y = *y * inv_len;
+  *z = *z * inv_len;
+}
+
+#endif
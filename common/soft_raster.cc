@@ -0,0 +1,529 @@
+#include "soft_raster.h"
+
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "image.h"
+#include "model.h"
+#include "parallel.h"
+#include "simd.h"
+
+namespace {
+
+const int kTileSize = 64;
+const int kMaxVaryings = 6;
+
+// Window coordinates are snapped to this many subpixel steps, like GL
+// hardware does, so that shared edges rasterize consistently
+const float kSubpixelSteps = 256.f;
+
+struct ClipVertex {
+  glm::vec4 clip;
+  float varyings[kMaxVaryings];
+};
+
+// A triangle after clipping, viewport transform and setup. Edge function i
+// is zero on the edge opposite vertex i and positive inside.
+struct Triangle {
+  // Edge values at the pixel center (min_x, min_y), in double so that rows
+  // far from the reference point keep their precision
+  double edge_ref[3];
+  float edge_a[3]; // Change per pixel in x
+  float edge_b[3]; // Change per pixel in y
+  bool top_left[3];
+
+  float inv_area; // Converts edge values into barycentric coordinates
+
+  float z[3];
+  float inv_w[3];
+  float varyings[3][kMaxVaryings]; // Divided by w
+
+  int min_x, min_y, max_x, max_y;
+};
+
+// Per-thread state of the setup phase. Triangle lists stay in submission
+// order, which keeps depth ties resolving the same way as on the GPU.
+struct SetupBins {
+  std::vector<Triangle> triangles;
+  std::vector<std::vector<unsigned int>> tiles;
+};
+
+// Depth and varyings of the frontmost fragment of each pixel in one tile
+struct TileBuffer {
+  float depth[kTileSize * kTileSize];
+  float varyings[kMaxVaryings][kTileSize * kTileSize];
+};
+
+struct RenderState {
+  const Model* model;
+  const LightingParams* params;
+  ShadingMode shading;
+  int num_varyings;
+
+  int width;
+  int height;
+  int tiles_x;
+  int tiles_y;
+
+  glm::vec3 light_eye_pos;
+
+  std::vector<ClipVertex> vertices;
+  std::vector<SetupBins> bins;
+};
+
+// Scalar calc_light, used per vertex
+glm::vec3 CalcLight(const LightingParams& params, const glm::vec3& light_pos,
+                    const glm::vec3& position, const glm::vec3& normal) {
+  glm::vec3 light_unit = glm::normalize(light_pos - position);
+  glm::vec3 normal_unit = glm::normalize(normal);
+  glm::vec3 position_unit = glm::normalize(-position);
+  return 0.1f * params.ambient_param +
+         params.diffuse_param *
+             std::max(glm::dot(position_unit, normal_unit), 0.f) +
+         params.specular_param *
+             std::pow(std::max(glm::dot(light_unit, normal_unit), 0.f),
+                      params.shininess);
+}
+
+// calc_light over eight pixels, used per pixel
+void CalcLight8(const LightingParams& params, const glm::vec3& light_pos,
+                Float8 px, Float8 py, Float8 pz,
+                Float8 nx, Float8 ny, Float8 nz,
+                Float8* r, Float8* g, Float8* b) {
+  Float8 lx = Float8(light_pos.x) - px;
+  Float8 ly = Float8(light_pos.y) - py;
+  Float8 lz = Float8(light_pos.z) - pz;
+  Normalize3(&lx, &ly, &lz);
+
+  Normalize3(&nx, &ny, &nz);
+
+  Float8 vx = Float8(0.f) - px;
+  Float8 vy = Float8(0.f) - py;
+  Float8 vz = Float8(0.f) - pz;
+  Normalize3(&vx, &vy, &vz);
+
+  Float8 zero(0.f);
+  Float8 diffuse = Max(Dot3(vx, vy, vz, nx, ny, nz), zero);
+  Float8 specular = Pow(Max(Dot3(lx, ly, lz, nx, ny, nz), zero),
+                        Float8(params.shininess));
+
+  *r = Float8(0.1f * params.ambient_param.r) +
+       Float8(params.diffuse_param.r) * diffuse +
+       Float8(params.specular_param.r) * specular;
+  *g = Float8(0.1f * params.ambient_param.g) +
+       Float8(params.diffuse_param.g) * diffuse +
+       Float8(params.specular_param.g) * specular;
+  *b = Float8(0.1f * params.ambient_param.b) +
+       Float8(params.diffuse_param.b) * diffuse +
+       Float8(params.specular_param.b) * specular;
+}
+
+void TransformVertices(RenderState* state, unsigned int begin,
+                       unsigned int end) {
+  const Model& model = *state->model;
+  const LightingParams& params = *state->params;
+
+  glm::mat4 model_view_mat = params.view_mat * params.model_mat;
+
+  for (unsigned int i = begin; i < end; ++i) {
+    glm::vec4 eye_pos = model_view_mat * glm::vec4(model.positions[i], 1.f);
+
+    ClipVertex& out = state->vertices[i];
+    out.clip = params.proj_mat * eye_pos;
+
+    if (state->shading == kShadePerVertex) {
+      glm::vec3 eye_normal = glm::normalize(glm::vec3(
+          params.normal_mat * glm::vec4(model.normals[i], 0.f)));
+      glm::vec3 color = CalcLight(params, state->light_eye_pos,
+                                  glm::vec3(eye_pos), eye_normal);
+      out.varyings[0] = color.r;
+      out.varyings[1] = color.g;
+      out.varyings[2] = color.b;
+    } else {
+      // The 08-edgedetect vertex shader transforms normals with w = 1
+      glm::vec3 eye_normal = glm::normalize(glm::vec3(
+          params.normal_mat * glm::vec4(model.normals[i], 1.f)));
+      out.varyings[0] = eye_pos.x;
+      out.varyings[1] = eye_pos.y;
+      out.varyings[2] = eye_pos.z;
+      out.varyings[3] = eye_normal.x;
+      out.varyings[4] = eye_normal.y;
+      out.varyings[5] = eye_normal.z;
+    }
+  }
+}
+
+ClipVertex LerpVertex(const ClipVertex& a, const ClipVertex& b, float t,
+                      int num_varyings) {
+  ClipVertex out;
+  out.clip = a.clip + (b.clip - a.clip) * t;
+  for (int k = 0; k < num_varyings; ++k) {
+    out.varyings[k] = a.varyings[k] + (b.varyings[k] - a.varyings[k]) * t;
+  }
+  return out;
+}
+
+// Edges that are exactly on a pixel center only cover it if they are top or
+// left edges, so pixels on an edge shared by two triangles are drawn once.
+// Window y points up and triangles are counter-clockwise here.
+bool IsTopLeft(float dx, float dy) {
+  return dy < 0.f || (dy == 0.f && dx < 0.f);
+}
+
+void SetupTriangle(RenderState* state, const ClipVertex* clip_verts,
+                   SetupBins* bins) {
+  struct WindowVertex {
+    float x, y, z, inv_w;
+    const float* varyings;
+  } v[3];
+
+  for (int i = 0; i < 3; ++i) {
+    const glm::vec4& clip = clip_verts[i].clip;
+    float inv_w = 1.f / clip.w;
+    float x = (clip.x * inv_w + 1.f) * 0.5f * state->width;
+    float y = (clip.y * inv_w + 1.f) * 0.5f * state->height;
+    v[i].x = std::round(x * kSubpixelSteps) / kSubpixelSteps;
+    v[i].y = std::round(y * kSubpixelSteps) / kSubpixelSteps;
+    v[i].z = (clip.z * inv_w + 1.f) * 0.5f;
+    v[i].inv_w = inv_w;
+    v[i].varyings = clip_verts[i].varyings;
+  }
+
+  double area2 = static_cast<double>(v[1].x - v[0].x) * (v[2].y - v[0].y) -
+                 static_cast<double>(v[2].x - v[0].x) * (v[1].y - v[0].y);
+  if (area2 == 0.0) {
+    return;
+  }
+
+  // Nothing is culled, so clockwise triangles are flipped
+  if (area2 < 0.0) {
+    std::swap(v[1], v[2]);
+    area2 = -area2;
+  }
+
+  Triangle tri;
+  tri.min_x = std::max(static_cast<int>(std::ceil(
+      std::min(std::min(v[0].x, v[1].x), v[2].x) - 0.5f)), 0);
+  tri.min_y = std::max(static_cast<int>(std::ceil(
+      std::min(std::min(v[0].y, v[1].y), v[2].y) - 0.5f)), 0);
+  tri.max_x = std::min(static_cast<int>(std::floor(
+      std::max(std::max(v[0].x, v[1].x), v[2].x) - 0.5f)), state->width - 1);
+  tri.max_y = std::min(static_cast<int>(std::floor(
+      std::max(std::max(v[0].y, v[1].y), v[2].y) - 0.5f)), state->height - 1);
+  if (tri.min_x > tri.max_x || tri.min_y > tri.max_y) {
+    return;
+  }
+
+  double ref_x = tri.min_x + 0.5;
+  double ref_y = tri.min_y + 0.5;
+
+  for (int i = 0; i < 3; ++i) {
+    const WindowVertex& vj = v[(i + 1) % 3];
+    const WindowVertex& vk = v[(i + 2) % 3];
+    float dx = vk.x - vj.x;
+    float dy = vk.y - vj.y;
+
+    tri.edge_a[i] = -dy;
+    tri.edge_b[i] = dx;
+    tri.edge_ref[i] = static_cast<double>(dx) * (ref_y - vj.y) -
+                      static_cast<double>(dy) * (ref_x - vj.x);
+    tri.top_left[i] = IsTopLeft(dx, dy);
+
+    tri.z[i] = v[i].z;
+    tri.inv_w[i] = v[i].inv_w;
+    for (int k = 0; k < state->num_varyings; ++k) {
+      tri.varyings[i][k] = v[i].varyings[k] * v[i].inv_w;
+    }
+  }
+  tri.inv_area = static_cast<float>(1.0 / area2);
+
+  unsigned int tri_index = bins->triangles.size();
+  bins->triangles.push_back(tri);
+
+  for (int ty = tri.min_y / kTileSize; ty <= tri.max_y / kTileSize; ++ty) {
+    for (int tx = tri.min_x / kTileSize; tx <= tri.max_x / kTileSize; ++tx) {
+      bins->tiles[ty * state->tiles_x + tx].push_back(tri_index);
+    }
+  }
+}
+
+// Clips the triangle against the near plane (z >= -w) and sets up the
+// resulting one or two triangles. The other planes need no clipping since
+// rasterization is limited to the image bounds anyway.
+void ClipTriangle(RenderState* state, const ClipVertex* tri,
+                  SetupBins* bins) {
+  // Trivially rejects triangles entirely outside one of the side planes
+  for (int axis = 0; axis < 2; ++axis) {
+    int outside_pos = 0;
+    int outside_neg = 0;
+    for (int i = 0; i < 3; ++i) {
+      outside_pos += tri[i].clip[axis] > tri[i].clip.w;
+      outside_neg += tri[i].clip[axis] < -tri[i].clip.w;
+    }
+    if (outside_pos == 3 || outside_neg == 3) {
+      return;
+    }
+  }
+
+  float dist[3];
+  int inside_count = 0;
+  for (int i = 0; i < 3; ++i) {
+    dist[i] = tri[i].clip.z + tri[i].clip.w;
+    inside_count += dist[i] >= 0.f;
+  }
+
+  if (inside_count == 3) {
+    SetupTriangle(state, tri, bins);
+    return;
+  }
+  if (inside_count == 0) {
+    return;
+  }
+
+  ClipVertex poly[4];
+  int poly_count = 0;
+  for (int i = 0; i < 3; ++i) {
+    int j = (i + 1) % 3;
+    if (dist[i] >= 0.f) {
+      poly[poly_count++] = tri[i];
+    }
+    if ((dist[i] >= 0.f) != (dist[j] >= 0.f)) {
+      float t = dist[i] / (dist[i] - dist[j]);
+      poly[poly_count++] = LerpVertex(tri[i], tri[j], t,
+                                      state->num_varyings);
+    }
+  }
+
+  for (int i = 1; i + 1 < poly_count; ++i) {
+    ClipVertex fan[3] = {poly[0], poly[i], poly[i + 1]};
+    SetupTriangle(state, fan, bins);
+  }
+}
+
+void SetupTriangles(RenderState* state, unsigned int begin, unsigned int end,
+                    SetupBins* bins) {
+  const Model& model = *state->model;
+
+  for (unsigned int f = begin; f < end; ++f) {
+    glm::uvec3 face = model.indexed_drawing
+                          ? model.faces[f]
+                          : glm::uvec3(f * 3, f * 3 + 1, f * 3 + 2);
+    ClipVertex tri[3] = {state->vertices[face.x], state->vertices[face.y],
+                         state->vertices[face.z]};
+    ClipTriangle(state, tri, bins);
+  }
+}
+
+void RasterizeTriangle(const RenderState& state, const Triangle& tri,
+                       int tile_x0, int tile_y0, int tile_x1, int tile_y1,
+                       TileBuffer* tile) {
+  int x0 = std::max(tri.min_x, tile_x0);
+  int y0 = std::max(tri.min_y, tile_y0);
+  int x1 = std::min(tri.max_x + 1, tile_x1);
+  int y1 = std::min(tri.max_y + 1, tile_y1);
+  if (x0 >= x1 || y0 >= y1) {
+    return;
+  }
+
+  // Groups of eight pixels start at multiples of eight within the tile
+  int group_x0 = tile_x0 + ((x0 - tile_x0) & ~(kSimdWidth - 1));
+
+  Float8 lane_offsets = Float8::Ramp(0.f);
+  Float8 edge_a[3];
+  for (int i = 0; i < 3; ++i) {
+    edge_a[i] = Float8(tri.edge_a[i]);
+  }
+  Float8 inv_area(tri.inv_area);
+  Float8 x_limit(static_cast<float>(x1));
+
+  for (int y = y0; y < y1; ++y) {
+    float* depth_row = tile->depth + (y - tile_y0) * kTileSize;
+
+    double row_edge[3];
+    for (int i = 0; i < 3; ++i) {
+      row_edge[i] = tri.edge_ref[i] +
+          static_cast<double>(tri.edge_a[i]) * (group_x0 - tri.min_x) +
+          static_cast<double>(tri.edge_b[i]) * (y - tri.min_y);
+    }
+
+    for (int gx = group_x0; gx < x1; gx += kSimdWidth) {
+      Float8 offsets = lane_offsets + Float8(static_cast<float>(gx - group_x0));
+
+      Mask8 mask = (Float8(static_cast<float>(gx)) + lane_offsets) < x_limit;
+      Float8 lambda[3];
+      for (int i = 0; i < 3; ++i) {
+        Float8 edge = Float8(static_cast<float>(row_edge[i])) +
+                      edge_a[i] * offsets;
+        mask = mask & (tri.top_left[i] ? edge >= Float8(0.f)
+                                       : edge > Float8(0.f));
+        lambda[i] = edge * inv_area;
+      }
+      if (!mask.Any()) {
+        continue;
+      }
+
+      // Depth is affine in window space, so it is interpolated directly
+      Float8 z = lambda[0] * Float8(tri.z[0]) + lambda[1] * Float8(tri.z[1]) +
+                 lambda[2] * Float8(tri.z[2]);
+
+      float* depth_ptr = depth_row + (gx - tile_x0);
+      Float8 old_depth = Float8::Load(depth_ptr);
+      mask = mask & (z < old_depth);
+      if (!mask.Any()) {
+        continue;
+      }
+      Select(mask, z, old_depth).Store(depth_ptr);
+
+      // Perspective-correct interpolation of the varyings
+      Float8 w = Float8(1.f) / (lambda[0] * Float8(tri.inv_w[0]) +
+                                lambda[1] * Float8(tri.inv_w[1]) +
+                                lambda[2] * Float8(tri.inv_w[2]));
+      for (int k = 0; k < state.num_varyings; ++k) {
+        float* var_ptr = tile->varyings[k] + (depth_ptr - tile->depth);
+        Float8 value = (lambda[0] * Float8(tri.varyings[0][k]) +
+                        lambda[1] * Float8(tri.varyings[1][k]) +
+                        lambda[2] * Float8(tri.varyings[2][k])) * w;
+        Select(mask, value, Float8::Load(var_ptr)).Store(var_ptr);
+      }
+    }
+  }
+}
+
+// Shades the covered pixels of a finished tile and writes them to the image
+void ResolveTile(const RenderState& state, const TileBuffer& tile,
+                 int tile_x0, int tile_y0, int tile_x1, int tile_y1,
+                 Image* image) {
+  const Float8 zero(0.f);
+  const Float8 one(1.f);
+
+  for (int y = tile_y0; y < tile_y1; ++y) {
+    int offset = (y - tile_y0) * kTileSize;
+
+    // Image rows go top to bottom, window rows bottom to top
+    unsigned char* out = &image->pixels[
+        ((state.height - 1 - y) * state.width + tile_x0) * 3];
+
+    for (int gx = tile_x0; gx < tile_x1; gx += kSimdWidth) {
+      int i = offset + (gx - tile_x0);
+      Mask8 covered = Float8::Load(tile.depth + i) < one;
+      if (!covered.Any()) {
+        int count = std::min(kSimdWidth, tile_x1 - gx);
+        std::fill(out, out + count * 3, 0);
+        out += count * 3;
+        continue;
+      }
+
+      Float8 r, g, b;
+      if (state.shading == kShadePerVertex) {
+        r = Float8::Load(tile.varyings[0] + i);
+        g = Float8::Load(tile.varyings[1] + i);
+        b = Float8::Load(tile.varyings[2] + i);
+      } else {
+        CalcLight8(*state.params, state.light_eye_pos,
+                   Float8::Load(tile.varyings[0] + i),
+                   Float8::Load(tile.varyings[1] + i),
+                   Float8::Load(tile.varyings[2] + i),
+                   Float8::Load(tile.varyings[3] + i),
+                   Float8::Load(tile.varyings[4] + i),
+                   Float8::Load(tile.varyings[5] + i),
+                   &r, &g, &b);
+      }
+
+      // Same conversion as writing to an 8-bit normalized color buffer
+      Float8 scale(255.f);
+      Float8 half(0.5f);
+      float rgb[3][kSimdWidth];
+      (Select(covered, Clamp(r, zero, one), zero) * scale + half).Store(rgb[0]);
+      (Select(covered, Clamp(g, zero, one), zero) * scale + half).Store(rgb[1]);
+      (Select(covered, Clamp(b, zero, one), zero) * scale + half).Store(rgb[2]);
+
+      int count = std::min(kSimdWidth, tile_x1 - gx);
+      for (int lane = 0; lane < count; ++lane) {
+        *out++ = static_cast<unsigned char>(rgb[0][lane]);
+        *out++ = static_cast<unsigned char>(rgb[1][lane]);
+        *out++ = static_cast<unsigned char>(rgb[2][lane]);
+      }
+    }
+  }
+}
+
+void RasterizeTiles(const RenderState& state, std::atomic<int>* next_tile,
+                    Image* image) {
+  std::unique_ptr<TileBuffer> tile(new TileBuffer);
+
+  int num_tiles = state.tiles_x * state.tiles_y;
+  for (int t = (*next_tile)++; t < num_tiles; t = (*next_tile)++) {
+    int tile_x0 = (t % state.tiles_x) * kTileSize;
+    int tile_y0 = (t / state.tiles_x) * kTileSize;
+    int tile_x1 = std::min(tile_x0 + kTileSize, state.width);
+    int tile_y1 = std::min(tile_y0 + kTileSize, state.height);
+
+    std::fill(tile->depth, tile->depth + kTileSize * kTileSize, 1.f);
+
+    for (const SetupBins& bins : state.bins) {
+      for (unsigned int tri_index : bins.tiles[t]) {
+        RasterizeTriangle(state, bins.triangles[tri_index], tile_x0, tile_y0,
+                          tile_x1, tile_y1, tile.get());
+      }
+    }
+
+    ResolveTile(state, *tile, tile_x0, tile_y0, tile_x1, tile_y1, image);
+  }
+}
+
+} // namespace
+
+void RenderLightingSoftware(const Model& model, const LightingParams& params,
+                            ShadingMode shading, unsigned int width,
+                            unsigned int height, unsigned int num_threads,
+                            Image* image) {
+  num_threads = ResolveThreadCount(num_threads);
+
+  RenderState state;
+  state.model = &model;
+  state.params = &params;
+  state.shading = shading;
+  state.num_varyings = shading == kShadePerVertex ? 3 : 6;
+  state.width = width;
+  state.height = height;
+  state.tiles_x = (width + kTileSize - 1) / kTileSize;
+  state.tiles_y = (height + kTileSize - 1) / kTileSize;
+  state.light_eye_pos = glm::vec3(params.view_mat *
+                                  glm::vec4(params.light_position, 1.f));
+
+  image->width = width;
+  image->height = height;
+  image->pixels.assign(width * height * 3, 0);
+
+  unsigned int vert_count = model.positions.size();
+  unsigned int face_count = model.indexed_drawing ? model.faces.size()
+                                                  : vert_count / 3;
+
+  // Vertex shading
+  state.vertices.resize(vert_count);
+  ParallelFor(num_threads, [&](unsigned int thread_index) {
+    TransformVertices(&state, vert_count * thread_index / num_threads,
+                      vert_count * (thread_index + 1) / num_threads);
+  });
+
+  // Clipping, triangle setup and binning into tiles
+  state.bins.resize(num_threads);
+  ParallelFor(num_threads, [&](unsigned int thread_index) {
+    SetupBins* bins = &state.bins[thread_index];
+    bins->tiles.resize(state.tiles_x * state.tiles_y);
+    SetupTriangles(&state, face_count * thread_index / num_threads,
+                   face_count * (thread_index + 1) / num_threads, bins);
+  });
+
+  // Rasterization, depth testing and shading, one tile at a time
+  std::atomic<int> next_tile(0);
+  ParallelFor(num_threads, [&](unsigned int) {
+    RasterizeTiles(state, &next_tile, image);
+  });
+}
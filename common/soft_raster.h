@@ -0,0 +1,42 @@
+#ifndef SOFT_RASTER_H_
+#define SOFT_RASTER_H_
+
+#include "glm/glm.hpp"
+
+#include "image.h"
+#include "model.h"
+
+// Uniforms of the lighting shaders (see calc_light in 04-lighting and
+// 08-edgedetect)
+struct LightingParams {
+  glm::vec3 light_position;
+  glm::vec3 diffuse_param;
+  glm::vec3 ambient_param;
+  glm::vec3 specular_param;
+  float shininess = 1.f;
+
+  glm::mat4 model_mat;
+  glm::mat4 view_mat;
+  glm::mat4 proj_mat;
+  glm::mat4 normal_mat;
+};
+
+enum ShadingMode {
+  kShadePerVertex, // calc_light in the vertex shader, as in 04-lighting
+  kShadePerPixel   // calc_light in the fragment shader, as in 08-edgedetect
+};
+
+// Renders the model into image on the CPU, following the GL pipeline the
+// samples set up: the color buffer is cleared to black, the depth buffer to
+// 1 with GL_LESS testing, and the viewport covers the whole image.
+//
+// The image is split into tiles that are rasterized in parallel, eight
+// pixels at a time. Per pixel lighting is done once per covered pixel after
+// depth testing instead of once per fragment, which gives the same image.
+// num_threads of 0 uses all hardware threads.
+void RenderLightingSoftware(const Model& model, const LightingParams& params,
+                            ShadingMode shading, unsigned int width,
+                            unsigned int height, unsigned int num_threads,
+                            Image* image);
+
+#endif
@@ -0,0 +1,231 @@
+#include "tess_cache.h"
+
+#include <iostream>
+#include <cstring>
+#include <string>
+
+#include "opengl.h"
+#include "glm/glm.hpp"
+#include "glm/gtc/type_ptr.hpp"
+
+#include "frame_stats.h"
+
+namespace {
+
+// Enough for a few thousand tessellated vertices. Captures that generate
+// more grow the buffer and tessellate again.
+const GLsizeiptr kInitialCapacity = 64 * 1024;
+
+GLsizeiptr VerticesPerPrimitive(GLenum primitive_mode) {
+  switch (primitive_mode) {
+    case GL_POINTS:
+      return 1;
+    case GL_LINES:
+      return 2;
+    default:
+      return 3;
+  }
+}
+
+} // namespace
+
+TessCache::TessCache() : capture_program_(NULL),
+                         primitive_mode_(GL_TRIANGLES),
+                         components_(0),
+                         feedback_id_(0),
+                         buffer_id_(0),
+                         vertex_array_id_(0),
+                         query_id_(0),
+                         capacity_(0),
+                         valid_(false),
+                         captured_first_(0),
+                         captured_count_(0),
+                         hits_(0),
+                         captures_(0),
+                         captured_primitives_(0) {}
+
+bool TessCache::Init(ShaderProgram* capture_program, GLenum primitive_mode,
+                     GLint components) {
+  Destroy();
+
+  if (components < 1 || components > 4) {
+    std::cerr << "Captured varyings must have 1 to 4 components"
+              << std::endl;
+    return false;
+  }
+
+  capture_program_ = capture_program;
+  primitive_mode_ = primitive_mode;
+  components_ = components;
+
+  glGenBuffers(1, &buffer_id_);
+  glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, buffer_id_);
+  capacity_ = kInitialCapacity;
+  glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER, capacity_, NULL, GL_STATIC_DRAW);
+  glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, 0);
+
+  // The feedback object remembers both the buffer binding and the vertex
+  // count of the last capture, which glDrawTransformFeedback draws
+  glGenTransformFeedbacks(1, &feedback_id_);
+  glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, feedback_id_);
+  glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, buffer_id_);
+  glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+
+  glGenVertexArrays(1, &vertex_array_id_);
+  glBindVertexArray(vertex_array_id_);
+  glBindBuffer(GL_ARRAY_BUFFER, buffer_id_);
+  glVertexAttribPointer(0, components_, GL_FLOAT, GL_FALSE, 0, NULL);
+  glEnableVertexAttribArray(0);
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  glGenQueries(1, &query_id_);
+
+  valid_ = false;
+  hits_ = 0;
+  captures_ = 0;
+  captured_primitives_ = 0;
+
+  return true;
+}
+
+void TessCache::Destroy() {
+  if (feedback_id_ != 0) {
+    glDeleteTransformFeedbacks(1, &feedback_id_);
+    feedback_id_ = 0;
+  }
+  if (buffer_id_ != 0) {
+    glDeleteBuffers(1, &buffer_id_);
+    buffer_id_ = 0;
+  }
+  if (vertex_array_id_ != 0) {
+    glDeleteVertexArrays(1, &vertex_array_id_);
+    vertex_array_id_ = 0;
+  }
+  if (query_id_ != 0) {
+    glDeleteQueries(1, &query_id_);
+    query_id_ = 0;
+  }
+
+  capacity_ = 0;
+  uniform_values_.clear();
+  control_points_.clear();
+  valid_ = false;
+}
+
+bool TessCache::UpdateState(std::string* stored, const void* value,
+                            size_t size) {
+  if (stored->size() == size && std::memcmp(stored->data(), value,
+                                            size) == 0) {
+    return false;
+  }
+
+  stored->assign(static_cast<const char*>(value), size);
+  valid_ = false;
+  return true;
+}
+
+void TessCache::SetUniform(const std::string& name, int value) {
+  if (UpdateState(&uniform_values_[name], &value, sizeof(value))) {
+    capture_program_->Use();
+    capture_program_->SetUniform(name, value);
+  }
+}
+
+void TessCache::SetUniform(const std::string& name, float value) {
+  if (UpdateState(&uniform_values_[name], &value, sizeof(value))) {
+    capture_program_->Use();
+    capture_program_->SetUniform(name, value);
+  }
+}
+
+void TessCache::SetUniform(const std::string& name,
+                           const glm::mat4& value) {
+  if (UpdateState(&uniform_values_[name], glm::value_ptr(value),
+                  sizeof(value))) {
+    capture_program_->Use();
+    capture_program_->SetUniform(name, value);
+  }
+}
+
+void TessCache::SetControlPoints(GLuint buffer_id, const void* data,
+                                 GLsizeiptr size) {
+  if (UpdateState(&control_points_[buffer_id], data, size)) {
+    glBindBuffer(GL_ARRAY_BUFFER, buffer_id);
+    glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+}
+
+void TessCache::Capture(GLuint vertex_array_id, GLint first,
+                        GLsizei count) {
+  // Only the captured vertices are wanted, nothing is drawn
+  glEnable(GL_RASTERIZER_DISCARD);
+
+  capture_program_->Use();
+  glBindVertexArray(vertex_array_id);
+  glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, feedback_id_);
+
+  GLsizeiptr vertex_size = components_ * sizeof(float);
+  GLsizeiptr primitive_size = VerticesPerPrimitive(primitive_mode_) *
+                              vertex_size;
+
+  while (true) {
+    glBeginQuery(GL_PRIMITIVES_GENERATED, query_id_);
+    glBeginTransformFeedback(primitive_mode_);
+    glDrawArrays(GL_PATCHES, first, count);
+    glEndTransformFeedback();
+    glEndQuery(GL_PRIMITIVES_GENERATED);
+    CountDrawCalls();
+
+    // Stalls until the capture is done, but only on frames that capture.
+    // Primitives that did not fit in the buffer are still counted.
+    GLuint primitives = 0;
+    glGetQueryObjectuiv(query_id_, GL_QUERY_RESULT, &primitives);
+    captured_primitives_ = primitives;
+
+    GLsizeiptr size = primitives * primitive_size;
+    if (size <= capacity_) {
+      break;
+    }
+
+    capacity_ = size;
+    glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, buffer_id_);
+    glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER, capacity_, NULL,
+                 GL_STATIC_DRAW);
+    glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, 0);
+  }
+
+  glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+  glBindVertexArray(0);
+  glDisable(GL_RASTERIZER_DISCARD);
+
+  valid_ = true;
+  captured_first_ = first;
+  captured_count_ = count;
+}
+
+void TessCache::Draw(const ShaderProgram& program, GLuint vertex_array_id,
+                     GLint first, GLsizei count) {
+  if (valid_ && first == captured_first_ && count == captured_count_) {
+    ++hits_;
+  } else {
+    Capture(vertex_array_id, first, count);
+    ++captures_;
+  }
+
+  program.Use();
+  glBindVertexArray(vertex_array_id_);
+  glDrawTransformFeedback(primitive_mode_, feedback_id_);
+  CountDrawCalls();
+  glBindVertexArray(0);
+}
+
+void TessCache::PrintStats() const {
+  unsigned int draws = hits_ + captures_;
+  double hit_rate = draws > 0 ? 100.0 * hits_ / draws : 0.0;
+
+  std::cout << "Tessellation cache: " << hits_ << " hits, " << captures_
+            << " captures (" << hit_rate << "% hit rate), "
+            << captured_primitives_ << " primitives captured" << std::endl;
+}
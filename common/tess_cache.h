@@ -0,0 +1,90 @@
+#ifndef TESS_CACHE_H_
+#define TESS_CACHE_H_
+
+#include <string>
+#include <unordered_map>
+
+#include "opengl.h"
+#include "glm/glm.hpp"
+
+#include "shader_program.h"
+
+// Captures the output of the tessellation stages with transform feedback
+// and draws it with glDrawTransformFeedback on later frames, so that static
+// patches are not tessellated again every frame.
+//
+// The capture program holds the vertex and tessellation stages only, with
+// the TES output to capture selected by SetFeedbackVaryings before linking.
+// Everything the tessellation depends on goes through the cache: uniforms
+// of the capture program are set with SetUniform and control points are
+// uploaded with SetControlPoints. A value that differs from the one set
+// before invalidates the captured output, and the next Draw() tessellates
+// again.
+//
+// Destroy() must be called explicitly while the GL context is alive.
+class TessCache {
+ public:
+  TessCache();
+
+  TessCache(const TessCache&) = delete;
+  TessCache& operator=(const TessCache&) = delete;
+
+  // primitive_mode is GL_LINES for isolines and GL_TRIANGLES for triangle
+  // and quad domains. components is the number of floats in the captured
+  // varying, which is read back as vertex attribute 0 when drawing.
+  bool Init(ShaderProgram* capture_program, GLenum primitive_mode,
+            GLint components);
+  void Destroy();
+
+  void SetUniform(const std::string& name, int value);
+  void SetUniform(const std::string& name, float value);
+  void SetUniform(const std::string& name, const glm::mat4& value);
+
+  // Uploads the control points into buffer_id with glBufferData
+  void SetControlPoints(GLuint buffer_id, const void* data, GLsizeiptr size);
+
+  void Invalidate() { valid_ = false; }
+  bool valid() const { return valid_; }
+
+  // Draws the patches [first, first + count) of vertex_array_id with
+  // program, whose vertex shader reads the captured vertices. Captures them
+  // first unless the captured output is still valid.
+  void Draw(const ShaderProgram& program, GLuint vertex_array_id,
+            GLint first, GLsizei count);
+
+  // Prints the hits, captures and captured primitives to stdout
+  void PrintStats() const;
+
+  unsigned int hits() const { return hits_; }
+  unsigned int captures() const { return captures_; }
+
+ private:
+  // Stores value in *stored and invalidates the cache if it changed.
+  // Returns true if it changed.
+  bool UpdateState(std::string* stored, const void* value, size_t size);
+
+  void Capture(GLuint vertex_array_id, GLint first, GLsizei count);
+
+  ShaderProgram* capture_program_;
+  GLenum primitive_mode_;
+  GLint components_;
+
+  GLuint feedback_id_;
+  GLuint buffer_id_;
+  GLuint vertex_array_id_; // Reads buffer_id_ as attribute 0
+  GLuint query_id_;
+  GLsizeiptr capacity_;
+
+  std::unordered_map<std::string, std::string> uniform_values_;
+  std::unordered_map<GLuint, std::string> control_points_;
+
+  bool valid_;
+  GLint captured_first_;
+  GLsizei captured_count_;
+
+  unsigned int hits_;
+  unsigned int captures_;
+  GLuint captured_primitives_;
+};
+
+#endif
@@ -0,0 +1,721 @@
+#include "tessellation.h"
+
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "glm/glm.hpp"
+
+#include "model.h"
+#include "parallel.h"
+#include "simd.h"
+
+namespace {
+
+// Appends a run of count points. Along the run the coordinate is
+// (first + i) / segments, divided in float like GL does, and the other
+// coordinate is fixed.
+void AddRun(int axis, int first, unsigned int count, int segments,
+            float fixed, TessDomain* domain) {
+  if (count == 0) {
+    return;
+  }
+
+  for (unsigned int i = 0; i < count; ++i) {
+    float along = static_cast<float>(first + static_cast<int>(i)) /
+                  static_cast<float>(segments);
+    domain->coords.push_back(axis == 0 ? glm::vec2(along, fixed)
+                                       : glm::vec2(fixed, along));
+  }
+
+  TessRun run;
+  run.start = domain->coords[domain->coords.size() - count];
+  run.axis = axis;
+  run.segments = static_cast<unsigned int>(segments);
+  run.count = count;
+  domain->runs.push_back(run);
+}
+
+// Connects an outer edge to the side of the inner grid facing it. Both
+// lists run counterclockwise around the domain, so the inner side is on
+// their left. Whichever list has the next point first along the edge
+// advances, adding a triangle.
+void StitchSide(const std::vector<unsigned int>& outer,
+                const std::vector<unsigned int>& inner,
+                const glm::vec2& direction, TessDomain* domain) {
+  auto along = [&](unsigned int index) {
+    return glm::dot(domain->coords[index], direction);
+  };
+
+  size_t k = 0;
+  size_t j = 0;
+  while (k + 1 < outer.size() || j + 1 < inner.size()) {
+    bool advance_outer = j + 1 == inner.size() ||
+                         (k + 1 < outer.size() &&
+                          along(outer[k + 1]) < along(inner[j + 1]));
+    if (advance_outer) {
+      domain->triangles.push_back(glm::uvec3(outer[k], outer[k + 1],
+                                             inner[j]));
+      ++k;
+    } else {
+      domain->triangles.push_back(glm::uvec3(outer[k], inner[j + 1],
+                                             inner[j]));
+      ++j;
+    }
+  }
+}
+
+// Cubic in one variable with vector coefficients, c[k] for x^k. Set up in
+// double so that the small higher order terms of short steps survive.
+struct Cubic {
+  glm::dvec3 c[4];
+
+  Cubic() {
+    for (int k = 0; k < 4; ++k) {
+      c[k] = glm::dvec3(0.0);
+    }
+  }
+};
+
+Cubic BezierToPower(const glm::dvec3 q[4]) {
+  Cubic r;
+  r.c[0] = q[0];
+  r.c[1] = 3.0 * (q[1] - q[0]);
+  r.c[2] = 3.0 * (q[0] - 2.0 * q[1] + q[2]);
+  r.c[3] = q[3] - q[0] + 3.0 * (q[1] - q[2]);
+  return r;
+}
+
+Cubic Derivative(const Cubic& p) {
+  Cubic r;
+  r.c[0] = p.c[1];
+  r.c[1] = 2.0 * p.c[2];
+  r.c[2] = 3.0 * p.c[3];
+  return r;
+}
+
+// The cubic in t after substituting x = x0 + h * t
+Cubic Reparameterize(const Cubic& p, double x0, double h) {
+  Cubic r;
+  r.c[0] = p.c[0] + x0 * (p.c[1] + x0 * (p.c[2] + x0 * p.c[3]));
+  r.c[1] = h * (p.c[1] + x0 * (2.0 * p.c[2] + 3.0 * x0 * p.c[3]));
+  r.c[2] = h * h * (p.c[2] + 3.0 * x0 * p.c[3]);
+  r.c[3] = h * h * h * p.c[3];
+  return r;
+}
+
+template <typename T>
+void Bernstein(T t, T b[4]) {
+  T s = 1 - t;
+  b[0] = s * s * s;
+  b[1] = 3 * s * s * t;
+  b[2] = 3 * s * t * t;
+  b[3] = t * t * t;
+}
+
+template <typename T>
+void BernsteinDerivative(T t, T d[4]) {
+  T s = 1 - t;
+  d[0] = -3 * s * s;
+  d[1] = 3 * s * s - 6 * s * t;
+  d[2] = 6 * s * t - 3 * t * t;
+  d[3] = 3 * t * t;
+}
+
+// Position and partial derivatives of a patch along a run, as cubics in the
+// index of the point within the run
+struct RunCubics {
+  Cubic position;
+  Cubic du;
+  Cubic dv;
+};
+
+// The derivatives are only set up for Bezier patches, the one type with
+// normals
+void SetupRun(PatchType type, const glm::vec3* cp, const TessRun& run,
+              RunCubics* cubics) {
+  double start = run.start[run.axis];
+  double fixed = run.start[1 - run.axis];
+  double step = 1.0 / run.segments;
+  bool along_u = run.axis == 0;
+
+  Cubic along;
+  Cubic across; // Derivative in the other coordinate
+
+  if (type == kBezierCurve) {
+    glm::dvec3 q[4] = {glm::dvec3(cp[0]), glm::dvec3(cp[1]),
+                       glm::dvec3(cp[2]), glm::dvec3(cp[3])};
+    along = BezierToPower(q);
+  } else if (type == kBilinearPatch) {
+    // Linear along either axis, between points on the two edges it joins
+    glm::dvec3 e0 = along_u ? glm::mix(glm::dvec3(cp[0]), glm::dvec3(cp[3]),
+                                       fixed)
+                            : glm::mix(glm::dvec3(cp[0]), glm::dvec3(cp[1]),
+                                       fixed);
+    glm::dvec3 e1 = along_u ? glm::mix(glm::dvec3(cp[1]), glm::dvec3(cp[2]),
+                                       fixed)
+                            : glm::mix(glm::dvec3(cp[3]), glm::dvec3(cp[2]),
+                                       fixed);
+    along.c[0] = e0;
+    along.c[1] = e1 - e0;
+  } else {
+    // Collapses the rows (or columns) at the fixed coordinate into the
+    // control points of one cubic Bezier along the run
+    double b[4];
+    double d[4];
+    Bernstein(fixed, b);
+    BernsteinDerivative(fixed, d);
+
+    glm::dvec3 q[4];
+    glm::dvec3 q_across[4];
+    for (int i = 0; i < 4; ++i) {
+      q[i] = glm::dvec3(0.0);
+      q_across[i] = glm::dvec3(0.0);
+      for (int j = 0; j < 4; ++j) {
+        glm::dvec3 p(along_u ? cp[j * 4 + i] : cp[i * 4 + j]);
+        q[i] += b[j] * p;
+        q_across[i] += d[j] * p;
+      }
+    }
+    along = BezierToPower(q);
+    across = BezierToPower(q_across);
+  }
+
+  cubics->position = Reparameterize(along, start, step);
+  if (type != kBezierPatch) {
+    return;
+  }
+
+  Cubic derivative = Reparameterize(Derivative(along), start, step);
+  across = Reparameterize(across, start, step);
+  cubics->du = along_u ? derivative : across;
+  cubics->dv = along_u ? across : derivative;
+}
+
+// Steps a cubic in t through t = 0, 1, 2, ... eight values at a time. Lane
+// k holds the value at t + k; each step adds t += 8 with three additions.
+// The differences are only set up for runs longer than one step.
+struct ForwardDifferences {
+  Float8 value[3];
+  Float8 d1[3];
+  Float8 d2[3];
+  Float8 d3[3];
+
+  void Init(const Cubic& cubic, unsigned int count) {
+    const float h = static_cast<float>(kSimdWidth);
+    Float8 t = Float8::Ramp(0.f);
+
+    for (int c = 0; c < 3; ++c) {
+      Float8 a(static_cast<float>(cubic.c[3][c]));
+      Float8 b(static_cast<float>(cubic.c[2][c]));
+      Float8 l(static_cast<float>(cubic.c[1][c]));
+      Float8 k(static_cast<float>(cubic.c[0][c]));
+
+      value[c] = ((a * t + b) * t + l) * t + k;
+      if (count <= static_cast<unsigned int>(kSimdWidth)) {
+        continue;
+      }
+
+      // Expanded differences of step h rather than differences of values,
+      // which would cancel to noise for the small higher order terms
+      d1[c] = a * (Float8(3.f * h) * t * t + Float8(3.f * h * h) * t +
+                   Float8(h * h * h)) +
+              b * (Float8(2.f * h) * t + Float8(h * h)) + l * Float8(h);
+      d2[c] = a * (Float8(6.f * h * h) * t + Float8(6.f * h * h * h)) +
+              b * Float8(2.f * h * h);
+      d3[c] = a * Float8(6.f * h * h * h);
+    }
+  }
+
+  void Step() {
+    for (int c = 0; c < 3; ++c) {
+      value[c] = value[c] + d1[c];
+      d1[c] = d1[c] + d2[c];
+      d2[c] = d2[c] + d3[c];
+    }
+  }
+};
+
+// Evaluates a patch at the points of a run. normals is NULL unless the
+// patch type has them.
+void EvaluateRun(PatchType type, const glm::vec3* cp, const TessRun& run,
+                 glm::vec3* positions, glm::vec3* normals) {
+  RunCubics cubics;
+  SetupRun(type, cp, run, &cubics);
+
+  ForwardDifferences position;
+  ForwardDifferences du;
+  ForwardDifferences dv;
+  position.Init(cubics.position, run.count);
+  if (normals != NULL) {
+    du.Init(cubics.du, run.count);
+    dv.Init(cubics.dv, run.count);
+  }
+
+  float lanes[3][kSimdWidth];
+  for (unsigned int i = 0; i < run.count; i += kSimdWidth) {
+    unsigned int count = std::min(run.count - i,
+                                  static_cast<unsigned int>(kSimdWidth));
+
+    for (int c = 0; c < 3; ++c) {
+      position.value[c].Store(lanes[c]);
+    }
+    for (unsigned int k = 0; k < count; ++k) {
+      positions[i + k] = glm::vec3(lanes[0][k], lanes[1][k], lanes[2][k]);
+    }
+    position.Step();
+
+    if (normals == NULL) {
+      continue;
+    }
+
+    const Float8* u = du.value;
+    const Float8* v = dv.value;
+    Float8 n[3] = {u[1] * v[2] - u[2] * v[1],
+                   u[2] * v[0] - u[0] * v[2],
+                   u[0] * v[1] - u[1] * v[0]};
+
+    // Zero where the derivatives are parallel, as at a collapsed edge
+    Float8 length_sq = Dot3(n[0], n[1], n[2], n[0], n[1], n[2]);
+    Mask8 nonzero = length_sq > Float8(0.f);
+    Float8 inv_length = Select(nonzero,
+                               Float8(1.f) / Sqrt(Select(nonzero, length_sq,
+                                                         Float8(1.f))),
+                               Float8(0.f));
+    for (int c = 0; c < 3; ++c) {
+      (n[c] * inv_length).Store(lanes[c]);
+    }
+    for (unsigned int k = 0; k < count; ++k) {
+      normals[i + k] = glm::vec3(lanes[0][k], lanes[1][k], lanes[2][k]);
+    }
+    du.Step();
+    dv.Step();
+  }
+}
+
+// Domain coordinates split by axis and padded to whole lanes
+struct DomainLanes {
+  std::vector<float> u;
+  std::vector<float> v;
+  size_t count = 0;
+
+  explicit DomainLanes(const TessDomain& domain)
+      : count(domain.coords.size()) {
+    size_t padded = (count + kSimdWidth - 1) / kSimdWidth * kSimdWidth;
+    u.resize(padded, 0.f);
+    v.resize(padded, 0.f);
+    for (size_t i = 0; i < count; ++i) {
+      u[i] = domain.coords[i].x;
+      v[i] = domain.coords[i].y;
+    }
+  }
+};
+
+// Evaluates a Bezier curve or bilinear patch at eight coordinates at a
+// time, with the weights of the evaluation shaders. Forward differencing
+// does not pay for these: a point costs a few multiplies either way, and
+// a run's setup is more than its steps save.
+void EvaluateLanes(PatchType type, const glm::vec3* cp,
+                   const DomainLanes& lanes, glm::vec3* positions) {
+  const Float8 one(1.f);
+  const Float8 three(3.f);
+
+  float out[3][kSimdWidth];
+  for (size_t i = 0; i < lanes.count; i += kSimdWidth) {
+    Float8 u = Float8::Load(&lanes.u[i]);
+    Float8 su = one - u;
+    Float8 w[4];
+    if (type == kBezierCurve) {
+      w[0] = su * su * su;
+      w[1] = three * su * su * u;
+      w[2] = three * su * u * u;
+      w[3] = u * u * u;
+    } else {
+      Float8 v = Float8::Load(&lanes.v[i]);
+      Float8 sv = one - v;
+      w[0] = su * sv;
+      w[1] = u * sv;
+      w[2] = u * v;
+      w[3] = su * v;
+    }
+
+    for (int c = 0; c < 3; ++c) {
+      (w[0] * Float8(cp[0][c]) + w[1] * Float8(cp[1][c]) +
+       w[2] * Float8(cp[2][c]) + w[3] * Float8(cp[3][c])).Store(out[c]);
+    }
+    size_t count = std::min(lanes.count - i,
+                            static_cast<size_t>(kSimdWidth));
+    for (size_t k = 0; k < count; ++k) {
+      positions[i + k] = glm::vec3(out[0][k], out[1][k], out[2][k]);
+    }
+  }
+}
+
+// The evaluation shaders' arithmetic, in float
+glm::vec3 EvaluatePoint(PatchType type, const glm::vec3* cp,
+                        const glm::vec2& coord, glm::vec3* normal) {
+  float u = coord.x;
+  float v = coord.y;
+
+  if (type == kBezierCurve) {
+    float b[4];
+    Bernstein(u, b);
+    return b[0] * cp[0] + b[1] * cp[1] + b[2] * cp[2] + b[3] * cp[3];
+  }
+
+  if (type == kBilinearPatch) {
+    return cp[0] * (1 - u) * (1 - v) +
+           cp[1] * u * (1 - v) +
+           cp[2] * u * v +
+           cp[3] * (1 - u) * v;
+  }
+
+  float bu[4];
+  float bv[4];
+  float du[4];
+  float dv[4];
+  Bernstein(u, bu);
+  Bernstein(v, bv);
+  BernsteinDerivative(u, du);
+  BernsteinDerivative(v, dv);
+
+  glm::vec3 position(0.f);
+  glm::vec3 tangent_u(0.f);
+  glm::vec3 tangent_v(0.f);
+  for (int j = 0; j < 4; ++j) {
+    for (int i = 0; i < 4; ++i) {
+      const glm::vec3& p = cp[j * 4 + i];
+      position += bu[i] * bv[j] * p;
+      tangent_u += du[i] * bv[j] * p;
+      tangent_v += bu[i] * dv[j] * p;
+    }
+  }
+
+  glm::vec3 n = glm::cross(tangent_u, tangent_v);
+  float length_sq = glm::dot(n, n);
+  *normal = length_sq > 0.f ? n / std::sqrt(length_sq) : glm::vec3(0.f);
+  return position;
+}
+
+bool PrepareModel(PatchType type, const std::vector<glm::vec3>& control_points,
+                  const TessDomain& domain, Model* model,
+                  std::vector<glm::uvec2>* lines) {
+  unsigned int patch_size = PatchControlPoints(type);
+  if (control_points.size() % patch_size != 0) {
+    std::cerr << "Control points are not a whole number of patches"
+              << std::endl;
+    return false;
+  }
+  size_t patch_count = control_points.size() / patch_size;
+
+  model->positions.resize(patch_count * domain.coords.size());
+  model->texcoords.resize(model->positions.size());
+  model->normals.resize(type == kBezierPatch ? model->positions.size() : 0);
+  model->faces.resize(patch_count * domain.triangles.size());
+  model->vert_count = static_cast<unsigned int>(model->positions.size());
+  model->face_count = static_cast<unsigned int>(model->faces.size());
+  model->indexed_drawing = true;
+
+  if (lines != NULL) {
+    lines->resize(patch_count * domain.lines.size());
+  }
+  return true;
+}
+
+// Everything of a patch's output that only depends on the domain
+void FillPatchTopology(const TessDomain& domain, size_t patch, Model* model,
+                       std::vector<glm::uvec2>* lines) {
+  size_t vert_count = domain.coords.size();
+  unsigned int base = static_cast<unsigned int>(patch * vert_count);
+
+  std::copy(domain.coords.begin(), domain.coords.end(),
+            model->texcoords.begin() + patch * vert_count);
+
+  glm::uvec3* faces = &model->faces[0] + patch * domain.triangles.size();
+  for (const glm::uvec3& triangle : domain.triangles) {
+    *faces++ = triangle + glm::uvec3(base);
+  }
+
+  if (lines != NULL && !domain.lines.empty()) {
+    glm::uvec2* out = &(*lines)[patch * domain.lines.size()];
+    for (const glm::uvec2& line : domain.lines) {
+      *out++ = line + glm::uvec2(base);
+    }
+  }
+}
+
+} // namespace
+
+int EqualSpacingLevel(float level) {
+  // Written so that NaN also goes to 1
+  if (!(level > 1.f)) {
+    return 1;
+  }
+  if (level >= static_cast<float>(kMaxTessLevel)) {
+    return kMaxTessLevel;
+  }
+  return static_cast<int>(std::ceil(level));
+}
+
+bool BuildQuadDomain(const QuadTessLevels& levels, TessDomain* domain) {
+  *domain = TessDomain();
+
+  int outer[4];
+  for (int k = 0; k < 4; ++k) {
+    if (!(levels.outer[k] > 0.f)) {
+      return false;
+    }
+    outer[k] = EqualSpacingLevel(levels.outer[k]);
+  }
+  int m = EqualSpacingLevel(levels.inner[0]);
+  int n = EqualSpacingLevel(levels.inner[1]);
+
+  if (m == 1 && n == 1 && outer[0] == 1 && outer[1] == 1 &&
+      outer[2] == 1 && outer[3] == 1) {
+    // The only case without an inner grid: the quad as two triangles
+    AddRun(0, 0, 2, 1, 0.f, domain);
+    AddRun(0, 0, 2, 1, 1.f, domain);
+    domain->triangles.push_back(glm::uvec3(0, 1, 3));
+    domain->triangles.push_back(glm::uvec3(0, 3, 2));
+    return true;
+  }
+
+  // Otherwise an inner level of 1 counts as 1 + epsilon, which
+  // equal_spacing rounds up to 2
+  m = std::max(m, 2);
+  n = std::max(n, 2);
+
+  const int left_level = outer[0];
+  const int bottom_level = outer[1];
+  const int right_level = outer[2];
+  const int top_level = outer[3];
+
+  // Bottom and top edges with the corners, then the rest of the left and
+  // right edges, then the rows of the inner grid
+  unsigned int bottom = 0;
+  AddRun(0, 0, bottom_level + 1, bottom_level, 0.f, domain);
+  unsigned int top = domain->coords.size();
+  AddRun(0, 0, top_level + 1, top_level, 1.f, domain);
+  unsigned int left = domain->coords.size();
+  AddRun(1, 1, left_level - 1, left_level, 0.f, domain);
+  unsigned int right = domain->coords.size();
+  AddRun(1, 1, right_level - 1, right_level, 1.f, domain);
+  unsigned int inner = domain->coords.size();
+  for (int j = 1; j < n; ++j) {
+    AddRun(0, 1, m - 1, m, static_cast<float>(j) / static_cast<float>(n),
+           domain);
+  }
+
+  auto inner_index = [&](int i, int j) {
+    return inner + (j - 1) * (m - 1) + (i - 1);
+  };
+  auto left_index = [&](int k) {
+    return k == 0 ? bottom : k == left_level ? top : left + k - 1;
+  };
+  auto right_index = [&](int k) {
+    return k == 0 ? bottom + bottom_level
+                  : k == right_level ? top + top_level : right + k - 1;
+  };
+
+  for (int j = 1; j < n - 1; ++j) {
+    for (int i = 1; i < m - 1; ++i) {
+      unsigned int a = inner_index(i, j);
+      unsigned int b = inner_index(i + 1, j);
+      unsigned int c = inner_index(i + 1, j + 1);
+      unsigned int d = inner_index(i, j + 1);
+      domain->triangles.push_back(glm::uvec3(a, b, c));
+      domain->triangles.push_back(glm::uvec3(a, c, d));
+    }
+  }
+
+  std::vector<unsigned int> outer_side;
+  std::vector<unsigned int> inner_side;
+
+  for (int k = 0; k <= bottom_level; ++k) {
+    outer_side.push_back(bottom + k);
+  }
+  for (int i = 1; i < m; ++i) {
+    inner_side.push_back(inner_index(i, 1));
+  }
+  StitchSide(outer_side, inner_side, glm::vec2(1.f, 0.f), domain);
+
+  outer_side.clear();
+  inner_side.clear();
+  for (int k = 0; k <= right_level; ++k) {
+    outer_side.push_back(right_index(k));
+  }
+  for (int j = 1; j < n; ++j) {
+    inner_side.push_back(inner_index(m - 1, j));
+  }
+  StitchSide(outer_side, inner_side, glm::vec2(0.f, 1.f), domain);
+
+  outer_side.clear();
+  inner_side.clear();
+  for (int k = top_level; k >= 0; --k) {
+    outer_side.push_back(top + k);
+  }
+  for (int i = m - 1; i >= 1; --i) {
+    inner_side.push_back(inner_index(i, n - 1));
+  }
+  StitchSide(outer_side, inner_side, glm::vec2(-1.f, 0.f), domain);
+
+  outer_side.clear();
+  inner_side.clear();
+  for (int k = left_level; k >= 0; --k) {
+    outer_side.push_back(left_index(k));
+  }
+  for (int j = n - 1; j >= 1; --j) {
+    inner_side.push_back(inner_index(1, j));
+  }
+  StitchSide(outer_side, inner_side, glm::vec2(0.f, -1.f), domain);
+
+  return true;
+}
+
+bool BuildIsolineDomain(float lines, float segments, TessDomain* domain) {
+  *domain = TessDomain();
+
+  if (!(lines > 0.f) || !(segments > 0.f)) {
+    return false;
+  }
+
+  // The line count is always rounded up like this, whatever the spacing
+  int line_count = EqualSpacingLevel(lines);
+  int segment_count = EqualSpacingLevel(segments);
+
+  for (int i = 0; i < line_count; ++i) {
+    unsigned int first = domain->coords.size();
+    AddRun(0, 0, segment_count + 1, segment_count,
+           static_cast<float>(i) / static_cast<float>(line_count), domain);
+    for (int k = 0; k < segment_count; ++k) {
+      domain->lines.push_back(glm::uvec2(first + k, first + k + 1));
+    }
+  }
+  return true;
+}
+
+unsigned int PatchControlPoints(PatchType type) {
+  return type == kBezierPatch ? 16 : 4;
+}
+
+bool LoadBezierPatches(const std::string& path,
+                       std::vector<glm::vec3>* control_points) {
+  std::ifstream file(path);
+  if (!file) {
+    std::cerr << "Could not open " << path << std::endl;
+    return false;
+  }
+
+  unsigned int patch_count = 0;
+  if (!(file >> patch_count)) {
+    std::cerr << "Missing patch count in " << path << std::endl;
+    return false;
+  }
+
+  control_points->reserve(control_points->size() + patch_count * 16);
+  for (unsigned int patch = 0; patch < patch_count; ++patch) {
+    int u_degree = 0;
+    int v_degree = 0;
+    if (!(file >> u_degree >> v_degree)) {
+      std::cerr << "Missing patch " << patch << " in " << path << std::endl;
+      return false;
+    }
+    if (u_degree != 3 || v_degree != 3) {
+      std::cerr << "Patch " << patch << " in " << path << " is not bicubic"
+                << std::endl;
+      return false;
+    }
+
+    for (int i = 0; i < 16; ++i) {
+      glm::vec3 point;
+      if (!(file >> point.x >> point.y >> point.z)) {
+        std::cerr << "Missing control point in patch " << patch << " of "
+                  << path << std::endl;
+        return false;
+      }
+      control_points->push_back(point);
+    }
+  }
+
+  return true;
+}
+
+bool TessellatePatches(PatchType type,
+                       const std::vector<glm::vec3>& control_points,
+                       const TessDomain& domain, unsigned int num_threads,
+                       Model* model, std::vector<glm::uvec2>* lines) {
+  if (!PrepareModel(type, control_points, domain, model, lines)) {
+    return false;
+  }
+
+  const unsigned int patch_size = PatchControlPoints(type);
+  const size_t patch_count = control_points.size() / patch_size;
+  const size_t vert_count = domain.coords.size();
+
+  unsigned int threads = ResolveThreadCount(num_threads);
+  threads = static_cast<unsigned int>(
+      std::max<size_t>(std::min<size_t>(threads, patch_count), 1));
+
+  const DomainLanes lanes(type == kBezierPatch ? TessDomain() : domain);
+
+  ParallelFor(threads, [&](unsigned int thread_index) {
+    size_t begin = patch_count * thread_index / threads;
+    size_t end = patch_count * (thread_index + 1) / threads;
+
+    for (size_t patch = begin; patch < end; ++patch) {
+      const glm::vec3* cp = &control_points[patch * patch_size];
+      size_t offset = patch * vert_count;
+
+      if (type != kBezierPatch) {
+        EvaluateLanes(type, cp, lanes, &model->positions[offset]);
+        FillPatchTopology(domain, patch, model, lines);
+        continue;
+      }
+
+      for (const TessRun& run : domain.runs) {
+        glm::vec3* normals = model->normals.empty()
+                                 ? NULL : &model->normals[offset];
+        EvaluateRun(type, cp, run, &model->positions[offset], normals);
+        offset += run.count;
+      }
+
+      FillPatchTopology(domain, patch, model, lines);
+    }
+  });
+
+  return true;
+}
+
+bool TessellatePatchesReference(PatchType type,
+                                const std::vector<glm::vec3>& control_points,
+                                const TessDomain& domain, Model* model,
+                                std::vector<glm::uvec2>* lines) {
+  if (!PrepareModel(type, control_points, domain, model, lines)) {
+    return false;
+  }
+
+  const unsigned int patch_size = PatchControlPoints(type);
+  const size_t patch_count = control_points.size() / patch_size;
+  const size_t vert_count = domain.coords.size();
+
+  for (size_t patch = 0; patch < patch_count; ++patch) {
+    const glm::vec3* cp = &control_points[patch * patch_size];
+
+    for (size_t i = 0; i < vert_count; ++i) {
+      size_t index = patch * vert_count + i;
+      glm::vec3 normal;
+      model->positions[index] = EvaluatePoint(type, cp, domain.coords[i],
+                                              &normal);
+      if (!model->normals.empty()) {
+        model->normals[index] = normal;
+      }
+    }
+
+    FillPatchTopology(domain, patch, model, lines);
+  }
+
+  return true;
+}
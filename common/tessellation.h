@@ -0,0 +1,101 @@
+#ifndef TESSELLATION_H_
+#define TESSELLATION_H_
+
+#include <string>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "model.h"
+
+// CPU versions of the tessellation in 06-bezier and 07-tess2d, for
+// pipelines that need the same geometry without a GPU. A domain holds the
+// tessellation coordinates the fixed-function tessellator generates for
+// given levels; the patches are then evaluated at those coordinates like
+// the evaluation shaders do.
+
+// Lowest gl_MaxTessGenLevel an implementation may have, which the samples
+// clamp their levels to
+const int kMaxTessLevel = 64;
+
+// Level an equal_spacing tessellator uses: clamped to [1, kMaxTessLevel]
+// and rounded up to an integer
+int EqualSpacingLevel(float level);
+
+struct QuadTessLevels {
+  float outer[4]; // Edges u = 0, v = 0, u = 1 and v = 1, as in GLSL
+  float inner[2]; // Along u and along v
+};
+
+// Coordinates are stored as runs of equally spaced points along u or v, so
+// that patches can be evaluated along each run by forward differencing
+struct TessRun {
+  glm::vec2 start;
+  int axis = 0;              // 0 if u changes along the run, 1 if v does
+  unsigned int segments = 1; // Points are 1 / segments apart
+  unsigned int count = 0;
+};
+
+struct TessDomain {
+  std::vector<glm::vec2> coords; // gl_TessCoord.xy, run by run
+  std::vector<TessRun> runs;
+  std::vector<glm::uvec3> triangles; // Counterclockwise in (u, v)
+  std::vector<glm::uvec2> lines;     // Isoline segments
+};
+
+// Domain of layout(quads, equal_spacing). The coordinates are exactly
+// those GL generates: the outer edges split by the outer levels, and the
+// interior points (i / m, j / n) of the grid of inner levels m and n. GL
+// leaves the triangles connecting them to the implementation; here each
+// inner grid cell becomes two triangles and every outer edge is stitched
+// to the side of the inner grid facing it. Returns false with an empty
+// domain if an outer level is not positive, as GL discards such patches.
+bool BuildQuadDomain(const QuadTessLevels& levels, TessDomain* domain);
+
+// Domain of layout(isolines, equal_spacing): lines at v = i / lines for
+// every i < lines, each split into segments at u = k / segments
+bool BuildIsolineDomain(float lines, float segments, TessDomain* domain);
+
+enum PatchType {
+  kBezierCurve,   // Four control points, like bezier.tes (v is ignored)
+  kBilinearPatch, // Four corners in the order of tess2d.tes
+  kBezierPatch    // 16 control points, in rows of constant v
+};
+
+unsigned int PatchControlPoints(PatchType type);
+
+// Loads the bicubic patches of a Bezier patch file, such as
+// assets/teapot.bpt: the number of patches, then for each patch its
+// degrees in u and v ("3 3") followed by 16 control points, u changing
+// fastest. The points are appended in the order kBezierPatch expects.
+bool LoadBezierPatches(const std::string& path,
+                       std::vector<glm::vec3>* control_points);
+
+// Evaluates every patch at every coordinate of the domain. The model gets
+// one vertex per patch and coordinate, in domain order, with the
+// coordinate as its texcoord, and the domain's triangles for each patch.
+// Bezier patches also get normals, the normalized cross product of the
+// partial derivatives in u and v (zero where they are parallel). Isoline
+// segments go to lines if it is not NULL, as the model only holds
+// triangles.
+//
+// Bezier patches are evaluated along each run by forward differencing,
+// eight points at a time (see simd.h), with the differences set up exactly
+// from the power form of the curve along the run. Curves and bilinear
+// patches are cheap enough to evaluate directly, also eight points at a
+// time: forward differencing was slower for them. Patches are split
+// between num_threads threads; 0 uses all hardware threads.
+bool TessellatePatches(PatchType type,
+                       const std::vector<glm::vec3>& control_points,
+                       const TessDomain& domain, unsigned int num_threads,
+                       Model* model,
+                       std::vector<glm::uvec2>* lines = NULL);
+
+// Evaluates each coordinate on its own with the Bernstein polynomials in
+// float, as the evaluation shaders do. Reference for TessellatePatches.
+bool TessellatePatchesReference(PatchType type,
+                                const std::vector<glm::vec3>& control_points,
+                                const TessDomain& domain, Model* model,
+                                std::vector<glm::uvec2>* lines = NULL);
+
+#endif
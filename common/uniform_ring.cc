@@ -0,0 +1,147 @@
+#include "uniform_ring.h"
+
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+
+#include "opengl.h"
+#include "gl_caps.h"
+
+namespace {
+
+// Gives up on a fence after one second, in case the context was lost
+const GLuint64 kFenceTimeoutNs = 1000000000;
+
+GLsizeiptr AlignUp(GLsizeiptr value, GLsizeiptr alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+UniformRing::UniformRing() : buffer_id_(0),
+                             frame_size_(0),
+                             offset_alignment_(1),
+                             frame_index_(0),
+                             write_offset_(0),
+                             mapped_(NULL) {
+  for (unsigned int i = 0; i < kUniformRingFrames; ++i) {
+    fences_[i] = 0;
+  }
+}
+
+bool UniformRing::Init(GLsizeiptr frame_size) {
+  Destroy();
+
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offset_alignment_);
+  if (offset_alignment_ < 1) {
+    offset_alignment_ = 1;
+  }
+
+  // Each region starts on an aligned offset so it can be bound directly
+  frame_size_ = AlignUp(frame_size, offset_alignment_);
+  GLsizeiptr buffer_size = frame_size_ * kUniformRingFrames;
+
+  glGenBuffers(1, &buffer_id_);
+  glBindBuffer(GL_UNIFORM_BUFFER, buffer_id_);
+
+#ifdef GL_MAP_PERSISTENT_BIT
+  // glBufferStorage is core in 4.4 and otherwise needs ARB_buffer_storage
+  if (HasGLVersion(4, 4) || HasGLExtension("GL_ARB_buffer_storage")) {
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT |
+                             GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_UNIFORM_BUFFER, buffer_size, NULL, flags);
+    mapped_ = static_cast<uint8_t*>(
+        glMapBufferRange(GL_UNIFORM_BUFFER, 0, buffer_size, flags));
+  }
+#endif
+
+  if (mapped_ == NULL) {
+    glBufferData(GL_UNIFORM_BUFFER, buffer_size, NULL, GL_STREAM_DRAW);
+  }
+
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+  frame_index_ = 0;
+  write_offset_ = 0;
+
+  return true;
+}
+
+void UniformRing::Destroy() {
+  for (unsigned int i = 0; i < kUniformRingFrames; ++i) {
+    if (fences_[i] != 0) {
+      glDeleteSync(fences_[i]);
+      fences_[i] = 0;
+    }
+  }
+
+  if (buffer_id_ != 0) {
+    if (mapped_ != NULL) {
+      glBindBuffer(GL_UNIFORM_BUFFER, buffer_id_);
+      glUnmapBuffer(GL_UNIFORM_BUFFER);
+      glBindBuffer(GL_UNIFORM_BUFFER, 0);
+      mapped_ = NULL;
+    }
+    glDeleteBuffers(1, &buffer_id_);
+    buffer_id_ = 0;
+  }
+}
+
+void UniformRing::BeginFrame() {
+  write_offset_ = 0;
+
+  GLsync& fence = fences_[frame_index_];
+  if (fence == 0) {
+    return;
+  }
+
+  GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                   kFenceTimeoutNs);
+  if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED) {
+    std::cerr << "Uniform ring fence was not signaled" << std::endl;
+  }
+
+  glDeleteSync(fence);
+  fence = 0;
+}
+
+bool UniformRing::Push(GLuint binding, const void* data, GLsizeiptr size) {
+  if (write_offset_ + size > frame_size_) {
+    std::cerr << "Uniform ring frame is full" << std::endl;
+    return false;
+  }
+
+  GLintptr offset = frame_size_ * frame_index_ + write_offset_;
+
+  if (mapped_ != NULL) {
+    std::memcpy(mapped_ + offset, data, size);
+  } else {
+    // The fence waited on in BeginFrame guarantees the GPU is done with
+    // this range, so the driver does not need to synchronize
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer_id_);
+    void* ptr = glMapBufferRange(GL_UNIFORM_BUFFER, offset, size,
+                                 GL_MAP_WRITE_BIT |
+                                 GL_MAP_INVALIDATE_RANGE_BIT |
+                                 GL_MAP_UNSYNCHRONIZED_BIT);
+    if (ptr != NULL) {
+      std::memcpy(ptr, data, size);
+      glUnmapBuffer(GL_UNIFORM_BUFFER);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    if (ptr == NULL) {
+      std::cerr << "Could not map uniform ring" << std::endl;
+      return false;
+    }
+  }
+
+  glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer_id_, offset, size);
+
+  write_offset_ += AlignUp(size, offset_alignment_);
+  return true;
+}
+
+void UniformRing::EndFrame() {
+  fences_[frame_index_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  frame_index_ = (frame_index_ + 1) % kUniformRingFrames;
+}
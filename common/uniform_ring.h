@@ -0,0 +1,62 @@
+#ifndef UNIFORM_RING_H_
+#define UNIFORM_RING_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "opengl.h"
+
+// Number of frames the CPU may run ahead of the GPU
+const unsigned int kUniformRingFrames = 3;
+
+// Uniform buffer split into one region per frame in flight. Each frame
+// writes its uniform blocks into its own region, after waiting on the fence
+// of the frame that used the region last, and binds them with
+// glBindBufferRange. Updating a block costs a memcpy and a bind.
+//
+// Where buffer storage is available (GL 4.4 or ARB_buffer_storage) the
+// buffer is mapped persistently once. Otherwise each push maps its range
+// with GL_MAP_UNSYNCHRONIZED_BIT, which the fences make safe.
+//
+// Destroy() must be called explicitly while the GL context is alive.
+class UniformRing {
+ public:
+  UniformRing();
+
+  UniformRing(const UniformRing&) = delete;
+  UniformRing& operator=(const UniformRing&) = delete;
+
+  // frame_size is the total size of the blocks pushed in one frame
+  bool Init(GLsizeiptr frame_size);
+  void Destroy();
+
+  // Waits until the GPU has finished with this frame's region
+  void BeginFrame();
+
+  // Copies a uniform block into this frame's region and binds it to the
+  // given uniform block binding point
+  bool Push(GLuint binding, const void* data, GLsizeiptr size);
+
+  template <typename T>
+  bool Push(GLuint binding, const T& block) {
+    return Push(binding, &block, sizeof(T));
+  }
+
+  // Fences this frame's region and moves on to the next one
+  void EndFrame();
+
+  bool persistent() const { return mapped_ != NULL; }
+
+ private:
+  GLuint buffer_id_;
+  GLsizeiptr frame_size_;
+  GLint offset_alignment_;
+
+  unsigned int frame_index_;
+  GLintptr write_offset_; // Within the current region
+
+  GLsync fences_[kUniformRingFrames];
+  uint8_t* mapped_;
+};
+
+#endif
@@ -0,0 +1,115 @@
+#include "vertex_format.h"
+
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/packing.hpp"
+
+#include "model.h"
+
+namespace {
+
+template <typename T>
+void WriteAttrib(PackedVertices* packed, unsigned int i, int offset,
+                 const T& value) {
+  memcpy(&packed->data[i * packed->stride + offset], &value, sizeof(T));
+}
+
+template <typename T>
+T ReadAttrib(const PackedVertices& packed, unsigned int i, int offset) {
+  T value;
+  memcpy(&value, &packed.data[i * packed.stride + offset], sizeof(T));
+  return value;
+}
+
+// Largest finite half float
+const float kHalfMax = 65504.f;
+
+} // namespace
+
+bool PackVertices(const Model& model, unsigned int attribs,
+                  VertexFormat format, PackedVertices* packed) {
+  if (format == kVertexSeparate) {
+    std::cerr << "PackVertices needs a packed vertex format" << std::endl;
+    return false;
+  }
+
+  unsigned int vert_count = model.vert_count;
+  if (vert_count == 0 || model.positions.size() < vert_count) {
+    std::cerr << "Model has no vertices to pack" << std::endl;
+    return false;
+  }
+
+  *packed = PackedVertices();
+  packed->vert_count = vert_count;
+  packed->half_positions = format == kVertexPackedHalf;
+
+  // Every attribute is a multiple of four bytes, so all stay aligned
+  if (attribs & kMeshPositions) {
+    packed->position_offset = packed->stride;
+    packed->stride += packed->half_positions ? 8 : 12;
+  }
+  if ((attribs & kMeshNormals) && model.normals.size() >= vert_count) {
+    packed->normal_offset = packed->stride;
+    packed->stride += 4;
+  }
+  if ((attribs & kMeshTexcoords) && model.texcoords.size() >= vert_count) {
+    for (unsigned int i = 0; i < vert_count; ++i) {
+      glm::vec2 texcoord = glm::abs(model.texcoords[i]);
+      if (!(texcoord.x <= kHalfMax && texcoord.y <= kHalfMax)) {
+        std::cerr << "Texcoord " << i << " is out of the half float range"
+                  << std::endl;
+        return false;
+      }
+    }
+    packed->texcoord_offset = packed->stride;
+    packed->stride += 4;
+  }
+
+  packed->data.resize(packed->stride * vert_count);
+
+  for (unsigned int i = 0; i < vert_count; ++i) {
+    if (packed->position_offset >= 0) {
+      if (packed->half_positions) {
+        WriteAttrib(packed, i, packed->position_offset,
+                    glm::packHalf4x16(glm::vec4(model.positions[i], 1.f)));
+      } else {
+        WriteAttrib(packed, i, packed->position_offset, model.positions[i]);
+      }
+    }
+    if (packed->normal_offset >= 0) {
+      WriteAttrib(packed, i, packed->normal_offset,
+                  glm::packSnorm3x10_1x2(glm::vec4(model.normals[i], 0.f)));
+    }
+    if (packed->texcoord_offset >= 0) {
+      WriteAttrib(packed, i, packed->texcoord_offset,
+                  glm::packHalf2x16(model.texcoords[i]));
+    }
+  }
+
+  return true;
+}
+
+void UnpackVertex(const PackedVertices& packed, unsigned int i,
+                  glm::vec3* position, glm::vec3* normal,
+                  glm::vec2* texcoord) {
+  if (packed.position_offset >= 0) {
+    if (packed.half_positions) {
+      *position = glm::vec3(glm::unpackHalf4x16(
+          ReadAttrib<glm::uint64>(packed, i, packed.position_offset)));
+    } else {
+      *position = ReadAttrib<glm::vec3>(packed, i, packed.position_offset);
+    }
+  }
+  if (packed.normal_offset >= 0) {
+    *normal = glm::vec3(glm::unpackSnorm3x10_1x2(
+        ReadAttrib<glm::uint32>(packed, i, packed.normal_offset)));
+  }
+  if (packed.texcoord_offset >= 0) {
+    *texcoord = glm::unpackHalf2x16(
+        ReadAttrib<glm::uint>(packed, i, packed.texcoord_offset));
+  }
+}
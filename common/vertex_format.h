@@ -0,0 +1,61 @@
+#ifndef VERTEX_FORMAT_H_
+#define VERTEX_FORMAT_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "model.h"
+
+// Which Model attributes to upload
+const unsigned int kMeshPositions = 1 << 0;
+const unsigned int kMeshNormals = 1 << 1;
+const unsigned int kMeshTexcoords = 1 << 2;
+
+// How vertex attributes are laid out in GPU memory
+enum VertexFormat {
+  // One float buffer per attribute, 32 bytes per full vertex
+  kVertexSeparate,
+
+  // One interleaved buffer: float positions, normals as signed normalized
+  // 10:10:10:2 and texcoords as half float pairs. 16 bytes per vertex with
+  // positions and normals, 20 with texcoords as well.
+  kVertexPacked,
+
+  // Same as kVertexPacked but with half float positions: 12 or 16 bytes
+  kVertexPackedHalf
+};
+
+// Interleaved vertex data produced by PackVertices. Offsets of attributes
+// that were not packed are -1.
+struct PackedVertices {
+  std::vector<uint8_t> data;
+  unsigned int vert_count = 0;
+  unsigned int stride = 0;
+
+  bool half_positions = false;
+  int position_offset = -1;
+  int normal_offset = -1;
+  int texcoord_offset = -1;
+};
+
+// Converts the attributes of model selected by attribs into the layout of
+// format, which must be one of the packed formats.
+//  - Half positions are written with glm::packHalf4x16 and w = 1, read as
+//    four GL_HALF_FLOAT components
+//  - Normals are written with glm::packSnorm3x10_1x2, read as
+//    normalized GL_INT_2_10_10_10_REV. GL versions before 4.2 decode these
+//    as (2c + 1) / 1023, which is at most 1/1023 away from c / 511.
+//  - Texcoords are written with glm::packHalf2x16, read as two
+//    GL_HALF_FLOAT components, so tiled texcoords outside [0, 1] are kept.
+//    Fails if a texcoord is beyond the half float range.
+bool PackVertices(const Model& model, unsigned int attribs,
+                  VertexFormat format, PackedVertices* packed);
+
+// Reads vertex i back the way GL 4.2 and later would, for checking the
+// quantization error.
+// Attributes that were not packed are left unchanged.
+void UnpackVertex(const PackedVertices& packed, unsigned int i,
+                  glm::vec3* position, glm::vec3* normal,
+                  glm::vec2* texcoord);
+
+#endif
@@ -0,0 +1,327 @@
+#include "window.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+#include <SDL2/SDL.h>
+
+#include "opengl.h"
+#include "frame_stats.h"
+#include "image.h"
+#include "shader_program.h"
+
+namespace {
+
+void PrintUsage(const char* program_name) {
+  std::cerr << "Usage: " << program_name
+            << " [--headless <frames>] [--warmup <frames>] [--stats <path>]"
+            << " [--frame-out <path>] [--instances <count>] [--compute]"
+            << " [--adaptive-tess] [--barycentric-wireframe] [--tess-cache]"
+            << " [--lod] [--per-pixel-lighting] [--async-load]"
+            << " [--model <path>] [--no-program-cache]" << std::endl;
+}
+
+bool CreateScreenFramebuffer(AppWindow* app_window) {
+  glGenRenderbuffers(1, &app_window->screen_color_rbo_id);
+  glBindRenderbuffer(GL_RENDERBUFFER, app_window->screen_color_rbo_id);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, app_window->width,
+                        app_window->height);
+
+  glGenRenderbuffers(1, &app_window->screen_depth_rbo_id);
+  glBindRenderbuffer(GL_RENDERBUFFER, app_window->screen_depth_rbo_id);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24,
+                        app_window->width, app_window->height);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  glGenFramebuffers(1, &app_window->screen_fbo_id);
+  glBindFramebuffer(GL_FRAMEBUFFER, app_window->screen_fbo_id);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_RENDERBUFFER, app_window->screen_color_rbo_id);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                            GL_RENDERBUFFER, app_window->screen_depth_rbo_id);
+
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    std::cerr << "Offscreen framebuffer is incomplete" << std::endl;
+    return false;
+  }
+
+  // Left bound so that the samples draw into it during setup and rendering
+  return true;
+}
+
+void DestroyScreenFramebuffer(AppWindow* app_window) {
+  glDeleteFramebuffers(1, &app_window->screen_fbo_id);
+  glDeleteRenderbuffers(1, &app_window->screen_color_rbo_id);
+  glDeleteRenderbuffers(1, &app_window->screen_depth_rbo_id);
+
+  app_window->screen_fbo_id = 0;
+  app_window->screen_color_rbo_id = 0;
+  app_window->screen_depth_rbo_id = 0;
+}
+
+// Waits for the first frame to finish and prints the time since the
+// window was created. Returns it in milliseconds.
+double FinishStartup(const AppWindow& app_window) {
+  glFinish();
+  double startup_ms = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - app_window.create_time).count();
+
+  const ProgramStats& stats = GetProgramStats();
+  std::cout << "Startup: " << startup_ms << " ms, " << stats.linked
+            << " programs in " << stats.ms << " ms (" << stats.cache_hits
+            << " from the program cache)" << std::endl;
+  return startup_ms;
+}
+
+void RunHeadlessFrames(AppWindow* app_window,
+                       const std::function<void()>& render_fn) {
+  const AppOptions& options = app_window->options;
+
+  // Vsync would cap the measured frame times at the refresh rate
+  SDL_GL_SetSwapInterval(0);
+
+  // Warmup keeps shader compilation and first use uploads out of the
+  // measurements. Some drivers (llvmpipe among them) also report a bogus
+  // elapsed time if the first timer query is issued before any other work.
+  double startup_ms = 0.0;
+  for (unsigned int i = 0; i < options.warmup_frames; ++i) {
+    glBindFramebuffer(GL_FRAMEBUFFER, app_window->screen_fbo_id);
+    render_fn();
+    glFlush();
+    if (i == 0) {
+      startup_ms = FinishStartup(*app_window);
+    }
+  }
+  if (options.warmup_frames == 0) {
+    // Without warmup, startup ends before the first timed frame
+    startup_ms = FinishStartup(*app_window);
+  }
+  glFinish();
+
+  FrameTimer timer;
+  timer.Init();
+
+  for (unsigned int i = 0; i < options.headless_frames; ++i) {
+    // Keeps the window system responsive, but a hidden window never quits
+    SDL_Event event;
+    while (SDL_PollEvent(&event)) {}
+
+    glBindFramebuffer(GL_FRAMEBUFFER, app_window->screen_fbo_id);
+
+    timer.BeginFrame();
+    render_fn();
+    glFlush();
+    timer.EndFrame();
+  }
+
+  timer.Finish();
+
+  WriteFrameStatsJson(options.stats_path, timer, app_window->width,
+                      app_window->height, startup_ms);
+  timer.Destroy();
+
+  if (!options.frame_out_path.empty()) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, app_window->screen_fbo_id);
+    SaveFramebufferPPM(options.frame_out_path, app_window->width,
+                       app_window->height);
+  }
+}
+
+} // namespace
+
+bool ParseAppOptions(int argc, char* argv[], AppOptions* options) {
+  for (int i = 1; i < argc; ++i) {
+    bool has_value = i + 1 < argc;
+
+    if (std::strcmp(argv[i], "--headless") == 0 && has_value) {
+      int frames = std::atoi(argv[++i]);
+      if (frames <= 0) {
+        std::cerr << "Frame count must be positive" << std::endl;
+        return false;
+      }
+      options->headless = true;
+      options->headless_frames = static_cast<unsigned int>(frames);
+    } else if (std::strcmp(argv[i], "--warmup") == 0 && has_value) {
+      int frames = std::atoi(argv[++i]);
+      if (frames < 0) {
+        std::cerr << "Warmup frame count must not be negative" << std::endl;
+        return false;
+      }
+      options->warmup_frames = static_cast<unsigned int>(frames);
+    } else if (std::strcmp(argv[i], "--stats") == 0 && has_value) {
+      options->stats_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--frame-out") == 0 && has_value) {
+      options->frame_out_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--instances") == 0 && has_value) {
+      int instances = std::atoi(argv[++i]);
+      if (instances <= 0) {
+        std::cerr << "Instance count must be positive" << std::endl;
+        return false;
+      }
+      options->instances = static_cast<unsigned int>(instances);
+    } else if (std::strcmp(argv[i], "--compute") == 0) {
+      options->compute = true;
+    } else if (std::strcmp(argv[i], "--adaptive-tess") == 0) {
+      options->adaptive_tess = true;
+    } else if (std::strcmp(argv[i], "--barycentric-wireframe") == 0) {
+      options->barycentric_wireframe = true;
+    } else if (std::strcmp(argv[i], "--tess-cache") == 0) {
+      options->tess_cache = true;
+    } else if (std::strcmp(argv[i], "--lod") == 0) {
+      options->lod = true;
+    } else if (std::strcmp(argv[i], "--per-pixel-lighting") == 0) {
+      options->per_pixel_lighting = true;
+    } else if (std::strcmp(argv[i], "--async-load") == 0) {
+      options->async_load = true;
+    } else if (std::strcmp(argv[i], "--model") == 0 && has_value) {
+      options->model_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--no-program-cache") == 0) {
+      options->program_cache = false;
+    } else {
+      PrintUsage(argv[0]);
+      return false;
+    }
+  }
+
+  if (options->headless && options->stats_path.empty()) {
+    std::cerr << "--headless needs --stats <path> for the frame times"
+              << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool CreateAppWindow(const std::string& title, unsigned int width,
+                     unsigned int height, int gl_major_version,
+                     int gl_minor_version, AppWindow* app_window) {
+  app_window->create_time = std::chrono::steady_clock::now();
+  SetProgramCacheEnabled(app_window->options.program_cache);
+
+  if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) != 0) {
+    SDL_Log("Failed to initialized SDL: %s", SDL_GetError());
+    return false;
+  }
+
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, gl_major_version);
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, gl_minor_version);
+
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK,
+                      SDL_GL_CONTEXT_PROFILE_CORE);
+
+  Uint32 window_flags = SDL_WINDOW_OPENGL;
+  if (app_window->options.headless) {
+    window_flags |= SDL_WINDOW_HIDDEN;
+  }
+  
+  app_window->window = SDL_CreateWindow(title.c_str(),
+                                        SDL_WINDOWPOS_UNDEFINED,
+                                        SDL_WINDOWPOS_UNDEFINED,
+                                        width,
+                                        height,
+                                        window_flags);
+  if (app_window->window == NULL) {
+    std::cout << "Window could not be created: " << SDL_GetError()
+              << std::endl;
+    SDL_Quit();
+    return false;
+  }
+
+  app_window->gl_context = SDL_GL_CreateContext(app_window->window);
+  
+  if (app_window->gl_context == NULL) {
+    std::cout << "OpenGL context could not be created: " << SDL_GetError()
+              << std::endl;
+    SDL_DestroyWindow(app_window->window);
+    SDL_Quit();
+    return false;
+  }
+
+  app_window->width = width;
+  app_window->height = height;
+
+  std::cout << "OpenGL Version: " << glGetString(GL_VERSION) << std::endl;
+  std::cout << "GLSL Version: " << glGetString(GL_SHADING_LANGUAGE_VERSION)
+            << std::endl;
+
+  if (app_window->options.headless) {
+    std::cout << "Renderer: " << glGetString(GL_RENDERER) << std::endl;
+
+    if (!CreateScreenFramebuffer(app_window)) {
+      DestroyAppWindow(app_window);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void DestroyAppWindow(AppWindow* app_window) {
+  if (app_window->screen_fbo_id != 0) {
+    DestroyScreenFramebuffer(app_window);
+  }
+
+  SDL_GL_DeleteContext(app_window->gl_context);
+  SDL_DestroyWindow(app_window->window);
+  SDL_Quit();
+
+  app_window->gl_context = NULL;
+  app_window->window = NULL;
+}
+
+void RunFrameLoop(AppWindow* app_window,
+                  const std::function<void()>& render_fn) {
+  if (app_window->options.headless) {
+    RunHeadlessFrames(app_window, render_fn);
+    return;
+  }
+
+  bool should_quit = false;
+  bool first_frame = true;
+  
+  while (!should_quit) {
+    SDL_Event event;
+    while (SDL_PollEvent(&event)) {
+      if (event.type == SDL_QUIT) {
+        should_quit = true;
+      }
+    }
+
+    render_fn();
+
+    SDL_GL_SwapWindow(app_window->window);
+
+    if (first_frame) {
+      FinishStartup(*app_window);
+      first_frame = false;
+    }
+  }
+}
+
+bool SaveFramebufferPPM(const std::string& path, unsigned int width,
+                        unsigned int height) {
+  std::vector<unsigned char> pixels(width * height * 3);
+
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+
+  Image image;
+  image.width = width;
+  image.height = height;
+  image.pixels.resize(pixels.size());
+
+  // GL rows start at the bottom of the image but PPM rows start at the top
+  size_t row_size = width * 3;
+  for (unsigned int row = 0; row < height; ++row) {
+    std::copy(pixels.begin() + (height - 1 - row) * row_size,
+              pixels.begin() + (height - row) * row_size,
+              image.pixels.begin() + row * row_size);
+  }
+
+  return SaveImagePPM(path, image);
+}
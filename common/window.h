@@ -0,0 +1,100 @@
+#ifndef WINDOW_H_
+#define WINDOW_H_
+
+#include <string>
+#include <chrono>
+#include <functional>
+
+#include <SDL2/SDL.h>
+
+#include "opengl.h"
+
+// Options read from the command line:
+//   --headless <frames>   renders the given number of frames offscreen and
+//                         reports frame times instead of opening a window
+//   --warmup <frames>     untimed frames rendered before the headless run,
+//                         so that lazy driver setup is not measured
+//   --stats <path>        writes the frame time JSON to path. Required with
+//                         --headless, since the samples log to stdout
+//   --frame-out <path>    saves the last headless frame as a PPM image
+//   --instances <count>   number of copies the instanced samples draw
+//   --compute             runs post-processing passes as compute shaders
+//                         where the context supports them
+//   --adaptive-tess       derives tessellation levels from the projected
+//                         size of each patch instead of fixed levels
+//   --barycentric-wireframe
+//                         draws wireframes from barycentric coordinates in
+//                         the fragment shader instead of a geometry shader
+//   --tess-cache          captures tessellated patches with transform
+//                         feedback once and redraws them on later frames
+//   --lod                 draws the simplest level of detail whose error
+//                         projects to less than a pixel
+//   --per-pixel-lighting  lights each fragment instead of each vertex
+//   --async-load          loads models on worker threads and uploads them
+//                         over several frames while the frame loop runs
+//   --model <path>        OBJ file drawn instead of the teapot
+//   --no-program-cache    compiles every shader instead of loading linked
+//                         programs saved by earlier runs
+struct AppOptions {
+  bool headless = false;
+  unsigned int headless_frames = 0;
+  unsigned int warmup_frames = 10;
+  std::string stats_path;
+  std::string frame_out_path;
+  unsigned int instances = 1;
+  bool compute = false;
+  bool adaptive_tess = false;
+  bool barycentric_wireframe = false;
+  bool tess_cache = false;
+  bool lod = false;
+  bool per_pixel_lighting = false;
+  bool async_load = false;
+  std::string model_path;
+  bool program_cache = true;
+};
+
+struct AppWindow {
+  SDL_Window* window = NULL;
+  SDL_GLContext gl_context = NULL;
+  unsigned int width = 0;
+  unsigned int height = 0;
+
+  AppOptions options;
+
+  // When CreateAppWindow was called, from which startup is measured
+  std::chrono::steady_clock::time_point create_time;
+
+  // Framebuffer that stands in for the screen. This is 0 unless running
+  // headless, in which case it is an offscreen framebuffer of the window size.
+  GLuint screen_fbo_id = 0;
+  GLuint screen_color_rbo_id = 0;
+  GLuint screen_depth_rbo_id = 0;
+};
+
+// Parses the options above. Prints the usage and returns false if the
+// arguments are not recognized.
+bool ParseAppOptions(int argc, char* argv[], AppOptions* options);
+
+// Initializes SDL and creates a window with a core profile GL context of the
+// given version. Prints the GL and GLSL versions on success. Set
+// app_window->options beforehand; when headless, the window is hidden and the
+// offscreen framebuffer is created and bound.
+bool CreateAppWindow(const std::string& title, unsigned int width,
+                     unsigned int height, int gl_major_version,
+                     int gl_minor_version, AppWindow* app_window);
+
+void DestroyAppWindow(AppWindow* app_window);
+
+// Calls render_fn and swaps buffers once per frame until the window is
+// closed. When headless, renders the requested number of frames into the
+// offscreen framebuffer and reports their CPU and GPU times as JSON.
+// Prints the startup time, up to the end of the first frame, and the time
+// spent building shader programs.
+void RunFrameLoop(AppWindow* app_window,
+                  const std::function<void()>& render_fn);
+
+// Saves the color buffer of the currently bound read framebuffer as a PPM
+bool SaveFramebufferPPM(const std::string& path, unsigned int width,
+                        unsigned int height);
+
+#endif
@@ -23,6 +23,9 @@ THE SOFTWARE.
 */
 
 //
+// (local) : Parse floats with a correctly rounded Eisel-Lemire kernel and
+//           face indices without atoi()
+// (local) : Add LoadObjParallel, a multithreaded loader for large files
 // version 1.2.0 : Hardened implementation(#175)
 // version 1.1.1 : Support smoothing groups(#162)
 // version 1.1.0 : Support parsing vertex color(#144)
@@ -356,6 +359,16 @@ bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
              std::istream *inStream, MaterialReader *readMatFn = NULL,
              bool triangulate = true);
 
+/// Loads .obj from a file using multiple threads.
+/// The file is mapped and split into line-aligned chunks that are parsed in
+/// parallel, then merged in file order. Fills 'attrib', 'shapes' and
+/// 'materials' with the same data as LoadObj() does for the same file.
+/// 'num_threads' is optional. 0 uses std::thread::hardware_concurrency().
+bool LoadObjParallel(attrib_t *attrib, std::vector<shape_t> *shapes,
+                     std::vector<material_t> *materials, std::string *err,
+                     const char *filename, const char *mtl_basedir = NULL,
+                     bool triangulate = true, unsigned int num_threads = 0);
+
 /// Loads materials into std::map
 void LoadMtl(std::map<std::string, int> *material_map,
              std::vector<material_t> *materials, std::istream *inStream,
@@ -368,15 +381,28 @@ void LoadMtl(std::map<std::string, int> *material_map,
 #ifdef TINYOBJLOADER_IMPLEMENTATION
 #include <cassert>
 #include <cctype>
+#include <cfloat>
+#include <climits>
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <utility>
 #include <limits>
 
+#include <algorithm>
 #include <fstream>
+#include <iterator>
 #include <sstream>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace tinyobj {
 
@@ -488,13 +514,68 @@ static inline std::string parseString(const char **token) {
   return s;
 }
 
+// Parses an integer as atoi() does, in the "C" locale: leading whitespace,
+// an optional sign and digits, saturated to the range of long and then
+// narrowed to int. Then moves *token to the first character in delims, as
+// strcspn() would.
+static inline int parseIntUntil(const char **token, const char *delims) {
+  const char *p = (*token);
+  while (*p == ' ' || (*p >= '\t' && *p <= '\r')) {
+    p++;
+  }
+  // Whitespace may include a delimiter, so the scan starts over after it
+  const char *scan_begin = p == (*token) ? NULL : (*token);
+
+  bool negative = false;
+  if (*p == '+' || *p == '-') {
+    negative = (*p == '-');
+    p++;
+  }
+
+  // 18 digits cannot overflow, so only longer numbers are checked
+  unsigned long long value = 0;
+  int digits = 0;
+  while (IS_DIGIT(*p) && digits < 18) {
+    value = value * 10 + static_cast<unsigned int>(*p - '0');
+    p++;
+    digits++;
+  }
+  const unsigned long long limit =
+      negative ? static_cast<unsigned long long>(LONG_MAX) + 1 : LONG_MAX;
+  while (IS_DIGIT(*p)) {
+    unsigned int digit = static_cast<unsigned int>(*p - '0');
+    value = value > (limit - digit) / 10 ? limit : value * 10 + digit;
+    p++;
+  }
+  if (value > limit) {
+    value = limit;
+  }
+  long result = negative ? static_cast<long>(0 - value)
+                         : static_cast<long>(value);
+
+  if (scan_begin == NULL) {
+    scan_begin = p;
+    if (strchr(delims, *p) != NULL) {
+      // Includes the terminating NUL
+      (*token) = p;
+      return static_cast<int>(result);
+    }
+  }
+  (*token) = scan_begin + strcspn(scan_begin, delims);
+  return static_cast<int>(result);
+}
+
 static inline int parseInt(const char **token) {
   (*token) += strspn((*token), " \t");
-  int i = atoi((*token));
-  (*token) += strcspn((*token), " \t\r");
-  return i;
+  return parseIntUntil(token, " \t\r");
 }
 
+// tryParseDouble() is only compiled for the double build, which is its one
+// caller. Defining TINYOBJLOADER_KEEP_DOUBLE_PARSER keeps it in the float
+// build too, for comparing the two parsers.
+#if defined(TINYOBJLOADER_USE_DOUBLE) || \
+    defined(TINYOBJLOADER_KEEP_DOUBLE_PARSER)
+
 // Tries to parse a floating point number located at s.
 //
 // s_end should be a location in the string where reading should absolutely
@@ -637,12 +718,454 @@ fail:
   return false;
 }
 
+#endif // TINYOBJLOADER_USE_DOUBLE || TINYOBJLOADER_KEEP_DOUBLE_PARSER
+
+#ifndef TINYOBJLOADER_USE_DOUBLE
+
+// Fast number parsing (local).
+//
+// tryParseFloat() accepts the same syntax as tryParseDouble(), but returns
+// the correctly rounded float, as strtof() does in the "C" locale, rather
+// than rounding an approximate double. The digits are gathered into a
+// 64-bit integer w, eight at a time where the token has eight bytes left
+// (SIMD within a register), and the value is w * 10^q. When w and 10^q are
+// both exact doubles, one double multiply or divide rounds correctly
+// (Clinger's fast path), and so does the float rounded from it unless it
+// lies halfway between two floats. Otherwise the Eisel-Lemire algorithm
+// multiplies w by a 128-bit truncation of 5^q and reads the float from the
+// high bits. Numbers with more than 19 significant digits, and the rare
+// products too close to a rounding boundary to decide, are passed to
+// strtof(). See Lemire, "Number Parsing at a Gigabyte per Second" (2021).
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define TINYOBJ_SWAR_DIGITS 0
+#else
+#define TINYOBJ_SWAR_DIGITS 1
+#endif
+
+static const int kFloatMantissaBits = 23;
+static const int kFloatMinExponent = -127;
+static const int kFloatInfinitePower = 0xFF;
+
+// Any w * 10^q below this q rounds to zero, and above the largest to
+// infinity
+static const int kFloatSmallestPowerOfTen = -65;
+static const int kFloatLargestPowerOfTen = 38;
+
+// Only for these q can w * 10^q fall exactly halfway between two floats
+static const int kFloatMinRoundToEven = -17;
+static const int kFloatMaxRoundToEven = 10;
+
+// Most significant digits that fit in a uint64_t
+static const int kMaxExactDigits = 19;
+
+// 5^q for q in [kFloatSmallestPowerOfTen, kFloatLargestPowerOfTen],
+// normalized so that the top bit is set and truncated to 128 bits, as
+// high and low 64-bit words
+static const uint64_t kPowersOfFive128[] = {
+    0x86ccbb52ea94baeaull, 0x98e947129fc2b4e9ull,  // 5^-65
+    0xa87fea27a539e9a5ull, 0x3f2398d747b36224ull,  // 5^-64
+    0xd29fe4b18e88640eull, 0x8eec7f0d19a03aadull,  // 5^-63
+    0x83a3eeeef9153e89ull, 0x1953cf68300424acull,  // 5^-62
+    0xa48ceaaab75a8e2bull, 0x5fa8c3423c052dd7ull,  // 5^-61
+    0xcdb02555653131b6ull, 0x3792f412cb06794dull,  // 5^-60
+    0x808e17555f3ebf11ull, 0xe2bbd88bbee40bd0ull,  // 5^-59
+    0xa0b19d2ab70e6ed6ull, 0x5b6aceaeae9d0ec4ull,  // 5^-58
+    0xc8de047564d20a8bull, 0xf245825a5a445275ull,  // 5^-57
+    0xfb158592be068d2eull, 0xeed6e2f0f0d56712ull,  // 5^-56
+    0x9ced737bb6c4183dull, 0x55464dd69685606bull,  // 5^-55
+    0xc428d05aa4751e4cull, 0xaa97e14c3c26b886ull,  // 5^-54
+    0xf53304714d9265dfull, 0xd53dd99f4b3066a8ull,  // 5^-53
+    0x993fe2c6d07b7fabull, 0xe546a8038efe4029ull,  // 5^-52
+    0xbf8fdb78849a5f96ull, 0xde98520472bdd033ull,  // 5^-51
+    0xef73d256a5c0f77cull, 0x963e66858f6d4440ull,  // 5^-50
+    0x95a8637627989aadull, 0xdde7001379a44aa8ull,  // 5^-49
+    0xbb127c53b17ec159ull, 0x5560c018580d5d52ull,  // 5^-48
+    0xe9d71b689dde71afull, 0xaab8f01e6e10b4a6ull,  // 5^-47
+    0x9226712162ab070dull, 0xcab3961304ca70e8ull,  // 5^-46
+    0xb6b00d69bb55c8d1ull, 0x3d607b97c5fd0d22ull,  // 5^-45
+    0xe45c10c42a2b3b05ull, 0x8cb89a7db77c506aull,  // 5^-44
+    0x8eb98a7a9a5b04e3ull, 0x77f3608e92adb242ull,  // 5^-43
+    0xb267ed1940f1c61cull, 0x55f038b237591ed3ull,  // 5^-42
+    0xdf01e85f912e37a3ull, 0x6b6c46dec52f6688ull,  // 5^-41
+    0x8b61313bbabce2c6ull, 0x2323ac4b3b3da015ull,  // 5^-40
+    0xae397d8aa96c1b77ull, 0xabec975e0a0d081aull,  // 5^-39
+    0xd9c7dced53c72255ull, 0x96e7bd358c904a21ull,  // 5^-38
+    0x881cea14545c7575ull, 0x7e50d64177da2e54ull,  // 5^-37
+    0xaa242499697392d2ull, 0xdde50bd1d5d0b9e9ull,  // 5^-36
+    0xd4ad2dbfc3d07787ull, 0x955e4ec64b44e864ull,  // 5^-35
+    0x84ec3c97da624ab4ull, 0xbd5af13bef0b113eull,  // 5^-34
+    0xa6274bbdd0fadd61ull, 0xecb1ad8aeacdd58eull,  // 5^-33
+    0xcfb11ead453994baull, 0x67de18eda5814af2ull,  // 5^-32
+    0x81ceb32c4b43fcf4ull, 0x80eacf948770ced7ull,  // 5^-31
+    0xa2425ff75e14fc31ull, 0xa1258379a94d028dull,  // 5^-30
+    0xcad2f7f5359a3b3eull, 0x096ee45813a04330ull,  // 5^-29
+    0xfd87b5f28300ca0dull, 0x8bca9d6e188853fcull,  // 5^-28
+    0x9e74d1b791e07e48ull, 0x775ea264cf55347eull,  // 5^-27
+    0xc612062576589ddaull, 0x95364afe032a819eull,  // 5^-26
+    0xf79687aed3eec551ull, 0x3a83ddbd83f52205ull,  // 5^-25
+    0x9abe14cd44753b52ull, 0xc4926a9672793543ull,  // 5^-24
+    0xc16d9a0095928a27ull, 0x75b7053c0f178294ull,  // 5^-23
+    0xf1c90080baf72cb1ull, 0x5324c68b12dd6339ull,  // 5^-22
+    0x971da05074da7beeull, 0xd3f6fc16ebca5e04ull,  // 5^-21
+    0xbce5086492111aeaull, 0x88f4bb1ca6bcf585ull,  // 5^-20
+    0xec1e4a7db69561a5ull, 0x2b31e9e3d06c32e6ull,  // 5^-19
+    0x9392ee8e921d5d07ull, 0x3aff322e62439fd0ull,  // 5^-18
+    0xb877aa3236a4b449ull, 0x09befeb9fad487c3ull,  // 5^-17
+    0xe69594bec44de15bull, 0x4c2ebe687989a9b4ull,  // 5^-16
+    0x901d7cf73ab0acd9ull, 0x0f9d37014bf60a11ull,  // 5^-15
+    0xb424dc35095cd80full, 0x538484c19ef38c95ull,  // 5^-14
+    0xe12e13424bb40e13ull, 0x2865a5f206b06fbaull,  // 5^-13
+    0x8cbccc096f5088cbull, 0xf93f87b7442e45d4ull,  // 5^-12
+    0xafebff0bcb24aafeull, 0xf78f69a51539d749ull,  // 5^-11
+    0xdbe6fecebdedd5beull, 0xb573440e5a884d1cull,  // 5^-10
+    0x89705f4136b4a597ull, 0x31680a88f8953031ull,  // 5^-9
+    0xabcc77118461cefcull, 0xfdc20d2b36ba7c3eull,  // 5^-8
+    0xd6bf94d5e57a42bcull, 0x3d32907604691b4dull,  // 5^-7
+    0x8637bd05af6c69b5ull, 0xa63f9a49c2c1b110ull,  // 5^-6
+    0xa7c5ac471b478423ull, 0x0fcf80dc33721d54ull,  // 5^-5
+    0xd1b71758e219652bull, 0xd3c36113404ea4a9ull,  // 5^-4
+    0x83126e978d4fdf3bull, 0x645a1cac083126eaull,  // 5^-3
+    0xa3d70a3d70a3d70aull, 0x3d70a3d70a3d70a4ull,  // 5^-2
+    0xccccccccccccccccull, 0xcccccccccccccccdull,  // 5^-1
+    0x8000000000000000ull, 0x0000000000000000ull,  // 5^0
+    0xa000000000000000ull, 0x0000000000000000ull,  // 5^1
+    0xc800000000000000ull, 0x0000000000000000ull,  // 5^2
+    0xfa00000000000000ull, 0x0000000000000000ull,  // 5^3
+    0x9c40000000000000ull, 0x0000000000000000ull,  // 5^4
+    0xc350000000000000ull, 0x0000000000000000ull,  // 5^5
+    0xf424000000000000ull, 0x0000000000000000ull,  // 5^6
+    0x9896800000000000ull, 0x0000000000000000ull,  // 5^7
+    0xbebc200000000000ull, 0x0000000000000000ull,  // 5^8
+    0xee6b280000000000ull, 0x0000000000000000ull,  // 5^9
+    0x9502f90000000000ull, 0x0000000000000000ull,  // 5^10
+    0xba43b74000000000ull, 0x0000000000000000ull,  // 5^11
+    0xe8d4a51000000000ull, 0x0000000000000000ull,  // 5^12
+    0x9184e72a00000000ull, 0x0000000000000000ull,  // 5^13
+    0xb5e620f480000000ull, 0x0000000000000000ull,  // 5^14
+    0xe35fa931a0000000ull, 0x0000000000000000ull,  // 5^15
+    0x8e1bc9bf04000000ull, 0x0000000000000000ull,  // 5^16
+    0xb1a2bc2ec5000000ull, 0x0000000000000000ull,  // 5^17
+    0xde0b6b3a76400000ull, 0x0000000000000000ull,  // 5^18
+    0x8ac7230489e80000ull, 0x0000000000000000ull,  // 5^19
+    0xad78ebc5ac620000ull, 0x0000000000000000ull,  // 5^20
+    0xd8d726b7177a8000ull, 0x0000000000000000ull,  // 5^21
+    0x878678326eac9000ull, 0x0000000000000000ull,  // 5^22
+    0xa968163f0a57b400ull, 0x0000000000000000ull,  // 5^23
+    0xd3c21bcecceda100ull, 0x0000000000000000ull,  // 5^24
+    0x84595161401484a0ull, 0x0000000000000000ull,  // 5^25
+    0xa56fa5b99019a5c8ull, 0x0000000000000000ull,  // 5^26
+    0xcecb8f27f4200f3aull, 0x0000000000000000ull,  // 5^27
+    0x813f3978f8940984ull, 0x4000000000000000ull,  // 5^28
+    0xa18f07d736b90be5ull, 0x5000000000000000ull,  // 5^29
+    0xc9f2c9cd04674edeull, 0xa400000000000000ull,  // 5^30
+    0xfc6f7c4045812296ull, 0x4d00000000000000ull,  // 5^31
+    0x9dc5ada82b70b59dull, 0xf020000000000000ull,  // 5^32
+    0xc5371912364ce305ull, 0x6c28000000000000ull,  // 5^33
+    0xf684df56c3e01bc6ull, 0xc732000000000000ull,  // 5^34
+    0x9a130b963a6c115cull, 0x3c7f400000000000ull,  // 5^35
+    0xc097ce7bc90715b3ull, 0x4b9f100000000000ull,  // 5^36
+    0xf0bdc21abb48db20ull, 0x1e86d40000000000ull,  // 5^37
+    0x96769950b50d88f4ull, 0x1314448000000000ull,  // 5^38
+};
+
+// Exact doubles for Clinger's fast path
+static const double kDoublePowersOfTen[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// The double mantissa bits a float drops, and their value at a midpoint
+static const uint64_t kFloatRoundingMask = (uint64_t(1) << 29) - 1;
+static const uint64_t kFloatHalfway = uint64_t(1) << 28;
+
+static inline void multiply64(uint64_t a, uint64_t b, uint64_t *high,
+                              uint64_t *low) {
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+  (*high) = static_cast<uint64_t>(product >> 64);
+  (*low) = static_cast<uint64_t>(product);
+#else
+  uint64_t a_lo = a & 0xffffffffu;
+  uint64_t a_hi = a >> 32;
+  uint64_t b_lo = b & 0xffffffffu;
+  uint64_t b_hi = b >> 32;
+  uint64_t lo_lo = a_lo * b_lo;
+  uint64_t hi_lo = a_hi * b_lo;
+  uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffffu) + a_lo * b_hi;
+  (*high) = a_hi * b_hi + (hi_lo >> 32) + (cross >> 32);
+  (*low) = (cross << 32) | (lo_lo & 0xffffffffu);
+#endif
+}
+
+static inline int countLeadingZeros64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_clzll(x);
+#else
+  int n = 0;
+  while (!(x & (uint64_t(1) << 63))) {
+    x <<= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+#if TINYOBJ_SWAR_DIGITS
+static inline bool isEightDigits(uint64_t val) {
+  return !(((val + 0x4646464646464646ull) | (val - 0x3030303030303030ull)) &
+           0x8080808080808080ull);
+}
+
+// Converts eight ASCII digits, the first in the lowest byte
+static inline uint32_t parseEightDigits(uint64_t val) {
+  const uint64_t mask = 0x000000ff000000ffull;
+  const uint64_t mul1 = 0x000f424000000064ull;  // 100 + (1000000 << 32)
+  const uint64_t mul2 = 0x0000271000000001ull;  // 1 + (10000 << 32)
+  val -= 0x3030303030303030ull;
+  val = (val * 10) + (val >> 8);
+  val = (((val & mask) * mul1) + (((val >> 16) & mask) * mul2)) >> 32;
+  return static_cast<uint32_t>(val);
+}
+#endif
+
+// Appends the digits at p to *w, which wraps if there are more than 19 of
+// them, and returns the first character after them
+static inline const char *parseDigits(const char *p, const char *end,
+                                      uint64_t *w) {
+#if TINYOBJ_SWAR_DIGITS
+  while (end - p >= 8) {
+    uint64_t val;
+    memcpy(&val, p, sizeof(val));
+    if (!isEightDigits(val)) {
+      break;
+    }
+    (*w) = (*w) * 100000000 + parseEightDigits(val);
+    p += 8;
+  }
+#endif
+  while (p != end && IS_DIGIT(*p)) {
+    (*w) = (*w) * 10 + static_cast<unsigned int>(*p - '0');
+    p++;
+  }
+  return p;
+}
+
+// Rounds w * 10^q to the bits of a positive float with the Eisel-Lemire
+// algorithm. Returns false if the truncated power of five cannot decide.
+static bool eiselLemireFloat(uint64_t w, int q, uint32_t *bits) {
+  if (w == 0 || q < kFloatSmallestPowerOfTen) {
+    (*bits) = 0;
+    return true;
+  }
+  if (q > kFloatLargestPowerOfTen) {
+    (*bits) = static_cast<uint32_t>(kFloatInfinitePower)
+              << kFloatMantissaBits;
+    return true;
+  }
+
+  int lz = countLeadingZeros64(w);
+  w <<= lz;
+
+  // The float needs the top mantissa bits + 3 of the product. If those may
+  // be off by a carry from below, the low word of the power adds it.
+  const int index = 2 * (q - kFloatSmallestPowerOfTen);
+  uint64_t high, low;
+  multiply64(w, kPowersOfFive128[index], &high, &low);
+  const uint64_t precision_mask =
+      0xffffffffffffffffull >> (kFloatMantissaBits + 3);
+  if ((high & precision_mask) == precision_mask) {
+    uint64_t second_high, second_low;
+    multiply64(w, kPowersOfFive128[index + 1], &second_high, &second_low);
+    low += second_high;
+    if (second_high > low) {
+      high++;
+    }
+  }
+  // 5^q is exact in 128 bits for q in [-27, 55]
+  if (low == 0xffffffffffffffffull && (q < -27 || q > 55)) {
+    return false;
+  }
+
+  int upper_bit = static_cast<int>(high >> 63);
+  int shift = upper_bit + 64 - kFloatMantissaBits - 3;
+  uint64_t mantissa = high >> shift;
+  // floor(q * log2(10)) + 63
+  int power2 = (((152170 + 65536) * q) >> 16) + 63 + upper_bit - lz -
+               kFloatMinExponent;
+
+  if (power2 <= 0) {
+    // Subnormal, or zero
+    if (-power2 + 1 >= 64) {
+      (*bits) = 0;
+      return true;
+    }
+    mantissa >>= -power2 + 1;
+    mantissa += (mantissa & 1);
+    mantissa >>= 1;
+    power2 = mantissa < (uint64_t(1) << kFloatMantissaBits) ? 0 : 1;
+    (*bits) = (static_cast<uint32_t>(power2) << kFloatMantissaBits) |
+              static_cast<uint32_t>(mantissa);
+    return true;
+  }
+
+  // Exactly halfway between two floats: round to even rather than up
+  if (low <= 1 && q >= kFloatMinRoundToEven && q <= kFloatMaxRoundToEven &&
+      (mantissa & 3) == 1 && (mantissa << shift) == high) {
+    mantissa &= ~uint64_t(1);
+  }
+
+  mantissa += (mantissa & 1);
+  mantissa >>= 1;
+  if (mantissa >= (uint64_t(2) << kFloatMantissaBits)) {
+    mantissa = uint64_t(1) << kFloatMantissaBits;
+    power2++;
+  }
+  mantissa &= ~(uint64_t(1) << kFloatMantissaBits);
+  if (power2 >= kFloatInfinitePower) {
+    power2 = kFloatInfinitePower;
+    mantissa = 0;
+  }
+
+  (*bits) = (static_cast<uint32_t>(power2) << kFloatMantissaBits) |
+            static_cast<uint32_t>(mantissa);
+  return true;
+}
+
+// Parses [s, s_end) with strtof(), for the numbers tryParseFloat() cannot
+// round by itself
+static float parseFloatSlow(const char *s, const char *s_end) {
+  std::string text(s, s_end);
+  return strtof(text.c_str(), NULL);
+}
+
+static bool tryParseFloat(const char *s, const char *s_end, float *result) {
+  if (s >= s_end) {
+    return false;
+  }
+
+  const char *p = s;
+  bool negative = false;
+  if (*p == '+' || *p == '-') {
+    negative = (*p == '-');
+    p++;
+  }
+
+  // At least one integer digit
+  const char *int_begin = p;
+  uint64_t w = 0;
+  p = parseDigits(p, s_end, &w);
+  if (p == int_begin) {
+    return false;
+  }
+  int digit_count = static_cast<int>(p - int_begin);
+
+  int exponent = 0;
+  if (p != s_end && *p == '.') {
+    p++;
+    const char *frac_begin = p;
+    p = parseDigits(p, s_end, &w);
+    exponent = -static_cast<int>(p - frac_begin);
+    digit_count -= exponent;
+  }
+  const char *digits_end = p;
+
+  // The exponent must have at least one digit. Large ones are clamped, as
+  // they give zero or infinity all the same.
+  if (p != s_end && (*p == 'e' || *p == 'E')) {
+    p++;
+    bool exp_negative = false;
+    if (p != s_end && (*p == '+' || *p == '-')) {
+      exp_negative = (*p == '-');
+      p++;
+    }
+    const char *exp_begin = p;
+    int exp_number = 0;
+    while (p != s_end && IS_DIGIT(*p)) {
+      if (exp_number < 0x10000) {
+        exp_number = exp_number * 10 + (*p - '0');
+      }
+      p++;
+    }
+    if (p == exp_begin) {
+      return false;
+    }
+    exponent += exp_negative ? -exp_number : exp_number;
+  }
+
+  if (digit_count > kMaxExactDigits) {
+    // Leading zeros do not count
+    int significant = digit_count;
+    for (const char *z = int_begin; z != digits_end; z++) {
+      if (*z == '0') {
+        significant--;
+      } else if (*z != '.') {
+        break;
+      }
+    }
+    if (significant > kMaxExactDigits) {
+      (*result) = parseFloatSlow(s, p);
+      return true;
+    }
+  }
+
+  float value;
+#if defined(FLT_EVAL_METHOD) && (FLT_EVAL_METHOD == 0)
+  if (w <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+    double exact = static_cast<double>(w);
+    if (exponent < 0) {
+      exact /= kDoublePowersOfTen[-exponent];
+    } else {
+      exact *= kDoublePowersOfTen[exponent];
+    }
+    // Rounding the correctly rounded double again gives the correctly
+    // rounded float, unless the double fell exactly halfway between two
+    // floats. The range of w * 10^q leaves out subnormal floats.
+    uint64_t exact_bits;
+    memcpy(&exact_bits, &exact, sizeof(exact_bits));
+    if ((exact_bits & kFloatRoundingMask) != kFloatHalfway) {
+      value = static_cast<float>(exact);
+      (*result) = negative ? -value : value;
+      return true;
+    }
+  }
+#endif
+
+  uint32_t bits;
+  if (!eiselLemireFloat(w, exponent, &bits)) {
+    (*result) = parseFloatSlow(s, p);
+    return true;
+  }
+  if (negative) {
+    bits |= 0x80000000u;
+  }
+  memcpy(&value, &bits, sizeof(value));
+  (*result) = value;
+  return true;
+}
+
+#endif // TINYOBJLOADER_USE_DOUBLE
+
+// Parses [s, s_end) into a real_t, with tryParseFloat() unless real_t is
+// double
+static inline bool tryParseReal(const char *s, const char *s_end,
+                                real_t *result) {
+#ifdef TINYOBJLOADER_USE_DOUBLE
+  return tryParseDouble(s, s_end, result);
+#else
+  return tryParseFloat(s, s_end, result);
+#endif
+}
+
 static inline real_t parseReal(const char **token, double default_value = 0.0) {
-  (*token) += strspn((*token), " \t");
-  const char *end = (*token) + strcspn((*token), " \t\r");
-  double val = default_value;
-  tryParseDouble((*token), end, &val);
-  real_t f = static_cast<real_t>(val);
+  const char *p = (*token);
+  while (IS_SPACE(*p)) p++;
+  (*token) = p;
+  while (*p != ' ' && *p != '\t' && *p != '\r' && *p != '\0') p++;
+  const char *end = p;
+  real_t f;
+  if (!tryParseReal((*token), end, &f)) {
+    f = static_cast<real_t>(default_value);
+  }
   (*token) = end;
   return f;
 }
@@ -650,12 +1173,7 @@ static inline real_t parseReal(const char **token, double default_value = 0.0) {
 static inline bool parseReal(const char **token, real_t *out) {
   (*token) += strspn((*token), " \t");
   const char *end = (*token) + strcspn((*token), " \t\r");
-  double val;
-  bool ret = tryParseDouble((*token), end, &val);
-  if (ret) {
-    real_t f = static_cast<real_t>(val);
-    (*out) = f;
-  }
+  bool ret = tryParseReal((*token), end, out);
   (*token) = end;
   return ret;
 }
@@ -780,11 +1298,10 @@ static bool parseTriple(const char **token, int vsize, int vnsize, int vtsize,
 
   vertex_index_t vi(-1);
 
-  if (!fixIndex(atoi((*token)), vsize, &(vi.v_idx))) {
+  if (!fixIndex(parseIntUntil(token, "/ \t\r"), vsize, &(vi.v_idx))) {
     return false;
   }
 
-  (*token) += strcspn((*token), "/ \t\r");
   if ((*token)[0] != '/') {
     (*ret) = vi;
     return true;
@@ -794,20 +1311,18 @@ static bool parseTriple(const char **token, int vsize, int vnsize, int vtsize,
   // i//k
   if ((*token)[0] == '/') {
     (*token)++;
-    if (!fixIndex(atoi((*token)), vnsize, &(vi.vn_idx))) {
+    if (!fixIndex(parseIntUntil(token, "/ \t\r"), vnsize, &(vi.vn_idx))) {
       return false;
     }
-    (*token) += strcspn((*token), "/ \t\r");
     (*ret) = vi;
     return true;
   }
 
   // i/j/k or i/j
-  if (!fixIndex(atoi((*token)), vtsize, &(vi.vt_idx))) {
+  if (!fixIndex(parseIntUntil(token, "/ \t\r"), vtsize, &(vi.vt_idx))) {
     return false;
   }
 
-  (*token) += strcspn((*token), "/ \t\r");
   if ((*token)[0] != '/') {
     (*ret) = vi;
     return true;
@@ -815,10 +1330,9 @@ static bool parseTriple(const char **token, int vsize, int vnsize, int vtsize,
 
   // i/j/k
   (*token)++;  // skip '/'
-  if (!fixIndex(atoi((*token)), vnsize, &(vi.vn_idx))) {
+  if (!fixIndex(parseIntUntil(token, "/ \t\r"), vnsize, &(vi.vn_idx))) {
     return false;
   }
-  (*token) += strcspn((*token), "/ \t\r");
 
   (*ret) = vi;
 
@@ -829,8 +1343,7 @@ static bool parseTriple(const char **token, int vsize, int vnsize, int vtsize,
 static vertex_index_t parseRawTriple(const char **token) {
   vertex_index_t vi(static_cast<int>(0));  // 0 is an invalid index in OBJ
 
-  vi.v_idx = atoi((*token));
-  (*token) += strcspn((*token), "/ \t\r");
+  vi.v_idx = parseIntUntil(token, "/ \t\r");
   if ((*token)[0] != '/') {
     return vi;
   }
@@ -839,22 +1352,19 @@ static vertex_index_t parseRawTriple(const char **token) {
   // i//k
   if ((*token)[0] == '/') {
     (*token)++;
-    vi.vn_idx = atoi((*token));
-    (*token) += strcspn((*token), "/ \t\r");
+    vi.vn_idx = parseIntUntil(token, "/ \t\r");
     return vi;
   }
 
   // i/j/k or i/j
-  vi.vt_idx = atoi((*token));
-  (*token) += strcspn((*token), "/ \t\r");
+  vi.vt_idx = parseIntUntil(token, "/ \t\r");
   if ((*token)[0] != '/') {
     return vi;
   }
 
   // i/j/k
   (*token)++;  // skip '/'
-  vi.vn_idx = atoi((*token));
-  (*token) += strcspn((*token), "/ \t\r");
+  vi.vn_idx = parseIntUntil(token, "/ \t\r");
   return vi;
 }
 
@@ -1753,6 +2263,268 @@ bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
                  trianglulate);
 }
 
+// Parser state for the statements that decide how faces are grouped into
+// shapes (usemtl, mtllib, g, o, t, s). Shared by LoadObj and LoadObjParallel
+// so that both produce the same shapes.
+struct obj_group_state {
+  std::vector<tag_t> tags;
+  std::vector<face_t> faceGroup;
+  std::string name;
+
+  // material
+  std::map<std::string, int> material_map;
+  int material;
+
+  // smoothing group id
+  unsigned int current_smoothing_id;  // 0 means no smoothing.
+
+  shape_t shape;
+
+  obj_group_state() : material(-1), current_smoothing_id(0) {}
+};
+
+// Handles one grouping statement. `token` points at the first non-space
+// character of the line. `v` holds the vertices parsed so far and is used
+// for triangulation. Returns false if the line is not a grouping statement.
+static bool parseGroupStatement(const char *token, obj_group_state *st,
+                                const std::vector<real_t> &v,
+                                std::vector<shape_t> *shapes,
+                                std::vector<material_t> *materials,
+                                MaterialReader *readMatFn, bool triangulate,
+                                std::string *err) {
+  // use mtl
+  if ((0 == strncmp(token, "usemtl", 6)) && IS_SPACE((token[6]))) {
+    token += 7;
+    std::stringstream ss;
+    ss << token;
+    std::string namebuf = ss.str();
+
+    int newMaterialId = -1;
+    if (st->material_map.find(namebuf) != st->material_map.end()) {
+      newMaterialId = st->material_map[namebuf];
+    } else {
+      // { error!! material not found }
+    }
+
+    if (newMaterialId != st->material) {
+      // Create per-face material. Thus we don't add `shape` to `shapes` at
+      // this time.
+      // just clear `faceGroup` after `exportFaceGroupToShape()` call.
+      exportFaceGroupToShape(&st->shape, st->faceGroup, st->tags,
+                             st->material, st->name, triangulate, v);
+      st->faceGroup.clear();
+      st->material = newMaterialId;
+    }
+
+    return true;
+  }
+
+  // load mtl
+  if ((0 == strncmp(token, "mtllib", 6)) && IS_SPACE((token[6]))) {
+    if (readMatFn) {
+      token += 7;
+
+      std::vector<std::string> filenames;
+      SplitString(std::string(token), ' ', filenames);
+
+      if (filenames.empty()) {
+        if (err) {
+          (*err) +=
+              "WARN: Looks like empty filename for mtllib. Use default "
+              "material. \n";
+        }
+      } else {
+        bool found = false;
+        for (size_t s = 0; s < filenames.size(); s++) {
+          std::string err_mtl;
+          bool ok = (*readMatFn)(filenames[s].c_str(), materials,
+                                 &st->material_map, &err_mtl);
+          if (err && (!err_mtl.empty())) {
+            (*err) += err_mtl;  // This should be warn message.
+          }
+
+          if (ok) {
+            found = true;
+            break;
+          }
+        }
+
+        if (!found) {
+          if (err) {
+            (*err) +=
+                "WARN: Failed to load material file(s). Use default "
+                "material.\n";
+          }
+        }
+      }
+    }
+
+    return true;
+  }
+
+  // group name
+  if (token[0] == 'g' && IS_SPACE((token[1]))) {
+    // flush previous face group.
+    bool ret = exportFaceGroupToShape(&st->shape, st->faceGroup, st->tags,
+                                      st->material, st->name, triangulate, v);
+    (void)ret;  // return value not used.
+
+    if (st->shape.mesh.indices.size() > 0) {
+      shapes->push_back(st->shape);
+    }
+
+    st->shape = shape_t();
+
+    // material = -1;
+    st->faceGroup.clear();
+
+    std::vector<std::string> names;
+    names.reserve(2);
+
+    while (!IS_NEW_LINE(token[0])) {
+      std::string str = parseString(&token);
+      names.push_back(str);
+      token += strspn(token, " \t\r");  // skip tag
+    }
+
+    assert(names.size() > 0);
+
+    // names[0] must be 'g', so skip the 0th element.
+    if (names.size() > 1) {
+      st->name = names[1];
+    } else {
+      st->name = "";
+    }
+
+    return true;
+  }
+
+  // object name
+  if (token[0] == 'o' && IS_SPACE((token[1]))) {
+    // flush previous face group.
+    bool ret = exportFaceGroupToShape(&st->shape, st->faceGroup, st->tags,
+                                      st->material, st->name, triangulate, v);
+    if (ret) {
+      shapes->push_back(st->shape);
+    }
+
+    // material = -1;
+    st->faceGroup.clear();
+    st->shape = shape_t();
+
+    // @todo { multiple object name? }
+    token += 2;
+    std::stringstream ss;
+    ss << token;
+    st->name = ss.str();
+
+    return true;
+  }
+
+  if (token[0] == 't' && IS_SPACE(token[1])) {
+    const int max_tag_nums = 8192; // FIXME(syoyo): Parameterize.
+    tag_t tag;
+
+    token += 2;
+
+    tag.name = parseString(&token);
+
+    tag_sizes ts = parseTagTriple(&token);
+
+    if (ts.num_ints < 0) {
+      ts.num_ints = 0;
+    }
+    if (ts.num_ints > max_tag_nums) {
+      ts.num_ints = max_tag_nums;
+    }
+
+    if (ts.num_reals < 0) {
+      ts.num_reals = 0;
+    }
+    if (ts.num_reals > max_tag_nums) {
+      ts.num_reals = max_tag_nums;
+    }
+
+    if (ts.num_strings < 0) {
+      ts.num_strings = 0;
+    }
+    if (ts.num_strings > max_tag_nums) {
+      ts.num_strings = max_tag_nums;
+    }
+
+    tag.intValues.resize(static_cast<size_t>(ts.num_ints));
+
+    for (size_t i = 0; i < static_cast<size_t>(ts.num_ints); ++i) {
+      tag.intValues[i] = parseInt(&token);
+    }
+
+    tag.floatValues.resize(static_cast<size_t>(ts.num_reals));
+    for (size_t i = 0; i < static_cast<size_t>(ts.num_reals); ++i) {
+      tag.floatValues[i] = parseReal(&token);
+    }
+
+    tag.stringValues.resize(static_cast<size_t>(ts.num_strings));
+    for (size_t i = 0; i < static_cast<size_t>(ts.num_strings); ++i) {
+      tag.stringValues[i] = parseString(&token);
+    }
+
+    st->tags.push_back(tag);
+
+    return true;
+  }
+
+  if (token[0] == 's' && IS_SPACE(token[1])) {
+    // smoothing group id
+    token += 2;
+
+    // skip space.
+    token += strspn(token, " \t");  // skip space
+
+    if (token[0] == '\0') {
+      return true;
+    }
+
+    if (token[0] == '\r' || token[1] == '\n') {
+      return true;
+    }
+
+    if (strlen(token) >= 3) {
+      if (token[0] == 'o' && token[1] == 'f' && token[2] == 'f') {
+        st->current_smoothing_id = 0;
+      }
+    } else {
+      // assume number
+      int smGroupId = parseInt(&token);
+      if (smGroupId < 0) {
+        // parse error. force set to 0.
+        // FIXME(syoyo): Report warning.
+        st->current_smoothing_id = 0;
+      } else {
+        st->current_smoothing_id = static_cast<unsigned int>(smGroupId);
+      }
+    }
+
+    return true;
+  }  // smoothing group id
+
+  return false;
+}
+
+// Flushes the last face group once the whole file has been parsed.
+static void finishGroupState(obj_group_state *st, const std::vector<real_t> &v,
+                             std::vector<shape_t> *shapes, bool triangulate) {
+  bool ret = exportFaceGroupToShape(&st->shape, st->faceGroup, st->tags,
+                                    st->material, st->name, triangulate, v);
+  // exportFaceGroupToShape return false when `usemtl` is called in the last
+  // line.
+  // we also add `shape` to `shapes` when `shape.mesh` has already some
+  // faces(indices)
+  if (ret || st->shape.mesh.indices.size()) {
+    shapes->push_back(st->shape);
+  }
+  st->faceGroup.clear();  // for safety
+}
+
 bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
              std::vector<material_t> *materials, std::string *err,
              std::istream *inStream, MaterialReader *readMatFn /*= NULL*/,
@@ -1763,19 +2535,8 @@ bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
   std::vector<real_t> vn;
   std::vector<real_t> vt;
   std::vector<real_t> vc;
-  std::vector<tag_t> tags;
-  std::vector<face_t> faceGroup;
-  std::string name;
 
-  // material
-  std::map<std::string, int> material_map;
-  int material = -1;
-
-  // smoothing group id
-  unsigned int current_smoothing_id =
-      0;  // Initial value. 0 means no smoothing.
-
-  shape_t shape;
+  obj_group_state st;
 
   std::string linebuf;
   while (inStream->peek() != -1) {
@@ -1849,7 +2610,7 @@ bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
 
       face_t face;
 
-      face.smoothing_group_id = current_smoothing_id;
+      face.smoothing_group_id = st.current_smoothing_id;
       face.vertex_indices.reserve(3);
 
       while (!IS_NEW_LINE(token[0])) {
@@ -1869,250 +2630,449 @@ bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
       }
 
       // replace with emplace_back + std::move on C++11
-      faceGroup.push_back(face);
+      st.faceGroup.push_back(face);
 
       continue;
     }
 
-    // use mtl
-    if ((0 == strncmp(token, "usemtl", 6)) && IS_SPACE((token[6]))) {
-      token += 7;
-      std::stringstream ss;
-      ss << token;
-      std::string namebuf = ss.str();
-
-      int newMaterialId = -1;
-      if (material_map.find(namebuf) != material_map.end()) {
-        newMaterialId = material_map[namebuf];
-      } else {
-        // { error!! material not found }
-      }
-
-      if (newMaterialId != material) {
-        // Create per-face material. Thus we don't add `shape` to `shapes` at
-        // this time.
-        // just clear `faceGroup` after `exportFaceGroupToShape()` call.
-        exportFaceGroupToShape(&shape, faceGroup, tags, material, name,
-                               triangulate, v);
-        faceGroup.clear();
-        material = newMaterialId;
-      }
+    parseGroupStatement(token, &st, v, shapes, materials, readMatFn,
+                        triangulate, err);
 
-      continue;
-    }
+    // Ignore unknown command.
+  }
 
-    // load mtl
-    if ((0 == strncmp(token, "mtllib", 6)) && IS_SPACE((token[6]))) {
-      if (readMatFn) {
-        token += 7;
+  finishGroupState(&st, v, shapes, triangulate);
 
-        std::vector<std::string> filenames;
-        SplitString(std::string(token), ' ', filenames);
+  if (err) {
+    (*err) += errss.str();
+  }
 
-        if (filenames.empty()) {
-          if (err) {
-            (*err) +=
-                "WARN: Looks like empty filename for mtllib. Use default "
-                "material. \n";
-          }
-        } else {
-          bool found = false;
-          for (size_t s = 0; s < filenames.size(); s++) {
-            std::string err_mtl;
-            bool ok = (*readMatFn)(filenames[s].c_str(), materials,
-                                   &material_map, &err_mtl);
-            if (err && (!err_mtl.empty())) {
-              (*err) += err_mtl;  // This should be warn message.
-            }
+  attrib->vertices.swap(v);
+  attrib->normals.swap(vn);
+  attrib->texcoords.swap(vt);
+  attrib->colors.swap(vc);
 
-            if (ok) {
-              found = true;
-              break;
-            }
-          }
+  return true;
+}
 
-          if (!found) {
-            if (err) {
-              (*err) +=
-                  "WARN: Failed to load material file(s). Use default "
-                  "material.\n";
-            }
-          }
-        }
-      }
+// Parallel loader.
+//
+// The file is mapped and split into newline-aligned chunks. Each chunk is
+// parsed on its own thread into local attribute arrays, while face indices
+// are kept raw together with the local attribute counts at that face. Every
+// other statement is recorded by its position in the chunk. A sequential
+// merge pass then appends the chunk arrays in file order, resolves relative
+// and negative face indices against the global counts and replays the
+// grouping statements through the same code as LoadObj.
+
+// Marks a missing vt/vn index in a raw triple.
+static const int kAbsentIndex = std::numeric_limits<int>::min();
+
+struct obj_chunk_face_t {
+  size_t first_corner;   // offset into obj_chunk_t::corners (in triples)
+  int num_corners;
+  int v_count;           // local attribute counts when the face was parsed
+  int vn_count;
+  int vt_count;
+};
 
-      continue;
-    }
+struct obj_chunk_stmt_t {
+  size_t face_pos;       // number of chunk faces parsed before the statement
+  size_t v_count;        // number of chunk vertices parsed before it
+  size_t begin;          // statement text in the chunk line store
+  size_t end;
+};
 
-    // group name
-    if (token[0] == 'g' && IS_SPACE((token[1]))) {
-      // flush previous face group.
-      bool ret = exportFaceGroupToShape(&shape, faceGroup, tags, material, name,
-                                        triangulate, v);
-      (void)ret;  // return value not used.
+struct obj_chunk_t {
+  std::vector<real_t> v;
+  std::vector<real_t> vn;
+  std::vector<real_t> vt;
+  std::vector<real_t> vc;
+  std::vector<int> corners;  // raw v/vt/vn triples
+  std::vector<obj_chunk_face_t> faces;
+  std::vector<obj_chunk_stmt_t> stmts;
+  std::vector<char> stmt_text;  // NUL-terminated grouping statements
+};
 
-      if (shape.mesh.indices.size() > 0) {
-        shapes->push_back(shape);
-      }
+// Scans one raw index of a triple the same way parseTriple does.
+static inline int parseRawIndex(const char **token) {
+  return parseIntUntil(token, "/ \t\r");
+}
 
-      shape = shape_t();
+// Parses a face triple without resolving relative indices.
+static void parseDeferredTriple(const char **token, int *raw) {
+  raw[0] = parseRawIndex(token);
+  raw[1] = kAbsentIndex;
+  raw[2] = kAbsentIndex;
 
-      // material = -1;
-      faceGroup.clear();
+  if ((*token)[0] != '/') {
+    return;
+  }
+  (*token)++;
 
-      std::vector<std::string> names;
-      names.reserve(2);
+  // i//k
+  if ((*token)[0] == '/') {
+    (*token)++;
+    raw[2] = parseRawIndex(token);
+    return;
+  }
 
-      while (!IS_NEW_LINE(token[0])) {
-        std::string str = parseString(&token);
-        names.push_back(str);
-        token += strspn(token, " \t\r");  // skip tag
-      }
+  // i/j/k or i/j
+  raw[1] = parseRawIndex(token);
+  if ((*token)[0] != '/') {
+    return;
+  }
 
-      assert(names.size() > 0);
+  // i/j/k
+  (*token)++;  // skip '/'
+  raw[2] = parseRawIndex(token);
+}
 
-      // names[0] must be 'g', so skip the 0th element.
-      if (names.size() > 1) {
-        name = names[1];
+static void parseObjChunk(const char *begin, const char *end,
+                          obj_chunk_t *chunk) {
+  std::vector<char> linebuf;
+
+  const char *p = begin;
+  while (p < end) {
+    // Split lines the same way as safeGetline: '\n', '\r' or "\r\n".
+    const char *line_end = p;
+    while (line_end < end && *line_end != '\n' && *line_end != '\r') {
+      line_end++;
+    }
+    const char *next = line_end;
+    if (next < end) {
+      if (*next == '\r' && next + 1 < end && next[1] == '\n') {
+        next += 2;
       } else {
-        name = "";
+        next += 1;
       }
+    }
 
+    size_t len = static_cast<size_t>(line_end - p);
+    linebuf.resize(len + 1);
+    if (len > 0) {
+      memcpy(&linebuf[0], p, len);
+    }
+    linebuf[len] = '\0';
+    p = next;
+
+    if (len == 0) {
       continue;
     }
 
-    // object name
-    if (token[0] == 'o' && IS_SPACE((token[1]))) {
-      // flush previous face group.
-      bool ret = exportFaceGroupToShape(&shape, faceGroup, tags, material, name,
-                                        triangulate, v);
-      if (ret) {
-        shapes->push_back(shape);
-      }
+    // Skip leading space.
+    const char *token = &linebuf[0];
+    token += strspn(token, " \t");
+
+    if (token[0] == '\0') continue;  // empty line
 
-      // material = -1;
-      faceGroup.clear();
-      shape = shape_t();
+    if (token[0] == '#') continue;  // comment line
 
-      // @todo { multiple object name? }
+    // vertex
+    if (token[0] == 'v' && IS_SPACE((token[1]))) {
       token += 2;
-      std::stringstream ss;
-      ss << token;
-      name = ss.str();
+      real_t x, y, z;
+      real_t r, g, b;
+      parseVertexWithColor(&x, &y, &z, &r, &g, &b, &token);
+      chunk->v.push_back(x);
+      chunk->v.push_back(y);
+      chunk->v.push_back(z);
 
+      chunk->vc.push_back(r);
+      chunk->vc.push_back(g);
+      chunk->vc.push_back(b);
       continue;
     }
 
-    if (token[0] == 't' && IS_SPACE(token[1])) {
-      const int max_tag_nums = 8192; // FIXME(syoyo): Parameterize.
-      tag_t tag;
+    // normal
+    if (token[0] == 'v' && token[1] == 'n' && IS_SPACE((token[2]))) {
+      token += 3;
+      real_t x, y, z;
+      parseReal3(&x, &y, &z, &token);
+      chunk->vn.push_back(x);
+      chunk->vn.push_back(y);
+      chunk->vn.push_back(z);
+      continue;
+    }
+
+    // texcoord
+    if (token[0] == 'v' && token[1] == 't' && IS_SPACE((token[2]))) {
+      token += 3;
+      real_t x, y;
+      parseReal2(&x, &y, &token);
+      chunk->vt.push_back(x);
+      chunk->vt.push_back(y);
+      continue;
+    }
 
+    // face
+    if (token[0] == 'f' && IS_SPACE((token[1]))) {
       token += 2;
+      token += strspn(token, " \t");
 
-      tag.name = parseString(&token);
+      obj_chunk_face_t face;
+      face.first_corner = chunk->corners.size() / 3;
+      face.num_corners = 0;
+      face.v_count = static_cast<int>(chunk->v.size() / 3);
+      face.vn_count = static_cast<int>(chunk->vn.size() / 3);
+      face.vt_count = static_cast<int>(chunk->vt.size() / 2);
 
-      tag_sizes ts = parseTagTriple(&token);
+      while (!IS_NEW_LINE(token[0])) {
+        int raw[3];
+        parseDeferredTriple(&token, raw);
+        chunk->corners.push_back(raw[0]);
+        chunk->corners.push_back(raw[1]);
+        chunk->corners.push_back(raw[2]);
+        face.num_corners++;
 
-      if (ts.num_ints < 0) {
-        ts.num_ints = 0;
-      }
-      if (ts.num_ints > max_tag_nums) {
-        ts.num_ints = max_tag_nums;
+        size_t n = strspn(token, " \t\r");
+        token += n;
       }
 
-      if (ts.num_reals < 0) {
-        ts.num_reals = 0;
-      }
-      if (ts.num_reals > max_tag_nums) {
-        ts.num_reals = max_tag_nums;
-      }
+      chunk->faces.push_back(face);
+      continue;
+    }
 
-      if (ts.num_strings < 0) {
-        ts.num_strings = 0;
-      }
-      if (ts.num_strings > max_tag_nums) {
-        ts.num_strings = max_tag_nums;
-      }
+    // Everything else is replayed in order by the merge pass.
+    obj_chunk_stmt_t stmt;
+    stmt.face_pos = chunk->faces.size();
+    stmt.v_count = chunk->v.size() / 3;
+    stmt.begin = chunk->stmt_text.size();
+    size_t token_len = strlen(token);
+    chunk->stmt_text.insert(chunk->stmt_text.end(), token, token + token_len);
+    chunk->stmt_text.push_back('\0');
+    stmt.end = chunk->stmt_text.size();
+    chunk->stmts.push_back(stmt);
+  }
+}
 
-      tag.intValues.resize(static_cast<size_t>(ts.num_ints));
+// Resolves a raw index against the number of attributes seen so far.
+static inline bool fixDeferredIndex(int raw, int n, int *ret) {
+  if (raw == kAbsentIndex) {
+    (*ret) = -1;
+    return true;
+  }
+  return fixIndex(raw, n, ret);
+}
 
-      for (size_t i = 0; i < static_cast<size_t>(ts.num_ints); ++i) {
-        tag.intValues[i] = parseInt(&token);
+static void splitObjChunks(const char *data, size_t size, size_t num_chunks,
+                           std::vector<size_t> *bounds) {
+  bounds->clear();
+  bounds->push_back(0);
+  for (size_t i = 1; i < num_chunks; i++) {
+    size_t pos = std::max(bounds->back(), size * i / num_chunks);
+    while (pos < size && data[pos] != '\n' && data[pos] != '\r') {
+      pos++;
+    }
+    if (pos < size) {
+      if (data[pos] == '\r' && pos + 1 < size && data[pos + 1] == '\n') {
+        pos += 2;
+      } else {
+        pos += 1;
       }
+    }
+    if (pos > bounds->back() && pos < size) {
+      bounds->push_back(pos);
+    }
+  }
+  bounds->push_back(size);
+}
 
-      tag.floatValues.resize(static_cast<size_t>(ts.num_reals));
-      for (size_t i = 0; i < static_cast<size_t>(ts.num_reals); ++i) {
-        tag.floatValues[i] = parseReal(&token);
+static bool mergeObjChunks(const std::vector<obj_chunk_t> &chunks,
+                           attrib_t *attrib, std::vector<shape_t> *shapes,
+                           std::vector<material_t> *materials,
+                           std::string *err, MaterialReader *readMatFn,
+                           bool triangulate) {
+  size_t total_v = 0, total_vn = 0, total_vt = 0;
+  for (size_t c = 0; c < chunks.size(); c++) {
+    total_v += chunks[c].v.size();
+    total_vn += chunks[c].vn.size();
+    total_vt += chunks[c].vt.size();
+  }
+
+  std::vector<real_t> v;
+  std::vector<real_t> vn;
+  std::vector<real_t> vt;
+  std::vector<real_t> vc;
+  v.reserve(total_v);
+  vn.reserve(total_vn);
+  vt.reserve(total_vt);
+  vc.reserve(total_v);
+
+  obj_group_state st;
+
+  for (size_t c = 0; c < chunks.size(); c++) {
+    const obj_chunk_t &chunk = chunks[c];
+
+    int v_base = static_cast<int>(v.size() / 3);
+    int vn_base = static_cast<int>(vn.size() / 3);
+    int vt_base = static_cast<int>(vt.size() / 2);
+    size_t v_copied = 0;  // chunk vertices already appended to `v`
+
+    size_t si = 0;
+    for (size_t fi = 0; fi <= chunk.faces.size(); fi++) {
+      // Statements that appeared before this face
+      while (si < chunk.stmts.size() && chunk.stmts[si].face_pos == fi) {
+        const obj_chunk_stmt_t &stmt = chunk.stmts[si];
+        // Triangulation only sees the vertices parsed before the statement
+        if (stmt.v_count > v_copied) {
+          v.insert(v.end(), chunk.v.begin() + 3 * v_copied,
+                   chunk.v.begin() + 3 * stmt.v_count);
+          v_copied = stmt.v_count;
+        }
+        parseGroupStatement(&chunk.stmt_text[stmt.begin], &st, v, shapes,
+                            materials, readMatFn, triangulate, err);
+        si++;
       }
 
-      tag.stringValues.resize(static_cast<size_t>(ts.num_strings));
-      for (size_t i = 0; i < static_cast<size_t>(ts.num_strings); ++i) {
-        tag.stringValues[i] = parseString(&token);
+      if (fi == chunk.faces.size()) {
+        break;
       }
 
-      tags.push_back(tag);
+      const obj_chunk_face_t &cf = chunk.faces[fi];
 
-      continue;
+      face_t face;
+      face.smoothing_group_id = st.current_smoothing_id;
+      face.vertex_indices.reserve(3);
+
+      for (int k = 0; k < cf.num_corners; k++) {
+        const int *raw = &chunk.corners[3 * (cf.first_corner + k)];
+        vertex_index_t vi(-1);
+        if (!fixDeferredIndex(raw[0], v_base + cf.v_count, &vi.v_idx) ||
+            !fixDeferredIndex(raw[1], vt_base + cf.vt_count, &vi.vt_idx) ||
+            !fixDeferredIndex(raw[2], vn_base + cf.vn_count, &vi.vn_idx)) {
+          if (err) {
+            (*err) = "Failed parse `f' line(e.g. zero value for face index).\n";
+          }
+          return false;
+        }
+        face.vertex_indices.push_back(vi);
+      }
+
+      st.faceGroup.push_back(face);
     }
 
-    if (token[0] == 's' && IS_SPACE(token[1])) {
-      // smoothing group id
-      token += 2;
+    v.insert(v.end(), chunk.v.begin() + 3 * v_copied, chunk.v.end());
+    vn.insert(vn.end(), chunk.vn.begin(), chunk.vn.end());
+    vt.insert(vt.end(), chunk.vt.begin(), chunk.vt.end());
+    vc.insert(vc.end(), chunk.vc.begin(), chunk.vc.end());
+  }
 
-      // skip space.
-      token += strspn(token, " \t");  // skip space
+  finishGroupState(&st, v, shapes, triangulate);
 
-      if (token[0] == '\0') {
-        continue;
-      }
+  attrib->vertices.swap(v);
+  attrib->normals.swap(vn);
+  attrib->texcoords.swap(vt);
+  attrib->colors.swap(vc);
 
-      if (token[0] == '\r' || token[1] == '\n') {
-        continue;
-      }
+  return true;
+}
 
-      if (strlen(token) >= 3) {
-        if (token[0] == 'o' && token[1] == 'f' && token[2] == 'f') {
-          current_smoothing_id = 0;
-        }
-      } else {
-        // assume number
-        int smGroupId = parseInt(&token);
-        if (smGroupId < 0) {
-          // parse error. force set to 0.
-          // FIXME(syoyo): Report warning.
-          current_smoothing_id = 0;
-        } else {
-          current_smoothing_id = static_cast<unsigned int>(smGroupId);
-        }
+bool LoadObjParallel(attrib_t *attrib, std::vector<shape_t> *shapes,
+                     std::vector<material_t> *materials, std::string *err,
+                     const char *filename, const char *mtl_basedir,
+                     bool triangulate, unsigned int num_threads) {
+  attrib->vertices.clear();
+  attrib->normals.clear();
+  attrib->texcoords.clear();
+  attrib->colors.clear();
+  shapes->clear();
+
+  std::stringstream errss;
+
+#ifndef _WIN32
+  int fd = open(filename, O_RDONLY);
+  struct stat st;
+  bool opened = (fd >= 0) && (fstat(fd, &st) == 0);
+  if (!opened && fd >= 0) {
+    close(fd);
+  }
+#else
+  std::ifstream ifs(filename, std::ios::binary);
+  bool opened = static_cast<bool>(ifs);
+#endif
+  if (!opened) {
+    errss << "Cannot open file [" << filename << "]" << std::endl;
+    if (err) {
+      (*err) = errss.str();
+    }
+    return false;
+  }
+
+  std::string baseDir;
+  if (mtl_basedir) {
+    baseDir = mtl_basedir;
+#ifndef _WIN32
+    const char dirsep = '/';
+#else
+    const char dirsep = '\\';
+#endif
+    if (baseDir[baseDir.length() - 1] != dirsep)
+      baseDir += dirsep;
+  }
+  MaterialFileReader matFileReader(baseDir);
+
+#ifndef _WIN32
+  size_t size = static_cast<size_t>(st.st_size);
+  const char *data = NULL;
+  void *mapping = NULL;
+  if (size > 0) {
+    mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+      close(fd);
+      if (err) {
+        (*err) = "Cannot map file [" + std::string(filename) + "]\n";
       }
+      return false;
+    }
+    data = static_cast<const char *>(mapping);
+  }
+  close(fd);
+#else
+  std::vector<char> contents((std::istreambuf_iterator<char>(ifs)),
+                             std::istreambuf_iterator<char>());
+  size_t size = contents.size();
+  const char *data = size > 0 ? &contents[0] : NULL;
+#endif
 
-      continue;
-    }  // smoothing group id
+  // Small files are not worth the thread start-up cost.
+  const size_t kMinChunkSize = 64 * 1024;
+  if (num_threads == 0) {
+    num_threads = std::thread::hardware_concurrency();
+  }
+  size_t num_chunks = std::min(static_cast<size_t>(std::max(num_threads, 1u)),
+                               size / kMinChunkSize + 1);
 
-    // Ignore unknown command.
+  std::vector<size_t> bounds;
+  splitObjChunks(data, size, num_chunks, &bounds);
+
+  std::vector<obj_chunk_t> chunks(bounds.size() - 1);
+  std::vector<std::thread> workers;
+  for (size_t c = 1; c < chunks.size(); c++) {
+    workers.push_back(std::thread(parseObjChunk, data + bounds[c],
+                                  data + bounds[c + 1], &chunks[c]));
+  }
+  if (!chunks.empty()) {
+    parseObjChunk(data + bounds[0], data + bounds[1], &chunks[0]);
+  }
+  for (size_t i = 0; i < workers.size(); i++) {
+    workers[i].join();
   }
 
-  bool ret = exportFaceGroupToShape(&shape, faceGroup, tags, material, name,
-                                    triangulate, v);
-  // exportFaceGroupToShape return false when `usemtl` is called in the last
-  // line.
-  // we also add `shape` to `shapes` when `shape.mesh` has already some
-  // faces(indices)
-  if (ret || shape.mesh.indices.size()) {
-    shapes->push_back(shape);
+#ifndef _WIN32
+  if (mapping) {
+    munmap(mapping, size);
   }
-  faceGroup.clear();  // for safety
+#endif
 
-  if (err) {
+  bool ret = mergeObjChunks(chunks, attrib, shapes, materials, err,
+                            &matFileReader, triangulate);
+
+  if (ret && err) {
     (*err) += errss.str();
   }
 
-  attrib->vertices.swap(v);
-  attrib->normals.swap(vn);
-  attrib->texcoords.swap(vt);
-  attrib->colors.swap(vc);
-
-  return true;
+  return ret;
 }
 
 bool LoadObjWithCallback(std::istream &inStream, const callback_t &callback,